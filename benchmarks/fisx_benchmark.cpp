@@ -0,0 +1,510 @@
+/*
+  Benchmark of the fisx physics kernels and of complete XRF calculations.
+
+  Usage:
+      fisx_benchmark [--min-time seconds] [--repetitions n] [--filter text] [--output file] dataDirectory
+
+  dataDirectory has to contain the EPDL97 and EADL97 files needed by the Elements constructor.
+  The results are written in JSON format to the output file or, if not given, to the standard output.
+  The library may print diagnostics to the standard output, use an output file to get clean JSON.
+  The progress is written to the standard error.
+
+  For each benchmark the operation is repeated until at least min-time seconds have elapsed and that
+  measurement is performed repetitions times. The reported latencies are per iteration and the
+  throughput is given in items (energies, evaluations, pixels, ...) per second.
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <stdexcept>
+#include "fisx_xrf.h"
+#include "fisx_math.h"
+#include "fisx_profile.h"
+#include "fisx_version.h"
+
+using namespace fisx;
+
+namespace
+{
+
+// prevent the compiler from discarding the benchmarked calculations
+volatile double sink = 0.0;
+
+struct Context
+{
+    std::string dataDirectory;
+    Elements * elements;
+    std::vector<double> energies;
+    std::map<std::string, std::vector<double> > muMap;
+    XRF singleLayer;
+    XRF multilayer;
+    XRF tube;
+    std::vector<std::string> singleLayerPeaks;
+    std::vector<std::string> multilayerPeaks;
+    std::vector<std::string> tubePeaks;
+};
+
+typedef void (*BenchmarkFunction)(Context &);
+
+struct BenchmarkCase
+{
+    const char * name;
+    BenchmarkFunction function;
+    // items processed per call (energies, evaluations, ...)
+    double items;
+};
+
+struct BenchmarkResult
+{
+    std::string name;
+    long iterations;
+    int repetitions;
+    double items;
+    double latencyMinimum;
+    double latencyMedian;
+    double latencyMaximum;
+};
+
+// Kernels
+
+void benchElementsConstruction(Context & context)
+{
+    Elements elements(context.dataDirectory);
+    sink = sink + elements.getElementNames().size();
+}
+
+void benchMuSingle(Context & context)
+{
+    std::vector<double>::size_type i;
+    double value = 0.0;
+
+    for (i = 0; i < context.energies.size(); i++)
+    {
+        value += context.elements->getMassAttenuationCoefficients("Fe", context.energies[i])["total"];
+    }
+    sink = sink + value;
+}
+
+void benchMuBatchElement(Context & context)
+{
+    context.elements->getMassAttenuationCoefficients(std::string("Pb"), context.energies, context.muMap);
+    sink = sink + context.muMap["total"].back();
+}
+
+void benchMuBatchFormula(Context & context)
+{
+    context.elements->getMassAttenuationCoefficients(std::string("Ca5(PO4)3F"), context.energies, \
+                                                     context.muMap);
+    sink = sink + context.muMap["total"].back();
+}
+
+void benchMuBatchMaterial(Context & context)
+{
+    context.elements->getMassAttenuationCoefficients(std::string("Steel"), context.energies, context.muMap);
+    sink = sink + context.muMap["total"].back();
+}
+
+void benchFormulaParsing(Context & context)
+{
+    sink = sink + context.elements->getCompositionFromFormula("Ca5(PO4)3F").size();
+    sink = sink + context.elements->getCompositionFromFormula("KAl2(AlSi3O10)(OH)2").size();
+    sink = sink + context.elements->getCompositionFromFormula("CuSO4(H2O)5").size();
+    sink = sink + context.elements->getCompositionFromFormula("Pb3O4").size();
+}
+
+void benchExcitationFactors(Context & context)
+{
+    sink = sink + context.elements->getExcitationFactors("Fe", 17.4, 1.0).size();
+    sink = sink + context.elements->getExcitationFactors("Pb", 40.0, 1.0).size();
+}
+
+void benchCascade(Context & context)
+{
+    const Element & element = context.elements->getElement("Pb");
+    std::map<std::string, double> distribution;
+
+    distribution = element.getInitialPhotoelectricVacancyDistribution(40.0);
+    sink = sink + element.getXRayLinesFromVacancyDistribution(distribution, 1, 1).size();
+}
+
+void benchDeBoerL0(Context &)
+{
+    int i;
+    double value = 0.0;
+
+    for (i = 0; i < 1000; i++)
+    {
+        value += Math::deBoerL0(100.0 + i, 50.0, 80.0 + 0.1 * i, 2.5, 0.01);
+    }
+    sink = sink + value;
+}
+
+void benchDeBoerX(Context &)
+{
+    int i;
+    double value = 0.0;
+
+    for (i = 0; i < 1000; i++)
+    {
+        value += Math::deBoerX(100.0 + i, 50.0, 0.02, 0.05, 80.0 + 0.1 * i, 60.0, 0.001);
+    }
+    sink = sink + value;
+}
+
+void benchHypermet(Context &)
+{
+    int i;
+    double value = 0.0;
+
+    for (i = 0; i < 1000; i++)
+    {
+        value += Math::hypermet(5.0 + 0.01 * i, 1000.0, 6.4, 0.15, 0.05, 0.5, 0.01, 5.0, 0.0001);
+    }
+    sink = sink + value;
+}
+
+// Complete calculations
+
+void runMultilayer(XRF & xrf, const std::vector<std::string> & peaks, Elements & elements, \
+                   const int & secondary)
+{
+    sink = sink + xrf.getMultilayerFluorescence(peaks, elements, secondary, 1, 0, 0.0, 1).size();
+}
+
+void benchSingleLayerPrimary(Context & context)
+{
+    runMultilayer(context.singleLayer, context.singleLayerPeaks, *context.elements, 0);
+}
+
+void benchSingleLayerSecondary(Context & context)
+{
+    runMultilayer(context.singleLayer, context.singleLayerPeaks, *context.elements, 1);
+}
+
+void benchSingleLayerTertiary(Context & context)
+{
+    runMultilayer(context.singleLayer, context.singleLayerPeaks, *context.elements, 2);
+}
+
+void benchMultilayerPrimary(Context & context)
+{
+    runMultilayer(context.multilayer, context.multilayerPeaks, *context.elements, 0);
+}
+
+void benchMultilayerSecondary(Context & context)
+{
+    runMultilayer(context.multilayer, context.multilayerPeaks, *context.elements, 1);
+}
+
+void benchMultilayerTertiary(Context & context)
+{
+    runMultilayer(context.multilayer, context.multilayerPeaks, *context.elements, 2);
+}
+
+void benchTubePrimary(Context & context)
+{
+    runMultilayer(context.tube, context.tubePeaks, *context.elements, 0);
+}
+
+void benchTubeSecondary(Context & context)
+{
+    runMultilayer(context.tube, context.tubePeaks, *context.elements, 1);
+}
+
+void benchTubeTertiary(Context & context)
+{
+    runMultilayer(context.tube, context.tubePeaks, *context.elements, 2);
+}
+
+const BenchmarkCase benchmarkCases[] = {
+    {"elements_construction", benchElementsConstruction, 1.0},
+    {"mu_single_energy", benchMuSingle, 1000.0},
+    {"mu_batch_element", benchMuBatchElement, 1000.0},
+    {"mu_batch_formula", benchMuBatchFormula, 1000.0},
+    {"mu_batch_material", benchMuBatchMaterial, 1000.0},
+    {"formula_parsing", benchFormulaParsing, 4.0},
+    {"excitation_factors", benchExcitationFactors, 2.0},
+    {"cascade", benchCascade, 1.0},
+    {"math_deboer_l0", benchDeBoerL0, 1000.0},
+    {"math_deboer_x", benchDeBoerX, 1000.0},
+    {"math_hypermet", benchHypermet, 1000.0},
+    {"single_layer_primary", benchSingleLayerPrimary, 1.0},
+    {"single_layer_secondary", benchSingleLayerSecondary, 1.0},
+    {"single_layer_tertiary", benchSingleLayerTertiary, 1.0},
+    {"multilayer_10_primary", benchMultilayerPrimary, 1.0},
+    {"multilayer_10_secondary", benchMultilayerSecondary, 1.0},
+    {"multilayer_10_tertiary", benchMultilayerTertiary, 1.0},
+    {"tube_beam_primary", benchTubePrimary, 1.0},
+    {"tube_beam_secondary", benchTubeSecondary, 1.0},
+    {"tube_beam_tertiary", benchTubeTertiary, 1.0}
+};
+
+void setupContext(Context & context)
+{
+    std::vector<double>::size_type i;
+    std::map<std::string, double> composition;
+    Material material;
+    std::vector<Layer> layers;
+    std::vector<Layer> attenuators;
+    std::vector<double> weights;
+    double energy;
+
+    context.elements = new Elements(context.dataDirectory);
+
+    // 1000 energies logarithmically spaced between 1 and 100 keV
+    context.energies.resize(1000);
+    for (i = 0; i < context.energies.size(); i++)
+    {
+        context.energies[i] = std::pow(10.0, 2.0 * i / (context.energies.size() - 1.0));
+    }
+
+    composition["Fe"] = 0.70;
+    composition["Cr"] = 0.18;
+    composition["Ni"] = 0.10;
+    composition["Mn"] = 0.02;
+    material = context.elements->createMaterial("Steel", 7.9, 0.1);
+    material.setComposition(composition);
+    context.elements->addMaterial(material);
+
+    Detector detector("Si", 2.33, 0.045);
+    detector.setActiveArea(30.0);
+    detector.setDistance(5.0);
+    attenuators.push_back(Layer("Be", 1.848, 0.0025));
+
+    // single layer, monochromatic beam
+    Layer steel("Steel", 7.9, 0.1);
+    steel.setMaterial(material);
+    context.singleLayer.setBeam(17.4);
+    context.singleLayer.setSample(steel);
+    context.singleLayer.setAttenuators(attenuators);
+    context.singleLayer.setDetector(detector);
+    context.singleLayer.setGeometry(45.0, 45.0);
+    context.singleLayerPeaks.push_back("Fe K");
+    context.singleLayerPeaks.push_back("Cr K");
+    context.singleLayerPeaks.push_back("Ni K");
+    context.singleLayerPeaks.push_back("Mn K");
+
+    // ten layers, monochromatic beam
+    layers.push_back(Layer("CaCO3", 2.7, 0.001));
+    layers.push_back(Layer("Fe2O3", 5.2, 0.0005));
+    layers.push_back(Layer("SiO2", 2.6, 0.002));
+    layers.push_back(Layer("Cu", 8.9, 0.0002));
+    layers.push_back(Layer("TiO2", 4.2, 0.001));
+    layers.push_back(Layer("ZnO", 5.6, 0.0005));
+    layers.push_back(Layer("Al2O3", 3.9, 0.002));
+    layers.push_back(Layer("Pb3O4", 8.3, 0.0002));
+    layers.push_back(Layer("K2SO4", 2.7, 0.001));
+    layers.push_back(Layer("Ni", 8.9, 0.0005));
+    context.multilayer.setBeam(20.0);
+    context.multilayer.setSample(layers);
+    context.multilayer.setAttenuators(attenuators);
+    context.multilayer.setDetector(detector);
+    context.multilayer.setGeometry(45.0, 45.0);
+    context.multilayerPeaks.push_back("Ca K");
+    context.multilayerPeaks.push_back("Fe K");
+    context.multilayerPeaks.push_back("Si K");
+    context.multilayerPeaks.push_back("Cu K");
+    context.multilayerPeaks.push_back("Ti K");
+    context.multilayerPeaks.push_back("Zn K");
+    context.multilayerPeaks.push_back("Pb L");
+    context.multilayerPeaks.push_back("Pb M");
+    context.multilayerPeaks.push_back("S K");
+    context.multilayerPeaks.push_back("Ni K");
+
+    // single layer excited by a bremsstrahlung like spectrum (Kramers' law) between 2 and 40 keV
+    std::vector<double> tubeEnergies;
+    for (i = 0; i < 39; i++)
+    {
+        energy = 2.0 + i;
+        tubeEnergies.push_back(energy);
+        weights.push_back((40.0 - energy) / energy);
+    }
+    weights.back() = 0.01;
+    context.tube.setBeam(tubeEnergies, weights);
+    context.tube.setSample(steel);
+    context.tube.setAttenuators(attenuators);
+    context.tube.setDetector(detector);
+    context.tube.setGeometry(45.0, 45.0);
+    context.tubePeaks = context.singleLayerPeaks;
+}
+
+void runCase(const BenchmarkCase & benchmarkCase, Context & context, const double & minimumTime, \
+             const int & repetitions, BenchmarkResult & result)
+{
+    std::vector<double> latencies;
+    long iterations, i;
+    double start, elapsed;
+    int repetition;
+
+    // warm up and calibrate the number of iterations
+    start = Profile::getWallTime();
+    benchmarkCase.function(context);
+    elapsed = Profile::getWallTime() - start;
+    iterations = 1;
+    if (elapsed < minimumTime)
+    {
+        iterations = (long) (minimumTime / std::max(elapsed, 1.0e-9)) + 1;
+    }
+
+    for (repetition = 0; repetition < repetitions; repetition++)
+    {
+        start = Profile::getWallTime();
+        for (i = 0; i < iterations; i++)
+        {
+            benchmarkCase.function(context);
+        }
+        elapsed = Profile::getWallTime() - start;
+        latencies.push_back(elapsed / iterations);
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    result.name = benchmarkCase.name;
+    result.iterations = iterations;
+    result.repetitions = repetitions;
+    result.items = benchmarkCase.items;
+    result.latencyMinimum = latencies.front();
+    result.latencyMaximum = latencies.back();
+    if (latencies.size() % 2)
+    {
+        result.latencyMedian = latencies[latencies.size() / 2];
+    }
+    else
+    {
+        result.latencyMedian = 0.5 * (latencies[latencies.size() / 2 - 1] + latencies[latencies.size() / 2]);
+    }
+}
+
+void printJSON(FILE * output, const std::vector<BenchmarkResult> & results, const double & minimumTime, \
+               const int & repetitions)
+{
+    std::vector<BenchmarkResult>::size_type i;
+
+    fprintf(output, "{\n");
+    fprintf(output, "  \"library\": \"fisx\",\n");
+    fprintf(output, "  \"version\": \"%s\",\n", fisxVersion().c_str());
+#ifdef _OPENMP
+    fprintf(output, "  \"openmp\": true,\n");
+#else
+    fprintf(output, "  \"openmp\": false,\n");
+#endif
+    fprintf(output, "  \"min_time\": %g,\n", minimumTime);
+    fprintf(output, "  \"repetitions\": %d,\n", repetitions);
+    fprintf(output, "  \"benchmarks\": [\n");
+    for (i = 0; i < results.size(); i++)
+    {
+        fprintf(output, "    {\"name\": \"%s\", \"iterations\": %ld, \"items_per_iteration\": %g, "
+                "\"latency_min\": %.6e, \"latency_median\": %.6e, \"latency_max\": %.6e, "
+                "\"items_per_second\": %.6e}%s\n",
+                results[i].name.c_str(), results[i].iterations, results[i].items,
+                results[i].latencyMinimum, results[i].latencyMedian, results[i].latencyMaximum,
+                results[i].items / results[i].latencyMedian,
+                (i + 1 < results.size()) ? "," : "");
+    }
+    fprintf(output, "  ]\n");
+    fprintf(output, "}\n");
+}
+
+void printUsage(const char * program)
+{
+    fprintf(stderr, "Usage: %s [--min-time seconds] [--repetitions n] [--filter text] [--output file] "
+                    "dataDirectory\n", \
+            program);
+}
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+    Context context;
+    std::vector<BenchmarkResult> results;
+    BenchmarkResult result;
+    std::string filter;
+    std::string outputFileName;
+    FILE * output;
+    double minimumTime = 0.2;
+    int repetitions = 5;
+    int i;
+    size_t iCase, nCases;
+
+    context.elements = NULL;
+    for (i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "--min-time") == 0) && (i + 1 < argc))
+        {
+            minimumTime = atof(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--repetitions") == 0) && (i + 1 < argc))
+        {
+            repetitions = atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--filter") == 0) && (i + 1 < argc))
+        {
+            filter = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--output") == 0) && (i + 1 < argc))
+        {
+            outputFileName = argv[++i];
+        }
+        else if (argv[i][0] == '-')
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+        else
+        {
+            context.dataDirectory = argv[i];
+        }
+    }
+    if ((context.dataDirectory.size() == 0) || (minimumTime <= 0.0) || (repetitions < 1))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try
+    {
+        setupContext(context);
+        nCases = sizeof(benchmarkCases) / sizeof(benchmarkCases[0]);
+        for (iCase = 0; iCase < nCases; iCase++)
+        {
+            if ((filter.size() > 0) && \
+                (std::string(benchmarkCases[iCase].name).find(filter) == std::string::npos))
+            {
+                continue;
+            }
+            fprintf(stderr, "%s ... ", benchmarkCases[iCase].name);
+            fflush(stderr);
+            runCase(benchmarkCases[iCase], context, minimumTime, repetitions, result);
+            fprintf(stderr, "%.3e s\n", result.latencyMedian);
+            results.push_back(result);
+        }
+    }
+    catch (const std::exception & exc)
+    {
+        fprintf(stderr, "\nError: %s\n", exc.what());
+        delete context.elements;
+        return 1;
+    }
+    delete context.elements;
+    output = stdout;
+    if (outputFileName.size() > 0)
+    {
+        output = fopen(outputFileName.c_str(), "w");
+        if (output == NULL)
+        {
+            fprintf(stderr, "Error: cannot open %s\n", outputFileName.c_str());
+            return 1;
+        }
+    }
+    printJSON(output, results, minimumTime, repetitions);
+    if (output != stdout)
+    {
+        fclose(output);
+    }
+    return 0;
+}
@@ -0,0 +1,29 @@
+#import numpy as np
+#cimport numpy as np
+cimport cython
+
+from libcpp.string cimport string as std_string
+from libcpp.vector cimport vector as std_vector
+from libcpp.map cimport map as std_map
+
+from Elements cimport *
+from XRFConfig cimport *
+
+cdef extern from "fisx_compositionengine.h" namespace "fisx":
+    cdef cppclass CompositionEngine:
+        CompositionEngine() except +
+        CompositionEngine(XRFConfig, Elements, std_vector[std_string], std_vector[std_string], \
+                          int, int, int) except +
+        std_vector[std_string] getElementList() except +
+        std_vector[std_string] getElementFamilyList() except +
+        std_vector[double] getRates(std_vector[double]) except +
+        void getRates(const double *, int, double *) except + nogil
+
+cdef extern from "fisx_influencecoefficients.h" namespace "fisx":
+    cdef cppclass InfluenceCoefficients:
+        InfluenceCoefficients()
+
+        std_map[std_string, std_map[std_string, std_map[std_string, double]]] \
+                getLachanceTraill(CompositionEngine, int, int) except +
+        std_map[std_string, std_map[std_string, std_map[std_string, double]]] \
+                getDeJongh(CompositionEngine, std_string, int, int) except +
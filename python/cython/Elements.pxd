@@ -11,9 +11,10 @@ from Material cimport *
 
 cdef extern from "fisx_elements.h" namespace "fisx":
     cdef cppclass Elements:
-        Elements(std_string) except +
-        Elements(std_string, std_string) except +
-        Elements(std_string, std_string, std_string) except +
+        Elements() except + nogil
+        Elements(std_string) except + nogil
+        Elements(std_string, std_string) except + nogil
+        Elements(std_string, std_string, std_string) except + nogil
 
         std_vector[std_string] getElementNames()
 
@@ -40,26 +41,36 @@ cdef extern from "fisx_elements.h" namespace "fisx":
                                             std_vector[double], \
                                             std_vector[double]) except +
 
-        void setMassAttenuationCoefficientsFile(std_string) except +
+        void setMassAttenuationCoefficientsFile(std_string) except + nogil
 
-        std_map[std_string, double] getMassAttenuationCoefficients(std_string, double) except +
+        std_map[std_string, double] getMassAttenuationCoefficients(std_string, double) except + nogil
 
-        std_map[std_string, std_vector[double]] getMassAttenuationCoefficients(std_string) except +
+        std_map[std_string, std_vector[double]] getMassAttenuationCoefficients(std_string) except + nogil
 
         std_map[std_string, std_vector[double]]\
-                            getMassAttenuationCoefficients(std_string, std_vector[double]) except +
+                            getMassAttenuationCoefficients(std_string, std_vector[double]) except + nogil
         
         std_map[std_string, std_vector[double]] getMassAttenuationCoefficients(std_map[std_string, double],\
-                                                                               double) except +
+                                                                               double) except + nogil
 
         std_map[std_string, std_vector[double]]\
                             getMassAttenuationCoefficients(std_map[std_string, double],\
-                                                           std_vector[double]) except +
+                                                           std_vector[double]) except + nogil
+
+        void getMassAttenuationCoefficients(std_string, const double *, int, \
+                                            double *, double *, double *, double *, double *) except + nogil
+
+        void getMassAttenuationCoefficients(std_map[std_string, double], const double *, int, \
+                                            double *, double *, double *, double *, double *) except + nogil
 
         std_vector[std_map[std_string, std_map[std_string, double]]] getExcitationFactors( \
                             std_string element,
                             std_vector[double] energy,
-                            std_vector[double] weights) except +
+                            std_vector[double] weights) except + nogil
+
+        void getExcitationFactors(std_string, const double *, const double *, int, \
+                                  std_map[std_string, std_vector[double]] &, \
+                                  std_map[std_string, double] &) except + nogil
 
         std_vector[std_pair[std_string, double]] getPeakFamilies(std_string, double) except +
 
@@ -68,7 +79,7 @@ cdef extern from "fisx_elements.h" namespace "fisx":
         std_map[std_string, double] getBindingEnergies(std_string) except +
 
         std_map[std_string, std_map [std_string, double]] getEscape(std_map[std_string, double],\
-                                              double, double, double, int, double, double) except +
+                                              double, double, double, int, double, double) except + nogil
 
         std_map[std_string, double] getRadiativeTransitions(std_string, std_string) except +
 
@@ -80,4 +91,12 @@ cdef extern from "fisx_elements.h" namespace "fisx":
 
         void emptyElementCascadeCache(std_string) except +
 
-        void removeMaterials()
\ No newline at end of file
+        void removeMaterials()
+
+        void getSnapshot(std_vector[char] &) except + nogil
+
+        void setSnapshot(const char *, size_t) except + nogil
+
+        void saveSnapshot(std_string) except + nogil
+
+        void loadSnapshot(std_string) except + nogil
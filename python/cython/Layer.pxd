@@ -16,6 +16,11 @@ cdef extern from "fisx_layer.h" namespace "fisx":
 
         std_vector[double] getTransmission(std_vector[double], Elements, double)
 
+        void getTransmission(const double *, int, Elements, double, double *) except + nogil
+
+        void getMassAttenuationCoefficients(const double *, int, Elements, \
+                                            double *, double *, double *, double *, double *) except + nogil
+
         void setMaterial(Material)
 
         std_vector[std_pair[std_string, double]] getPeakFamilies(double, Elements) except +
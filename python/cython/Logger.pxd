@@ -0,0 +1,15 @@
+#import numpy as np
+#cimport numpy as np
+cimport cython
+
+cdef extern from "fisx_logger.h" namespace "fisx":
+    cdef cppclass Logger:
+        Logger()
+
+        void setLevel(int)
+
+        int getLevel()
+
+        int getCompiledLevel()
+
+        void setRateLimit(int, double)
@@ -0,0 +1,19 @@
+#import numpy as np
+#cimport numpy as np
+cimport cython
+
+from libcpp.string cimport string as std_string
+from libcpp.vector cimport vector as std_vector
+from libcpp.map cimport map as std_map
+
+from Elements cimport *
+from XRFConfig cimport *
+
+cdef extern from "fisx_montecarlo.h" namespace "fisx":
+    cdef cppclass MonteCarlo:
+        MonteCarlo() except +
+        void setConfiguration(XRFConfig) except +
+        XRFConfig getConfiguration()
+        std_map[std_string, std_map[int, std_map[std_string, std_map[std_string, double]]]] \
+                getMultilayerFluorescence(std_vector[std_string], Elements, long, unsigned long, \
+                                          int, int, int, int) except + nogil
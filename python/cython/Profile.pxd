@@ -0,0 +1,12 @@
+#import numpy as np
+#cimport numpy as np
+cimport cython
+
+from libcpp.string cimport string as std_string
+from libcpp.map cimport map as std_map
+
+cdef extern from "fisx_profile.h" namespace "fisx":
+    cdef cppclass Profile:
+        Profile() except +
+        void reset()
+        std_map[std_string, double] getValues() except +
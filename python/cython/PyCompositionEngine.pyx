@@ -0,0 +1,118 @@
+import numpy
+import sys
+cimport cython
+
+from cython.operator cimport dereference as deref
+from libcpp.string cimport string as std_string
+from libcpp.vector cimport vector as std_vector
+
+from CompositionEngine cimport *
+from FisxCythonTools import toBytes, toString, toStringKeysAndValues
+
+cdef class PyCompositionEngine:
+    cdef CompositionEngine *thisptr
+
+    def __cinit__(self, PyXRF xrf, PyElements elementsLibrary, elementList, elementFamilyList, \
+                  int layerIndex=0, int secondary=1, int useGeometricEfficiency=1):
+        """
+        Prepare the fast evaluation of the rates of the given peak families for many compositions
+        of one sample layer. The beam, sample, attenuators, detector and geometry are taken from
+        the supplied PyXRF instance and later changes to it are not seen by the engine.
+
+        elementList - Elements defining each composition
+        elementFamilyList - Peak families of the form "Fe K" whose elements are in elementList
+        layerIndex - Sample layer whose composition varies
+        secondary - 0 Only primary excitation, 1 Include intralayer secondary excitation. Secondary
+                    excitation by the other layers is not included.
+        useGeometricEfficiency - Take into account solid angle or not. Default is 1 (yes)
+        """
+        cdef std_vector[std_string] elements
+        cdef std_vector[std_string] families
+        for item in elementList:
+            elements.push_back(toBytes(item))
+        for item in elementFamilyList:
+            families.push_back(toBytes(item))
+        self.thisptr = new CompositionEngine(xrf.thisptr.getConfiguration(), \
+                                             deref(elementsLibrary.thisptr), \
+                                             elements, families, \
+                                             layerIndex, secondary, useGeometricEfficiency)
+
+    def __dealloc__(self):
+        del self.thisptr
+
+    def getElementList(self):
+        return [toString(x) for x in self.thisptr.getElementList()]
+
+    def getElementFamilyList(self):
+        return [toString(x) for x in self.thisptr.getElementFamilyList()]
+
+    def getRates(self, compositions, out=None):
+        """
+        compositions - Array of shape (nCompositions, nElements) with the mass fractions of the
+        elements given at construction time. Contiguous float64 arrays are used without copy.
+        out - Optional contiguous float64 array of shape (nCompositions, nFamilies) to be filled.
+
+        Return an array of shape (nCompositions, nFamilies) with the detected rate of each family
+        (already multiplied by the mass fraction of the emitting element).
+        The calculation releases the GIL.
+        """
+        cdef const double[:, ::1] compositionsView
+        cdef double[:, ::1] ratesView
+        cdef int nElements = self.thisptr.getElementList().size()
+        cdef int nFamilies = self.thisptr.getElementFamilyList().size()
+        cdef int n
+        compositions = numpy.ascontiguousarray(compositions, dtype=numpy.float64).reshape(-1, nElements)
+        compositionsView = compositions
+        n = compositionsView.shape[0]
+        if out is None:
+            rates = numpy.empty((n, nFamilies), dtype=numpy.float64)
+        else:
+            rates = out
+            if rates.shape != (n, nFamilies):
+                raise ValueError("Output array does not have shape (%d, %d)" % (n, nFamilies))
+        ratesView = rates
+        if (n > 0) and (nFamilies > 0):
+            with nogil:
+                self.thisptr.getRates(&compositionsView[0, 0], n, &ratesView[0, 0])
+        return rates
+
+    def getLachanceTraillCoefficients(self, int nSteps=20, ternary=False):
+        """
+        Fit the Lachance-Traill influence coefficients of each family with respect to the other
+        elements over a grid of binary compositions with nSteps intervals. If ternary is True, the
+        ternary compositions of each analyte with each pair of the other elements are added and
+        the coefficients of each analyte are fitted together.
+
+        Return a dictionary of the form [family][element][key] with the keys:
+        alpha - Influence coefficient
+        rms - Root mean square error of the concentration predicted by the model over the grid
+              points containing the element
+        maximum - Maximum absolute error of the concentration predicted by the model over them
+        points - Number of grid points containing the element
+        """
+        cdef InfluenceCoefficients generator
+        if sys.version > "3.0":
+            return toStringKeysAndValues(generator.getLachanceTraill(deref(self.thisptr), nSteps, \
+                                                                     1 if ternary else 0))
+        else:
+            return generator.getLachanceTraill(deref(self.thisptr), nSteps, 1 if ternary else 0)
+
+    def getDeJonghCoefficients(self, eliminatedElement, int nSteps=20, ternary=False):
+        """
+        Fit the de Jongh influence coefficients of each family with respect to the elements other
+        than eliminatedElement, the analyte included, over the same grid as
+        getLachanceTraillCoefficients plus the pure analyte.
+
+        Return a dictionary of the form [family][element][key] with the keys:
+        d - Influence coefficient
+        E - Proportionality constant of the analyte, the same for all its entries
+        rms, maximum, points - As in getLachanceTraillCoefficients
+        """
+        cdef InfluenceCoefficients generator
+        if sys.version > "3.0":
+            return toStringKeysAndValues(generator.getDeJongh(deref(self.thisptr), \
+                                                              toBytes(eliminatedElement), nSteps, \
+                                                              1 if ternary else 0))
+        else:
+            return generator.getDeJongh(deref(self.thisptr), eliminatedElement, nSteps, \
+                                        1 if ternary else 0)
@@ -1,6 +1,9 @@
 import sys
+import numpy
 cimport cython
 
+from cython.operator cimport dereference as deref, preincrement as inc
+from libc.string cimport memcpy
 from operator import itemgetter
 from libcpp.string cimport string as std_string
 from libcpp.vector cimport vector as std_vector
@@ -32,25 +35,64 @@ from fisx import DataDir
 dataDir = DataDir.DATA_DIR
 xcom = Elements(dataDir, bindingEnergies, xcomFile)
 
+Thread safety:
+
+The construction and the calculation methods (getMassAttenuationCoefficients,
+getExcitationFactors and getEscape) release the GIL while the library works.
+Several threads can query the same instance concurrently, but the methods modifying
+it (addMaterial, set..., removeMaterials, ...) must not be called while other
+threads are using it, either directly or through an XRF instance.
+
+Sharing the library among processes:
+
+Building the library reads and parses the data files. A process can serialize its
+instance with getSnapshot (or saveSnapshot) and other processes can initialize their
+own instance from it much faster:
+
+from multiprocessing import shared_memory
+data = xcom.getSnapshot()
+shm = shared_memory.SharedMemory(create=True, size=len(data))
+shm.buf[:len(data)] = data
+# in the worker processes
+shm = shared_memory.SharedMemory(name=sharedMemoryName)
+xcom = Elements(snapshot=shm.buf)
+
+The snapshot argument accepts any object exporting a buffer (bytes, mmap, ...) or,
+if it is a text string, the name of a file written by saveSnapshot. User defined materials are not
+part of the snapshot.
+
 """
 cdef class PyElements:
     cdef Elements *thisptr
 
     def __cinit__(self, directoryName="",
                         bindingEnergiesFile="",
-                        crossSectionsFile=""):
+                        crossSectionsFile="",
+                        snapshot=None):
+        cdef std_string directory
+        cdef std_string bindingEnergies
+        cdef std_string crossSections
+        if snapshot is not None:
+            self.thisptr = new Elements()
+            if hasattr(snapshot, "encode") and not isinstance(snapshot, bytes):
+                # a text string is the name of a snapshot file
+                self.loadSnapshot(snapshot)
+            else:
+                self.setSnapshot(snapshot)
+            return
         if len(directoryName) == 0:
             from fisx import DataDir
             directoryName = DataDir.DATA_DIR
-        directoryName = toBytes(directoryName)
-        bindingEnergiesFile = toBytes(bindingEnergiesFile)
-        crossSectionsFile = toBytes(crossSectionsFile)
-        if len(bindingEnergiesFile):
-            self.thisptr = new Elements(directoryName, bindingEnergiesFile)
-        else:
-            self.thisptr = new Elements(directoryName)
-        if len(crossSectionsFile):
-            self.thisptr.setMassAttenuationCoefficientsFile(crossSectionsFile)
+        directory = toBytes(directoryName)
+        bindingEnergies = toBytes(bindingEnergiesFile)
+        crossSections = toBytes(crossSectionsFile)
+        with nogil:
+            if bindingEnergies.size():
+                self.thisptr = new Elements(directory, bindingEnergies)
+            else:
+                self.thisptr = new Elements(directory)
+            if crossSections.size():
+                self.thisptr.setMassAttenuationCoefficientsFile(crossSections)
 
     def initializeAsPyMca(self):
         import os
@@ -139,16 +181,22 @@ cdef class PyElements:
     
     def _getSingleMassAttenuationCoefficients(self, std_string element,
                                                      double energy):
+        cdef std_map[std_string, double] result
+        with nogil:
+            result = self.thisptr.getMassAttenuationCoefficients(element, energy)
         if sys.version < "3.0":
-            return self.thisptr.getMassAttenuationCoefficients(element, energy)
+            return result
         else:
-            return toStringKeys(self.thisptr.getMassAttenuationCoefficients(element, energy))
+            return toStringKeys(result)
 
     def _getElementDefaultMassAttenuationCoefficients(self, std_string element):
+        cdef std_map[std_string, std_vector[double]] result
+        with nogil:
+            result = self.thisptr.getMassAttenuationCoefficients(element)
         if sys.version < "3.0":
-            return self.thisptr.getMassAttenuationCoefficients(element)
+            return result
         else:
-            return toStringKeys(self.thisptr.getMassAttenuationCoefficients(element))
+            return toStringKeys(result)
 
     def getElementMassAttenuationCoefficients(self, element, energy=None):
         if energy is None:
@@ -162,10 +210,13 @@ cdef class PyElements:
 
     def _getMultipleMassAttenuationCoefficients(self, std_string element,
                                                        std_vector[double] energy):
+        cdef std_map[std_string, std_vector[double]] result
+        with nogil:
+            result = self.thisptr.getMassAttenuationCoefficients(element, energy)
         if sys.version < "3.0":
-            return self.thisptr.getMassAttenuationCoefficients(element, energy)
+            return result
         else:
-            return toStringKeys(self.thisptr.getMassAttenuationCoefficients(element, energy))
+            return toStringKeys(result)
 
     def getMassAttenuationCoefficients(self, name, energy=None):
         if hasattr(name, "keys"):
@@ -191,6 +242,118 @@ cdef class PyElements:
                 weight = [weight]
             return self._getExcitationFactors(toBytes(name), energy, weight)
 
+    def getMassAttenuationCoefficientsArray(self, name, energy, out=None):
+        """
+        Array version of getMassAttenuationCoefficients for large numbers of energies.
+
+        name - Element, formula, material name or dictionary of mass fractions
+        energy - Energies in keV. Contiguous float64 arrays are used without copy.
+        out - Optional dictionary of contiguous float64 arrays, with the same length as energy,
+              to be filled. Missing keys are allocated.
+
+        Return a dictionary with the keys "energy", "total", "photoelectric", "coherent",
+        "compton" and "pair" and NumPy arrays as values.
+        """
+        cdef std_string formula
+        cdef std_map[std_string, double] composition
+        cdef const double[::1] energyView
+        cdef double[::1] total, photoelectric, coherent, compton, pair
+        cdef const double *energyPointer = NULL
+        cdef double *pointers[5]
+        cdef int i
+        cdef int n
+        cdef bint isComposition = hasattr(name, "keys")
+
+        energy = numpy.ascontiguousarray(energy, dtype=numpy.float64).reshape(-1)
+        energyView = energy
+        n = energyView.shape[0]
+        result = self._getOutputArrays(out, n, ["total", "photoelectric", "coherent", "compton", "pair"])
+        result["energy"] = energy
+        total = result["total"]
+        photoelectric = result["photoelectric"]
+        coherent = result["coherent"]
+        compton = result["compton"]
+        pair = result["pair"]
+        for i in range(5):
+            pointers[i] = NULL
+        if n > 0:
+            energyPointer = &energyView[0]
+            pointers[0] = &total[0]
+            pointers[1] = &photoelectric[0]
+            pointers[2] = &coherent[0]
+            pointers[3] = &compton[0]
+            pointers[4] = &pair[0]
+        if isComposition:
+            composition = toBytesKeys(name)
+        else:
+            formula = toBytes(name)
+        with nogil:
+            if isComposition:
+                self.thisptr.getMassAttenuationCoefficients(composition, energyPointer, n, pointers[0], \
+                                                            pointers[1], pointers[2], pointers[3], pointers[4])
+            else:
+                self.thisptr.getMassAttenuationCoefficients(formula, energyPointer, n, pointers[0], \
+                                                            pointers[1], pointers[2], pointers[3], pointers[4])
+        return result
+
+    def _getOutputArrays(self, out, int n, keys):
+        result = {}
+        for key in keys:
+            if (out is not None) and (key in out):
+                if len(out[key]) != n:
+                    raise ValueError("Output array %s does not have %d values" % (key, n))
+                result[key] = out[key]
+            else:
+                result[key] = numpy.empty((n,), dtype=numpy.float64)
+        return result
+
+    def getExcitationFactorsArray(self, name, energy, weight=None):
+        """
+        Array version of getExcitationFactors for large numbers of incident energies.
+
+        name - Element
+        energy - Incident energies in keV. Contiguous float64 arrays are used without copy.
+        weight - Optional weight of each energy. Default is 1.0 for all of them.
+
+        Return a dictionary [line]["energy"] with the energy of each emitted line and
+        [line]["rate"] with a NumPy array of its rate at each incident energy.
+        """
+        cdef std_string element = toBytes(name)
+        cdef const double[::1] energyView
+        cdef const double[::1] weightView
+        cdef const double *energyPointer = NULL
+        cdef const double *weightPointer = NULL
+        cdef std_map[std_string, std_vector[double]] rates
+        cdef std_map[std_string, double] lineEnergies
+        cdef std_map[std_string, std_vector[double]].iterator it
+        cdef double[::1] rateView
+        cdef int n
+
+        energy = numpy.ascontiguousarray(energy, dtype=numpy.float64).reshape(-1)
+        energyView = energy
+        n = energyView.shape[0]
+        if n > 0:
+            energyPointer = &energyView[0]
+        if weight is not None:
+            weight = numpy.ascontiguousarray(weight, dtype=numpy.float64).reshape(-1)
+            weightView = weight
+            if weightView.shape[0] != n:
+                raise ValueError("Number of weights does not match number of energies")
+            if n > 0:
+                weightPointer = &weightView[0]
+        with nogil:
+            self.thisptr.getExcitationFactors(element, energyPointer, weightPointer, n, rates, lineEnergies)
+        result = {}
+        it = rates.begin()
+        while it != rates.end():
+            rate = numpy.empty((n,), dtype=numpy.float64)
+            if n > 0:
+                rateView = rate
+                memcpy(&rateView[0], deref(it).second.data(), n * sizeof(double))
+            result[toString(deref(it).first)] = {"energy": lineEnergies[deref(it).first], "rate": rate}
+            inc(it)
+        return result
+
     def _getMaterialMassAttenuationCoefficients(self, elementDict, energy):
         """
         elementDict is a dictionary of the form:
@@ -209,15 +372,21 @@ cdef class PyElements:
 
     def _getMassAttenuationCoefficients(self, std_map[std_string, double] elementDict,
                                               std_vector[double] energy):
-        return self.thisptr.getMassAttenuationCoefficients(elementDict, energy)
+        cdef std_map[std_string, std_vector[double]] result
+        with nogil:
+            result = self.thisptr.getMassAttenuationCoefficients(elementDict, energy)
+        return result
 
     def _getExcitationFactors(self, std_string element,
                                    std_vector[double] energies,
                                    std_vector[double] weights):
+        cdef std_vector[std_map[std_string, std_map[std_string, double]]] result
+        with nogil:
+            result = self.thisptr.getExcitationFactors(element, energies, weights)
         if sys.version < "3.0":
-            return self.thisptr.getExcitationFactors(element, energies, weights)
+            return result
         else:
-            return [toStringKeysAndValues(x) for x in self.thisptr.getExcitationFactors(element, energies, weights)]
+            return [toStringKeysAndValues(x) for x in result]
 
     def getPeakFamilies(self, nameOrVector, energy):
         if type(nameOrVector) in [type([]), type(())]:
@@ -251,8 +420,11 @@ cdef class PyElements:
                                         int nThreshold=4 ,
                                         double alphaIn=90.,
                                         double thickness=0.0):
-        return self.thisptr.getEscape(composition, energy, energyThreshold, intensityThreshold, nThreshold,
-                                      alphaIn, thickness)
+        cdef std_map[std_string, std_map[std_string, double]] result
+        with nogil:
+            result = self.thisptr.getEscape(composition, energy, energyThreshold, intensityThreshold, nThreshold,
+                                            alphaIn, thickness)
+        return result
 
     def getShellConstants(self, elementName, subshell):
         if sys.version < "3.0":
@@ -280,3 +452,39 @@ cdef class PyElements:
 
     def removeMaterials(self):
         self.thisptr.removeMaterials()
+
+    def getSnapshot(self):
+        """
+        Return the library (without user defined materials) serialized as bytes.
+        """
+        cdef std_vector[char] buffer
+        with nogil:
+            self.thisptr.getSnapshot(buffer)
+        if buffer.size() == 0:
+            return b""
+        return (<char *> buffer.data())[:buffer.size()]
+
+    def setSnapshot(self, snapshot):
+        """
+        Replace the library contents by those of a buffer obtained from getSnapshot.
+        snapshot - bytes or any object exporting a buffer (shared memory, mmap, ...)
+        The defined materials are kept.
+        """
+        cdef const unsigned char[::1] view = snapshot
+        cdef size_t size = view.shape[0]
+        cdef const char *pointer
+        if size < 1:
+            raise ValueError("Empty snapshot")
+        pointer = <const char *> &view[0]
+        with nogil:
+            self.thisptr.setSnapshot(pointer, size)
+
+    def saveSnapshot(self, fileName):
+        cdef std_string name = toBytes(fileName)
+        with nogil:
+            self.thisptr.saveSnapshot(name)
+
+    def loadSnapshot(self, fileName):
+        cdef std_string name = toBytes(fileName)
+        with nogil:
+            self.thisptr.loadSnapshot(name)
@@ -27,6 +27,36 @@ cdef class PyLayer:
             energies = numpy.array([energies], numpy.float)
         return self.thisptr.getTransmission(energies, deref(elementsLib.thisptr), angle)
 
+    def getTransmissionArray(self, energies, PyElements elementsLib, double angle=90., out=None):
+        """
+        Array version of getTransmission for large numbers of energies.
+
+        energies - Energies in keV. Contiguous float64 arrays are used without copy.
+        out - Optional contiguous float64 array, with the same length as energies, to be filled.
+
+        Return a NumPy array with the transmission at each energy (out if given).
+        """
+        cdef const double[::1] energyView
+        cdef double[::1] resultView
+        cdef const double *energyPointer = NULL
+        cdef double *resultPointer = NULL
+        cdef int n
+
+        energies = numpy.ascontiguousarray(energies, dtype=numpy.float64).reshape(-1)
+        energyView = energies
+        n = energyView.shape[0]
+        if out is None:
+            out = numpy.empty((n,), dtype=numpy.float64)
+        resultView = out
+        if resultView.shape[0] != n:
+            raise ValueError("Output array does not have %d values" % n)
+        if n > 0:
+            energyPointer = &energyView[0]
+            resultPointer = &resultView[0]
+        with nogil:
+            self.thisptr.getTransmission(energyPointer, n, deref(elementsLib.thisptr), angle, resultPointer)
+        return out
+
     def setMaterial(self, PyMaterial material):
         self.thisptr.setMaterial(deref(material.thisptr))
 
@@ -0,0 +1,48 @@
+#import numpy as np
+#cimport numpy as np
+cimport cython
+
+from Logger cimport *
+
+cdef class PyLogger:
+    """
+    Control of the diagnostic messages of the library.
+
+    Messages are written to the standard error stream. Messages below the level compiled into
+    the library (python setup.py build --log-level=N) are never emitted.
+    """
+    DEBUG = 0
+    INFO = 1
+    WARNING = 2
+    ERROR = 3
+    NONE = 4
+
+    cdef Logger *thisptr
+
+    def __cinit__(self):
+        self.thisptr = new Logger()
+
+    def __dealloc__(self):
+        del self.thisptr
+
+    def setLevel(self, int level):
+        """
+        Set the minimum level of the messages to be emitted. Default is WARNING.
+        """
+        self.thisptr.setLevel(level)
+
+    def getLevel(self):
+        return self.thisptr.getLevel()
+
+    def getCompiledLevel(self):
+        """
+        Minimum level compiled into the library.
+        """
+        return self.thisptr.getCompiledLevel()
+
+    def setRateLimit(self, int maximumMessages, double interval=1.0):
+        """
+        Emit at most maximumMessages messages from the same source per interval (in seconds).
+        A non positive maximumMessages disables the rate limiting.
+        """
+        self.thisptr.setRateLimit(maximumMessages, interval)
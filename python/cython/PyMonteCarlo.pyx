@@ -0,0 +1,63 @@
+#import numpy as np
+import sys
+#cimport numpy as np
+cimport cython
+
+from cython.operator cimport dereference as deref
+from libcpp.string cimport string as std_string
+from libcpp.vector cimport vector as std_vector
+from libcpp.map cimport map as std_map
+
+from MonteCarlo cimport *
+
+cdef class PyMonteCarlo:
+    """
+    Photon transport reference for the analytic fluorescence calculation of PyXRF.
+
+    The configuration is taken from a PyXRF instance and the result has the format of
+    PyXRF.getMultilayerFluorescence with an additional key "_error" for the statistical
+    error of each contribution.
+    """
+    cdef MonteCarlo *thisptr
+
+    def __cinit__(self):
+        self.thisptr = new MonteCarlo()
+
+    def __dealloc__(self):
+        del self.thisptr
+
+    def setConfiguration(self, PyXRF xrf):
+        """
+        Use the current configuration of the given XRF instance. Later changes of the XRF
+        instance are not taken into account.
+        """
+        self.thisptr.setConfiguration(xrf.thisptr.getConfiguration())
+
+    def getMultilayerFluorescence(self, elementFamilyLayer, PyElements elementsLibrary, \
+                                  long nHistories, unsigned long seed = 0, \
+                                  int useGeometricEfficiency = 1, int useMassFractions = 0, \
+                                  int scattering = 1, int nThreads = 0):
+        """
+        Follow nHistories incident photons and return the detected fluorescence.
+
+        elementFamilyLayer - Information requested in the form "Cr", "Cr K" or "Cr K 0"
+        seed - Seed of the random numbers. The same seed gives the same result whatever the
+               number of threads.
+        scattering - If 0, scattered photons are not followed.
+        nThreads - Number of threads. Zero uses the OpenMP default.
+
+        The calculation releases the GIL. elementsLibrary must not be modified meanwhile.
+        """
+        cdef std_vector[std_string] elementFamilyLayerVector
+        cdef std_map[std_string, std_map[int, std_map[std_string, std_map[std_string, double]]]] result
+        if sys.version > "3.0":
+            elementFamilyLayer = [toBytes(x) for x in elementFamilyLayer]
+        elementFamilyLayerVector = elementFamilyLayer
+        with nogil:
+            result = self.thisptr.getMultilayerFluorescence(elementFamilyLayerVector, \
+                                        deref(elementsLibrary.thisptr), nHistories, seed, \
+                                        useGeometricEfficiency, useMassFractions, scattering, nThreads)
+        if sys.version > "3.0":
+            return toStringKeysAndValues(result)
+        else:
+            return result
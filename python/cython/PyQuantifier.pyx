@@ -0,0 +1,85 @@
+import numpy
+import sys
+cimport cython
+
+from cython.operator cimport dereference as deref
+from libcpp.string cimport string as std_string
+from libcpp.vector cimport vector as std_vector
+
+from Quantifier cimport *
+from FisxCythonTools import toBytes, toString
+
+cdef class PyQuantifier:
+    cdef Quantifier *thisptr
+    cdef int nElements
+    cdef int nFamilies
+
+    def __cinit__(self, PyXRF xrf, PyElements elementsLibrary, elementList, elementFamilyList, \
+                  int layerIndex=0, int secondary=1, int useGeometricEfficiency=1):
+        """
+        Fundamental parameters quantification of one sample layer. Same arguments as
+        PyCompositionEngine. Each family must belong to a different element.
+        """
+        cdef std_vector[std_string] elements
+        cdef std_vector[std_string] families
+        for item in elementList:
+            elements.push_back(toBytes(item))
+        for item in elementFamilyList:
+            families.push_back(toBytes(item))
+        self.thisptr = new Quantifier(xrf.thisptr.getConfiguration(), \
+                                      deref(elementsLibrary.thisptr), \
+                                      elements, families, \
+                                      layerIndex, secondary, useGeometricEfficiency)
+        self.nElements = elements.size()
+        self.nFamilies = families.size()
+
+    def __dealloc__(self):
+        del self.thisptr
+
+    def setFlux(self, double flux):
+        self.thisptr.setFlux(flux)
+
+    def getFlux(self):
+        return self.thisptr.getFlux()
+
+    def setBalanceElement(self, elementName):
+        self.thisptr.setBalanceElement(toBytes(elementName))
+
+    def getBalanceElement(self):
+        return toString(self.thisptr.getBalanceElement())
+
+    def setConvergence(self, int maxIterations, double tolerance, double damping=1.0):
+        self.thisptr.setConvergence(maxIterations, tolerance, damping)
+
+    def quantify(self, areas, initialCompositions, int warmStart=1):
+        """
+        areas - Array of shape (nPixels, nFamilies) with the measured areas
+        initialCompositions - Array of shape (nPixels, nElements) with the starting mass fractions
+
+        Contiguous float64 arrays are used without copy.
+
+        Return a tuple (compositions, iterations). The iterations are -1 for the pixels that did
+        not converge. The calculation releases the GIL.
+        """
+        cdef const double[:, ::1] areasView
+        cdef const double[:, ::1] initialView
+        cdef double[:, ::1] compositionsView
+        cdef int[::1] iterationsView
+        cdef int nPixels
+        areas = numpy.ascontiguousarray(areas, dtype=numpy.float64).reshape(-1, self.nFamilies)
+        initialCompositions = numpy.ascontiguousarray(initialCompositions, \
+                                                      dtype=numpy.float64).reshape(-1, self.nElements)
+        areasView = areas
+        initialView = initialCompositions
+        nPixels = areasView.shape[0]
+        if initialView.shape[0] != nPixels:
+            raise ValueError("Initial compositions do not match the number of pixels")
+        compositions = numpy.empty((nPixels, self.nElements), dtype=numpy.float64)
+        iterations = numpy.empty((nPixels,), dtype=numpy.intc)
+        compositionsView = compositions
+        iterationsView = iterations
+        if nPixels > 0:
+            with nogil:
+                self.thisptr.quantify(&areasView[0, 0], nPixels, &initialView[0, 0], \
+                                      &compositionsView[0, 0], &iterationsView[0], warmStart)
+        return compositions, iterations
@@ -0,0 +1,121 @@
+import numpy
+import sys
+cimport cython
+
+from libcpp.string cimport string as std_string
+from libcpp.vector cimport vector as std_vector
+from libcpp.map cimport map as std_map
+
+from SpectrumFitter cimport *
+
+cdef class PySpectrumFitter:
+    """
+    Linear fit of peak family areas in measured spectra.
+
+    Each peak family is described by a template built from the line ratios given by
+    PyXRF.getMultilayerFluorescence and the detector response. The templates and their Gram
+    matrix are kept until the channels, the detector or shape parameters or the peak families
+    change. The areas are obtained by non-negative least squares.
+
+    fitter = SpectrumFitter()
+    fitter.setChannels(numpy.arange(100, 2048))
+    fitter.setDetectorParameters({"Zero": 0.0, "Gain": 0.01, "Noise": 0.1, "Fano": 0.114})
+    fitter.setPeakFamilies(["Fe K", "Ca K"], xrf.getMultilayerFluorescence(["Fe K", "Ca K"], elements))
+    areas, chiSquare = fitter.fit(spectra[:, 100:2048])
+    """
+    cdef SpectrumFitter *thisptr
+
+    def __cinit__(self):
+        self.thisptr = new SpectrumFitter()
+
+    def __dealloc__(self):
+        del self.thisptr
+
+    def setChannels(self, channels):
+        """
+        Channels of the points of the spectra to be fitted.
+        """
+        self.thisptr.setChannels(numpy.asarray(channels, dtype=numpy.float64).reshape(-1))
+
+    def getChannels(self):
+        return numpy.array(self.thisptr.getChannels(), dtype=numpy.float64)
+
+    def setDetectorParameters(self, detectorParameters):
+        """
+        Dictionary with the keys Zero, Gain, Noise, Fano and QuantumEnergy (see PyXRF.getSpectrum).
+        """
+        self.thisptr.setDetectorParameters(toBytesKeys(detectorParameters))
+
+    def getDetectorParameters(self):
+        return toStringKeys(self.thisptr.getDetectorParameters())
+
+    def setShapeParameters(self, shapeParameters):
+        self.thisptr.setShapeParameters(toBytesKeys(shapeParameters))
+
+    def getShapeParameters(self):
+        return toStringKeys(self.thisptr.getShapeParameters())
+
+    def setPeakFamilies(self, peakFamilies, emissionRatios):
+        """
+        peakFamilies - Families to be fitted in the form "Fe K" or "Fe K 0"
+        emissionRatios - Output of PyXRF.getMultilayerFluorescence including those families
+        """
+        cdef std_vector[std_string] families
+        for item in peakFamilies:
+            families.push_back(toBytes(item))
+        self.thisptr.setPeakFamilies(families, toBytesKeysAndValues(emissionRatios))
+
+    def getPeakFamilies(self):
+        return [toString(x) for x in self.thisptr.getPeakFamilies()]
+
+    def setBackgroundDegree(self, int degree):
+        """
+        Degree of the Bernstein polynomials describing the background. Negative for no background.
+        """
+        self.thisptr.setBackgroundDegree(degree)
+
+    def getBackgroundDegree(self):
+        return self.thisptr.getBackgroundDegree()
+
+    def getParameterNames(self):
+        """
+        Peak families followed by "background 0", "background 1", ... if the background is fitted.
+        """
+        return [toString(x) for x in self.thisptr.getParameterNames()]
+
+    def getTemplates(self):
+        """
+        Array of shape (nParameters, nChannels) with the counts of each template. The peak
+        family templates correspond to a unit area.
+        """
+        return numpy.array(self.thisptr.getTemplates(), dtype=numpy.float64)
+
+    def fit(self, spectra):
+        """
+        spectra - Array of shape (nChannels,) or (nSpectra, nChannels)
+
+        Return a tuple (areas, chiSquare) with the areas of the parameters, of shape
+        (nParameters,) or (nSpectra, nParameters), and the sums of the squared residuals.
+        The calculation releases the GIL.
+        """
+        cdef const double[::1] spectraView
+        cdef double[::1] areasView
+        cdef double[::1] chiSquareView
+        cdef int nChannels, nParameters, nSpectra
+        nChannels = self.thisptr.getChannels().size()
+        nParameters = self.thisptr.getParameterNames().size()
+        spectra = numpy.asarray(spectra, dtype=numpy.float64)
+        single = (spectra.ndim == 1)
+        spectra = numpy.ascontiguousarray(spectra.reshape(-1, nChannels))
+        nSpectra = spectra.shape[0]
+        areas = numpy.zeros((nSpectra, nParameters), dtype=numpy.float64)
+        chiSquare = numpy.zeros((nSpectra,), dtype=numpy.float64)
+        if nSpectra > 0:
+            spectraView = spectra.reshape(-1)
+            areasView = areas.reshape(-1)
+            chiSquareView = chiSquare
+            with nogil:
+                self.thisptr.fit(&spectraView[0], nSpectra, &areasView[0], &chiSquareView[0])
+        if single:
+            return areas[0], chiSquare[0]
+        return areas, chiSquare
@@ -11,6 +11,14 @@ from XRF cimport *
 from Layer cimport *
     
 cdef class PyXRF:
+    """
+    Thread safety:
+
+    getMultilayerFluorescence and getFluorescence release the GIL while the library works.
+    An instance keeps the state of the last calculation and it must not be used by several
+    threads at the same time. Use one instance per thread (or XRFBatch) sharing a single
+    Elements instance.
+    """
     cdef XRF *thisptr
 
     def __cinit__(self, std_string configurationFile=""):
@@ -25,6 +33,44 @@ cdef class PyXRF:
     def readConfigurationFromFile(self, std_string fileName):
         self.thisptr.readConfigurationFromFile(fileName)
 
+    def saveConfigurationToFile(self, fileName):
+        """
+        Write the configuration in the fisx binary format. The file can be read back with
+        readConfigurationFromFile or by passing its name to the constructor.
+        """
+        cdef std_string name = toBytes(fileName)
+        self.thisptr.getConfiguration().saveConfigurationToFile(name)
+
+    def getConfigurationSnapshot(self):
+        """
+        Return the configuration (beam, filters, sample, attenuators, detector, geometry and
+        materials) serialized as bytes.
+        """
+        cdef std_vector[char] buffer
+        self.thisptr.getConfiguration().getSnapshot(buffer)
+        return (<char *> buffer.data())[:buffer.size()]
+
+    def setConfigurationSnapshot(self, snapshot):
+        """
+        Replace the configuration by the one contained in a buffer obtained from
+        getConfigurationSnapshot.
+        snapshot - bytes or any object exporting a buffer
+        """
+        cdef const unsigned char[::1] view = snapshot
+        cdef size_t size = view.shape[0]
+        cdef XRFConfig configuration
+        if size < 1:
+            raise ValueError("Empty snapshot")
+        configuration.setSnapshot(<const char *> &view[0], size)
+        self.thisptr.setConfiguration(configuration)
+
+    def getConfigurationHash(self):
+        """
+        Return a hash of the configuration contents as an hexadecimal string.
+        Identical configurations give the same hash in any process on the same platform.
+        """
+        return toString(self.thisptr.getConfiguration().getHash())
+
     def setBeam(self, energies, weights=None, characteristic=None, divergency=None):
         if not hasattr(energies, "__len__"):
             if divergency is None:
@@ -49,6 +95,30 @@ cdef class PyXRF:
                        std_vector[int] characteristic, std_vector[double] divergency):
         self.thisptr.setBeam(energies, weights, characteristic, divergency)
 
+    def setBeamCompression(self, double tolerance):
+        """
+        Replace the polychromatic excitation beam by a reduced set of energies before computing
+        the fluorescence. The reduced beam keeps the photoelectric absorption of the sample
+        elements within the given relative tolerance (for instance 1.0e-3) and it is reused while
+        neither the configuration nor the library change. A tolerance of 0.0 (default) disables
+        the compression.
+
+        The rays dropped because of their negligible absorption are removed with their weight,
+        the weights of the reduced beam add up to less than those of the configured beam.
+        """
+        self.thisptr.setBeamCompression(tolerance)
+
+    def getBeamCompression(self):
+        return self.thisptr.getBeamCompression()
+
+    def getBeamCompressionErrorEstimate(self):
+        """
+        Heuristic estimate of the relative error introduced by the beam compression in the last
+        calculation. It is the change of the photoelectric absorption of the sample elements, the
+        fluorescence itself can change several times more. It is not an upper bound.
+        """
+        return self.thisptr.getBeamCompressionErrorEstimate()
+
     def setBeamFilters(self, layerList):
         """
         Due to wrapping constraints, the filter list must have the form:
@@ -111,6 +181,30 @@ cdef class PyXRF:
     def setDetector(self, PyDetector detector):
         self.thisptr.setDetector(deref(detector.thisptr))
 
+    def addDetector(self, PyDetector detector, double alphaOut, attenuators=None):
+        """
+        Add a detector looking at the sample together with the one given by setDetector.
+        alphaOut - Outgoing angle of the detector in degrees
+        attenuators - List of attenuators of that detector with the same form as in setAttenuators
+
+        The additional detectors are only used by getMultiDetectorFluorescence.
+        """
+        cdef std_vector[Layer] container
+        if attenuators:
+            if len(attenuators[0]) == 4:
+                for name, density, thickness, funny in attenuators:
+                    container.push_back(Layer(toBytes(name), density, thickness, funny))
+            else:
+                for name, density, thickness in attenuators:
+                    container.push_back(Layer(toBytes(name), density, thickness, 1.0))
+        self.thisptr.addDetector(deref(detector.thisptr), alphaOut, container)
+
+    def clearAdditionalDetectors(self):
+        self.thisptr.clearAdditionalDetectors()
+
+    def getNumberOfDetectors(self):
+        return self.thisptr.getConfiguration().getNumberOfDetectors()
+
     def setGeometry(self, double alphaIn, double alphaOut, double scatteringAngle = -90.0):
         if scatteringAngle < 0.0:
             self.thisptr.setGeometry(alphaIn, alphaOut, alphaIn + alphaOut)
@@ -119,7 +213,7 @@ cdef class PyXRF:
 
     def getMultilayerFluorescence(self, elementFamilyLayer, PyElements elementsLibrary, \
                             int secondary = 0, int useGeometricEfficiency = 1, int useMassFractions = 0, \
-                            secondaryCalculationLimit = 0.0):
+                            secondaryCalculationLimit = 0.0, int detailLevel = 2):
         """
         Input
         elementFamilyLayer - Vector of strings. Each string represents the information we are interested on.
@@ -138,6 +232,11 @@ cdef class PyXRF:
         has to multiply bthe rates by the actual mass fraction of the element on each sample layer.
                            If set to 1 the rate will be already corrected by the actual mass fraction.
 
+        detailLevel - Amount of information returned for each line.
+                      0 Only energy, rate, efficiency and massFraction
+                      1 As 0 plus primary, secondary and tertiary totals
+                      2 (default) As 1 plus the secondary contribution of each source
+
         Return a complete output of the form
         [Element Family][Layer][line]["energy"] - Energy in keV of the emission line
         [Element Family][Layer][line]["primary"] - Primary rate prior to correct for detection efficiency
@@ -147,32 +246,164 @@ cdef class PyXRF:
         [Element Family][Layer][line][element line layer] - Secondary rate (prior to correct for detection efficiency)
         due to the fluorescence from the given element, line and layer index composing the map key.
         """
-        if sys.version > "3.0":
-            elementFamilyLayer = [toBytes(x) for x in elementFamilyLayer]
-            return toStringKeysAndValues(self.thisptr.getMultilayerFluorescence(elementFamilyLayer, \
+        cdef std_vector[std_string] families
+        cdef double limit = secondaryCalculationLimit
+        cdef std_map[std_string, std_map[int, std_map[std_string, std_map[std_string, double]]]] result
+        for item in elementFamilyLayer:
+            families.push_back(toBytes(item))
+        with nogil:
+            result = self.thisptr.getMultilayerFluorescence(families, \
                             deref(elementsLibrary.thisptr), \
                             secondary, useGeometricEfficiency, \
-                            useMassFractions, secondaryCalculationLimit))
+                            useMassFractions, limit, detailLevel)
+        if sys.version > "3.0":
+            return toStringKeysAndValues(result)
         else:
-            return self.thisptr.getMultilayerFluorescence(elementFamilyLayer, \
+            return result
+
+    def getMultiDetectorFluorescence(self, elementFamilyLayer, PyElements elementsLibrary, \
+                            int secondary = 0, int useGeometricEfficiency = 1, int useMassFractions = 0, \
+                            secondaryCalculationLimit = 0.0, int detailLevel = 2):
+        """
+        Same as getMultilayerFluorescence for all the detectors (see addDetector) in a single pass.
+        The incident beam side of the calculation is shared, only the outgoing path, attenuators
+        and detector terms are evaluated for each detector.
+
+        Return a list with the output of getMultilayerFluorescence for each detector. The first
+        one corresponds to the detector given by setDetector.
+        """
+        cdef std_vector[std_string] families
+        cdef double limit = secondaryCalculationLimit
+        cdef std_vector[std_map[std_string, std_map[int, std_map[std_string, std_map[std_string, double]]]]] result
+        for item in elementFamilyLayer:
+            families.push_back(toBytes(item))
+        with nogil:
+            result = self.thisptr.getMultiDetectorFluorescence(families, \
                             deref(elementsLibrary.thisptr), \
                             secondary, useGeometricEfficiency, \
-                            useMassFractions, secondaryCalculationLimit)
+                            useMassFractions, limit, detailLevel)
+        if sys.version > "3.0":
+            return [toStringKeysAndValues(item) for item in result]
+        else:
+            return result
 
     def getFluorescence(self, elementName, PyElements elementsLibrary, \
                             int sampleLayer = 0, lineFamily="K", int secondary = 0, \
                             int useGeometricEfficiency = 1, int useMassFractions = 0, \
-                            double secondaryCalculationLimit = 0.0):
+                            double secondaryCalculationLimit = 0.0, int detailLevel = 2):
+        cdef std_string element = toBytes(elementName)
+        cdef std_string family = toBytes(lineFamily)
+        cdef std_map[std_string, std_map[int, std_map[std_string, std_map[std_string, double]]]] result
+        with nogil:
+            result = self.thisptr.getMultilayerFluorescence(element, deref(elementsLibrary.thisptr), \
+                            sampleLayer, family, secondary, useGeometricEfficiency, useMassFractions, \
+                            secondaryCalculationLimit, detailLevel)
+        if sys.version > "3.0":
+            return toStringKeysAndValues(result)
+        else:
+            return result
+
+    def getGeometricEfficiency(self, int layerIndex = 0, int detectorIndex = 0):
+        return self.thisptr.getGeometricEfficiency(layerIndex, detectorIndex)
+
+    def getStackResponseCurves(self, PyElements elementsLibrary, double minimumEnergy=1.0, \
+                               double maximumEnergy=100.0, int pointsPerDecade=500, energies=None):
+        """
+        Tabulate the response of the beam filters, attenuators and detector of the current
+        configuration between minimumEnergy and maximumEnergy (in keV).
+
+        If energies (in keV, in increasing order) are given, the curves are interpolated at them
+        instead of being returned at the tabulated energies.
+
+        Return a dictionary with the keys:
+        energy - Energies (in keV) including the absorption edges of the involved elements
+        filters - Beam filters transmission
+        attenuators - Attenuators transmission
+        detector - Intrinsic detector efficiency
+        efficiency - Product of attenuators transmission and intrinsic detector efficiency
+        """
+        cdef StackResponse response
+        cdef std_vector[double] energyVector
+        cdef std_map[std_string, std_vector[double]] curves
+        response = self.thisptr.getStackResponse(deref(elementsLibrary.thisptr), \
+                                                 minimumEnergy, maximumEnergy, pointsPerDecade)
+        if energies is None:
+            curves = response.getCurves()
+        else:
+            for energy in energies:
+                energyVector.push_back(energy)
+            curves = response.getCurves(energyVector)
+        if sys.version > "3.0":
+            return toStringKeys(curves)
+        else:
+            return curves
+
+    def getProfile(self):
+        """
+        Wall time of each calculation phase (keys ending in "_time", in seconds) and operation
+        counters of the last getMultilayerFluorescence call.
+
+        The dictionary is empty unless the library was built with instrumentation
+        (python setup.py build --profile).
+        """
+        cdef Profile profile
+        profile = self.thisptr.getProfile()
         if sys.version > "3.0":
-            elementName = toBytes(elementName)
-            lineFamily = toBytes(lineFamily)
-            return toStringKeysAndValues(self.thisptr.getMultilayerFluorescence(elementName, deref(elementsLibrary.thisptr), \
-                            sampleLayer, lineFamily, secondary, useGeometricEfficiency, useMassFractions, \
-                            secondaryCalculationLimit))
+            return toStringKeys(profile.getValues())
         else:
-            return self.thisptr.getMultilayerFluorescence(elementName, deref(elementsLibrary.thisptr), \
-                            sampleLayer, lineFamily, secondary, useGeometricEfficiency, useMassFractions, \
-                            secondaryCalculationLimit)
+            return profile.getValues()
 
-    def getGeometricEfficiency(self, int layerIndex = 0):
-        return self.thisptr.getGeometricEfficiency(layerIndex)
+    def getFluorescenceScan(self, energies, elementFamilyList, PyElements elementsLibrary, \
+                            int layerIndex=0, int secondary=1, int useGeometricEfficiency=1):
+        """
+        Fluorescence of a sample layer as function of the incident energy.
+
+        energies - Incident energies in keV in increasing order. They replace the configured beam.
+        elementFamilyList - Peak families of interest in the form "Fe K"
+        layerIndex - Sample layer emitting the fluorescence
+        secondary - 0 Only primary excitation, 1 Include intralayer secondary excitation
+
+        Return a dictionary [Element Family] -> rate at each incident energy, already corrected
+        by the mass fraction of the element in the layer. Secondary excitation by the other
+        layers is not included.
+        """
+        cdef std_vector[std_string] families
+        for item in elementFamilyList:
+            families.push_back(toBytes(item))
+        if sys.version > "3.0":
+            return toStringKeys(self.thisptr.getFluorescenceScan(energies, families, \
+                                    deref(elementsLibrary.thisptr), \
+                                    layerIndex, secondary, useGeometricEfficiency))
+        else:
+            return self.thisptr.getFluorescenceScan(energies, families, \
+                                    deref(elementsLibrary.thisptr), \
+                                    layerIndex, secondary, useGeometricEfficiency)
+
+    def getSpectrum(self, channel, detectorParameters, peakFamilyArea, emissionRatios, \
+                    shapeParameters=None):
+        """
+        Synthetic spectrum of the given peak families.
+
+        channel - Channels at which the spectrum is evaluated
+        detectorParameters - Dictionary with the keys Zero, Gain, Noise, Fano and QuantumEnergy.
+                             The pile-up peaks are added if it also contains CountRate (counts
+                             per second) and PileUpTime (pulse pair resolving time in seconds).
+                             PileUpOrder is 1 for two photons, 2 (default) to include three.
+        peakFamilyArea - Dictionary of total areas with keys of the form "Fe K" or "Fe K 0"
+        emissionRatios - Output of getMultilayerFluorescence describing the peak families
+
+        Return a dictionary with the keys channel, energy, spectrum (pile-up included), pileup
+        and, for each peak family, its peaks and, followed by " pileup", its pile-up contribution.
+        The pile-up is evaluated by FFT convolution on a grid of Gain keV.
+        """
+        if shapeParameters is None:
+            shapeParameters = {}
+        if sys.version > "3.0":
+            return toStringKeys(self.thisptr.getSpectrum(channel, \
+                                        toBytesKeys(detectorParameters), \
+                                        toBytesKeys(shapeParameters), \
+                                        toBytesKeys(peakFamilyArea), \
+                                        toBytesKeysAndValues(emissionRatios)))
+        else:
+            return self.thisptr.getSpectrum(channel, detectorParameters, shapeParameters, \
+                                            peakFamilyArea, emissionRatios)
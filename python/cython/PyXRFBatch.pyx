@@ -0,0 +1,115 @@
+#import numpy as np
+import sys
+#cimport numpy as np
+cimport cython
+
+from cython.operator cimport dereference as deref
+from libcpp.string cimport string as std_string
+from libcpp.vector cimport vector as std_vector
+from libcpp.map cimport map as std_map
+
+from XRFBatch cimport *
+
+cdef void _pyXRFBatchCallback(const int & index, const int & status, \
+        const std_map[std_string, std_map[int, std_map[std_string, std_map[std_string, double]]]] & result, \
+        const std_string & error, void * userData) noexcept with gil:
+    # userData is a list [callback, exception raised by the callback]
+    state = <object> userData
+    if state[1] is not None:
+        # a previous call failed, the exception is raised once the batch is finished
+        return
+    try:
+        if sys.version > "3.0":
+            state[0](index, status, toStringKeysAndValues(result), toString(error))
+        else:
+            state[0](index, status, result, error)
+    except BaseException:
+        state[1] = sys.exc_info()[1]
+
+cdef class PyXRFBatch:
+    """
+    Evaluation of many independent configurations sharing one library.
+
+    Items are added with addItem and evaluated with a single call to run. The calculation
+    releases the GIL and, when the library is compiled with OpenMP, the items are evaluated
+    in parallel.
+    """
+    PENDING = 0
+    DONE = 1
+    FAILED = 2
+
+    cdef XRFBatch *thisptr
+
+    def __cinit__(self):
+        self.thisptr = new XRFBatch()
+
+    def __dealloc__(self):
+        del self.thisptr
+
+    def addItem(self, PyXRF xrf, elementFamilyLayer, int secondary = 0, int useGeometricEfficiency = 1, \
+                int useMassFractions = 0, double secondaryCalculationLimit = 0.0, int detailLevel = 2):
+        """
+        Add the current configuration of the given XRF instance together with the information
+        requested (see PyXRF.getMultilayerFluorescence). Later changes of the XRF instance do not
+        affect the batch. Return the index of the item.
+        """
+        if sys.version > "3.0":
+            elementFamilyLayer = [toBytes(x) for x in elementFamilyLayer]
+        return self.thisptr.addItem(xrf.thisptr.getConfiguration(), elementFamilyLayer, \
+                                    secondary, useGeometricEfficiency, useMassFractions, \
+                                    secondaryCalculationLimit, detailLevel)
+
+    def getNumberOfItems(self):
+        return self.thisptr.getNumberOfItems()
+
+    def clear(self):
+        self.thisptr.clear()
+
+    def run(self, PyElements elementsLibrary, callback=None, int nThreads=0):
+        """
+        Evaluate all the pending items without holding the GIL.
+
+        elementsLibrary must not be modified while the batch is running.
+        If given, callback(index, status, result, error) is called as soon as each item is
+        finished, while the rest of the batch is still running. The result is empty if the item
+        failed and the error is empty if it succeeded. The calls are never concurrent, but they
+        may come from different threads and they hold the other threads while they run.
+        If the callback raises an exception, it is not called again and the exception is raised
+        once the batch is finished.
+        """
+        cdef void * userData = NULL
+        state = [callback, None]
+        if callback is not None:
+            userData = <void *> state
+        with nogil:
+            if userData == NULL:
+                self.thisptr.run(deref(elementsLibrary.thisptr), NULL, NULL, nThreads)
+            else:
+                self.thisptr.run(deref(elementsLibrary.thisptr), _pyXRFBatchCallback, \
+                                 userData, nThreads)
+        if state[1] is not None:
+            raise state[1]
+
+    def getStatus(self, int index):
+        """
+        PyXRFBatch.PENDING, PyXRFBatch.DONE or PyXRFBatch.FAILED
+        """
+        return self.thisptr.getStatus(index)
+
+    def getResult(self, int index):
+        """
+        Result of a finished item in the format returned by PyXRF.getMultilayerFluorescence.
+        """
+        if sys.version > "3.0":
+            return toStringKeysAndValues(self.thisptr.getResult(index))
+        else:
+            return self.thisptr.getResult(index)
+
+    def getError(self, int index):
+        if sys.version > "3.0":
+            return toString(self.thisptr.getError(index))
+        else:
+            return self.thisptr.getError(index)
+
+    def getCompletionOrder(self):
+        return self.thisptr.getCompletionOrder()
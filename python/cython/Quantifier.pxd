@@ -0,0 +1,22 @@
+#import numpy as np
+#cimport numpy as np
+cimport cython
+
+from libcpp.string cimport string as std_string
+from libcpp.vector cimport vector as std_vector
+
+from Elements cimport *
+from XRFConfig cimport *
+
+cdef extern from "fisx_quantifier.h" namespace "fisx":
+    cdef cppclass Quantifier:
+        Quantifier() except +
+        Quantifier(XRFConfig, Elements, std_vector[std_string], std_vector[std_string], \
+                   int, int, int) except +
+        void setFlux(double) except +
+        double getFlux() except +
+        void setBalanceElement(std_string) except +
+        std_string getBalanceElement() except +
+        void setConvergence(int, double, double) except +
+        std_vector[double] quantify(std_vector[double], std_vector[double], std_vector[int] &, int) except +
+        void quantify(const double *, int, const double *, double *, int *, int) except + nogil
@@ -0,0 +1,25 @@
+#import numpy as np
+#cimport numpy as np
+cimport cython
+
+from libcpp.string cimport string as std_string
+from libcpp.vector cimport vector as std_vector
+from libcpp.map cimport map as std_map
+
+cdef extern from "fisx_spectrumfitter.h" namespace "fisx":
+    cdef cppclass SpectrumFitter:
+        SpectrumFitter() except +
+        void setChannels(std_vector[double]) except +
+        std_vector[double] getChannels()
+        void setDetectorParameters(std_map[std_string, double]) except +
+        std_map[std_string, double] getDetectorParameters()
+        void setShapeParameters(std_map[std_string, double]) except +
+        std_map[std_string, double] getShapeParameters()
+        void setPeakFamilies(std_vector[std_string], \
+                             std_map[std_string, std_map[int, std_map[std_string, std_map[std_string, double]]]]) except +
+        std_vector[std_string] getPeakFamilies()
+        void setBackgroundDegree(int) except +
+        int getBackgroundDegree()
+        std_vector[std_string] getParameterNames() except +
+        std_vector[std_vector[double]] getTemplates()
+        void fit(const double *, int, double *, double *) except + nogil
@@ -0,0 +1,19 @@
+#import numpy as np
+#cimport numpy as np
+cimport cython
+
+from libcpp.string cimport string as std_string
+from libcpp.vector cimport vector as std_vector
+from libcpp.map cimport map as std_map
+
+cdef extern from "fisx_stackresponse.h" namespace "fisx":
+    cdef cppclass StackResponse:
+        StackResponse() except +
+        std_vector[double] getEnergies() except +
+        double getBeamFilterTransmission(double) except +
+        double getAttenuatorTransmission(double) except +
+        double getDetectorEfficiency(double) except +
+        double getDetectionEfficiency(double) except +
+        void getDetectionEfficiency(std_vector[double], std_vector[double] &) except +
+        std_map[std_string, std_vector[double]] getCurves() except +
+        std_map[std_string, std_vector[double]] getCurves(std_vector[double]) except +
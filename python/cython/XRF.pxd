@@ -9,6 +9,9 @@ from libcpp.map cimport map as std_map
 from Detector cimport *
 from Elements cimport *
 from Layer cimport *
+from StackResponse cimport *
+from Profile cimport *
+from XRFConfig cimport *
 
 cdef extern from "fisx_xrf.h" namespace "fisx":
     cdef cppclass XRF:
@@ -22,14 +25,35 @@ cdef extern from "fisx_xrf.h" namespace "fisx":
         void setAttenuators(std_vector[Layer]) except +
         void setGeometry(double, double, double) except +
         void setDetector(Detector) except +
-        double getGeometricEfficiency(int) except +
+        void addDetector(Detector, double, std_vector[Layer]) except +
+        void clearAdditionalDetectors() except +
+        double getGeometricEfficiency(int, int) except +
+        XRFConfig getConfiguration() except +
+        void setConfiguration(XRFConfig) except +
+        void setBeamCompression(double) except +
+        double getBeamCompression()
+        double getBeamCompressionErrorEstimate()
 
         std_map[std_string, std_map[std_string, double]] getFluorescence(std_string, \
                 Elements, int, std_string, int, int, double) except +
 
         std_map[std_string, std_map[int, std_map[std_string, std_map[std_string, double]]]] \
-                getMultilayerFluorescence(std_vector[std_string], Elements, int, int, int, double) except +
+                getMultilayerFluorescence(std_vector[std_string], Elements, int, int, int, double, int) except + nogil
 
         std_map[std_string, std_map[int, std_map[std_string, std_map[std_string, double]]]] \
                 getMultilayerFluorescence(std_string, \
-                                          Elements, int, std_string, int, int, int, double) except +
+                                          Elements, int, std_string, int, int, int, double, int) except + nogil
+
+        std_vector[std_map[std_string, std_map[int, std_map[std_string, std_map[std_string, double]]]]] \
+                getMultiDetectorFluorescence(std_vector[std_string], Elements, int, int, int, double, int) except + nogil
+
+        StackResponse getStackResponse(Elements, double, double, int) except +
+
+        Profile getProfile() except +
+
+        std_map[std_string, std_vector[double]] getFluorescenceScan(std_vector[double], std_vector[std_string], \
+                                                                    Elements, int, int, int) except +
+
+        std_map[std_string, std_vector[double]] getSpectrum(std_vector[double], std_map[std_string, double], \
+                std_map[std_string, double], std_map[std_string, double], \
+                std_map[std_string, std_map[int, std_map[std_string, std_map[std_string, double]]]]) except +
@@ -0,0 +1,26 @@
+#import numpy as np
+#cimport numpy as np
+cimport cython
+
+from libcpp.string cimport string as std_string
+from libcpp.vector cimport vector as std_vector
+from libcpp.map cimport map as std_map
+
+from Elements cimport *
+from XRFConfig cimport *
+
+cdef extern from "fisx_xrfbatch.h" namespace "fisx":
+    cdef cppclass XRFBatch:
+        ctypedef void (*Callback)(const int &, const int &, \
+                                  const std_map[std_string, std_map[int, std_map[std_string, std_map[std_string, double]]]] &, \
+                                  const std_string &, void *) noexcept nogil
+        XRFBatch() except +
+        int addItem(XRFConfig, std_vector[std_string], int, int, int, double, int) except +
+        int getNumberOfItems()
+        void clear()
+        void run(Elements, Callback, void *, int) except + nogil
+        int getStatus(int) except +
+        std_map[std_string, std_map[int, std_map[std_string, std_map[std_string, double]]]] \
+                getResult(int) except +
+        std_string getError(int) except +
+        std_vector[int] getCompletionOrder()
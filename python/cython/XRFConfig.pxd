@@ -0,0 +1,16 @@
+#import numpy as np
+#cimport numpy as np
+cimport cython
+
+from libcpp.string cimport string as std_string
+from libcpp.vector cimport vector as std_vector
+
+cdef extern from "fisx_xrfconfig.h" namespace "fisx":
+    cdef cppclass XRFConfig:
+        XRFConfig() except +
+        void readConfigurationFromFile(std_string) except + nogil
+        void saveConfigurationToFile(std_string) except + nogil
+        void getSnapshot(std_vector[char] &) except + nogil
+        void setSnapshot(const char *, size_t) except + nogil
+        std_string getHash() except +
+        int getNumberOfDetectors() except +
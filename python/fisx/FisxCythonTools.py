@@ -42,8 +42,8 @@ else:
     def toBytesKeysAndValues(inputDict, encoding="utf-8"):
         if not isinstance(inputDict, dict):
             return inputDict
-        return dict((key.encode(encoding), toByteKeysAndValues(value)) if hasattr(key, "encode") \
-                    else (key, toByteKeysAndValues(value)) for key, value in inputDict.items())
+        return dict((key.encode(encoding), toBytesKeysAndValues(value)) if hasattr(key, "encode") \
+                    else (key, toBytesKeysAndValues(value)) for key, value in inputDict.items())
 
     def toStringKeysAndValues(inputDict, encoding="utf-8"):
         if not isinstance(inputDict, dict):
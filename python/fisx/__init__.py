@@ -7,8 +7,14 @@ from ._fisx import PyElements as Elements
 from ._fisx import PyLayer as Layer
 from ._fisx import PyDetector as Detector
 from ._fisx import PyXRF as XRF
+from ._fisx import PyXRFBatch as XRFBatch
+from ._fisx import PyQuantifier as Quantifier
+from ._fisx import PyMonteCarlo as MonteCarlo
+from ._fisx import PySpectrumFitter as SpectrumFitter
+from ._fisx import PyCompositionEngine as CompositionEngine
 from ._fisx import PyMath as Math
 from ._fisx import PyMaterial as Material
+from ._fisx import PyLogger as Logger
 from ._fisx import fisxVersion
 
 __version__ = fisxVersion()
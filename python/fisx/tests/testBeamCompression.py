@@ -0,0 +1,124 @@
+import unittest
+import sys
+import os
+
+import numpy
+
+FAMILIES = ["Fe K", "Cu K", "Zr K", "Zr L", "Pb L", "Pb M"]
+
+class testBeamCompression(unittest.TestCase):
+    def setUp(self):
+        """
+        import the module
+        """
+        try:
+            from fisx import XRF
+            self.xrf = XRF
+        except:
+            self.xrf = None
+
+    def tearDown(self):
+        self.xrf = None
+
+    def _getConfiguredXRF(self, sample):
+        xrf = self.xrf()
+        # bremsstrahlung like continuum
+        energies = numpy.linspace(1.5, 40.0, 502)
+        xrf.setBeam(energies, (40.0 - energies) / energies)
+        xrf.setBeamFilters([["Al1", 2.7, 0.01, 1.0]])
+        xrf.setSample(sample)
+        xrf.setAttenuators([["Be", 1.848, 0.002, 1.0]])
+        xrf.setGeometry(45., 45.)
+        return xrf
+
+    def _getLargestRelativeChange(self, expected, obtained):
+        worst = 0.0
+        for family in expected:
+            for layer in expected[family]:
+                for line in expected[family][layer]:
+                    value = expected[family][layer][line]["rate"]
+                    if value > 1.0e-8:
+                        worst = max(worst,
+                            abs(obtained[family][layer][line]["rate"] / value - 1.0))
+        return worst
+
+    def testBeamCompressionImport(self):
+        self.assertTrue(self.xrf is not None,
+                        'Unsuccessful fisx.XRF import')
+
+    def testBeamCompressionTolerance(self):
+        from fisx import DataDir
+        from fisx import Elements
+        elementsInstance = Elements(DataDir.FISX_DATA_DIR)
+        sample = [["Fe", 7.87, 0.0005], ["Cu", 8.9, 0.0005],
+                  ["Zr", 6.5, 0.001], ["Pb", 11.35, 0.01]]
+        xrf = self._getConfiguredXRF(sample)
+        expected = xrf.getMultilayerFluorescence(FAMILIES, elementsInstance,
+                                                 secondary=0)
+        for tolerance in [1.0e-3, 1.0e-4]:
+            xrf = self._getConfiguredXRF(sample)
+            xrf.setBeamCompression(tolerance)
+            obtained = xrf.getMultilayerFluorescence(FAMILIES, elementsInstance,
+                                                     secondary=0)
+            estimate = xrf.getBeamCompressionErrorEstimate()
+            self.assertTrue((estimate > 0.0) and (estimate <= tolerance),
+                            "Tolerance %g, estimate %g" % (tolerance, estimate))
+            # the primary excitation is within tolerance
+            worst = self._getLargestRelativeChange(expected, obtained)
+            self.assertTrue(worst <= tolerance,
+                            "Tolerance %g, largest relative change %g" % \
+                                (tolerance, worst))
+
+    def testBeamCompressionCache(self):
+        from fisx import DataDir
+        from fisx import Elements
+        from fisx import Material
+        elementsInstance = Elements(DataDir.FISX_DATA_DIR)
+        material = Material("Alloy", 8.0, 0.001)
+        material.setComposition({"Fe": 0.5, "Cu": 0.5})
+        elementsInstance.addMaterial(material)
+        xrf = self._getConfiguredXRF([["Alloy", 8.0, 0.001]])
+        xrf.setBeamCompression(1.0e-3)
+        xrf.getMultilayerFluorescence(["Fe K"], elementsInstance, secondary=0)
+
+        # a change of the configuration is seen
+        xrf.setSample([["Alloy", 8.0, 0.01]])
+        obtained = xrf.getMultilayerFluorescence(["Fe K"], elementsInstance,
+                                                 secondary=0)
+        reference = self._getConfiguredXRF([["Alloy", 8.0, 0.01]])
+        reference.setBeamCompression(1.0e-3)
+        expected = reference.getMultilayerFluorescence(["Fe K"], elementsInstance,
+                                                       secondary=0)
+        self.assertTrue(self._getLargestRelativeChange(expected, obtained) == 0.0,
+                        "Compressed beam not updated after a configuration change")
+
+        # and so is a change of the library
+        material = Material("Alloy", 8.0, 0.001)
+        material.setComposition({"Fe": 0.5, "Pb": 0.5})
+        elementsInstance.addMaterial(material, 0)
+        obtained = xrf.getMultilayerFluorescence(["Fe K"], elementsInstance,
+                                                 secondary=0)
+        reference = self._getConfiguredXRF([["Alloy", 8.0, 0.01]])
+        reference.setBeamCompression(1.0e-3)
+        expected = reference.getMultilayerFluorescence(["Fe K"], elementsInstance,
+                                                       secondary=0)
+        self.assertTrue(self._getLargestRelativeChange(expected, obtained) == 0.0,
+                        "Compressed beam not updated after a library change")
+
+def getSuite(auto=True):
+    testSuite = unittest.TestSuite()
+    if auto:
+        testSuite.addTest(\
+            unittest.TestLoader().loadTestsFromTestCase(testBeamCompression))
+    else:
+        # use a predefined order
+        testSuite.addTest(testBeamCompression("testBeamCompressionImport"))
+        testSuite.addTest(testBeamCompression("testBeamCompressionTolerance"))
+        testSuite.addTest(testBeamCompression("testBeamCompressionCache"))
+    return testSuite
+
+def test(auto=False):
+    unittest.TextTestRunner(verbosity=2).run(getSuite(auto=auto))
+
+if __name__ == '__main__':
+    test()
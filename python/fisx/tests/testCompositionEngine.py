@@ -0,0 +1,113 @@
+import unittest
+import sys
+import os
+
+import numpy
+
+ELEMENTS = ["Fe", "Cr", "Ni"]
+FAMILIES = ["Fe K", "Cr K", "Ni K"]
+COMPOSITIONS = [[0.5, 0.2, 0.3], [0.7, 0.2, 0.1], [0.1, 0.1, 0.8]]
+
+class testCompositionEngine(unittest.TestCase):
+    def setUp(self):
+        """
+        import the module
+        """
+        try:
+            from fisx import CompositionEngine
+            self.compositionEngine = CompositionEngine
+        except:
+            self.compositionEngine = None
+
+    def tearDown(self):
+        self.compositionEngine = None
+
+    def _getConfiguredXRF(self):
+        from fisx import Detector
+        from fisx import XRF
+        xrf = XRF()
+        xrf.setBeam(numpy.linspace(10., 20., 4), numpy.ones(4))
+        xrf.setSample([["Alloy", 8.0, 0.005]])
+        xrf.setAttenuators([["Be", 1.848, 0.002, 1.0]])
+        detector = Detector("Si1", 2.33, 0.035)
+        detector.setActiveArea(30.)
+        detector.setDistance(5.)
+        xrf.setDetector(detector)
+        xrf.setGeometry(45., 45.)
+        return xrf
+
+    def _setComposition(self, elementsInstance, composition):
+        from fisx import Material
+        material = Material("Alloy", 8.0, 0.005)
+        material.setComposition(dict(zip(ELEMENTS, composition)))
+        elementsInstance.addMaterial(material, 0)
+
+    def testCompositionEngineImport(self):
+        self.assertTrue(self.compositionEngine is not None,
+                        'Unsuccessful fisx.CompositionEngine import')
+
+    def testCompositionEngineVersusMultilayer(self):
+        from fisx import DataDir
+        from fisx import Elements
+        elementsInstance = Elements(DataDir.FISX_DATA_DIR)
+        self._setComposition(elementsInstance, COMPOSITIONS[0])
+        xrf = self._getConfiguredXRF()
+        for secondary in [0, 1]:
+            engine = self.compositionEngine(xrf, elementsInstance, ELEMENTS, FAMILIES,
+                                            secondary=secondary)
+            rates = engine.getRates(COMPOSITIONS)
+            self.assertTrue(rates.shape == (len(COMPOSITIONS), len(FAMILIES)),
+                            "Unexpected shape %s" % (rates.shape,))
+            for i in range(len(COMPOSITIONS)):
+                self._setComposition(elementsInstance, COMPOSITIONS[i])
+                expected = xrf.getMultilayerFluorescence(FAMILIES, elementsInstance,
+                                                         secondary=secondary,
+                                                         useMassFractions=1)
+                for j in range(len(FAMILIES)):
+                    # escape peaks included
+                    total = 0.0
+                    for line in expected[FAMILIES[j]][0]:
+                        total += expected[FAMILIES[j]][0][line]["rate"]
+                    self.assertTrue(abs(rates[i, j] - total) < 1.0e-8 * total,
+                        "Secondary %d composition %d %s: %g, expected %g" % \
+                            (secondary, i, FAMILIES[j], rates[i, j], total))
+
+    def testCompositionEngineOutput(self):
+        from fisx import DataDir
+        from fisx import Elements
+        elementsInstance = Elements(DataDir.FISX_DATA_DIR)
+        self._setComposition(elementsInstance, COMPOSITIONS[0])
+        engine = self.compositionEngine(self._getConfiguredXRF(), elementsInstance,
+                                        ELEMENTS, FAMILIES)
+        # many compositions spanning several blocks
+        numpy.random.seed(0)
+        compositions = numpy.random.random((150, len(ELEMENTS)))
+        compositions /= compositions.sum(axis=1)[:, None]
+        rates = engine.getRates(compositions)
+        out = numpy.zeros((150, len(FAMILIES)))
+        self.assertTrue(engine.getRates(compositions, out=out) is out,
+                        "Output array not used")
+        self.assertTrue(numpy.all(out == rates), "Different rates in the output array")
+        for i in [0, 63, 64, 149]:
+            self.assertTrue(numpy.all(engine.getRates(compositions[i]) == rates[i]),
+                            "Composition %d, different rate when evaluated alone" % i)
+        self.assertRaises(ValueError, engine.getRates, compositions,
+                          out=numpy.zeros((149, len(FAMILIES))))
+
+def getSuite(auto=True):
+    testSuite = unittest.TestSuite()
+    if auto:
+        testSuite.addTest(\
+            unittest.TestLoader().loadTestsFromTestCase(testCompositionEngine))
+    else:
+        # use a predefined order
+        testSuite.addTest(testCompositionEngine("testCompositionEngineImport"))
+        testSuite.addTest(testCompositionEngine("testCompositionEngineVersusMultilayer"))
+        testSuite.addTest(testCompositionEngine("testCompositionEngineOutput"))
+    return testSuite
+
+def test(auto=False):
+    unittest.TextTestRunner(verbosity=2).run(getSuite(auto=auto))
+
+if __name__ == '__main__':
+    test()
@@ -0,0 +1,96 @@
+import unittest
+import sys
+import os
+import tempfile
+
+import numpy
+
+class testElementsSnapshot(unittest.TestCase):
+    def setUp(self):
+        """
+        import the module
+        """
+        try:
+            from fisx import Elements
+            self.elements = Elements
+        except:
+            self.elements = None
+
+    def tearDown(self):
+        self.elements = None
+
+    def testElementsSnapshotImport(self):
+        self.assertTrue(self.elements is not None,
+                        'Unsuccessful fisx.Elements import')
+
+    def _checkEqual(self, original, restored):
+        energies = numpy.linspace(1.0, 80., 157)
+        for element in ["O", "Fe", "Zr", "Pb", "U"]:
+            self.assertTrue(original.getBindingEnergies(element) == \
+                            restored.getBindingEnergies(element),
+                            "Element %s, different binding energies" % element)
+            for shell in ["K", "L1", "L2", "L3", "M5"]:
+                for method in ["getShellConstants", "getRadiativeTransitions",
+                               "getNonradiativeTransitions"]:
+                    self.assertTrue(getattr(original, method)(element, shell) == \
+                                    getattr(restored, method)(element, shell),
+                                    "Element %s, shell %s, different %s" % \
+                                        (element, shell, method))
+            expected = original.getMassAttenuationCoefficients(element, energies)
+            obtained = restored.getMassAttenuationCoefficients(element, energies)
+            for key in expected:
+                self.assertTrue(list(expected[key]) == list(obtained[key]),
+                                "Element %s, different %s" % (element, key))
+            expected = original.getExcitationFactors(element, [12.0, 40.0])
+            obtained = restored.getExcitationFactors(element, [12.0, 40.0])
+            self.assertTrue(expected == obtained,
+                            "Element %s, different excitation factors" % element)
+
+    def testElementsSnapshotRoundTrip(self):
+        from fisx import DataDir
+        from fisx import Material
+        original = self.elements(DataDir.FISX_DATA_DIR)
+        # the cascade caches are part of the snapshot
+        original.setElementCascadeCacheEnabled("Pb", 1)
+        snapshot = original.getSnapshot()
+        self.assertTrue(len(snapshot) > 0, "Empty snapshot")
+        restored = self.elements(snapshot=snapshot)
+        self.assertTrue(restored.getSnapshot() == snapshot,
+                        "Snapshot changed by a round trip")
+        self._checkEqual(original, restored)
+
+        # the materials are kept when replacing the contents of an instance
+        material = Material("Steel", 7.9, 0.1)
+        material.setComposition({"Fe": 0.7, "Cr": 0.2, "Ni": 0.1})
+        restored.addMaterial(material)
+        restored.setSnapshot(snapshot)
+        self.assertTrue(abs(restored.getComposition("Steel")["Fe"] - 0.7) < 1.0e-10,
+                        "Material lost by setSnapshot")
+
+        # and the same through a file
+        fd, fileName = tempfile.mkstemp(suffix=".snapshot")
+        os.close(fd)
+        try:
+            original.saveSnapshot(fileName)
+            restored = self.elements(snapshot=fileName)
+        finally:
+            os.remove(fileName)
+        self.assertTrue(restored.getSnapshot() == snapshot,
+                        "Snapshot changed by a file round trip")
+
+def getSuite(auto=True):
+    testSuite = unittest.TestSuite()
+    if auto:
+        testSuite.addTest(\
+            unittest.TestLoader().loadTestsFromTestCase(testElementsSnapshot))
+    else:
+        # use a predefined order
+        testSuite.addTest(testElementsSnapshot("testElementsSnapshotImport"))
+        testSuite.addTest(testElementsSnapshot("testElementsSnapshotRoundTrip"))
+    return testSuite
+
+def test(auto=False):
+    unittest.TextTestRunner(verbosity=2).run(getSuite(auto=auto))
+
+if __name__ == '__main__':
+    test()
@@ -0,0 +1,91 @@
+import unittest
+import sys
+import os
+
+FAMILIES = ["Fe K", "Cr K", "Ni K", "Fe L"]
+# below and above the edges, with repeated energies
+ENERGIES = [5.0, 6.0, 7.0, 7.2, 8.0, 8.0, 8.5, 10.0, 10.0, 20.0]
+
+class testFluorescenceScan(unittest.TestCase):
+    def setUp(self):
+        """
+        import the module
+        """
+        try:
+            from fisx import XRF
+            self.xrf = XRF
+        except:
+            self.xrf = None
+
+    def tearDown(self):
+        self.xrf = None
+
+    def _getSetup(self):
+        from fisx import DataDir
+        from fisx import Elements
+        from fisx import Material
+        from fisx import Detector
+        elementsInstance = Elements(DataDir.FISX_DATA_DIR)
+        material = Material("Alloy", 8.0, 0.005)
+        material.setComposition({"Fe": 0.5, "Cr": 0.2, "Ni": 0.3})
+        elementsInstance.addMaterial(material)
+        xrf = self.xrf()
+        xrf.setSample([["Alloy", 8.0, 0.005]])
+        xrf.setAttenuators([["Be", 1.848, 0.002, 1.0]])
+        detector = Detector("Si1", 2.33, 0.035)
+        detector.setActiveArea(30.)
+        detector.setDistance(5.)
+        xrf.setDetector(detector)
+        xrf.setGeometry(45., 45.)
+        return xrf, elementsInstance
+
+    def testFluorescenceScanImport(self):
+        self.assertTrue(self.xrf is not None,
+                        'Unsuccessful fisx.XRF import')
+
+    def testFluorescenceScanVersusMultilayer(self):
+        xrf, elementsInstance = self._getSetup()
+        for secondary in [0, 1]:
+            scan = xrf.getFluorescenceScan(ENERGIES, FAMILIES, elementsInstance,
+                                           secondary=secondary)
+            for i in range(len(ENERGIES)):
+                xrf.setBeam(ENERGIES[i])
+                expected = xrf.getMultilayerFluorescence(FAMILIES, elementsInstance,
+                                                         secondary=secondary,
+                                                         useMassFractions=1)
+                for family in FAMILIES:
+                    # families that cannot be excited are not returned
+                    total = 0.0
+                    if family in expected:
+                        for line in expected[family][0]:
+                            total += expected[family][0][line]["rate"]
+                    self.assertTrue(abs(scan[family][i] - total) <= 1.0e-8 * total,
+                        "Secondary %d energy %g %s: %g, expected %g" % \
+                            (secondary, ENERGIES[i], family, scan[family][i], total))
+
+    def testFluorescenceScanSecondary(self):
+        from fisx import CompositionEngine
+        xrf, elementsInstance = self._getSetup()
+        # interlayer secondary excitation is not supported
+        self.assertRaises(ValueError, xrf.getFluorescenceScan, ENERGIES, FAMILIES,
+                          elementsInstance, secondary=2)
+        self.assertRaises(ValueError, CompositionEngine, xrf, elementsInstance,
+                          ["Fe", "Cr", "Ni"], ["Fe K"], secondary=2)
+
+def getSuite(auto=True):
+    testSuite = unittest.TestSuite()
+    if auto:
+        testSuite.addTest(\
+            unittest.TestLoader().loadTestsFromTestCase(testFluorescenceScan))
+    else:
+        # use a predefined order
+        testSuite.addTest(testFluorescenceScan("testFluorescenceScanImport"))
+        testSuite.addTest(testFluorescenceScan("testFluorescenceScanVersusMultilayer"))
+        testSuite.addTest(testFluorescenceScan("testFluorescenceScanSecondary"))
+    return testSuite
+
+def test(auto=False):
+    unittest.TextTestRunner(verbosity=2).run(getSuite(auto=auto))
+
+if __name__ == '__main__':
+    test()
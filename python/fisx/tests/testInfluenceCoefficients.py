@@ -0,0 +1,114 @@
+import unittest
+import sys
+import os
+
+import numpy
+
+ELEMENTS = ["Fe", "Cr", "Ni"]
+FAMILIES = ["Fe K", "Cr K", "Ni K"]
+
+class testInfluenceCoefficients(unittest.TestCase):
+    def setUp(self):
+        """
+        import the module
+        """
+        try:
+            from fisx import CompositionEngine
+            self.compositionEngine = CompositionEngine
+        except:
+            self.compositionEngine = None
+
+    def tearDown(self):
+        self.compositionEngine = None
+
+    def _getEngine(self):
+        from fisx import DataDir
+        from fisx import Elements
+        from fisx import Material
+        from fisx import XRF
+        elementsInstance = Elements(DataDir.FISX_DATA_DIR)
+        material = Material("Alloy", 8.0, 0.01)
+        material.setComposition({"Fe": 0.5, "Cr": 0.2, "Ni": 0.3})
+        elementsInstance.addMaterial(material)
+        xrf = XRF()
+        xrf.setBeam(20.0)
+        xrf.setSample([["Alloy", 8.0, 0.01]])
+        xrf.setGeometry(45., 45.)
+        return self.compositionEngine(xrf, elementsInstance, ELEMENTS, FAMILIES, secondary=0)
+
+    def testInfluenceCoefficientsImport(self):
+        self.assertTrue(self.compositionEngine is not None,
+                        'Unsuccessful fisx.CompositionEngine import')
+
+    def testInfluenceCoefficientsLachanceTraill(self):
+        engine = self._getEngine()
+        for ternary in [False, True]:
+            coefficients = engine.getLachanceTraillCoefficients(10, ternary)
+            self.assertTrue(sorted(coefficients.keys()) == sorted(FAMILIES),
+                            "Families %s" % list(coefficients.keys()))
+            for family in FAMILIES:
+                others = [x for x in ELEMENTS if x != family.split()[0]]
+                self.assertTrue(sorted(coefficients[family].keys()) == sorted(others),
+                                "%s, elements %s" % (family, list(coefficients[family].keys())))
+                for element in others:
+                    self.assertTrue(coefficients[family][element]["rms"] < 1.0e-4,
+                                    "Ternary %s %s %s rms %g" % \
+                                        (ternary, family, element,
+                                         coefficients[family][element]["rms"]))
+            # Cr strongly absorbs Fe K
+            self.assertTrue(coefficients["Fe K"]["Cr"]["alpha"] > 1.0,
+                            "Fe K alpha Cr %g" % coefficients["Fe K"]["Cr"]["alpha"])
+
+        # the model predicts the concentrations of a composition outside the grid
+        coefficients = engine.getLachanceTraillCoefficients(10)
+        composition = numpy.array([0.45, 0.25, 0.30])
+        rates = engine.getRates(composition)[0]
+        pure = engine.getRates(numpy.eye(len(ELEMENTS)))
+        for i in range(len(FAMILIES)):
+            relative = rates[i] / pure[i, i]
+            predicted = relative
+            for j in range(len(ELEMENTS)):
+                if j != i:
+                    predicted += relative * coefficients[FAMILIES[i]][ELEMENTS[j]]["alpha"] * \
+                                 composition[j]
+            self.assertTrue(abs(predicted - composition[i]) < 1.0e-4,
+                            "%s predicted %g instead of %g" % \
+                                (FAMILIES[i], predicted, composition[i]))
+
+    def testInfluenceCoefficientsDeJongh(self):
+        engine = self._getEngine()
+        coefficients = engine.getDeJonghCoefficients("Ni", 10)
+        for family in FAMILIES:
+            self.assertTrue(sorted(coefficients[family].keys()) == ["Cr", "Fe"],
+                            "%s, elements %s" % (family, list(coefficients[family].keys())))
+            values = [coefficients[family][x]["E"] for x in coefficients[family]]
+            self.assertTrue(values[0] == values[1], "%s, different E values" % family)
+            for element in coefficients[family]:
+                self.assertTrue(coefficients[family][element]["rms"] < 1.0e-4,
+                                "%s %s rms %g" % \
+                                    (family, element, coefficients[family][element]["rms"]))
+
+    def testInfluenceCoefficientsErrors(self):
+        engine = self._getEngine()
+        self.assertRaises(ValueError, engine.getLachanceTraillCoefficients, 1)
+        self.assertRaises(ValueError, engine.getDeJonghCoefficients, "Ni", 1)
+        self.assertRaises(ValueError, engine.getDeJonghCoefficients, "Cu")
+
+def getSuite(auto=True):
+    testSuite = unittest.TestSuite()
+    if auto:
+        testSuite.addTest(\
+            unittest.TestLoader().loadTestsFromTestCase(testInfluenceCoefficients))
+    else:
+        # use a predefined order
+        testSuite.addTest(testInfluenceCoefficients("testInfluenceCoefficientsImport"))
+        testSuite.addTest(testInfluenceCoefficients("testInfluenceCoefficientsLachanceTraill"))
+        testSuite.addTest(testInfluenceCoefficients("testInfluenceCoefficientsDeJongh"))
+        testSuite.addTest(testInfluenceCoefficients("testInfluenceCoefficientsErrors"))
+    return testSuite
+
+def test(auto=False):
+    unittest.TextTestRunner(verbosity=2).run(getSuite(auto=auto))
+
+if __name__ == '__main__':
+    test()
@@ -0,0 +1,101 @@
+import unittest
+import sys
+import os
+
+import numpy
+
+KEYS = ["total", "photoelectric", "coherent", "compton", "pair"]
+
+class testInterpolationCursor(unittest.TestCase):
+    def setUp(self):
+        """
+        import the module
+        """
+        try:
+            from fisx import Elements
+            self.elements = Elements
+        except:
+            self.elements = None
+
+    def tearDown(self):
+        self.elements = None
+
+    def _getEnergies(self, elementsInstance, element):
+        # regular grid plus the edges themselves and points just around them
+        energies = list(numpy.linspace(0.5, 100., 397))
+        bindingEnergies = elementsInstance.getBindingEnergies(element)
+        for shell in bindingEnergies:
+            edge = bindingEnergies[shell]
+            if edge > 0.5:
+                energies += [edge * (1.0 - 1.0e-6), edge, edge, edge * (1.0 + 1.0e-6)]
+        energies.sort()
+        return energies
+
+    def testInterpolationCursorImport(self):
+        self.assertTrue(self.elements is not None,
+                        'Unsuccessful fisx.Elements import')
+
+    def testInterpolationCursorLookups(self):
+        from fisx import DataDir
+        elementsInstance = self.elements(DataDir.FISX_DATA_DIR)
+        numpy.random.seed(0)
+        for name in ["H", "Fe", "Pb", "U", "Fe2O3", "PbSO4"]:
+            if name in ["Fe2O3", "PbSO4"]:
+                energies = self._getEnergies(elementsInstance, "Pb")
+            else:
+                energies = self._getEnergies(elementsInstance, name)
+            # sorted, reversed and shuffled sequences share a single cursor
+            for order in ["sorted", "reversed", "shuffled"]:
+                if order == "reversed":
+                    energies = energies[::-1]
+                elif order == "shuffled":
+                    energies = list(numpy.random.permutation(energies))
+                shared = elementsInstance.getMassAttenuationCoefficients(name, energies)
+                array = elementsInstance.getMassAttenuationCoefficientsArray(name, energies)
+                for i in range(len(energies)):
+                    # a lookup with a fresh cursor
+                    single = elementsInstance.getMassAttenuationCoefficients(name,
+                                                                            energies[i])
+                    for key in KEYS:
+                        self.assertTrue(shared[key][i] == single[key][0],
+                            "%s %s energy %g %s: %g, single lookup %g" % \
+                                (name, order, energies[i], key,
+                                 shared[key][i], single[key][0]))
+                        self.assertTrue(array[key][i] == single[key][0],
+                            "%s %s energy %g %s: array %g, single lookup %g" % \
+                                (name, order, energies[i], key,
+                                 array[key][i], single[key][0]))
+
+    def testInterpolationCursorExcitationFactors(self):
+        from fisx import DataDir
+        elementsInstance = self.elements(DataDir.FISX_DATA_DIR)
+        energies = [e for e in self._getEnergies(elementsInstance, "Pb") if e > 1.0]
+        energies = energies[::3] + energies[1::3] + energies[2::3]
+        shared = elementsInstance.getExcitationFactorsArray("Pb", energies)
+        for i in range(len(energies)):
+            single = elementsInstance.getExcitationFactors("Pb", energies[i])[0]
+            for line in single:
+                # the array path only differs by the order of the floating point operations
+                self.assertTrue(abs(shared[line]["rate"][i] - single[line]["rate"]) <= \
+                                1.0e-12 * single[line]["rate"],
+                                "Energy %g line %s: %g, single lookup %g" % \
+                                    (energies[i], line, shared[line]["rate"][i],
+                                     single[line]["rate"]))
+
+def getSuite(auto=True):
+    testSuite = unittest.TestSuite()
+    if auto:
+        testSuite.addTest(\
+            unittest.TestLoader().loadTestsFromTestCase(testInterpolationCursor))
+    else:
+        # use a predefined order
+        testSuite.addTest(testInterpolationCursor("testInterpolationCursorImport"))
+        testSuite.addTest(testInterpolationCursor("testInterpolationCursorLookups"))
+        testSuite.addTest(testInterpolationCursor("testInterpolationCursorExcitationFactors"))
+    return testSuite
+
+def test(auto=False):
+    unittest.TextTestRunner(verbosity=2).run(getSuite(auto=auto))
+
+if __name__ == '__main__':
+    test()
@@ -0,0 +1,66 @@
+import unittest
+import sys
+import os
+
+class testMonteCarlo(unittest.TestCase):
+    def setUp(self):
+        """
+        import the module
+        """
+        try:
+            from fisx import MonteCarlo
+            self.monteCarlo = MonteCarlo
+        except:
+            self.monteCarlo = None
+
+    def tearDown(self):
+        self.monteCarlo = None
+
+    def testMonteCarloImport(self):
+        self.assertTrue(self.monteCarlo is not None,
+                        'Unsuccessful fisx.MonteCarlo import')
+
+    def testMonteCarloThreads(self):
+        from fisx import DataDir
+        from fisx import Elements
+        from fisx import XRF
+        elementsInstance = Elements(DataDir.FISX_DATA_DIR)
+        xrf = XRF()
+        xrf.setBeam(20.0)
+        xrf.setSample([["Fe", 7.87, 0.0005], ["Cu", 8.9, 0.001]])
+        xrf.setGeometry(45., 45.)
+        monteCarlo = self.monteCarlo()
+        monteCarlo.setConfiguration(xrf)
+        families = ["Fe K", "Cu K"]
+        expected = monteCarlo.getMultilayerFluorescence(families, elementsInstance,
+                                                        20000, seed=7, nThreads=1)
+        self.assertTrue(len(expected) == len(families),
+                        "Unexpected result %s" % list(expected.keys()))
+        # the same seed gives the same result whatever the number of threads
+        for nThreads in [2, 3, 4]:
+            obtained = monteCarlo.getMultilayerFluorescence(families, elementsInstance,
+                                                            20000, seed=7,
+                                                            nThreads=nThreads)
+            self.assertTrue(obtained == expected,
+                            "Different result with %d threads" % nThreads)
+        obtained = monteCarlo.getMultilayerFluorescence(families, elementsInstance,
+                                                        20000, seed=8, nThreads=1)
+        self.assertTrue(obtained != expected,
+                        "Same result with a different seed")
+
+def getSuite(auto=True):
+    testSuite = unittest.TestSuite()
+    if auto:
+        testSuite.addTest(\
+            unittest.TestLoader().loadTestsFromTestCase(testMonteCarlo))
+    else:
+        # use a predefined order
+        testSuite.addTest(testMonteCarlo("testMonteCarloImport"))
+        testSuite.addTest(testMonteCarlo("testMonteCarloThreads"))
+    return testSuite
+
+def test(auto=False):
+    unittest.TextTestRunner(verbosity=2).run(getSuite(auto=auto))
+
+if __name__ == '__main__':
+    test()
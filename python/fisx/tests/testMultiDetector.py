@@ -0,0 +1,108 @@
+import unittest
+import sys
+import os
+
+import numpy
+
+FAMILIES = ["Fe K", "Cu K", "Pb L", "Pb M"]
+# detector material, outgoing angle and attenuators of each detector
+DETECTORS = [["Si1", 45.0, [["Be", 1.848, 0.002, 1.0]]],
+             ["Ge", 60.0, [["Be", 1.848, 0.0025, 1.0], ["Al1", 2.7, 0.001, 1.0]]],
+             ["Si1", 20.0, []]]
+
+class testMultiDetector(unittest.TestCase):
+    def setUp(self):
+        """
+        import the module
+        """
+        try:
+            from fisx import XRF
+            self.xrf = XRF
+        except:
+            self.xrf = None
+
+    def tearDown(self):
+        self.xrf = None
+
+    def _getDetector(self, index):
+        from fisx import Detector
+        if DETECTORS[index][0] == "Ge":
+            detector = Detector("Ge", 5.32, 0.5)
+        else:
+            detector = Detector("Si1", 2.33, 0.035)
+        detector.setActiveArea(30. + 10. * index)
+        detector.setDistance(5. + index)
+        return detector
+
+    def _getConfiguredXRF(self, index):
+        xrf = self.xrf()
+        xrf.setBeam(numpy.linspace(10., 30., 5), numpy.ones(5))
+        xrf.setBeamFilters([["Al1", 2.7, 0.01, 1.0]])
+        xrf.setSample([["Fe", 7.87, 0.0005], ["Cu", 8.9, 0.0005], ["Pb", 11.35, 0.001]])
+        if len(DETECTORS[index][2]):
+            xrf.setAttenuators(DETECTORS[index][2])
+        xrf.setDetector(self._getDetector(index))
+        xrf.setGeometry(45., DETECTORS[index][1])
+        return xrf
+
+    def testMultiDetectorImport(self):
+        self.assertTrue(self.xrf is not None,
+                        'Unsuccessful fisx.XRF import')
+
+    def testMultiDetectorVersusSeparateRuns(self):
+        from fisx import DataDir
+        from fisx import Elements
+        elementsInstance = Elements(DataDir.FISX_DATA_DIR)
+        xrf = self._getConfiguredXRF(0)
+        for index in range(1, len(DETECTORS)):
+            xrf.addDetector(self._getDetector(index), DETECTORS[index][1],
+                            DETECTORS[index][2])
+        self.assertTrue(xrf.getNumberOfDetectors() == len(DETECTORS),
+                        "Got %d detectors" % xrf.getNumberOfDetectors())
+        for secondary in [0, 1, 2]:
+            obtained = xrf.getMultiDetectorFluorescence(FAMILIES, elementsInstance,
+                                                        secondary=secondary,
+                                                        useMassFractions=1)
+            self.assertTrue(len(obtained) == len(DETECTORS),
+                            "Got %d results" % len(obtained))
+            for index in range(len(DETECTORS)):
+                expected = self._getConfiguredXRF(index).getMultilayerFluorescence( \
+                                    FAMILIES, elementsInstance, secondary=secondary,
+                                    useMassFractions=1)
+                self.assertTrue(sorted(obtained[index].keys()) == sorted(expected.keys()),
+                                "Detector %d, different families" % index)
+                for family in expected:
+                    for layer in expected[family]:
+                        for line in expected[family][layer]:
+                            for key in expected[family][layer][line]:
+                                value = expected[family][layer][line][key]
+                                current = obtained[index][family][layer][line][key]
+                                self.assertTrue(abs(current - value) <= 1.0e-12 * abs(value),
+                                    "Secondary %d detector %d %s %d %s %s: %g, expected %g" % \
+                                        (secondary, index, family, layer, line, key,
+                                         current, value))
+            # the detectors do see different rates
+            rates = [obtained[index]["Fe K"][0]["KL3"]["rate"] for index in range(len(DETECTORS))]
+            self.assertTrue(len(set(rates)) == len(DETECTORS),
+                            "Secondary %d, equal rates %s" % (secondary, rates))
+        # the additional detectors can be removed
+        xrf.clearAdditionalDetectors()
+        self.assertTrue(xrf.getNumberOfDetectors() == 1,
+                        "Got %d detectors" % xrf.getNumberOfDetectors())
+
+def getSuite(auto=True):
+    testSuite = unittest.TestSuite()
+    if auto:
+        testSuite.addTest(\
+            unittest.TestLoader().loadTestsFromTestCase(testMultiDetector))
+    else:
+        # use a predefined order
+        testSuite.addTest(testMultiDetector("testMultiDetectorImport"))
+        testSuite.addTest(testMultiDetector("testMultiDetectorVersusSeparateRuns"))
+    return testSuite
+
+def test(auto=False):
+    unittest.TextTestRunner(verbosity=2).run(getSuite(auto=auto))
+
+if __name__ == '__main__':
+    test()
@@ -0,0 +1,117 @@
+import unittest
+import sys
+import os
+
+import numpy
+
+ELEMENTS = ["Fe", "Cr", "Ni", "O"]
+FAMILIES = ["Fe K", "Cr K", "Ni K"]
+FLUX = 1.0e6
+
+class testQuantifier(unittest.TestCase):
+    def setUp(self):
+        """
+        import the module
+        """
+        try:
+            from fisx import Quantifier
+            self.quantifier = Quantifier
+        except:
+            self.quantifier = None
+
+    def tearDown(self):
+        self.quantifier = None
+
+    def _getSetup(self, thickness=0.01):
+        from fisx import DataDir
+        from fisx import Elements
+        from fisx import Material
+        from fisx import XRF
+        from fisx import CompositionEngine
+        elementsInstance = Elements(DataDir.FISX_DATA_DIR)
+        material = Material("Steel", 7.9, thickness)
+        material.setComposition({"Fe": 0.6, "Cr": 0.2, "Ni": 0.1, "O": 0.1})
+        elementsInstance.addMaterial(material)
+        xrf = XRF()
+        xrf.setBeam(20.0)
+        xrf.setSample([["Steel", 7.9, thickness]])
+        xrf.setGeometry(45., 45.)
+        # smooth map of compositions and its areas
+        t = numpy.linspace(0.0, 1.0, 40)
+        compositions = numpy.zeros((len(t), len(ELEMENTS)))
+        compositions[:, 0] = 0.6 - 0.1 * t
+        compositions[:, 1] = 0.2 + 0.05 * t
+        compositions[:, 2] = 0.1 + 0.02 * t
+        compositions[:, 3] = 1.0 - compositions[:, :3].sum(axis=1)
+        engine = CompositionEngine(xrf, elementsInstance, ELEMENTS, FAMILIES)
+        areas = FLUX * engine.getRates(compositions)
+        quantifier = self.quantifier(xrf, elementsInstance, ELEMENTS, FAMILIES)
+        quantifier.setFlux(FLUX)
+        quantifier.setConvergence(100, 1.0e-8)
+        return quantifier, compositions, areas
+
+    def testQuantifierImport(self):
+        self.assertTrue(self.quantifier is not None,
+                        'Unsuccessful fisx.Quantifier import')
+
+    def testQuantifierRecovery(self):
+        # without balance the oxygen keeps its starting value and a thin layer is needed
+        # because the rates of a thick one barely change when scaling all the mass fractions
+        quantifier, compositions, areas = self._getSetup(0.0002)
+        initial = compositions.copy()
+        initial[:, :3] *= 1.2
+        obtained, iterations = quantifier.quantify(areas, initial, warmStart=0)
+        self.assertTrue(numpy.all(iterations > 0), "Pixels not converged")
+        self.assertTrue(numpy.abs(obtained - compositions).max() < 1.0e-6,
+                        "Largest deviation %g" % numpy.abs(obtained - compositions).max())
+
+        # with balance the oxygen is obtained from the quantified elements
+        quantifier, compositions, areas = self._getSetup()
+        quantifier.setBalanceElement("O")
+        self.assertTrue(quantifier.getBalanceElement() == "O",
+                        "Balance element not set")
+        initial = numpy.tile([0.3, 0.3, 0.3, 0.1], (compositions.shape[0], 1))
+        obtained, iterations = quantifier.quantify(areas, initial, warmStart=0)
+        self.assertTrue(numpy.all(iterations > 0), "Pixels not converged")
+        self.assertTrue(numpy.abs(obtained - compositions).max() < 1.0e-6,
+                        "Largest deviation %g" % numpy.abs(obtained - compositions).max())
+        self.assertTrue(numpy.allclose(obtained.sum(axis=1), 1.0),
+                        "Balance element does not complete the composition")
+        self.assertRaises(ValueError, quantifier.setBalanceElement, "Fe")
+
+    def testQuantifierWarmStart(self):
+        quantifier, compositions, areas = self._getSetup()
+        quantifier.setBalanceElement("O")
+        initial = numpy.tile([0.3, 0.3, 0.3, 0.1], (compositions.shape[0], 1))
+        cold, coldIterations = quantifier.quantify(areas, initial, warmStart=0)
+        warm, warmIterations = quantifier.quantify(areas, initial, warmStart=1)
+        self.assertTrue(numpy.all(warmIterations > 0), "Pixels not converged")
+        self.assertTrue(numpy.abs(warm - cold).max() < 1.0e-6,
+                        "Warm start changes the result by %g" % numpy.abs(warm - cold).max())
+        # neighbouring pixels of the smooth map converge faster
+        self.assertTrue(warmIterations.sum() < coldIterations.sum(),
+                        "Iterations %d with warm start, %d without" % \
+                            (warmIterations.sum(), coldIterations.sum()))
+
+        # non converged pixels are flagged
+        quantifier.setConvergence(2, 1.0e-8)
+        obtained, iterations = quantifier.quantify(areas, initial, warmStart=0)
+        self.assertTrue(numpy.all(iterations == -1), "Unexpected convergence")
+
+def getSuite(auto=True):
+    testSuite = unittest.TestSuite()
+    if auto:
+        testSuite.addTest(\
+            unittest.TestLoader().loadTestsFromTestCase(testQuantifier))
+    else:
+        # use a predefined order
+        testSuite.addTest(testQuantifier("testQuantifierImport"))
+        testSuite.addTest(testQuantifier("testQuantifierRecovery"))
+        testSuite.addTest(testQuantifier("testQuantifierWarmStart"))
+    return testSuite
+
+def test(auto=False):
+    unittest.TextTestRunner(verbosity=2).run(getSuite(auto=auto))
+
+if __name__ == '__main__':
+    test()
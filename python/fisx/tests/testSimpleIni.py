@@ -0,0 +1,140 @@
+import unittest
+import sys
+import os
+import tempfile
+
+CONTENTS = """
+[Section A]
+key1 = 1 2 3
+key2=value ; comment
+key3 = "quoted # not a comment ; = "  # comment
+ list = a,
+   b,
+   c
+after = 1
+# a comment line ends the continuation
+   ignored
+[fit]
+Key With Spaces = x y
+empty =
+=no key
+; comment
+
+[Indented]
+x = 1.5e-3\r
+y = "a" "b"\r
+[Other.Sub]
+values = 1.0, 2.0,
+         3.0
+"""
+
+def parseReference(text):
+    """
+    Line by line parsing following the previous implementation of SimpleIni
+    """
+    sections = []
+    contents = {}
+    mainKey = ""
+    key = ""
+    for line in text.split("\n"):
+        trimmed = line.strip(" \n\r\t")
+        if not len(trimmed):
+            continue
+        if trimmed[0] == "[":
+            mainKey = trimmed[1:trimmed.rindex("]")]
+            sections.append(mainKey)
+            continue
+        tmpString = ""
+        nQuotes = 0
+        equalPosition = 0
+        for c in trimmed:
+            if c == '"':
+                nQuotes += 1
+                tmpString += c
+                continue
+            if nQuotes % 2:
+                tmpString += c
+                continue
+            if c in "#;":
+                break
+            if equalPosition == 0:
+                if not c.isspace():
+                    tmpString += c
+                if (c == "=") and (len(tmpString) > 1):
+                    equalPosition = len(tmpString) - 1
+            else:
+                tmpString += c
+        if not len(tmpString):
+            key = ""
+            continue
+        if equalPosition > 0:
+            key = tmpString[:equalPosition]
+            if mainKey not in contents:
+                contents[mainKey] = {}
+            contents[mainKey][key] = tmpString[equalPosition + 1:]
+        elif len(key) and len(mainKey):
+            contents[mainKey][key] += tmpString
+    return sections, contents
+
+class testSimpleIni(unittest.TestCase):
+    def setUp(self):
+        """
+        import the module
+        """
+        try:
+            from fisx import SimpleIni
+            self.simpleIni = SimpleIni
+        except:
+            self.simpleIni = None
+
+    def tearDown(self):
+        self.simpleIni = None
+
+    def testSimpleIniImport(self):
+        self.assertTrue(self.simpleIni is not None,
+                        'Unsuccessful fisx.SimpleIni import')
+
+    def testSimpleIniVersusReference(self):
+        fd, fileName = tempfile.mkstemp(suffix=".ini")
+        os.close(fd)
+        try:
+            with open(fileName, "wb") as f:
+                f.write(CONTENTS.encode("utf-8"))
+            ini = self.simpleIni(fileName)
+            sections = ini.getKeys()
+            contents = {}
+            for section in sections:
+                contents[section] = ini.readKey(section)
+        finally:
+            os.remove(fileName)
+        if sys.version > "3.0":
+            sections = [x.decode("utf-8") for x in sections]
+            contents = dict([(section.decode("utf-8"),
+                              dict([(key.decode("utf-8"), value.decode("utf-8")) \
+                                    for key, value in contents[section].items()])) \
+                             for section in contents])
+        expectedSections, expectedContents = parseReference(CONTENTS)
+        self.assertTrue(sections == expectedSections,
+                        "Sections %s, expected %s" % (sections, expectedSections))
+        for section in expectedSections:
+            expected = expectedContents.get(section, {})
+            self.assertTrue(contents[section] == expected,
+                            "Section %s: %s, expected %s" % \
+                                (section, contents[section], expected))
+
+def getSuite(auto=True):
+    testSuite = unittest.TestSuite()
+    if auto:
+        testSuite.addTest(\
+            unittest.TestLoader().loadTestsFromTestCase(testSimpleIni))
+    else:
+        # use a predefined order
+        testSuite.addTest(testSimpleIni("testSimpleIniImport"))
+        testSuite.addTest(testSimpleIni("testSimpleIniVersusReference"))
+    return testSuite
+
+def test(auto=False):
+    unittest.TextTestRunner(verbosity=2).run(getSuite(auto=auto))
+
+if __name__ == '__main__':
+    test()
@@ -0,0 +1,115 @@
+import unittest
+import sys
+import os
+
+import numpy
+
+FAMILIES = ["Ca K", "Fe K", "Cu K", "Zn K"]
+
+class testSpectrumFitter(unittest.TestCase):
+    def setUp(self):
+        """
+        import the module
+        """
+        try:
+            from fisx import SpectrumFitter
+            self.spectrumFitter = SpectrumFitter
+        except:
+            self.spectrumFitter = None
+
+    def tearDown(self):
+        self.spectrumFitter = None
+
+    def _getFitter(self):
+        from fisx import DataDir
+        from fisx import Elements
+        from fisx import XRF
+        elementsInstance = Elements(DataDir.FISX_DATA_DIR)
+        xrf = XRF()
+        xrf.setBeam(20.0)
+        xrf.setSample([["Fe", 7.87, 0.001]])
+        xrf.setGeometry(45., 45.)
+        fitter = self.spectrumFitter()
+        fitter.setChannels(numpy.arange(100, 1500))
+        fitter.setDetectorParameters({"Zero": 0.0, "Gain": 0.01, "Noise": 0.1,
+                                      "Fano": 0.114})
+        fitter.setPeakFamilies(FAMILIES,
+                               xrf.getMultilayerFluorescence(FAMILIES, elementsInstance))
+        fitter.setBackgroundDegree(2)
+        return fitter
+
+    def testSpectrumFitterImport(self):
+        self.assertTrue(self.spectrumFitter is not None,
+                        'Unsuccessful fisx.SpectrumFitter import')
+
+    def testSpectrumFitterRecovery(self):
+        fitter = self._getFitter()
+        templates = fitter.getTemplates()
+        self.assertTrue(templates.shape[0] == len(FAMILIES) + 3,
+                        "Unexpected number of templates %d" % templates.shape[0])
+        expected = numpy.array([1000., 5000., 2000., 300., 10., 5., 20.])
+        spectrum = numpy.dot(expected, templates)
+        areas, chiSquare = fitter.fit(spectrum)
+        for i in range(len(expected)):
+            self.assertTrue(abs(areas[i] - expected[i]) < 1.0e-6 * expected.max(),
+                            "Parameter %s, area %g, expected %g" % \
+                                (fitter.getParameterNames()[i], areas[i], expected[i]))
+        self.assertTrue(chiSquare < 1.0e-12 * numpy.dot(spectrum, spectrum),
+                        "Non zero residuals %g" % chiSquare)
+
+    def testSpectrumFitterKKT(self):
+        fitter = self._getFitter()
+        templates = fitter.getTemplates()
+        # a negative Zn contribution and noise force an active constraint
+        numpy.random.seed(0)
+        spectra = []
+        for zinc in [-300., 300.]:
+            spectrum = numpy.dot(numpy.array([1000., 5000., 2000., zinc, 10., 5., 20.]),
+                                 templates)
+            spectra.append(spectrum + numpy.random.normal(0.0, 1.0, spectrum.shape))
+        spectra = numpy.array(spectra)
+        areas, chiSquare = fitter.fit(spectra)
+        self.assertTrue(areas[0, 3] == 0.0,
+                        "Zn area %g instead of zero" % areas[0, 3])
+        for k in range(spectra.shape[0]):
+            residuals = spectra[k] - numpy.dot(areas[k], templates)
+            self.assertTrue(abs(chiSquare[k] - numpy.dot(residuals, residuals)) < \
+                            1.0e-8 * chiSquare[k],
+                            "Spectrum %d, wrong sum of squared residuals" % k)
+            # Karush-Kuhn-Tucker conditions of the non-negative least squares problem
+            gradient = numpy.dot(templates, residuals)
+            for i in range(templates.shape[0]):
+                tolerance = 1.0e-8 * numpy.sqrt(numpy.dot(templates[i], templates[i]) * \
+                                                numpy.dot(spectra[k], spectra[k]))
+                self.assertTrue(areas[k, i] >= 0.0,
+                                "Spectrum %d, negative area %g" % (k, areas[k, i]))
+                if areas[k, i] > 0.0:
+                    self.assertTrue(abs(gradient[i]) < tolerance,
+                        "Spectrum %d, parameter %d, free with gradient %g" % \
+                            (k, i, gradient[i]))
+                else:
+                    self.assertTrue(gradient[i] < tolerance,
+                        "Spectrum %d, parameter %d, bound with gradient %g" % \
+                            (k, i, gradient[i]))
+            # fitting several spectra at once gives the same as one by one
+            single, chi = fitter.fit(spectra[k])
+            self.assertTrue(numpy.allclose(single, areas[k], rtol=1.0e-12, atol=0.0),
+                            "Spectrum %d, different areas when fitted alone" % k)
+
+def getSuite(auto=True):
+    testSuite = unittest.TestSuite()
+    if auto:
+        testSuite.addTest(\
+            unittest.TestLoader().loadTestsFromTestCase(testSpectrumFitter))
+    else:
+        # use a predefined order
+        testSuite.addTest(testSpectrumFitter("testSpectrumFitterImport"))
+        testSuite.addTest(testSpectrumFitter("testSpectrumFitterRecovery"))
+        testSuite.addTest(testSpectrumFitter("testSpectrumFitterKKT"))
+    return testSuite
+
+def test(auto=False):
+    unittest.TextTestRunner(verbosity=2).run(getSuite(auto=auto))
+
+if __name__ == '__main__':
+    test()
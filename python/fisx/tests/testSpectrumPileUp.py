@@ -0,0 +1,115 @@
+import unittest
+import sys
+import os
+
+import numpy
+
+FAMILIES = ["Fe K", "Cu K"]
+AREAS = {"Fe K": 1.0e5, "Cu K": 5.0e4}
+DETECTOR = {"Zero": 0.0, "Gain": 0.01, "Noise": 0.1, "Fano": 0.114}
+COUNT_RATE = 1.0e5
+PILE_UP_TIME = 1.0e-6
+
+class testSpectrumPileUp(unittest.TestCase):
+    def setUp(self):
+        """
+        import the module
+        """
+        try:
+            from fisx import XRF
+            self.xrf = XRF
+        except:
+            self.xrf = None
+
+    def tearDown(self):
+        self.xrf = None
+
+    def _getSpectrum(self, channels, **kw):
+        from fisx import DataDir
+        from fisx import Elements
+        elementsInstance = Elements(DataDir.FISX_DATA_DIR)
+        xrf = self.xrf()
+        xrf.setBeam(20.0)
+        xrf.setSample([["Fe", 7.87, 0.0005], ["Cu", 8.9, 0.0005]])
+        xrf.setGeometry(45., 45.)
+        ratios = xrf.getMultilayerFluorescence(FAMILIES, elementsInstance)
+        detectorParameters = dict(DETECTOR)
+        detectorParameters.update(kw)
+        result = xrf.getSpectrum(channels, detectorParameters, AREAS, ratios)
+        for key in result:
+            result[key] = numpy.array(result[key])
+        return result
+
+    def testSpectrumPileUpImport(self):
+        self.assertTrue(self.xrf is not None,
+                        'Unsuccessful fisx.XRF import')
+
+    def testSpectrumPileUpAbsent(self):
+        channels = numpy.arange(4096.)
+        expected = self._getSpectrum(channels)
+        self.assertTrue(numpy.all(expected["pileup"] == 0.0), "Unexpected pile-up")
+        peaks = expected["Fe K"] + expected["Cu K"]
+        self.assertTrue(numpy.allclose(expected["spectrum"], peaks, rtol=1.0e-12, atol=0.0),
+                        "Spectrum is not the sum of the peak families")
+        # both CountRate and PileUpTime are needed
+        for kw in [{"CountRate": COUNT_RATE}, {"PileUpTime": PILE_UP_TIME}]:
+            obtained = self._getSpectrum(channels, **kw)
+            self.assertTrue(sorted(obtained.keys()) == sorted(expected.keys()),
+                            "Different keys with %s" % kw)
+            for key in expected:
+                self.assertTrue(numpy.array_equal(obtained[key], expected[key]),
+                                "Different %s with %s" % (key, kw))
+
+    def testSpectrumPileUpVersusConvolution(self):
+        channels = numpy.arange(4096.)
+        x = COUNT_RATE * PILE_UP_TIME
+        # the grid of the direct convolution starts at 0 keV with a step equal to the gain
+        peaks = self._getSpectrum(channels)["spectrum"]
+        area = peaks.sum()
+        firstOrder = x * numpy.convolve(peaks, peaks)[:len(peaks)] / area
+        secondOrder = x * x * numpy.convolve(numpy.convolve(peaks, peaks), peaks)[:len(peaks)] / \
+                      (2 * area * area)
+        for order, expected in [[1, firstOrder], [2, firstOrder + secondOrder]]:
+            obtained = self._getSpectrum(channels, CountRate=COUNT_RATE,
+                                         PileUpTime=PILE_UP_TIME, PileUpOrder=order)
+            deviation = numpy.abs(obtained["pileup"] - expected).max() / expected.max()
+            self.assertTrue(deviation < 1.0e-10,
+                            "Order %d, deviation %g from the direct convolution" % \
+                                (order, deviation))
+            if order == 1:
+                # the first order term moves a fraction x of the counts
+                self.assertTrue(abs(obtained["pileup"].sum() / (x * area) - 1.0) < 1.0e-10,
+                                "First order area %g instead of %g" % \
+                                    (obtained["pileup"].sum(), x * area))
+            # the family contributions add up to the total pile-up
+            total = obtained["Fe K pileup"] + obtained["Cu K pileup"]
+            self.assertTrue(numpy.allclose(total, obtained["pileup"], rtol=1.0e-12,
+                                           atol=1.0e-12 * obtained["pileup"].max()),
+                            "Order %d, family pile-up does not add up" % order)
+            self.assertTrue(numpy.allclose(obtained["spectrum"], peaks + obtained["pileup"],
+                                           rtol=1.0e-12, atol=1.0e-12 * peaks.max()),
+                            "Order %d, spectrum is not peaks plus pile-up" % order)
+            # a subset of the channels gives the same values
+            subset = self._getSpectrum(channels[300:3000], CountRate=COUNT_RATE,
+                                       PileUpTime=PILE_UP_TIME, PileUpOrder=order)
+            self.assertTrue(numpy.allclose(subset["pileup"], obtained["pileup"][300:3000],
+                                           rtol=1.0e-12, atol=1.0e-12 * expected.max()),
+                            "Order %d, different pile-up on a subset of channels" % order)
+
+def getSuite(auto=True):
+    testSuite = unittest.TestSuite()
+    if auto:
+        testSuite.addTest(\
+            unittest.TestLoader().loadTestsFromTestCase(testSpectrumPileUp))
+    else:
+        # use a predefined order
+        testSuite.addTest(testSpectrumPileUp("testSpectrumPileUpImport"))
+        testSuite.addTest(testSpectrumPileUp("testSpectrumPileUpAbsent"))
+        testSuite.addTest(testSpectrumPileUp("testSpectrumPileUpVersusConvolution"))
+    return testSuite
+
+def test(auto=False):
+    unittest.TextTestRunner(verbosity=2).run(getSuite(auto=auto))
+
+if __name__ == '__main__':
+    test()
@@ -0,0 +1,73 @@
+import unittest
+import sys
+import os
+
+import numpy
+
+class testStackResponse(unittest.TestCase):
+    def setUp(self):
+        """
+        import the module
+        """
+        try:
+            from fisx import XRF
+            self.xrf = XRF
+        except:
+            self.xrf = None
+
+    def tearDown(self):
+        self.xrf = None
+
+    def testStackResponseImport(self):
+        self.assertTrue(self.xrf is not None,
+                        'Unsuccessful fisx.XRF import')
+
+    def testStackResponseAtEdges(self):
+        from fisx import DataDir
+        from fisx import Elements
+        from fisx import Layer
+        elementsInstance = Elements(DataDir.FISX_DATA_DIR)
+        # foils of an absorbing thickness to get steep jumps at the edges
+        for element, density, thickness in [("Fe", 7.87, 0.002),
+                                            ("Ti", 4.5, 0.002),
+                                            ("Pb", 11.35, 0.0005),
+                                            ("Ar", 0.00166, 10.0),
+                                            ("Zr", 6.5, 0.001)]:
+            xrf = self.xrf()
+            foil = Layer(element, density, thickness, 1.0)
+            xrf.setAttenuators([[element, density, thickness, 1.0]])
+            energy = numpy.array(\
+                elementsInstance.getElementMassAttenuationCoefficients(element)["energy"])
+            # the edges are repeated energies in the tables
+            edges = energy[1:][energy[1:] == energy[:-1]]
+            edges = edges[(edges > 1.0) & (edges < 90.0)]
+            self.assertTrue(len(edges) > 0,
+                            "No edges found for element %s" % element)
+            x = numpy.sort(numpy.concatenate((edges * (1.0 + 1.0e-5),
+                                              edges * (1.0 + 1.0e-3),
+                                              edges * (1.0 - 1.0e-3))))
+            curves = xrf.getStackResponseCurves(elementsInstance, 1.0, 100.0,
+                                                500, energies=x)
+            expected = foil.getTransmission(x, elementsInstance)
+            for i in range(len(x)):
+                delta = abs(curves["attenuators"][i] - expected[i])
+                self.assertTrue(delta < 1.0e-4,
+                    "Element %s, energy = %f, table = %g, direct = %g" %\
+                        (element, x[i], curves["attenuators"][i], expected[i]))
+
+def getSuite(auto=True):
+    testSuite = unittest.TestSuite()
+    if auto:
+        testSuite.addTest(\
+            unittest.TestLoader().loadTestsFromTestCase(testStackResponse))
+    else:
+        # use a predefined order
+        testSuite.addTest(testStackResponse("testStackResponseImport"))
+        testSuite.addTest(testStackResponse("testStackResponseAtEdges"))
+    return testSuite
+
+def test(auto=False):
+    unittest.TextTestRunner(verbosity=2).run(getSuite(auto=auto))
+
+if __name__ == '__main__':
+    test()
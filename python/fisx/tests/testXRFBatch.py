@@ -0,0 +1,112 @@
+import unittest
+import sys
+import os
+
+FAMILIES = ["Fe K", "Cu K"]
+THICKNESSES = [0.0005, 0.001, 0.002, 0.005]
+
+class testXRFBatch(unittest.TestCase):
+    def setUp(self):
+        """
+        import the module
+        """
+        try:
+            from fisx import XRFBatch
+            self.xrfBatch = XRFBatch
+        except:
+            self.xrfBatch = None
+
+    def tearDown(self):
+        self.xrfBatch = None
+
+    def _getConfiguredXRF(self, thickness, material="Cu"):
+        from fisx import XRF
+        xrf = XRF()
+        xrf.setBeam(20.0)
+        xrf.setSample([["Fe", 7.87, 0.0005], [material, 8.9, thickness]])
+        xrf.setGeometry(45., 45.)
+        return xrf
+
+    def testXRFBatchImport(self):
+        self.assertTrue(self.xrfBatch is not None,
+                        'Unsuccessful fisx.XRFBatch import')
+
+    def testXRFBatchRun(self):
+        from fisx import DataDir
+        from fisx import Elements
+        elementsInstance = Elements(DataDir.FISX_DATA_DIR)
+        batch = self.xrfBatch()
+        for thickness in THICKNESSES:
+            batch.addItem(self._getConfiguredXRF(thickness), FAMILIES, secondary=2)
+        # a sample made of an unknown material fails
+        failing = batch.addItem(self._getConfiguredXRF(0.001, "Unobtainium"), FAMILIES)
+        self.assertTrue(batch.getNumberOfItems() == len(THICKNESSES) + 1,
+                        "Got %d items" % batch.getNumberOfItems())
+        calls = []
+        def callback(index, status, result, error):
+            calls.append([index, status, len(result), error])
+        batch.run(elementsInstance, callback)
+
+        # the callback is called once per item
+        self.assertTrue(sorted([call[0] for call in calls]) == \
+                        list(range(batch.getNumberOfItems())),
+                        "Callback calls %s" % [call[0] for call in calls])
+        self.assertTrue([call[0] for call in calls] == list(batch.getCompletionOrder()),
+                        "Callback calls not in completion order")
+        for index, status, size, error in calls:
+            self.assertTrue(status == batch.getStatus(index),
+                            "Item %d, callback status %d" % (index, status))
+            if index == failing:
+                self.assertTrue((size == 0) and len(error),
+                                "Failing item without error message")
+            else:
+                self.assertTrue((size > 0) and (error == ""),
+                                "Item %d, unexpected error %s" % (index, error))
+
+        # the failure does not stop the batch
+        self.assertTrue(batch.getStatus(failing) == self.xrfBatch.FAILED,
+                        "Failing item status %d" % batch.getStatus(failing))
+        self.assertTrue(len(batch.getError(failing)) > 0, "Empty error message")
+        for index in range(len(THICKNESSES)):
+            self.assertTrue(batch.getStatus(index) == self.xrfBatch.DONE,
+                            "Item %d status %d" % (index, batch.getStatus(index)))
+            expected = self._getConfiguredXRF(THICKNESSES[index]).getMultilayerFluorescence( \
+                                                FAMILIES, elementsInstance, secondary=2)
+            self.assertTrue(batch.getResult(index) == expected,
+                            "Item %d, different from the serial calculation" % index)
+
+    def testXRFBatchCallbackException(self):
+        from fisx import DataDir
+        from fisx import Elements
+        elementsInstance = Elements(DataDir.FISX_DATA_DIR)
+        batch = self.xrfBatch()
+        for thickness in THICKNESSES:
+            batch.addItem(self._getConfiguredXRF(thickness), FAMILIES)
+        calls = []
+        def callback(index, status, result, error):
+            calls.append(index)
+            raise KeyError("callback %d" % index)
+        self.assertRaises(KeyError, batch.run, elementsInstance, callback)
+        # the callback is not called again, but the batch is finished
+        self.assertTrue(len(calls) == 1, "Callback called %d times" % len(calls))
+        for index in range(len(THICKNESSES)):
+            self.assertTrue(batch.getStatus(index) == self.xrfBatch.DONE,
+                            "Item %d status %d" % (index, batch.getStatus(index)))
+
+def getSuite(auto=True):
+    testSuite = unittest.TestSuite()
+    if auto:
+        testSuite.addTest(\
+            unittest.TestLoader().loadTestsFromTestCase(testXRFBatch))
+    else:
+        # use a predefined order
+        testSuite.addTest(testXRFBatch("testXRFBatchImport"))
+        testSuite.addTest(testXRFBatch("testXRFBatchRun"))
+        testSuite.addTest(testXRFBatch("testXRFBatchCallbackException"))
+    return testSuite
+
+def test(auto=False):
+    unittest.TextTestRunner(verbosity=2).run(getSuite(auto=auto))
+
+if __name__ == '__main__':
+    test()
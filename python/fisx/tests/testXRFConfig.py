@@ -0,0 +1,111 @@
+import unittest
+import sys
+import os
+import tempfile
+
+import numpy
+
+class testXRFConfig(unittest.TestCase):
+    def setUp(self):
+        """
+        import the module
+        """
+        try:
+            from fisx import XRF
+            self.xrf = XRF
+        except:
+            self.xrf = None
+
+    def tearDown(self):
+        self.xrf = None
+
+    def _getConfiguredXRF(self, thickness=0.1):
+        from fisx import Detector
+        xrf = self.xrf()
+        xrf.setBeam(numpy.linspace(10., 20., 5), numpy.ones(5))
+        xrf.setBeamFilters([["Al1", 2.7, 0.01, 1.0]])
+        xrf.setSample([["Fe", 7.87, 0.001], ["Cu", 8.9, thickness]])
+        xrf.setAttenuators([["Be", 1.848, 0.002, 1.0]])
+        detector = Detector("Si1", 2.33, 0.035)
+        detector.setActiveArea(30.)
+        detector.setDistance(5.)
+        xrf.setDetector(detector)
+        xrf.setGeometry(45., 30.)
+        return xrf
+
+    def testXRFConfigImport(self):
+        self.assertTrue(self.xrf is not None,
+                        'Unsuccessful fisx.XRF import')
+
+    def testXRFConfigSnapshotRoundTrip(self):
+        from fisx import DataDir
+        from fisx import Elements
+        elementsInstance = Elements(DataDir.FISX_DATA_DIR)
+        xrf = self._getConfiguredXRF()
+        snapshot = xrf.getConfigurationSnapshot()
+        restored = self.xrf()
+        restored.setConfigurationSnapshot(snapshot)
+        self.assertTrue(restored.getConfigurationSnapshot() == snapshot,
+                        "Snapshot changed by a round trip")
+        self.assertTrue(restored.getConfigurationHash() == xrf.getConfigurationHash(),
+                        "Hash changed by a round trip")
+
+        # the restored configuration gives the same results
+        expected = xrf.getMultilayerFluorescence(["Fe K", "Cu K"], elementsInstance,
+                                                 secondary=2)
+        obtained = restored.getMultilayerFluorescence(["Fe K", "Cu K"], elementsInstance,
+                                                      secondary=2)
+        for family in expected:
+            for layer in expected[family]:
+                for line in expected[family][layer]:
+                    for key in expected[family][layer][line]:
+                        self.assertTrue(obtained[family][layer][line][key] == \
+                                        expected[family][layer][line][key],
+                            "Family %s layer %d line %s key %s differs" % \
+                                (family, layer, line, key))
+
+        # and the same for the file format
+        fd, fileName = tempfile.mkstemp(suffix=".fisx")
+        os.close(fd)
+        try:
+            xrf.saveConfigurationToFile(fileName)
+            if sys.version > "3.0":
+                restored = self.xrf(fileName.encode())
+            else:
+                restored = self.xrf(fileName)
+        finally:
+            os.remove(fileName)
+        self.assertTrue(restored.getConfigurationSnapshot() == snapshot,
+                        "Configuration changed by a file round trip")
+
+    def testXRFConfigHashStability(self):
+        xrf = self._getConfiguredXRF()
+        hashValue = xrf.getConfigurationHash()
+        self.assertTrue(len(hashValue) > 0, "Empty hash")
+        self.assertTrue(xrf.getConfigurationHash() == hashValue,
+                        "Hash changed without changing the configuration")
+        self.assertTrue(self._getConfiguredXRF().getConfigurationHash() == hashValue,
+                        "Identical configurations give different hashes")
+        self.assertTrue(self._getConfiguredXRF(0.2).getConfigurationHash() != hashValue,
+                        "Different configurations give the same hash")
+        xrf.setGeometry(45., 45.)
+        self.assertTrue(xrf.getConfigurationHash() != hashValue,
+                        "Hash not changed by the geometry")
+
+def getSuite(auto=True):
+    testSuite = unittest.TestSuite()
+    if auto:
+        testSuite.addTest(\
+            unittest.TestLoader().loadTestsFromTestCase(testXRFConfig))
+    else:
+        # use a predefined order
+        testSuite.addTest(testXRFConfig("testXRFConfigImport"))
+        testSuite.addTest(testXRFConfig("testXRFConfigSnapshotRoundTrip"))
+        testSuite.addTest(testXRFConfig("testXRFConfigHashStability"))
+    return testSuite
+
+def test(auto=False):
+    unittest.TextTestRunner(verbosity=2).run(getSuite(auto=auto))
+
+if __name__ == '__main__':
+    test()
@@ -22,6 +22,73 @@ def use_cython():
         return False
     return True
 
+# check if OpenMP is to be used for the parallel parts of the library
+def use_openmp():
+    """
+    Check if OpenMP is requested from the command line or the environment.
+    """
+    if "WITH_OPENMP" in os.environ:
+        if os.environ["WITH_OPENMP"] == "True":
+            print("OpenMP requested by environment")
+            return True
+
+    if ("--openmp" in sys.argv):
+        sys.argv.remove("--openmp")
+        os.environ["WITH_OPENMP"] = "True"
+        print("OpenMP requested by command line")
+        return True
+    return False
+
+# check if the phase timers and operation counters are to be compiled
+def use_profile():
+    """
+    Check if the instrumentation is requested from the command line or the environment.
+    """
+    if "WITH_PROFILE" in os.environ:
+        if os.environ["WITH_PROFILE"] == "True":
+            print("Instrumentation requested by environment")
+            return True
+
+    if ("--profile" in sys.argv):
+        sys.argv.remove("--profile")
+        os.environ["WITH_PROFILE"] = "True"
+        print("Instrumentation requested by command line")
+        return True
+    return False
+
+# check if the finiteness checks of the math kernels arguments are to be skipped
+def use_unchecked():
+    """
+    Check if the unchecked kernels are requested from the command line or the environment.
+    """
+    if "WITH_UNCHECKED" in os.environ:
+        if os.environ["WITH_UNCHECKED"] == "True":
+            print("Unchecked kernels requested by environment")
+            return True
+
+    if ("--unchecked" in sys.argv):
+        sys.argv.remove("--unchecked")
+        os.environ["WITH_UNCHECKED"] = "True"
+        print("Unchecked kernels requested by command line")
+        return True
+    return False
+
+# get the minimum level of the diagnostic messages to be compiled
+def get_log_level():
+    """
+    Get the level (0 debug, 1 info, 2 warning, 3 error, 4 none) from the command line
+    (--log-level=N) or the environment (FISX_LOG_LEVEL). None if not given.
+    """
+    for arg in sys.argv[:]:
+        if arg.startswith("--log-level="):
+            sys.argv.remove(arg)
+            os.environ["FISX_LOG_LEVEL"] = arg.split("=")[-1]
+    if "FISX_LOG_LEVEL" in os.environ:
+        level = int(os.environ["FISX_LOG_LEVEL"])
+        print("Diagnostics log level %d requested" % level)
+        return level
+    return None
+
 if use_cython():
     try:
         from Cython.Distutils import build_ext
@@ -108,6 +175,59 @@ class smart_install_data(install_data):
         print("fisx to be installed in %s" %  self.install_dir)
         return install_data.run(self)
 
+from distutils.core import Command
+class build_benchmark(Command):
+    """
+    Build the fisx_benchmark executable of the benchmarks directory.
+
+    Run it as: fisx_benchmark [--min-time seconds] [--filter text] [--output file] dataDirectory
+    """
+    description = "build the C++ benchmark executable"
+    user_options = [('build-temp=', 't', "directory for temporary files and the executable")]
+
+    def initialize_options(self):
+        self.build_temp = None
+
+    def finalize_options(self):
+        self.set_undefined_options('build', ('build_temp', 'build_temp'))
+
+    def run(self):
+        from distutils.ccompiler import new_compiler
+        from distutils.sysconfig import customize_compiler
+        topDir = os.path.dirname(os.path.abspath(__file__))
+        sources = glob.glob(os.path.join(topDir, 'src', 'fisx_*.cpp'))
+        sources.append(os.path.join(topDir, 'benchmarks', 'fisx_benchmark.cpp'))
+        compiler = new_compiler(verbose=self.verbose, dry_run=self.dry_run)
+        customize_compiler(compiler)
+        if sys.platform == 'win32':
+            compileArgs = ['/EHsc', '/O2']
+        else:
+            compileArgs = ['-O2']
+        linkArgs = []
+        macros = []
+        if use_profile():
+            macros.append(('FISX_PROFILE', None))
+        if use_unchecked():
+            macros.append(('FISX_UNCHECKED', None))
+        logLevel = get_log_level()
+        if logLevel is not None:
+            macros.append(('FISX_LOG_LEVEL', str(logLevel)))
+        if use_openmp():
+            if sys.platform == 'win32':
+                compileArgs.append('/openmp')
+            else:
+                compileArgs.append('-fopenmp')
+                linkArgs.append('-fopenmp')
+        objects = compiler.compile(sources,
+                                   output_dir=self.build_temp,
+                                   include_dirs=[os.path.join(topDir, 'src')],
+                                   macros=macros,
+                                   extra_postargs=compileArgs)
+        compiler.link_executable(objects, 'fisx_benchmark',
+                                 output_dir=self.build_temp,
+                                 extra_postargs=linkArgs,
+                                 target_lang='c++')
+
 topLevel = os.path.dirname(os.path.abspath(__file__))
 fileList = glob.glob(os.path.join(topLevel, "fisx_data", "*.dat"))
 fileList.append(os.path.join(topLevel, "changelog.txt"))
@@ -137,7 +257,8 @@ if build_ext:
         except:
             print("WARNING: Could not delete file. Assuming up-to-date.")
     if not os.path.exists(multiple_pyx):
-        pyx = glob.glob(os.path.join(cython_dir, "*pyx"))
+        # sorted to get the same module on every platform
+        pyx = sorted(glob.glob(os.path.join(cython_dir, "Py*.pyx")))
         f = open(multiple_pyx, 'wb')
         for fname in pyx:
             inFile = open(fname, 'rb')
@@ -145,6 +266,8 @@ if build_ext:
             inFile.close()
             for line in lines:
                 f.write(line)
+            # the last line of a file may not end with a newline
+            f.write(b"\n")
         f.close()
     src = [multiple_pyx]
 else:
@@ -158,14 +281,29 @@ include_dirs = [numpy.get_include(),
 if sys.platform == 'win32':
     extra_compile_args = ['/EHsc']
     extra_link_args = []
+    if use_openmp():
+        extra_compile_args.append('/openmp')
 else:
     extra_compile_args = []
     extra_link_args = []
+    if use_openmp():
+        extra_compile_args.append('-fopenmp')
+        extra_link_args.append('-fopenmp')
+
+define_macros = []
+if use_profile():
+    define_macros.append(('FISX_PROFILE', None))
+if use_unchecked():
+    define_macros.append(('FISX_UNCHECKED', None))
+logLevel = get_log_level()
+if logLevel is not None:
+    define_macros.append(('FISX_LOG_LEVEL', str(logLevel)))
 
 def buildExtension():
     module = Extension(name="fisx._fisx",
                     sources=src,
                     include_dirs=include_dirs,
+                    define_macros=define_macros,
                     extra_compile_args=extra_compile_args,
                     extra_link_args=extra_link_args,
                     language="c++",
@@ -177,6 +315,7 @@ ext_modules = [buildExtension()]
 cmdclass = {'install_data':smart_install_data,
             'build_py':smart_build_py,
             'build_ext': build_ext,
+            'build_benchmark': build_benchmark,
             }
 
 description = "Quantitative X-Ray Fluorescence Analysis Support Library"
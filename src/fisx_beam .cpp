@@ -1,5 +1,8 @@
 #include "fisx_beam.h"
+#include "fisx_math.h"
 #include <algorithm>
+#include <cmath>
+#include <stdexcept>
 
 namespace fisx
 {
@@ -184,36 +187,321 @@ void Beam::normalizeBeam()
 }
 
 std::vector<std::vector<double> > Beam::getBeamAsDoubleVectors() const
+{
+    std::vector<std::vector<double> >returnValue;
+
+    this->getBeamAsDoubleVectors(returnValue);
+    return returnValue;
+}
+
+void Beam::getBeamAsDoubleVectors(std::vector<std::vector<double> > & returnValue) const
 {
     std::vector<double>::size_type nItems;
     std::vector<Ray>::size_type c_it;
-    std::vector<std::vector<double> >returnValue;
     const Ray *ray;
 
-    //if (!this->normalized)
-    //{
-    //    this->normalizeBeam();
-    //}
     nItems = this->rays.size();
     returnValue.resize(4);
-    if (nItems > 0)
+    returnValue[0].resize(nItems);
+    returnValue[1].resize(nItems);
+    returnValue[2].resize(nItems);
+    returnValue[3].resize(nItems);
+    for(c_it = 0; c_it < nItems; c_it++)
     {
-        returnValue[0].resize(nItems);
-        returnValue[1].resize(nItems);
-        returnValue[2].resize(nItems);
-        returnValue[3].resize(nItems);
-        for(c_it = 0; c_it < nItems; c_it++)
+        ray = &(this->rays[c_it]);
+        returnValue[0][c_it] = (*ray).energy;
+        returnValue[1][c_it] = (*ray).weight;
+        returnValue[2][c_it] = (*ray).characteristic;
+        returnValue[3][c_it] = (*ray).divergency;
+    }
+}
+
+
+// response at energy interpolated in log-log scale between the rays first to last of a group
+static double interpolateResponse(const std::vector<double> & energies, const std::vector<double> & response, \
+                                  const std::vector<int> & group, const double & energy)
+{
+    std::vector<int>::size_type k;
+    double e0, e1, r0, r1;
+
+    k = 1;
+    while ((k < (group.size() - 1)) && (energies[group[k]] < energy))
+    {
+        k++;
+    }
+    e0 = energies[group[k - 1]];
+    e1 = energies[group[k]];
+    r0 = response[group[k - 1]];
+    r1 = response[group[k]];
+    if (e1 <= e0)
+    {
+        return 0.5 * (r0 + r1);
+    }
+    if ((r0 > 0.0) && (r1 > 0.0) && (e0 > 0.0) && (energy > 0.0))
+    {
+        return r0 * std::exp(std::log(r1 / r0) * std::log(energy / e0) / std::log(e1 / e0));
+    }
+    return r0 + (r1 - r0) * (energy - e0) / (e1 - e0);
+}
+
+double Beam::compress(const std::vector<double> & edges, const double & tolerance, \
+                      const std::vector<std::vector<double> > & responses)
+{
+    const int MAXIMUM_NUMBER_OF_NODES = 16;
+    std::vector<std::vector<double> > actualResponses;
+    std::vector<double> sortedEdges;
+    std::vector<double> energies;
+    std::vector<double> totals, dropped, errors;
+    std::vector<std::vector<int> > groups;
+    std::vector<std::vector<double> > groupSums;
+    std::vector<std::pair<double, int> > groupOrder;
+    std::vector<bool> droppedGroup;
+    std::vector<Ray> newRays;
+    std::vector<double> x, w, nodes, nodeWeights, groupErrors, rangeSums;
+    std::vector<std::pair<int, int> > pending;
+    std::vector<Ray>::size_type i, nRays;
+    std::vector<std::vector<double> >::size_type j;
+    std::vector<std::vector<int> >::size_type g;
+    std::vector<int>::size_type k;
+    int nNodes, groupSize, first, interval, lastInterval;
+    bool mixed, mergeable, accepted, fits;
+    double value, divergency, estimatedError;
+    Ray ray;
+
+    if (!(tolerance > 0.0))
+    {
+        throw std::invalid_argument("Beam::compress. Tolerance must be positive");
+    }
+    nRays = this->rays.size();
+    if (nRays < 2)
+    {
+        return 0.0;
+    }
+    energies.resize(nRays);
+    for (i = 0; i < nRays; i++)
+    {
+        energies[i] = this->rays[i].energy;
+    }
+    if (responses.size())
+    {
+        for (j = 0; j < responses.size(); j++)
         {
-            ray = &(this->rays[c_it]);
-            returnValue[0][c_it] = (*ray).energy;
-            returnValue[1][c_it] = (*ray).weight;
-            returnValue[2][c_it] = (*ray).characteristic;
-            returnValue[3][c_it] = (*ray).divergency;
+            if (responses[j].size() != nRays)
+            {
+                throw std::invalid_argument("Beam::compress. Responses must have one value per ray");
+            }
+        }
+        actualResponses = responses;
+    }
+    else
+    {
+        actualResponses.resize(2);
+        actualResponses[0].resize(nRays);
+        actualResponses[1].resize(nRays);
+        for (i = 0; i < nRays; i++)
+        {
+            actualResponses[0][i] = 1.0 / energies[i];
+            actualResponses[1][i] = actualResponses[0][i] * actualResponses[0][i] * actualResponses[0][i];
+        }
+    }
+    sortedEdges = edges;
+    std::sort(sortedEdges.begin(), sortedEdges.end());
+
+    // characteristic rays are only kept apart when the beam also has other rays
+    mixed = false;
+    for (i = 1; i < nRays; i++)
+    {
+        if ((this->rays[i].characteristic != 0) != (this->rays[0].characteristic != 0))
+        {
+            mixed = true;
+            break;
+        }
+    }
+
+    // group the mergeable rays lying between the same pair of edges, the rays are ordered
+    totals.resize(actualResponses.size(), 0.0);
+    lastInterval = -1;
+    for (i = 0; i < nRays; i++)
+    {
+        if (!(this->rays[i].weight > 0.0))
+        {
+            continue;
+        }
+        for (j = 0; j < actualResponses.size(); j++)
+        {
+            totals[j] += this->rays[i].weight * actualResponses[j][i];
+        }
+        mergeable = (!mixed) || (this->rays[i].characteristic == 0);
+        if (!mergeable)
+        {
+            newRays.push_back(this->rays[i]);
+            continue;
+        }
+        interval = (int) (std::upper_bound(sortedEdges.begin(), sortedEdges.end(), energies[i]) - \
+                          sortedEdges.begin());
+        if ((interval != lastInterval) || (groups.size() == 0))
+        {
+            groups.push_back(std::vector<int>());
+            lastInterval = interval;
+        }
+        groups.back().push_back((int) i);
+    }
+    groupSums.resize(groups.size());
+    for (g = 0; g < groups.size(); g++)
+    {
+        groupSums[g].resize(actualResponses.size(), 0.0);
+        for (k = 0; k < groups[g].size(); k++)
+        {
+            for (j = 0; j < actualResponses.size(); j++)
+            {
+                groupSums[g][j] += this->rays[groups[g][k]].weight * actualResponses[j][groups[g][k]];
+            }
         }
     }
-    return returnValue;
-}
 
+    // drop the groups with the smallest contributions using half of the error budget
+    dropped.resize(actualResponses.size(), 0.0);
+    droppedGroup.resize(groups.size(), false);
+    for (g = 0; g < groups.size(); g++)
+    {
+        value = 0.0;
+        for (j = 0; j < actualResponses.size(); j++)
+        {
+            if (totals[j] > 0.0)
+            {
+                value = std::max(value, groupSums[g][j] / totals[j]);
+            }
+        }
+        groupOrder.push_back(std::make_pair(value, (int) g));
+    }
+    std::sort(groupOrder.begin(), groupOrder.end());
+    for (g = 0; g < groupOrder.size(); g++)
+    {
+        fits = true;
+        for (j = 0; j < actualResponses.size(); j++)
+        {
+            if ((dropped[j] + groupSums[groupOrder[g].second][j]) > (0.5 * tolerance * totals[j]))
+            {
+                fits = false;
+                break;
+            }
+        }
+        if (!fits)
+        {
+            break;
+        }
+        for (j = 0; j < actualResponses.size(); j++)
+        {
+            dropped[j] += groupSums[groupOrder[g].second][j];
+        }
+        droppedGroup[groupOrder[g].second] = true;
+    }
+
+    // smallest quadrature of each group keeping its sums within the other half of the budget,
+    // the groups that cannot be reduced are bisected until they become too small to gain anything
+    errors.resize(actualResponses.size(), 0.0);
+    nodes.resize(MAXIMUM_NUMBER_OF_NODES);
+    nodeWeights.resize(MAXIMUM_NUMBER_OF_NODES);
+    for (g = 0; g < groups.size(); g++)
+    {
+        if (droppedGroup[g])
+        {
+            continue;
+        }
+        pending.clear();
+        pending.push_back(std::make_pair(0, (int) groups[g].size()));
+        while (pending.size())
+        {
+            first = pending.back().first;
+            groupSize = pending.back().second - first;
+            pending.pop_back();
+            x.resize(groupSize);
+            w.resize(groupSize);
+            rangeSums.assign(actualResponses.size(), 0.0);
+            divergency = 0.0;
+            value = 0.0;
+            for (k = 0; k < (std::vector<int>::size_type) groupSize; k++)
+            {
+                i = groups[g][first + k];
+                x[k] = energies[i];
+                w[k] = this->rays[i].weight;
+                divergency += w[k] * this->rays[i].divergency;
+                value += w[k];
+                for (j = 0; j < actualResponses.size(); j++)
+                {
+                    rangeSums[j] += w[k] * actualResponses[j][i];
+                }
+            }
+            divergency /= value;
+            accepted = false;
+            groupErrors.assign(actualResponses.size(), 0.0);
+            for (nNodes = 1; (nNodes < groupSize) && (nNodes <= MAXIMUM_NUMBER_OF_NODES); nNodes++)
+            {
+                Math::gaussQuadrature(&x[0], &w[0], groupSize, nNodes, &nodes[0], &nodeWeights[0]);
+                accepted = true;
+                for (j = 0; j < actualResponses.size(); j++)
+                {
+                    value = 0.0;
+                    for (k = 0; k < (std::vector<int>::size_type) nNodes; k++)
+                    {
+                        value += nodeWeights[k] * \
+                                 interpolateResponse(energies, actualResponses[j], groups[g], nodes[k]);
+                    }
+                    groupErrors[j] = std::fabs(value - rangeSums[j]);
+                    if (groupErrors[j] > (0.5 * tolerance * rangeSums[j]))
+                    {
+                        accepted = false;
+                        break;
+                    }
+                }
+                if (accepted)
+                {
+                    break;
+                }
+            }
+            if (accepted)
+            {
+                for (k = 0; k < (std::vector<int>::size_type) nNodes; k++)
+                {
+                    ray.energy = nodes[k];
+                    ray.weight = nodeWeights[k];
+                    ray.characteristic = mixed ? 0 : this->rays[0].characteristic;
+                    ray.divergency = divergency;
+                    newRays.push_back(ray);
+                }
+                for (j = 0; j < actualResponses.size(); j++)
+                {
+                    errors[j] += groupErrors[j];
+                }
+            }
+            else if (groupSize > MAXIMUM_NUMBER_OF_NODES)
+            {
+                pending.push_back(std::make_pair(first, first + groupSize / 2));
+                pending.push_back(std::make_pair(first + groupSize / 2, first + groupSize));
+            }
+            else
+            {
+                // the rays cannot be reduced within tolerance
+                for (k = 0; k < (std::vector<int>::size_type) groupSize; k++)
+                {
+                    newRays.push_back(this->rays[groups[g][first + k]]);
+                }
+            }
+        }
+    }
+
+    estimatedError = 0.0;
+    for (j = 0; j < actualResponses.size(); j++)
+    {
+        if (totals[j] > 0.0)
+        {
+            estimatedError = std::max(estimatedError, (errors[j] + dropped[j]) / totals[j]);
+        }
+    }
+    std::sort(newRays.begin(), newRays.end());
+    this->rays = newRays;
+    return estimatedError;
+}
 
 const std::vector<Ray> & Beam::getBeam()
 {
@@ -222,6 +510,40 @@ const std::vector<Ray> & Beam::getBeam()
     return this->rays;
 }
 
+void Beam::writeBinary(BinaryWriter & writer) const
+{
+    std::vector<Ray>::size_type i;
+
+    writer.write((int) this->normalized);
+    writer.write((int) this->rays.size());
+    for (i = 0; i < this->rays.size(); i++)
+    {
+        writer.write(this->rays[i].energy);
+        writer.write(this->rays[i].weight);
+        writer.write(this->rays[i].characteristic);
+        writer.write(this->rays[i].divergency);
+    }
+}
+
+void Beam::readBinary(BinaryReader & reader)
+{
+    int i, n, flag;
+    Ray ray;
+
+    reader.read(flag);
+    this->normalized = (flag != 0);
+    reader.read(n);
+    this->rays.clear();
+    for (i = 0; i < n; i++)
+    {
+        reader.read(ray.energy);
+        reader.read(ray.weight);
+        reader.read(ray.characteristic);
+        reader.read(ray.divergency);
+        this->rays.push_back(ray);
+    }
+}
+
 std::ostream& operator<< (std::ostream& o, Beam const & beam)
 {
     std::vector<Ray>::size_type i;
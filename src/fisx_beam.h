@@ -3,6 +3,7 @@
 #include <cstddef> // needed for NULL definition!!!
 #include <vector>
 #include <iostream>
+#include "fisx_binarystream.h"
 
 namespace fisx
 {
@@ -32,7 +33,7 @@ struct Ray
   \class Beam
   \brief Class describing an X-ray beam
 
-   At this point a beam is described by a set of energies and weights. The characteristic flag just indicates if
+   At this point a beam is described by a set of energies and weights. The characteristic flag just indicates if
    it is an energy to be considered for calculation of scattering peaks.
 */
 class Beam
@@ -82,6 +83,45 @@ public:
     */
     std::vector<std::vector<double> > getBeamAsDoubleVectors() const;
 
+    /*!
+    Same as above filling the supplied vector. The inner vectors are resized in place and
+    therefore do not allocate memory when reused with a beam of the same number of rays.
+    */
+    void getBeamAsDoubleVectors(std::vector<std::vector<double> > & result) const;
+
+    /*!
+    Reduce the number of rays keeping the weighted sums of a set of responses within tolerance.
+
+    The rays between two consecutive absorption edges are replaced by the nodes and weights of
+    the smallest Gaussian quadrature of their weights reproducing the sums of the responses
+    over them. The smallest groups of rays are dropped when their contribution is negligible.
+    Their weight is not given to the remaining rays, since that would change the sums of the
+    responses by the relative weight dropped and not by the relative contribution dropped, so the
+    total weight of the beam decreases.
+    When the beam mixes characteristic and non characteristic rays, only the latter are merged.
+
+    edges - absorption edge energies (keV) of the elements of the sample, filters, attenuators
+    and detector. The responses are expected to be smooth between them.
+
+    tolerance - target relative accuracy of the weighted sums of the responses.
+
+    responses - values of positive functions at each ray (in the order given by getBeamAsDoubleVectors).
+    They are interpolated in log-log scale at the new energies. If empty, 1/E and 1/E^3 are used.
+
+    Returns the largest relative change among the weighted sums, measured with the responses
+    interpolated at the new energies. It is a heuristic estimate, the sums of other functions can
+    change more.
+    */
+    double compress(const std::vector<double> & edges, const double & tolerance, \
+                    const std::vector<std::vector<double> > & responses = \
+                                                        std::vector<std::vector<double> >());
+
+    /*!
+    Write or read the complete state of the instance (see XRFConfig::getSnapshot).
+    */
+    void writeBinary(BinaryWriter & writer) const;
+    void readBinary(BinaryReader & reader);
+
 private:
     bool normalized;
     void normalizeBeam(void);
@@ -0,0 +1,176 @@
+#include "fisx_binarystream.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace fisx
+{
+
+const int BINARY_STREAM_BYTE_ORDER_MARK = 0x01020304;
+
+BinaryWriter::BinaryWriter(std::vector<char> & buffer)
+{
+    this->buffer = &buffer;
+}
+
+void BinaryWriter::writeHeader(const std::string & tag, const int & version)
+{
+    this->write(tag);
+    this->write(BINARY_STREAM_BYTE_ORDER_MARK);
+    this->write((int) sizeof(double));
+    this->write(version);
+}
+
+void BinaryWriter::writeBytes(const void * data, const std::size_t & size)
+{
+    std::size_t offset;
+
+    if (size < 1)
+    {
+        return;
+    }
+    offset = this->buffer->size();
+    this->buffer->resize(offset + size);
+    std::memcpy(&(*this->buffer)[offset], data, size);
+}
+
+void BinaryWriter::write(const int & value)
+{
+    this->writeBytes(&value, sizeof(int));
+}
+
+void BinaryWriter::write(const double & value)
+{
+    this->writeBytes(&value, sizeof(double));
+}
+
+void BinaryWriter::write(const std::string & value)
+{
+    this->write((int) value.size());
+    this->writeBytes(value.data(), value.size());
+}
+
+void BinaryWriter::write(const std::vector<double> & values)
+{
+    this->write((int) values.size());
+    if (values.size() > 0)
+    {
+        this->writeBytes(&values[0], values.size() * sizeof(double));
+    }
+}
+
+BinaryReader::BinaryReader(const char * buffer, const std::size_t & size)
+{
+    this->buffer = buffer;
+    this->size = size;
+    this->position = 0;
+}
+
+int BinaryReader::readHeader(const std::string & tag)
+{
+    std::string readTag;
+    int marker;
+    int doubleSize;
+    int version;
+
+    if (!this->checkTag(tag))
+    {
+        throw std::runtime_error("BinaryReader. Buffer does not contain " + tag + " data");
+    }
+    this->read(readTag);
+    this->read(marker);
+    this->read(doubleSize);
+    if ((marker != BINARY_STREAM_BYTE_ORDER_MARK) || (doubleSize != (int) sizeof(double)))
+    {
+        throw std::runtime_error("BinaryReader. " + tag + " data written on an incompatible platform");
+    }
+    this->read(version);
+    return version;
+}
+
+bool BinaryReader::checkTag(const std::string & tag) const
+{
+    int length;
+
+    // check the length of the tag before trusting the buffer
+    if (this->getRemainingSize() < (sizeof(int) + tag.size()))
+    {
+        return false;
+    }
+    std::memcpy(&length, this->buffer + this->position, sizeof(int));
+    if (length != (int) tag.size())
+    {
+        return false;
+    }
+    return (tag.compare(0, tag.size(), this->buffer + this->position + sizeof(int), tag.size()) == 0);
+}
+
+void BinaryReader::readBytes(void * data, const std::size_t & size)
+{
+    if (size > this->getRemainingSize())
+    {
+        throw std::runtime_error("BinaryReader. Unexpected end of buffer");
+    }
+    if (size > 0)
+    {
+        std::memcpy(data, this->buffer + this->position, size);
+        this->position += size;
+    }
+}
+
+std::size_t BinaryReader::getRemainingSize() const
+{
+    return this->size - this->position;
+}
+
+int BinaryReader::readSize()
+{
+    int n;
+
+    this->read(n);
+    if ((n < 0) || ((std::size_t) n > this->getRemainingSize()))
+    {
+        // every element takes at least one byte
+        throw std::runtime_error("BinaryReader. Invalid size found in buffer");
+    }
+    return n;
+}
+
+void BinaryReader::read(int & value)
+{
+    this->readBytes(&value, sizeof(int));
+}
+
+void BinaryReader::read(double & value)
+{
+    this->readBytes(&value, sizeof(double));
+}
+
+void BinaryReader::read(std::string & value)
+{
+    int n;
+
+    n = this->readSize();
+    if (n > 0)
+    {
+        value.assign(this->buffer + this->position, n);
+        this->position += n;
+    }
+    else
+    {
+        value.clear();
+    }
+}
+
+void BinaryReader::read(std::vector<double> & values)
+{
+    int n;
+
+    n = this->readSize();
+    values.resize(n);
+    if (n > 0)
+    {
+        this->readBytes(&values[0], n * sizeof(double));
+    }
+}
+
+} // namespace fisx
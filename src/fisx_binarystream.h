@@ -0,0 +1,139 @@
+#ifndef FISX_BINARYSTREAM_H
+#define FISX_BINARYSTREAM_H
+#include <string>
+#include <vector>
+#include <map>
+#include <cstddef>
+
+namespace fisx
+{
+
+/*!
+  \class BinaryWriter
+  \brief Serialization of library data into a flat buffer
+
+   Values are appended to the supplied buffer in native byte order without any pointer, so
+   the buffer can be copied, written to a file or placed in shared memory and read back by
+   BinaryReader at any address. Sizes are stored as int.
+*/
+class BinaryWriter
+{
+public:
+    BinaryWriter(std::vector<char> & buffer);
+
+    /*!
+    Write a tag identifying the content and its format version, together with markers to
+    detect a buffer written on a platform with a different byte order or double size.
+    */
+    void writeHeader(const std::string & tag, const int & version);
+
+    void write(const int & value);
+    void write(const double & value);
+    void write(const std::string & value);
+    void write(const std::vector<double> & values);
+
+    template<typename T>
+    void write(const std::vector<T> & values)
+    {
+        typename std::vector<T>::size_type i;
+
+        this->write((int) values.size());
+        for (i = 0; i < values.size(); i++)
+        {
+            this->write(values[i]);
+        }
+    };
+
+    template<typename T>
+    void write(const std::map<std::string, T> & values)
+    {
+        typename std::map<std::string, T>::const_iterator c_it;
+
+        this->write((int) values.size());
+        for (c_it = values.begin(); c_it != values.end(); ++c_it)
+        {
+            this->write(c_it->first);
+            this->write(c_it->second);
+        }
+    };
+
+    void writeBytes(const void * data, const std::size_t & size);
+
+private:
+    std::vector<char> * buffer;
+};
+
+/*!
+  \class BinaryReader
+  \brief Reading of a buffer written by BinaryWriter
+
+   The buffer is not copied and it has to remain valid while the reader is in use.
+   Reading beyond the end of the buffer throws std::runtime_error.
+*/
+class BinaryReader
+{
+public:
+    BinaryReader(const char * buffer, const std::size_t & size);
+
+    /*!
+    Check the tag and the platform markers written by BinaryWriter::writeHeader and return the
+    format version. Throws std::runtime_error if the buffer was not written with that tag or
+    on a compatible platform.
+    */
+    int readHeader(const std::string & tag);
+
+    /*!
+    Return true if the unread part of the buffer starts with the given header tag.
+    Nothing is consumed.
+    */
+    bool checkTag(const std::string & tag) const;
+
+    void read(int & value);
+    void read(double & value);
+    void read(std::string & value);
+    void read(std::vector<double> & values);
+
+    template<typename T>
+    void read(std::vector<T> & values)
+    {
+        typename std::vector<T>::size_type i;
+
+        values.resize(this->readSize());
+        for (i = 0; i < values.size(); i++)
+        {
+            this->read(values[i]);
+        }
+    };
+
+    template<typename T>
+    void read(std::map<std::string, T> & values)
+    {
+        int i, n;
+        std::string key;
+
+        values.clear();
+        n = this->readSize();
+        for (i = 0; i < n; i++)
+        {
+            this->read(key);
+            this->read(values[key]);
+        }
+    };
+
+    void readBytes(void * data, const std::size_t & size);
+
+    /*!
+    Number of bytes not read yet.
+    */
+    std::size_t getRemainingSize() const;
+
+private:
+    int readSize();
+    const char * buffer;
+    std::size_t size;
+    std::size_t position;
+};
+
+} // namespace fisx
+
+#endif // FISX_BINARYSTREAM_H
@@ -0,0 +1,617 @@
+#include "fisx_compositionengine.h"
+#include "fisx_xrf.h"
+#include "fisx_math.h"
+#include "fisx_logger.h"
+#include <cmath>
+#include <stdexcept>
+#include <algorithm>
+
+namespace fisx
+{
+
+CompositionEngine::CompositionEngine()
+{
+    this->secondary = 0;
+    this->sinAlphaIn = 1.0;
+    this->sinAlphaOut = 1.0;
+    this->density = 0.0;
+    this->thickness = 0.0;
+    this->nBeamRays = 0;
+}
+
+CompositionEngine::CompositionEngine(const XRFConfig & configuration, \
+                                     const Elements & elementsLibrary, \
+                                     const std::vector<std::string> & elementList, \
+                                     const std::vector<std::string> & elementFamilyList, \
+                                     const int & layerIndex, \
+                                     const int & secondary, \
+                                     const int & useGeometricEfficiency)
+{
+    this->update(configuration, elementsLibrary, elementList, elementFamilyList, \
+                 layerIndex, secondary, useGeometricEfficiency);
+}
+
+int CompositionEngine::getEnergyIndex(const double & energy)
+{
+    std::map<double, int>::const_iterator it;
+
+    it = this->energyIndex.find(energy);
+    if (it != this->energyIndex.end())
+    {
+        return it->second;
+    }
+    this->energyIndex[energy] = (int) this->energies.size();
+    this->energies.push_back(energy);
+    return (int) (this->energies.size() - 1);
+}
+
+void CompositionEngine::update(const XRFConfig & configuration, \
+                               const Elements & elementsLibrary, \
+                               const std::vector<std::string> & elementList, \
+                               const std::vector<std::string> & elementFamilyList, \
+                               const int & layerIndex, \
+                               const int & secondary, \
+                               const int & useGeometricEfficiency)
+{
+    const std::vector<Layer> & filters = configuration.getBeamFilters();
+    const std::vector<Layer> & sample = configuration.getSample();
+    const std::vector<Layer> & attenuators = configuration.getAttenuators();
+    const Detector & detector = configuration.getDetector();
+    const double PI = std::acos(-1.0);
+    std::vector<std::vector<double> > rays;
+    std::vector<double> transmission;
+    std::vector<std::string> familyElement;
+    std::vector<std::string> family;
+    std::vector<int> familyElementIndex;
+    std::vector<double> familyThreshold;
+    std::map<std::pair<int, std::string>, int> lineIndex;
+    std::vector<std::string> lineName;
+    std::vector<std::map<int, double> > rayLineFactor;
+    std::map<std::string, std::map<std::string, double> > excitationFactors;
+    std::map<std::string, std::map<std::string, double> >::const_iterator c_it;
+    std::map<std::string, double>::const_iterator mapIt;
+    std::map<std::string, std::vector<double> > muMap;
+    std::vector<double>::size_type i, j;
+    std::vector<Layer>::size_type iLayer;
+    std::string::size_type iString;
+    double minimumEnergy;
+    double tmpDouble;
+    double geometricEfficiency;
+    XRF xrf;
+    int iRay, iLine, iFamily, iElement;
+    int nEnergies, nLines, nRays, nElements;
+
+    if ((layerIndex < 0) || (layerIndex >= (int) sample.size()))
+    {
+        throw std::invalid_argument("CompositionEngine. Invalid sample layer index");
+    }
+    if (elementList.size() < 1)
+    {
+        throw std::invalid_argument("CompositionEngine. Empty element list");
+    }
+    if ((secondary < 0) || (secondary > 1))
+    {
+        throw std::invalid_argument("CompositionEngine. Secondary must be 0 or 1");
+    }
+    if ((secondary > 0) && (sample.size() > 1))
+    {
+        FISX_LOG_WARNING("CompositionEngine::update", \
+                         "Secondary excitation by the other sample layers is not included");
+    }
+    this->elementList = elementList;
+    this->elementFamilyList = elementFamilyList;
+    this->secondary = secondary;
+    this->sinAlphaIn = std::sin(configuration.getAlphaIn() * (PI / 180.));
+    this->sinAlphaOut = std::sin(configuration.getAlphaOut() * (PI / 180.));
+    this->density = sample[layerIndex].getDensity();
+    this->thickness = sample[layerIndex].getThickness();
+    this->energies.clear();
+    this->energyIndex.clear();
+
+    xrf.setConfiguration(configuration);
+
+    // parse the requested families
+    minimumEnergy = -1.0;
+    for (i = 0; i < elementFamilyList.size(); i++)
+    {
+        iString = elementFamilyList[i].find(' ');
+        if (iString == std::string::npos)
+        {
+            throw std::invalid_argument("CompositionEngine. Families must be given as \"Element Family\"");
+        }
+        familyElement.push_back(elementFamilyList[i].substr(0, iString));
+        family.push_back(elementFamilyList[i].substr(iString + 1));
+        iElement = -1;
+        for (j = 0; j < elementList.size(); j++)
+        {
+            if (elementList[j] == familyElement[i])
+            {
+                iElement = (int) j;
+            }
+        }
+        if (iElement < 0)
+        {
+            throw std::invalid_argument("CompositionEngine. Element " + familyElement[i] + \
+                                        " not present in the element list");
+        }
+        familyElementIndex.push_back(iElement);
+        familyThreshold.push_back(xrf.getEnergyThreshold(familyElement[i], family[i].substr(0, 1), \
+                                                         elementsLibrary));
+        if ((minimumEnergy < 0.0) || (familyThreshold[i] < minimumEnergy))
+        {
+            minimumEnergy = familyThreshold[i];
+        }
+    }
+
+    // incident beam after the filters and the layers above the selected one
+    rays = configuration.getBeam().getBeamAsDoubleVectors();
+    for (iLayer = 0; iLayer < filters.size(); iLayer++)
+    {
+        transmission = filters[iLayer].getTransmission(rays[0], elementsLibrary);
+        for (i = 0; i < rays[0].size(); i++)
+        {
+            rays[1][i] *= transmission[i];
+        }
+    }
+    this->nBeamRays = (int) rays[0].size();
+    this->rayBeamIndex.clear();
+    this->rayEnergyIndex.clear();
+    this->rayWeight.clear();
+    for (i = 0; i < rays[0].size(); i++)
+    {
+        if ((rays[0][i] < minimumEnergy) || (rays[1][i] <= 0.0))
+        {
+            continue;
+        }
+        tmpDouble = 0.0;
+        for (iLayer = 0; iLayer < (std::vector<Layer>::size_type) layerIndex; iLayer++)
+        {
+            tmpDouble += sample[iLayer].getDensity() * sample[iLayer].getThickness() * \
+                         sample[iLayer].getMassAttenuationCoefficients(rays[0][i], elementsLibrary)["total"] / \
+                         this->sinAlphaIn;
+        }
+        this->rayBeamIndex.push_back((int) i);
+        this->rayEnergyIndex.push_back(this->getEnergyIndex(rays[0][i]));
+        this->rayWeight.push_back(rays[1][i] * std::exp(-tmpDouble));
+    }
+    nRays = (int) this->rayWeight.size();
+
+    // lines excited by each ray
+    rayLineFactor.resize(nRays);
+    for (iRay = 0; iRay < nRays; iRay++)
+    {
+        for (iFamily = 0; iFamily < (int) family.size(); iFamily++)
+        {
+            const std::string & lineFamily = family[iFamily];
+            if (this->energies[this->rayEnergyIndex[iRay]] < familyThreshold[iFamily])
+            {
+                continue;
+            }
+            excitationFactors = elementsLibrary.getExcitationFactors(familyElement[iFamily], \
+                                                    this->energies[this->rayEnergyIndex[iRay]], 1.0);
+            for (c_it = excitationFactors.begin(); c_it != excitationFactors.end(); ++c_it)
+            {
+                if (lineFamily == "Ka")
+                {
+                    if (c_it->first.compare(0, 2, "KL") != 0)
+                        continue;
+                }
+                else if (lineFamily == "Kb")
+                {
+                    if ((c_it->first[0] != 'K') || (c_it->first[1] == 'L'))
+                        continue;
+                }
+                else if (c_it->first.compare(0, lineFamily.length(), lineFamily) != 0)
+                {
+                    continue;
+                }
+                mapIt = c_it->second.find("factor");
+                if ((mapIt == c_it->second.end()) || (mapIt->second <= 0.0))
+                {
+                    continue;
+                }
+                std::pair<int, std::string> key(iFamily, c_it->first);
+                if (lineIndex.find(key) == lineIndex.end())
+                {
+                    lineIndex[key] = (int) lineName.size();
+                    lineName.push_back(c_it->first);
+                    this->lineFamily.push_back(iFamily);
+                    this->lineElement.push_back(familyElementIndex[iFamily]);
+                    mapIt = c_it->second.find("energy");
+                    this->lineEnergyIndex.push_back(this->getEnergyIndex(mapIt->second));
+                }
+                mapIt = c_it->second.find("rate");
+                rayLineFactor[iRay][lineIndex[key]] = mapIt->second;
+            }
+        }
+    }
+    nLines = (int) lineName.size();
+
+    // detection efficiency of each line
+    if (useGeometricEfficiency)
+    {
+        geometricEfficiency = xrf.getGeometricEfficiency(layerIndex);
+    }
+    else
+    {
+        geometricEfficiency = 1.0;
+    }
+    this->lineEfficiency.resize(nLines);
+    for (iLine = 0; iLine < nLines; iLine++)
+    {
+        const double & energy = this->energies[this->lineEnergyIndex[iLine]];
+        tmpDouble = geometricEfficiency;
+        for (iLayer = 0; iLayer < (std::vector<Layer>::size_type) layerIndex; iLayer++)
+        {
+            tmpDouble *= sample[iLayer].getTransmission(energy, elementsLibrary, configuration.getAlphaOut());
+        }
+        for (iLayer = 0; iLayer < attenuators.size(); iLayer++)
+        {
+            tmpDouble *= attenuators[iLayer].getTransmission(energy, elementsLibrary, 90.0);
+        }
+        if (detector.hasMaterialComposition() || (detector.getMaterialName().size() > 0 ))
+        {
+            if ((detector.getDensity() > 0.0) && (detector.getThickness() > 0.0))
+            {
+                tmpDouble *= (1.0 - detector.getTransmission(energy, elementsLibrary, 90.0));
+            }
+        }
+        this->lineEfficiency[iLine] = tmpDouble;
+    }
+
+    // secondary sources excited by each ray
+    this->sourceStart.clear();
+    this->sourceElement.clear();
+    this->sourceEnergyIndex.clear();
+    this->sourceFactor.clear();
+    for (iRay = 0; iRay < nRays; iRay++)
+    {
+        this->sourceStart.push_back((int) this->sourceElement.size());
+        if (this->secondary < 1)
+        {
+            continue;
+        }
+        for (iElement = 0; iElement < (int) elementList.size(); iElement++)
+        {
+            excitationFactors = elementsLibrary.getExcitationFactors(elementList[iElement], \
+                                                    this->energies[this->rayEnergyIndex[iRay]], 1.0);
+            for (c_it = excitationFactors.begin(); c_it != excitationFactors.end(); ++c_it)
+            {
+                mapIt = c_it->second.find("rate");
+                if ((mapIt == c_it->second.end()) || (mapIt->second <= 0.0))
+                {
+                    continue;
+                }
+                tmpDouble = mapIt->second;
+                mapIt = c_it->second.find("energy");
+                if (mapIt->second < minimumEnergy)
+                {
+                    continue;
+                }
+                this->sourceElement.push_back(iElement);
+                this->sourceEnergyIndex.push_back(this->getEnergyIndex(mapIt->second));
+                this->sourceFactor.push_back(tmpDouble);
+            }
+        }
+        // coherently scattered beam, its intensity depends on the composition
+        this->sourceElement.push_back(-1);
+        this->sourceEnergyIndex.push_back(this->rayEnergyIndex[iRay]);
+        this->sourceFactor.push_back(1.0);
+    }
+    this->sourceStart.push_back((int) this->sourceElement.size());
+
+    // all the energies are known
+    nEnergies = (int) this->energies.size();
+    nElements = (int) elementList.size();
+    this->linePrimaryFactor.resize(nRays * nLines);
+    std::fill(this->linePrimaryFactor.begin(), this->linePrimaryFactor.end(), 0.0);
+    for (iRay = 0; iRay < nRays; iRay++)
+    {
+        std::map<int, double>::const_iterator it;
+        for (it = rayLineFactor[iRay].begin(); it != rayLineFactor[iRay].end(); ++it)
+        {
+            this->linePrimaryFactor[iRay * nLines + it->first] = it->second;
+        }
+    }
+
+    this->lineSecondaryFactor.resize(nLines * nEnergies);
+    std::fill(this->lineSecondaryFactor.begin(), this->lineSecondaryFactor.end(), 0.0);
+    if (this->secondary > 0)
+    {
+        std::vector<bool> isSource(nEnergies, false);
+        for (i = 0; i < this->sourceEnergyIndex.size(); i++)
+        {
+            isSource[this->sourceEnergyIndex[i]] = true;
+        }
+        for (iFamily = 0; iFamily < (int) family.size(); iFamily++)
+        {
+            for (j = 0; j < (std::vector<double>::size_type) nEnergies; j++)
+            {
+                if ((!isSource[j]) || (this->energies[j] < familyThreshold[iFamily]))
+                {
+                    continue;
+                }
+                excitationFactors = elementsLibrary.getExcitationFactors(familyElement[iFamily], \
+                                                                         this->energies[j], 1.0);
+                for (iLine = 0; iLine < nLines; iLine++)
+                {
+                    if (this->lineFamily[iLine] != iFamily)
+                    {
+                        continue;
+                    }
+                    c_it = excitationFactors.find(lineName[iLine]);
+                    if (c_it == excitationFactors.end())
+                    {
+                        continue;
+                    }
+                    mapIt = c_it->second.find("rate");
+                    this->lineSecondaryFactor[iLine * nEnergies + j] = mapIt->second;
+                }
+            }
+        }
+    }
+
+    // mass attenuation coefficients of the elements
+    this->muTotal.resize(nElements * nEnergies);
+    this->muCoherent.resize(nElements * nRays);
+    for (iElement = 0; iElement < nElements; iElement++)
+    {
+        muMap = elementsLibrary.getMassAttenuationCoefficients(elementList[iElement], this->energies);
+        for (j = 0; j < (std::vector<double>::size_type) nEnergies; j++)
+        {
+            this->muTotal[iElement * nEnergies + j] = muMap["total"][j];
+        }
+        for (iRay = 0; iRay < nRays; iRay++)
+        {
+            this->muCoherent[iElement * nRays + iRay] = muMap["coherent"][this->rayEnergyIndex[iRay]];
+        }
+    }
+}
+
+const std::vector<std::string> & CompositionEngine::getElementList() const
+{
+    return this->elementList;
+}
+
+const std::vector<std::string> & CompositionEngine::getElementFamilyList() const
+{
+    return this->elementFamilyList;
+}
+
+std::vector<double> CompositionEngine::getRates(const std::vector<double> & compositions) const
+{
+    std::vector<double> rates;
+    int nCompositions;
+
+    if (compositions.size() % this->elementList.size())
+    {
+        throw std::invalid_argument("CompositionEngine. Composition size not a multiple of number of elements");
+    }
+    nCompositions = (int) (compositions.size() / this->elementList.size());
+    rates.resize(nCompositions * this->elementFamilyList.size());
+    if (nCompositions > 0)
+    {
+        this->getRates(&compositions[0], nCompositions, &rates[0]);
+    }
+    return rates;
+}
+
+void CompositionEngine::getRates(const double * compositions, const int & nCompositions, double * rates) const
+{
+    const int blockSize = 64;
+    int nBlocks;
+    int iBlock;
+    bool failed;
+    std::string errorMessage;
+
+    if (this->elementList.size() < 1)
+    {
+        throw std::runtime_error("CompositionEngine. Engine not initialized");
+    }
+    nBlocks = (nCompositions + blockSize - 1) / blockSize;
+    failed = false;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (iBlock = 0; iBlock < nBlocks; iBlock++)
+    {
+        int n;
+        n = std::min(blockSize, nCompositions - iBlock * blockSize);
+        try
+        {
+            this->getBlockRates(compositions + iBlock * blockSize * this->elementList.size(), n, \
+                                rates + iBlock * blockSize * this->elementFamilyList.size());
+        }
+        catch (const std::exception & exc)
+        {
+#ifdef _OPENMP
+            #pragma omp critical
+#endif
+            {
+                failed = true;
+                errorMessage = exc.what();
+            }
+        }
+    }
+    if (failed)
+    {
+        throw std::runtime_error(errorMessage);
+    }
+}
+
+void CompositionEngine::getMixtureMu(const double * massFractions, std::vector<double> & mu) const
+{
+    const int nElements = (int) this->elementList.size();
+    const int nEnergies = (int) this->energies.size();
+    int iElement, iEnergy;
+
+    // the mixture mass attenuation coefficients are a weighted sum
+    mu.resize(nEnergies);
+    std::fill(mu.begin(), mu.end(), 0.0);
+    for (iElement = 0; iElement < nElements; iElement++)
+    {
+        if (massFractions[iElement] == 0.0)
+            continue;
+        const double * muElement = &this->muTotal[iElement * nEnergies];
+        for (iEnergy = 0; iEnergy < nEnergies; iEnergy++)
+        {
+            mu[iEnergy] += massFractions[iElement] * muElement[iEnergy];
+        }
+    }
+}
+
+void CompositionEngine::addRayRates(const double * massFractions, const std::vector<double> & mu, \
+                                    const int & iRay, double * familyRates) const
+{
+    const int nElements = (int) this->elementList.size();
+    const int nEnergies = (int) this->energies.size();
+    const int nRays = (int) this->rayWeight.size();
+    const int nLines = (int) this->lineEfficiency.size();
+    double muIn, muOut, muSource, sum;
+    double weight, coherent, sourceRate;
+    double massFraction, factor, tmpDouble;
+    int iElement, iEnergy, iLine, iSource;
+
+    weight = this->rayWeight[iRay];
+    muIn = mu[this->rayEnergyIndex[iRay]] / this->sinAlphaIn;
+    if (muIn <= 0.0)
+        return;
+
+    // primary
+    for (iLine = 0; iLine < nLines; iLine++)
+    {
+        massFraction = massFractions[this->lineElement[iLine]];
+        factor = this->linePrimaryFactor[iRay * nLines + iLine];
+        if ((massFraction <= 0.0) || (factor <= 0.0))
+            continue;
+        muOut = mu[this->lineEnergyIndex[iLine]] / this->sinAlphaOut;
+        sum = muIn + muOut;
+        tmpDouble = (1.0 - std::exp(-sum * this->density * this->thickness)) / sum;
+        tmpDouble *= massFraction / this->sinAlphaIn;
+        familyRates[this->lineFamily[iLine]] += tmpDouble * factor * weight * \
+                                                this->lineEfficiency[iLine];
+    }
+
+    if (this->secondary < 1)
+        return;
+
+    // intralayer secondary
+    for (iSource = this->sourceStart[iRay]; iSource < this->sourceStart[iRay + 1]; iSource++)
+    {
+        iEnergy = this->sourceEnergyIndex[iSource];
+        if (this->sourceElement[iSource] < 0)
+        {
+            coherent = 0.0;
+            for (iElement = 0; iElement < nElements; iElement++)
+            {
+                coherent += massFractions[iElement] * this->muCoherent[iElement * nRays + iRay];
+            }
+            sourceRate = weight * coherent / mu[this->rayEnergyIndex[iRay]];
+        }
+        else
+        {
+            sourceRate = weight * massFractions[this->sourceElement[iSource]] * \
+                         this->sourceFactor[iSource];
+        }
+        muSource = mu[iEnergy];
+        if ((sourceRate <= 0.0) || (muSource <= 0.0))
+            continue;
+        for (iLine = 0; iLine < nLines; iLine++)
+        {
+            factor = this->lineSecondaryFactor[iLine * nEnergies + iEnergy];
+            massFraction = massFractions[this->lineElement[iLine]];
+            if ((factor <= 0.0) || (massFraction <= 0.0))
+                continue;
+            muOut = mu[this->lineEnergyIndex[iLine]] / this->sinAlphaOut;
+            tmpDouble = Math::deBoerL0(muIn, muOut, muSource, this->density, this->thickness);
+            tmpDouble += Math::deBoerL0(muOut, muIn, muSource, this->density, this->thickness);
+            tmpDouble *= massFraction * (0.5 / this->sinAlphaIn) * factor * sourceRate;
+            familyRates[this->lineFamily[iLine]] += tmpDouble * this->lineEfficiency[iLine];
+        }
+    }
+}
+
+void CompositionEngine::getBlockRates(const double * compositions, const int & nCompositions, double * rates) const
+{
+    const int nElements = (int) this->elementList.size();
+    const int nFamilies = (int) this->elementFamilyList.size();
+    const int nRays = (int) this->rayWeight.size();
+    std::vector<double> mu;
+    double * familyRates;
+    int iComposition, iRay;
+
+    if (nElements < 1)
+    {
+        throw std::runtime_error("CompositionEngine. Engine not initialized");
+    }
+    for (iComposition = 0; iComposition < nCompositions; iComposition++)
+    {
+        familyRates = rates + iComposition * nFamilies;
+        std::fill(familyRates, familyRates + nFamilies, 0.0);
+        this->getMixtureMu(compositions + iComposition * nElements, mu);
+        for (iRay = 0; iRay < nRays; iRay++)
+        {
+            this->addRayRates(compositions + iComposition * nElements, mu, iRay, familyRates);
+        }
+    }
+}
+
+void CompositionEngine::getRayRates(const double * composition, double * rates) const
+{
+    const int nFamilies = (int) this->elementFamilyList.size();
+    const int nRays = (int) this->rayWeight.size();
+    std::vector<double> mu;
+    int iRay;
+    bool failed;
+    std::string errorMessage;
+
+    if (this->elementList.size() < 1)
+    {
+        throw std::runtime_error("CompositionEngine. Engine not initialized");
+    }
+    std::fill(rates, rates + this->nBeamRays * nFamilies, 0.0);
+    this->getMixtureMu(composition, mu);
+    failed = false;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (iRay = 0; iRay < nRays; iRay++)
+    {
+        try
+        {
+            this->addRayRates(composition, mu, iRay, rates + this->rayBeamIndex[iRay] * nFamilies);
+        }
+        catch (const std::exception & exc)
+        {
+#ifdef _OPENMP
+            #pragma omp critical
+#endif
+            {
+                failed = true;
+                errorMessage = exc.what();
+            }
+        }
+    }
+    if (failed)
+    {
+        throw std::runtime_error(errorMessage);
+    }
+}
+
+std::vector<double> CompositionEngine::getRayRates(const std::vector<double> & composition) const
+{
+    std::vector<double> rates;
+
+    if (composition.size() != this->elementList.size())
+    {
+        throw std::invalid_argument("CompositionEngine. Composition size does not match number of elements");
+    }
+    rates.resize(this->nBeamRays * this->elementFamilyList.size());
+    if (rates.size() > 0)
+    {
+        this->getRayRates(&composition[0], &rates[0]);
+    }
+    return rates;
+}
+
+} // namespace fisx
@@ -0,0 +1,159 @@
+#ifndef FISX_COMPOSITIONENGINE_H
+#define FISX_COMPOSITIONENGINE_H
+#include <string>
+#include <vector>
+#include <map>
+#include "fisx_xrfconfig.h"
+#include "fisx_elements.h"
+
+namespace fisx
+{
+
+/*!
+  \class CompositionEngine
+  \brief Fast evaluation of fluorescence rates for many compositions of one sample layer
+
+   Imaging applications evaluate the same beam, geometry, layer structure and detector for a large number
+   of pixels that only differ in the composition of one layer. All the composition independent quantities
+   (mass attenuation coefficients of each element at every needed energy, excitation factors, detection
+   efficiencies and the attenuation of the other layers) are evaluated once when the engine is built.
+   The attenuation of a mixture is then just a weighted sum and the rates of a block of pixels are obtained
+   without calling the library again.
+
+   The calculation covers primary excitation and intralayer secondary excitation (including the coherently
+   scattered beam as secondary source) in the selected layer. Layers above it attenuate both the incoming
+   beam and the emitted radiation. Interlayer secondary excitation is not considered, so on samples with
+   several layers the rates are below those of XRF::getMultilayerFluorescence with secondary = 1 and a
+   warning is logged.
+
+   Once built, the engine is read-only and it can be shared by several threads.
+*/
+class CompositionEngine
+{
+public:
+    CompositionEngine();
+
+    /*!
+    Build an engine for the given configuration.
+    \param configuration - Beam, beam filters, sample, attenuators, detector and geometry to be used.
+    \param elementsLibrary - Instance of library to be used for all the Physical constants
+    \param elementList - Elements defining the composition. Each composition supplied to getRates
+                         is a set of mass fractions of these elements in the same order.
+    \param elementFamilyList - Peak families for which rates are requested, in the form "Fe K".
+                               Elements must be part of elementList.
+    \param layerIndex - Sample layer whose composition varies.
+    \param secondary - 0 Only primary excitation, 1 Include intralayer secondary excitation.
+                       Other values throw std::invalid_argument.
+    \param useGeometricEfficiency - Take into account solid angle or not. Default is 1 (yes)
+    */
+    CompositionEngine(const XRFConfig & configuration, \
+                      const Elements & elementsLibrary, \
+                      const std::vector<std::string> & elementList, \
+                      const std::vector<std::string> & elementFamilyList, \
+                      const int & layerIndex = 0, \
+                      const int & secondary = 1, \
+                      const int & useGeometricEfficiency = 1);
+
+    /*!
+    Rebuild the engine. Same arguments as the constructor.
+    */
+    void update(const XRFConfig & configuration, \
+                const Elements & elementsLibrary, \
+                const std::vector<std::string> & elementList, \
+                const std::vector<std::string> & elementFamilyList, \
+                const int & layerIndex = 0, \
+                const int & secondary = 1, \
+                const int & useGeometricEfficiency = 1);
+
+    const std::vector<std::string> & getElementList() const;
+
+    const std::vector<std::string> & getElementFamilyList() const;
+
+    /*!
+    Calculate the detected rate of each peak family for nCompositions compositions.
+
+    compositions is a contiguous row-major array of nCompositions x elementList.size() mass fractions.
+    rates is a contiguous row-major array of nCompositions x elementFamilyList.size() values that receives
+    the detected rate (per incident photon, escape peaks included) of each family. The rates are already
+    multiplied by the mass fraction of the emitting element.
+
+    When the library is compiled with OpenMP support, blocks of compositions are evaluated in parallel.
+    */
+    void getRates(const double * compositions, const int & nCompositions, double * rates) const;
+
+    /*!
+    Convenience method. The number of compositions is deduced from the size of the input vector.
+    */
+    std::vector<double> getRates(const std::vector<double> & compositions) const;
+
+    /*!
+    Calculate the detected rate of each peak family due to each ray of the incident beam for a
+    single composition. rates is a contiguous row-major array of nBeamRays x elementFamilyList.size()
+    values in the order of the beam supplied with the configuration. Rays unable to excite any of
+    the families give zero.
+
+    When the library is compiled with OpenMP support, the rays are evaluated in parallel.
+    */
+    void getRayRates(const double * composition, double * rates) const;
+
+    /*!
+    Convenience method. Returns the rates in the same layout.
+    */
+    std::vector<double> getRayRates(const std::vector<double> & composition) const;
+
+    /*!
+    Same as getRates but always evaluated serially in the calling thread. Intended for callers
+    already running in parallel, as the Quantifier does for each pixel.
+    */
+    void getBlockRates(const double * compositions, const int & nCompositions, double * rates) const;
+
+private:
+    void getMixtureMu(const double * massFractions, std::vector<double> & mu) const;
+    void addRayRates(const double * massFractions, const std::vector<double> & mu, \
+                     const int & iRay, double * familyRates) const;
+    int getEnergyIndex(const double & energy);
+
+    std::vector<std::string> elementList;
+    std::vector<std::string> elementFamilyList;
+    int secondary;
+    double sinAlphaIn;
+    double sinAlphaOut;
+    double density;
+    double thickness;
+
+    // all the energies needed for the calculation
+    std::vector<double> energies;
+    std::map<double, int> energyIndex;
+
+    // [iElement * nEnergies + iEnergy] total mass attenuation coefficient of each element
+    std::vector<double> muTotal;
+    // [iElement * nRays + iRay] coherent mass attenuation coefficient at the incident energies
+    std::vector<double> muCoherent;
+
+    // incident rays reaching the layer
+    int nBeamRays;
+    std::vector<int> rayBeamIndex;
+    std::vector<int> rayEnergyIndex;
+    std::vector<double> rayWeight;
+
+    // detected lines
+    std::vector<int> lineFamily;
+    std::vector<int> lineElement;
+    std::vector<int> lineEnergyIndex;
+    std::vector<double> lineEfficiency;
+    // [iRay * nLines + iLine] line emission rate per unit mass fraction following incident ray
+    std::vector<double> linePrimaryFactor;
+    // [iLine * nEnergies + iEnergy] line emission rate per unit mass fraction following a photon of the
+    // given energy. Zero if that energy cannot excite the line family.
+    std::vector<double> lineSecondaryFactor;
+
+    // secondary sources excited by each ray in the selected layer
+    std::vector<int> sourceStart;
+    std::vector<int> sourceElement;
+    std::vector<int> sourceEnergyIndex;
+    std::vector<double> sourceFactor;
+};
+
+} // namespace fisx
+
+#endif // FISX_COMPOSITIONENGINE_H
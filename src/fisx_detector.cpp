@@ -126,4 +126,27 @@ std::map<std::string, std::map<std::string, double> > Detector::getEscape(const
     }
 }
 
+void Detector::writeBinary(BinaryWriter & writer) const
+{
+    this->Layer::writeBinary(writer);
+    writer.write(this->diameter);
+    writer.write(this->distance);
+    writer.write(this->escapePeakEnergyThreshold);
+    writer.write(this->escapePeakIntensityThreshold);
+    writer.write(this->escapePeakNThreshold);
+    writer.write(this->escapePeakAlphaIn);
+}
+
+void Detector::readBinary(BinaryReader & reader)
+{
+    this->escapePeakCache.clear();
+    this->Layer::readBinary(reader);
+    reader.read(this->diameter);
+    reader.read(this->distance);
+    reader.read(this->escapePeakEnergyThreshold);
+    reader.read(this->escapePeakIntensityThreshold);
+    reader.read(this->escapePeakNThreshold);
+    reader.read(this->escapePeakAlphaIn);
+}
+
 } // namespace fisx
@@ -74,6 +74,13 @@ public:
     void setMinimumEscapePeakIntensity(const double & intensity);
     void setMaximumNumberOfEscapePeaks(const int & nPeaks);
 
+    /*!
+    Write or read the complete state of the instance (see XRFConfig::getSnapshot).
+    The escape peak cache is not written and it is emptied when reading.
+    */
+    void writeBinary(BinaryWriter & writer) const;
+    void readBinary(BinaryReader & reader);
+
 private:
     double diameter ;
     double distance ;
@@ -1,6 +1,6 @@
 #include "fisx_element.h"
 #include "fisx_math.h"
-#include <iostream>
+#include "fisx_logger.h"
 #include <math.h>
 #include <stdexcept>
 
@@ -178,8 +178,8 @@ void Element::setMassAttenuationCoefficients(const std::vector<double> & energie
         {
             if (energies[i] < energies[i-1])
             {
-                std::cout << "ELEMENT " << this->name << std::endl;
-                std::cout << energies[i] << " < " << energies[i-1] << std::endl;
+                FISX_LOG_DEBUG("Element::setMassAttenuationCoefficients", \
+                               this->name << " " << energies[i] << " < " << energies[i-1]);
                 throw std::invalid_argument("Energies have to be supplied in ascending order");
             }
         }
@@ -241,14 +241,102 @@ const std::map< std::string, std::vector<double> > & Element::getMassAttenuation
 }
 
 std::map<std::string, double> Element::getMassAttenuationCoefficients(const double & energy) const
+{
+    InterpolationCursor cursor;
+    return this->getMassAttenuationCoefficients(energy, cursor);
+}
+
+std::map<std::string, double> Element::getMassAttenuationCoefficients(const double & energy, \
+                                                                      InterpolationCursor & cursor) const
+{
+    std::string shellList[10] = {"K", "L1", "L2", "L3", "M1", "M2", "M3", "M4", "M5", "all other"};
+    std::map<std::string, double> result;
+    double processes[3];
+    double shellValues[10];
+    int i;
+
+    this->interpolateMassAttenuationCoefficients(energy, cursor, processes, shellValues);
+    if (this->hasPartialPhotoelectricCoefficients())
+    {
+        for (i = 0; i < 10; i++)
+        {
+            result[shellList[i]] = shellValues[i];
+        }
+    }
+    result["energy"] = energy;
+    result["coherent"] = processes[0];
+    result["compton"] = processes[1];
+    result["pair"] = processes[2];
+    result["photoelectric"] = shellValues[0] + shellValues[1] + shellValues[2] + shellValues[3] +\
+                (shellValues[4] + shellValues[5] + shellValues[6] + shellValues[7] + shellValues[8] +\
+                shellValues[9]);
+    result["total"] = result["photoelectric"] + result["coherent"] + result["compton"] + result["pair"];
+    if (!Math::isFiniteNumber(result["total"]))
+    {
+        FISX_LOG_DEBUG("Element::getMassAttenuationCoefficients", "element = " << this->name << \
+                       " energy = " << energy << " photoelectric = " << result["photoelectric"] << \
+                       " coherent = " << result["coherent"] << " compton = " << result["compton"] << \
+                       " pair = " << result["pair"]);
+        throw std::runtime_error("Invalid total mass attenuation coefficient");
+    }
+    return result;
+}
+
+bool Element::hasPartialPhotoelectricCoefficients() const
+{
+    std::map<std::string, std::vector<double> >::const_iterator c_it;
+
+    for (c_it = this->muPartialPhotoelectricEnergy.begin();
+         c_it != this->muPartialPhotoelectricEnergy.end(); ++c_it)
+    {
+        if (c_it->second.size() > 0)
+        {
+            // partial initialized at least for one shell
+            return true;
+        }
+    }
+    return false;
+}
+
+void Element::getMassAttenuationCoefficients(const double * energy, const int & nEnergies, \
+                                             InterpolationCursor & cursor, \
+                                             double * coherent, double * compton, \
+                                             double * pair, double * photoelectric) const
+{
+    double processes[3];
+    double shellValues[10];
+    int i;
+
+    for (i = 0; i < nEnergies; i++)
+    {
+        this->interpolateMassAttenuationCoefficients(energy[i], cursor, processes, shellValues);
+        coherent[i] = processes[0];
+        compton[i] = processes[1];
+        pair[i] = processes[2];
+        photoelectric[i] = shellValues[0] + shellValues[1] + shellValues[2] + shellValues[3] +\
+                (shellValues[4] + shellValues[5] + shellValues[6] + shellValues[7] + shellValues[8] +\
+                shellValues[9]);
+#ifndef FISX_UNCHECKED
+        if (!Math::isFiniteNumber(coherent[i] + compton[i] + pair[i] + photoelectric[i]))
+        {
+            FISX_LOG_DEBUG("Element::getMassAttenuationCoefficients", \
+                           "element = " << this->name << " energy = " << energy[i]);
+            throw std::runtime_error("Invalid total mass attenuation coefficient");
+        }
+#endif
+    }
+}
+
+void Element::interpolateMassAttenuationCoefficients(const double & energy, InterpolationCursor & cursor, \
+                                                     double * processes, double * shellValues) const
 {
     std::pair<long, long> indices;
     long i1, i2;
     double A, B, x0, x1, y0, y1;
-    //std::string shellList[10] = {"K", "L1", "L2", "L3", "M1", "M2", "M3", "M4", "M5", "all other"};
+    // the order of the output processes
+    static const char * processList[3] = {"coherent", "compton", "pair"};
     std::map<std::string, std::vector<double> >::const_iterator c_it;
-    std::string key;
-    std::map<std::string, double> result;
+    int i;
 
     if (this->muEnergy.size() < 1)
     {
@@ -258,20 +346,20 @@ std::map<std::string, double> Element::getMassAttenuationCoefficients(const doub
     // TODO: if the partial are not given, use the total photoelectric
 
     // calculate the partial photoelectric mass attenuation coefficients
-    for (c_it = this->muPartialPhotoelectricEnergy.begin();
-         c_it != this->muPartialPhotoelectricEnergy.end(); ++c_it)
+    if (this->hasPartialPhotoelectricCoefficients())
     {
-        if (c_it->second.size() > 0)
+        this->getPartialPhotoelectricMassAttenuationCoefficients(energy, cursor, shellValues);
+    }
+    else
+    {
+        for (i = 0; i < 10; i++)
         {
-            // partial initialized at least for one shell
-            //std::cout << " Getting partial photoelectric mass attenuation coefficients " << std::endl;
-            result = this->getPartialPhotoelectricMassAttenuationCoefficients(energy);
-            break;
+            shellValues[i] = 0.0;
         }
     }
 
     // std::cout << "Calling interpolation" <<std::endl;
-    indices = this->getInterpolationIndices(this->muEnergy, energy);
+    indices = cursor.getIndices(this->muEnergy, energy, 0);
 
     i1 = indices.first;
     i2 = indices.second;
@@ -300,17 +388,19 @@ std::map<std::string, double> Element::getMassAttenuationCoefficients(const doub
     }
 
 
-    result["energy"] = energy;
+    processes[0] = 0.0;
+    processes[1] = 0.0;
+    processes[2] = 0.0;
     if ((i1 == i2) ||((x1 - x0) < 5.E-10))
     {
         // std::cout << "case a" <<std::endl;
         //std::cout << "x0, x1 " << x0 << " " << x1 << " energy = " << energy <<std::endl;
-        for (c_it = this->mu.begin(); c_it != this->mu.end(); ++c_it)
+        for (i = 0; i < 3; i++)
         {
-            key = c_it->first;
-            if ((key == "coherent") || (key == "compton") || (key == "pair"))
+            c_it = this->mu.find(processList[i]);
+            if (c_it != this->mu.end())
             {
-                result[key] = c_it->second[i1];
+                processes[i] = c_it->second[i1];
             }
         }
     }
@@ -321,11 +411,10 @@ std::map<std::string, double> Element::getMassAttenuationCoefficients(const doub
         B = 1.0 / log( x1 / x0);
         A = log(x1/energy) * B;
         B *= log( energy / x0);
-        for (c_it = this->mu.begin(); c_it != this->mu.end(); ++c_it)
+        for (i = 0; i < 3; i++)
         {
-            key = c_it->first;
-            //std::cout << "key " << key << std::endl;
-            if ((key == "coherent") || (key == "compton") || (key == "pair"))
+            c_it = this->mu.find(processList[i]);
+            if (c_it != this->mu.end())
             {
                 // we are left with coherent, compton and pair
                 y0 = c_it->second[i1];
@@ -334,39 +423,23 @@ std::map<std::string, double> Element::getMassAttenuationCoefficients(const doub
                 if ((y0 > 0.0) && (y1 > 0.0))
                 {
                     // std::cout << "standard case" <<std::endl;
-                    result[key] = exp(A * log(y0) + B * log(y1));
+                    processes[i] = exp(A * log(y0) + B * log(y1));
                     // std::cout << "entered value = " << result[key] <<std::endl;
                 }
                 else
                 {
                     if ((y1 > 0.0) && ((energy - x0) > 1.E-5))
                     {
-                        result[key] = exp(B * log(y1));
+                        processes[i] = exp(B * log(y1));
                     }
                     else
                     {
-                        result[key] = 0.0;
+                        processes[i] = 0.0;
                     }
                 }
             }
         }
     }
-    result["photoelectric"] = result["K"] + result["L1"] + result["L2"] + result["L3"] +\
-                (result["M1"] + result["M2"] + result["M3"] + result["M4"] + result["M5"] +\
-                result["all other"]);
-
-    result["total"] = result["photoelectric"] + result["coherent"] + result["compton"] + result["pair"];
-    if (!Math::isFiniteNumber(result["total"]))
-    {
-        std::cout << "element = " << this->name << std::endl;
-        std::cout << "energy = " << energy << std::endl;
-        std::cout << "Photo = " << result["photoelectric"] << std::endl;
-        std::cout << "coherent = " << result["coherent"] << std::endl;
-        std::cout << "compton = " << result["compton"] << std::endl;
-        std::cout << "pair = " << result["pair"] << std::endl;
-        throw std::runtime_error("Invalid total mass attenuation coefficient");
-    }
-    return result;
 }
 
 std::map<std::string, std::vector<double> > Element::getMassAttenuationCoefficients(\
@@ -376,12 +449,13 @@ std::map<std::string, std::vector<double> > Element::getMassAttenuationCoefficie
     std::map<std::string, double> tmpResult;
     std::map<std::string, std::vector<double> > result;
     std::map<std::string, double>::const_iterator c_it;
+    InterpolationCursor cursor;
 
     length = energy.size();
 
     for (i = 0; i < length; i++)
     {
-        tmpResult = this->getMassAttenuationCoefficients(energy[i]);
+        tmpResult = this->getMassAttenuationCoefficients(energy[i], cursor);
         if (i == 0)
         {
             for (c_it = tmpResult.begin(); c_it != tmpResult.end(); ++c_it)
@@ -493,7 +567,8 @@ std::map<std::string, std::pair<double, int> > \
         {
             key = result_it->first;
             energy = result_it->second.first;
-            std::cout << this->name << " Found shell " << key << " at " << energy << std::endl;
+            FISX_LOG_DEBUG("Element::extractEdgeEnergiesFromMassAttenuationCoefficients", \
+                           this->name << " Found shell " << key << " at " << energy);
         }
     }
     return result;
@@ -542,8 +617,8 @@ void Element::setPartialPhotoelectricMassAttenuationCoefficients(const std::stri
     {
         if (energy[i] < lastEnergy)
         {
-            std::cout << "ELEMENT " << this->name << std::endl;
-            std::cout << energy[i] << " < " << lastEnergy << std::endl;
+            FISX_LOG_DEBUG("Element::setPartialPhotoelectricMassAttenuationCoefficients", \
+                           this->name << " " << energy[i] << " < " << lastEnergy);
             throw std::invalid_argument("Partial photoelectric energies should be in ascending order");
         }
         else
@@ -564,10 +639,34 @@ void Element::setPartialPhotoelectricMassAttenuationCoefficients(const std::stri
 
 std::map<std::string, double> \
     Element::getPartialPhotoelectricMassAttenuationCoefficients(const double & energy) const
+{
+    InterpolationCursor cursor;
+    return this->getPartialPhotoelectricMassAttenuationCoefficients(energy, cursor);
+}
+
+std::map<std::string, double> \
+    Element::getPartialPhotoelectricMassAttenuationCoefficients(const double & energy, \
+                                                                InterpolationCursor & cursor) const
 {
     std::string shellList[10] = {"K", "L1", "L2", "L3", "M1", "M2", "M3", "M4", "M5", "all other"};
-    std::string shell;
     std::map<std::string, double> result;
+    double shellValues[10];
+    int i;
+
+    this->getPartialPhotoelectricMassAttenuationCoefficients(energy, cursor, shellValues);
+    for (i = 0; i < 10; i++)
+    {
+        result[shellList[i]] = shellValues[i];
+    }
+    return result;
+}
+
+void Element::getPartialPhotoelectricMassAttenuationCoefficients(const double & energy, \
+                                                                 InterpolationCursor & cursor, \
+                                                                 double * shellValues) const
+{
+    std::string shellList[10] = {"K", "L1", "L2", "L3", "M1", "M2", "M3", "M4", "M5", "all other"};
+    std::string shell;
     std::vector<std::string>::size_type i;
     std::pair<long, long> indices;
     long i1, i2, i1w, i2w;
@@ -588,7 +687,7 @@ std::map<std::string, double> \
     {
         shell = shellList[i];
         // std::cout << "shell " << shell << std::endl;
-        result[shell] = 0.0;
+        shellValues[i] = 0.0;
         if (shell != "all other")
         {
             c_itSingle = this->bindingEnergy.find(shell);
@@ -599,7 +698,8 @@ std::map<std::string, double> \
         }
         c_it = this->muPartialPhotoelectricEnergy.find(shell);
         y_it = this->muPartialPhotoelectricValue.find(shell);
-        indices = this->getInterpolationIndices(c_it->second, energy);
+        // table 0 is the one of the total mass attenuation coefficients
+        indices = cursor.getIndices(c_it->second, energy, (int) (i + 1));
         i1 = indices.first;
         i2 = indices.second;
         x0 = c_it->second[i1];
@@ -629,21 +729,21 @@ std::map<std::string, double> \
             // std::cout << "case a " <<std::endl;
             if (shell == "all other")
             {
-                result[shell] = y_it->second[i2];
+                shellValues[i] = y_it->second[i2];
             }
             else
             {
                 y0 = y_it->second[i1];
                 if ( y0 > 0.0)
                 {
-                    result[shell] = y0;
+                    shellValues[i] = y0;
                 }
                 else
                 {
                     y1 = y_it->second[i2];
                     if (((x1 - x0) < 5.E-10) && (y1 > 0.0))
                     {
-                        result[shell] = y1;
+                        shellValues[i] = y1;
                     }
                     else
                      {
@@ -662,7 +762,7 @@ std::map<std::string, double> \
                         B = 1.0 / log( x1w / x0w);
                         A = log(x1w/energy) * B;
                         B *= log( energy / x0w);
-                        result[shell] = exp(A * log(y0) + B * log(y1));
+                        shellValues[i] = exp(A * log(y0) + B * log(y1));
                     }
                 }
             }
@@ -680,17 +780,17 @@ std::map<std::string, double> \
             {
                 if ((y0 > 0.0) && (y1 > 0.0))
                 {
-                    result[shell] = exp(A * log(y0) + B * log(y1));
+                    shellValues[i] = exp(A * log(y0) + B * log(y1));
                 }
                 else
                 {
                     if ((y1 > 0.0) && ((energy - x0) > 1.E-5))
                     {
-                        result[shell] = exp(B * log(y1));
+                        shellValues[i] = exp(B * log(y1));
                     }
                     else
                     {
-                        result[shell] = 0.0;
+                        shellValues[i] = 0.0;
                     }
                 }
             }
@@ -702,7 +802,7 @@ std::map<std::string, double> \
                     // std::cout << "case b1" << std::endl;
                     // usual interpolation case
                     // the shell is excited and the photoelectric coefficient is positive
-                    result[shell] = exp(A * log(y0) + B * log(y1));
+                    shellValues[i] = exp(A * log(y0) + B * log(y1));
                 }
                 else
                 {
@@ -722,22 +822,20 @@ std::map<std::string, double> \
                     B = 1.0 / log( x1w / x0w);
                     A = log(x1w/energy) * B;
                     B *= log( energy / x0w);
-                    result[shell] = exp(A * log(y0) + B * log(y1));
+                    shellValues[i] = exp(A * log(y0) + B * log(y1));
                 }
             }
         }
-        if (!Math::isFiniteNumber(result[shell]))
+#ifndef FISX_UNCHECKED
+        if (!Math::isFiniteNumber(shellValues[i]))
         {
-            std::cout << "energy " << energy << std::endl;
-            std::cout << "i1 " << i1 << " i2 " << i2 << std::endl;
-            std::cout << "A " << A << " B " << B << std::endl;
-            std::cout << "x0 " << x0 << " x1 " << x1 << std::endl;
-            std::cout << "y0 " << y0 << " y1 " << y1 << std::endl;
+            FISX_LOG_DEBUG("Element::interpolateMassAttenuationCoefficients", "energy = " << energy << \
+                           " i1 = " << i1 << " i2 = " << i2 << " A = " << A << " B = " << B << \
+                           " x0 = " << x0 << " x1 = " << x1 << " y0 = " << y0 << " y1 = " << y1);
             throw std::runtime_error("Partial photoelectric coefficient is not finite");
         }
+#endif
     }
-
-    return result;
 }
 
 std::vector<std::string> Element::getExcitedShells(const double & energy) const
@@ -794,6 +892,13 @@ std::vector<std::string> Element::getExcitedShells(const double & energy) const
 
 std::map<std::string, double> Element::getInitialPhotoelectricVacancyDistribution(\
                                                                 const double & energy) const
+{
+    InterpolationCursor cursor;
+    return this->getInitialPhotoelectricVacancyDistribution(energy, cursor);
+}
+
+std::map<std::string, double> Element::getInitialPhotoelectricVacancyDistribution(\
+                                            const double & energy, InterpolationCursor & cursor) const
 {
     std::map<std::string, double> tmpMap;
     std::map<std::string, double> result;
@@ -802,7 +907,7 @@ std::map<std::string, double> Element::getInitialPhotoelectricVacancyDistributio
     double total;
     std::string shellList[10] = {"K", "L1", "L2", "L3", "M1", "M2", "M3", "M4", "M5", "all other"};
 
-    tmpMap = this->getMassAttenuationCoefficients(energy);
+    tmpMap = this->getMassAttenuationCoefficients(energy, cursor);
     for (i = 0; i < 10; i++)
     {
         shell = shellList[i];
@@ -950,7 +1055,7 @@ const std::map<std::string, std::map<std::string, double> > & Element::getCoster
     return shell.getCosterKronigRatios();
 }
 
-std::map<std::string, double> Element::getShellConstants(const std::string & subshell) const
+const std::map<std::string, double> & Element::getShellConstants(const std::string & subshell) const
 {
 
     std::map<std::string, Shell>::const_iterator it;
@@ -991,7 +1096,7 @@ std::map<std::string, double> Element::getEmittedXRayLines(const double & energy
         c_it = this->bindingEnergy.find(keys[i]);
         if(c_it == this->bindingEnergy.end())
         {
-            std::cout << "Shell defined but energy not set " << keys[i] << std::endl;
+            FISX_LOG_DEBUG("Element::getEmittedXRayLines", "Shell defined but energy not set " << keys[i]);
             throw std::runtime_error("Shell defined but shell energy not set!");
         }
         if (energy <= c_it->second)
@@ -1033,7 +1138,7 @@ double Element::getTransitionEnergy(const std::string & transition) const
         }
         else
         {
-            std::cout << "Fluorescence transition " << transition << std::endl;
+            FISX_LOG_DEBUG("Element::getTransitionEnergy", "Fluorescence transition " << transition);
             throw std::domain_error("Invalid flurescence transition");
         }
     }
@@ -1041,20 +1146,20 @@ double Element::getTransitionEnergy(const std::string & transition) const
     bind_it = this->bindingEnergy.find(toShell);
     if(bind_it == this->bindingEnergy.end())
     {
-        std::cout << "Fluorescence transition " << transition << std::endl;
+        FISX_LOG_DEBUG("Element::getTransitionEnergy", "Fluorescence transition " << transition);
         throw std::domain_error("Transition to an undefined shell!");
     }
     energy0 = bind_it->second;
     if (energy0 <= 0)
     {
-        std::cout << "Fluorescence transition " << transition << std::endl;
+        FISX_LOG_DEBUG("Element::getTransitionEnergy", "Fluorescence transition " << transition);
         throw std::domain_error("Transition to a shell with 0 binding energy!");
     }
     bind_it = this->bindingEnergy.find(fromShell);
     if (bind_it == this->bindingEnergy.end())
     {
-        std::cout << "Fluorescence transition from undefined shell ";
-        std::cout << fromShell << std::endl;
+        FISX_LOG_DEBUG("Element::getTransitionEnergy", \
+                       "Fluorescence transition from undefined shell " << fromShell);
         energy1 = 0.0;
     }
     else
@@ -1065,21 +1170,15 @@ double Element::getTransitionEnergy(const std::string & transition) const
     {
         if (energy1 < 0.0)
         {
-            std::cout << this->name << " " << bind_it->first << " " ;
-            std::cout << bind_it->second << std::endl;
+            FISX_LOG_DEBUG("Element::getTransitionEnergy", \
+                           this->name << " " << bind_it->first << " " << bind_it->second);
             throw std::runtime_error("Negative binding energy!");
         }
         else
         {
-#ifndef NDEBUG
-            if (0)
-            {
-                std::cout << "Fluorescence transition from unset energy shell ";
-                std::cout << " Element = " << this->name;
-                std::cout << "Transition = " << transition << std::endl;
-                std::cout << fromShell << "Assuming 3 eV" << std::endl;
-            }
-#endif
+            FISX_LOG_DEBUG("Element::getTransitionEnergy", "Element = " << this->name << \
+                           " Transition = " << transition << " from unset energy shell " << fromShell << \
+                           ". Assuming 3 eV");
             energy1 = 0.003;
         }
     }
@@ -1180,7 +1279,8 @@ Element::getXRayLinesFromVacancyDistribution(const std::map<std::string, double>
                 cacheKey = cascadeCache.find(c_it->first);
                 if (cacheKey == cascadeCache.end())
                 {
-                    std::cout << this->name << " Error processing vacancy on shell " << c_it->first << std::endl;
+                    FISX_LOG_DEBUG("Element::getXRayLinesFromVacancyDistribution", \
+                                   this->name << " Error processing vacancy on shell " << c_it->first);
                     throw std::runtime_error("Vacancy on a shell not present in the cache!");
                     // the above is not good, there can be no emission following a vacancy (rate too low)
                     // it seems to be triggered by As L1 vacancies
@@ -1245,21 +1345,23 @@ Element::getXRayLinesFromVacancyDistribution(const std::map<std::string, double>
                 bind_it = this->bindingEnergy.find(keys[i]);
                 if(bind_it == this->bindingEnergy.end())
                 {
-                    std::cout << "Fluorescence transition " << c_it->first << std::endl;
+                    FISX_LOG_DEBUG("Element::getXRayLinesFromVacancyDistribution", \
+                                   "Fluorescence transition " << c_it->first);
                     throw std::domain_error("Transition to an undefined shell!");
                 }
                 energy0 = bind_it->second;
                 if (energy0 <= 0)
                 {
-                    std::cout << "Fluorescence transition " << c_it->first << std::endl;
+                    FISX_LOG_DEBUG("Element::getXRayLinesFromVacancyDistribution", \
+                                   "Fluorescence transition " << c_it->first);
                     throw std::domain_error("Transition to a shell with 0 binding energy!");
                 }
                 tmpString = c_it->first.substr(c_it->first.size() - 2, 2);
                 bind_it = this->bindingEnergy.find(tmpString);
                 if (bind_it == this->bindingEnergy.end())
                 {
-                    std::cout << "Fluorescence transition from undefined shell ";
-                    std::cout << tmpString << std::endl;
+                    FISX_LOG_DEBUG("Element::getXRayLinesFromVacancyDistribution", \
+                                   "Fluorescence transition from undefined shell " << tmpString);
                     energy1 = 0.0;
                 }
                 else
@@ -1270,23 +1372,16 @@ Element::getXRayLinesFromVacancyDistribution(const std::map<std::string, double>
                 {
                     if (energy1 < 0.0)
                     {
-                        std::cout << this->name << " " << bind_it->first << " " ;
-                        std::cout << bind_it->second << std::endl;
+                        FISX_LOG_DEBUG("Element::getXRayLinesFromVacancyDistribution", \
+                                       this->name << " " << bind_it->first << " " << bind_it->second);
                         throw std::runtime_error("Negative binding energy!");
                     }
                     else
                     {
-#ifndef NDEBUG
-                        if (0)
-                        {
-                        std::cout << "Element = " << this->name << " ";
-                        std::cout << "Fluorescence transition " << c_it->first << std::endl;
-                        std::cout << "rate = " << rate << std::endl;
-                        std::cout << "Fluorescence transition from unset energy shell ";
-                        std::cout << " destination shell energy = " << energy0 << std::endl;
-                        std::cout << tmpString << "Assuming 3 eV" << std::endl;
-                        }
-#endif
+                        FISX_LOG_DEBUG("Element::getXRayLinesFromVacancyDistribution", \
+                                       "Element = " << this->name << " Transition = " << c_it->first << \
+                                       " rate = " << rate << " from unset energy shell " << tmpString << \
+                                       ". Assuming 3 eV");
                         energy1 = 0.003;
                     }
                 }
@@ -1305,7 +1400,6 @@ const Shell & Element::getShell(const std::string & name) const
     it = this->shellInstance.find(name);
     if (it == this->shellInstance.end())
     {
-        std::cout << "Undefined shell " << name << std::endl;
         throw std::invalid_argument("Non defined shell: " + name);
     }
     return it->second;
@@ -1355,23 +1449,16 @@ std::vector<std::map<std::string, std::map<std::string, double> > >Element::getP
     std::vector<double>::size_type i;
     std::vector<std::map<std::string, std::map<std::string, double> > > result;
     std::map<std::string, std::map<std::string, double> >::iterator it;
-    static std::map<std::string, double> lastEnergy = std::map<std::string, double>() ;
-    static std::map<std::string, std::map<std::string, std::map<std::string, double> > >lastPhotoelectricExcitationFactors;
-    bool useCache;
 
+    // No state is kept between calls in order to allow concurrent calls on a shared instance
     if (weights.size() == 1)
         weight = weights[0];
     else
         weight = 1.0 / energy.size();
     result.clear();
-    if ((lastEnergy.size() == 0) || (this->cascadeCacheEnabledFlag == 0))
-    {
-        lastPhotoelectricExcitationFactors.clear();
-        lastEnergy.clear();
-    }
     if ((energy.size() > this->shellInstance.size()) && (this->cascadeCacheEnabledFlag == false) )
     {
-        std::cout << "USING TEMPORARY CACHE " << std::endl;
+        FISX_LOG_DEBUG("Element::getPhotoelectricExcitationFactors", "Using temporary cascade cache");
         std::map<std::string, std::map<std::string, std::map<std::string, double> > > cache;
         std::map<std::string, std::map<std::string, std::map<std::string, double> > >::const_iterator cacheKey;
         // calculate cascade for a single vacancy on each shell
@@ -1431,49 +1518,8 @@ std::vector<std::map<std::string, std::map<std::string, double> > >Element::getP
         {
             if (weights.size() > 1)
                 weight = weights[i];
-            useCache = false;
-            if (this->cascadeCacheEnabledFlag)
-            {
-                if ((lastEnergy.find(this->name) != lastEnergy.end()) && \
-                    (lastPhotoelectricExcitationFactors.find(this->name) != lastPhotoelectricExcitationFactors.end()))
-                {
-                    if (energy[i] == lastEnergy[this->name])
-                    {
-                        useCache = true;
-                    }
-                }
-            }
-            if (useCache)
-            {
-                // recalculating
-                //result.push_back(lastPhotoelectricExcitationFactors);
-                if (false)
-                {
-                    //test
-                    vacancyDistribution = this->getInitialPhotoelectricVacancyDistribution(energy[i]);
-                    result.push_back(this->getXRayLinesFromVacancyDistribution(vacancyDistribution, 1, 1));
-                    // CHECK
-                    for(it = result.back().begin(); it != result.back().end(); ++it)
-                    {
-                        std::cout << " ENERGIES = " << energy[i] << "  " << lastEnergy[this->name] << std::endl;
-                        std::cout << this->name << it->first << "->" << it->second["rate"] << " ????? ";
-                        std::cout << lastPhotoelectricExcitationFactors[this->name][it->first]["rate"] << std::endl;
-                    //result.push_back(lastPhotoelectricExcitationFactors);
-                    }
-                }
-                else
-                {
-                    result.push_back(lastPhotoelectricExcitationFactors[this->name]);
-                }
-            }
-            else
-            {
-                vacancyDistribution = this->getInitialPhotoelectricVacancyDistribution(energy[i]);
-                lastPhotoelectricExcitationFactors[this->name] = \
-                        this->getXRayLinesFromVacancyDistribution(vacancyDistribution, 1, 1);
-                lastEnergy[this->name] = energy[i];
-                result.push_back(lastPhotoelectricExcitationFactors[this->name]);
-            }
+            vacancyDistribution = this->getInitialPhotoelectricVacancyDistribution(energy[i]);
+            result.push_back(this->getXRayLinesFromVacancyDistribution(vacancyDistribution, 1, 1));
             for(it = result[i].begin(); it != result[i].end(); ++it)
             {
                 it->second["factor"] = it->second["rate"] * weight;
@@ -1500,66 +1546,8 @@ std::map<std::string, std::map<std::string, double> > Element::getPhotoelectricE
 
 std::pair<long, long> Element::getInterpolationIndices(const std::vector<double> & vec, const double & x) const
 {
-    static long lastI0 = 0L;
-    std::vector<double>::size_type length, iMin, iMax, distance;
-    int counter;
-    std::pair<long, long> result;
-
-    // try if last point is of any use
-    length = vec.size();
-    if (lastI0 >= (int) length)
-    {
-        lastI0 = (long) (length - 1);
-    }
-    if (x < vec[lastI0])
-    {
-        iMax = lastI0;
-        iMin = 0;
-    }
-    else
-    {
-        iMin = lastI0;
-        iMax = length - 1;
-        // try a point that is close?
-        if ((length - iMin) > 21)
-        {
-            lastI0 = (long) (iMin + 20);
-            if (x < vec[lastI0])
-            {
-                iMax = lastI0;
-            }
-        }
-    }
-
-    counter = 0;
-    distance = iMax - iMin;
-    while (distance > 1)
-    {
-        // divide the distance by two
-        if (distance > 2)
-        {
-            distance = distance >> 1;
-        }
-        else
-        {
-            distance -= 1;
-        }
-        lastI0 = (long) (iMin + distance);
-        if (x > vec[lastI0])
-        {
-            iMin = lastI0;
-        }
-        else
-        {
-            iMax = lastI0;
-        }
-        distance = iMax - iMin;
-        counter++;
-    }
-    // std::cout << "Needed " << counter << " iterations " << std::endl;
-    result.first = (long) iMin;
-    result.second = (long) iMax;
-    return result;
+    InterpolationCursor cursor;
+    return cursor.getIndices(vec, x);
 }
 
 
@@ -1620,4 +1608,55 @@ int Element::isCascadeCacheFilled() const
     }
 }
 
+void Element::writeBinary(BinaryWriter & writer) const
+{
+    std::map<std::string, Shell>::const_iterator c_it;
+
+    writer.write(this->name);
+    writer.write(this->atomicNumber);
+    writer.write(this->density);
+    writer.write(this->atomicMass);
+    writer.write(this->bindingEnergy);
+    writer.write(this->muEnergy);
+    writer.write(this->mu);
+    writer.write(this->muPartialPhotoelectricEnergy);
+    writer.write(this->muPartialPhotoelectricValue);
+    writer.write((int) this->shellInstance.size());
+    for (c_it = this->shellInstance.begin(); c_it != this->shellInstance.end(); ++c_it)
+    {
+        writer.write(c_it->first);
+        c_it->second.writeBinary(writer);
+    }
+    writer.write(this->shellXRayLines);
+    writer.write((int) this->cascadeCacheEnabledFlag);
+    writer.write(this->cascadeCache);
+}
+
+void Element::readBinary(BinaryReader & reader)
+{
+    int i, n, flag;
+    std::string key;
+
+    reader.read(this->name);
+    reader.read(this->atomicNumber);
+    reader.read(this->density);
+    reader.read(this->atomicMass);
+    reader.read(this->bindingEnergy);
+    reader.read(this->muEnergy);
+    reader.read(this->mu);
+    reader.read(this->muPartialPhotoelectricEnergy);
+    reader.read(this->muPartialPhotoelectricValue);
+    reader.read(n);
+    this->shellInstance.clear();
+    for (i = 0; i < n; i++)
+    {
+        reader.read(key);
+        this->shellInstance[key].readBinary(reader);
+    }
+    reader.read(this->shellXRayLines);
+    reader.read(flag);
+    this->cascadeCacheEnabledFlag = (flag != 0);
+    reader.read(this->cascadeCache);
+}
+
 } // namespace fisx
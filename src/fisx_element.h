@@ -6,6 +6,8 @@
 #include <map>
 #include "fisx_shell.h"
 #include "fisx_epdl97.h"
+#include "fisx_interpolationcursor.h"
+#include "fisx_binarystream.h"
 
 namespace fisx
 {
@@ -143,6 +145,22 @@ public:
     */
     std::map<std::string, double> getMassAttenuationCoefficients(const double & energy) const;
 
+    /*!
+    Same as above using the supplied cursor to speed up the table lookup. Sequential calls at
+    increasing energies with the same cursor are the most efficient.
+    */
+    std::map<std::string, double> getMassAttenuationCoefficients(const double & energy, \
+                                                                 InterpolationCursor & cursor) const;
+
+    /*!
+    Allocation free version for nEnergies energies. The coherent, Compton, pair and photoelectric
+    mass attenuation coefficients are written into the supplied arrays. The total is their sum.
+    */
+    void getMassAttenuationCoefficients(const double * energy, const int & nEnergies, \
+                                        InterpolationCursor & cursor, \
+                                        double * coherent, double * compton, \
+                                        double * pair, double * photoelectric) const;
+
     std::map<std::string, std::pair<double, int> > extractEdgeEnergiesFromMassAttenuationCoefficients();
     std::map<std::string, std::pair<double, int> > extractEdgeEnergiesFromMassAttenuationCoefficients(\
                                                             const std::vector<double> & energies,\
@@ -162,6 +180,16 @@ public:
     */
     std::map<std::string, double> getPartialPhotoelectricMassAttenuationCoefficients(\
                                                                     const double & energy) const;
+    std::map<std::string, double> getPartialPhotoelectricMassAttenuationCoefficients(\
+                                                                    const double & energy, \
+                                                                    InterpolationCursor & cursor) const;
+    /*!
+    Allocation free version. shellValues receives the K, L1, L2, L3, M1, M2, M3, M4, M5 and
+    "all other" values in that order.
+    */
+    void getPartialPhotoelectricMassAttenuationCoefficients(const double & energy, \
+                                                            InterpolationCursor & cursor, \
+                                                            double * shellValues) const;
 
     // Shell transitions description
     void setRadiativeTransitions(std::string subshell, std::map<std::string, double> values);
@@ -183,7 +211,7 @@ public:
 
     // Shell constants (fluorescence yield, Coster-Kronig yields)
     void setShellConstants(std::string subshell, std::map<std::string, double> constants);
-    std::map<std::string, double> getShellConstants(const std::string & subshell) const;
+    const std::map<std::string, double> & getShellConstants(const std::string & subshell) const;
 
 
     /*!
@@ -219,6 +247,8 @@ public:
     mu_photoelectric(shell, E)/mu_photoelectric(total, E).
     */
     std::map<std::string, double> getInitialPhotoelectricVacancyDistribution(const double & energy) const;
+    std::map<std::string, double> getInitialPhotoelectricVacancyDistribution(const double & energy, \
+                                                                    InterpolationCursor & cursor) const;
 
     std::map<std::string, double> getCascadeModifiedVacancyDistribution(const std::map<std::string, \
                                                                         double> & distribution) const;
@@ -289,7 +319,18 @@ public:
     void fillCascadeCache();
     void emptyCascadeCache();
 
+    /*!
+    Write or read the complete state of the instance, shells and cascade cache included
+    (see Elements::getSnapshot).
+    */
+    void writeBinary(BinaryWriter & writer) const;
+    void readBinary(BinaryReader & reader);
+
 private:
+    bool hasPartialPhotoelectricCoefficients() const;
+    // coherent, compton and pair into processes, partial photoelectric into shellValues
+    void interpolateMassAttenuationCoefficients(const double & energy, InterpolationCursor & cursor, \
+                                                double * processes, double * shellValues) const;
     std::string name;
     int    atomicNumber;
     double density;
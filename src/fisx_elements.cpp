@@ -5,11 +5,20 @@
 #include <cmath>
 #include <sstream>
 #include <algorithm>
+#include <fstream>
 #include "fisx_elements.h"
 
 namespace fisx
 {
 
+const std::string ELEMENTS_SNAPSHOT_TAG = "fisx Elements";
+const int ELEMENTS_SNAPSHOT_VERSION = 1;
+
+Elements::Elements()
+{
+    this->revision = 0;
+}
+
 Elements::Elements(std::string epdl97Directory, std::string bindingEnergiesFileName, std::string crossSectionsFile)
 {
     // this is to simplify an initialization equivalent to that of PyMca:
@@ -66,6 +75,8 @@ void Elements::initialize(std::string epdl97Directory, std::string bindingEnergi
     std::string joinSymbol;
     std::string filename;
 
+    this->revision = 0;
+
     // Indicate we are going to configure everything
     this->shellConstantsFile["K"] = "";
     this->shellConstantsFile["L"] = "";
@@ -207,6 +218,8 @@ void Elements::addElement(const Element & element)
     std::string name;
     name = element.getName();
 
+    this->revision++;
+
     if (this->elementDict.find(name) != this->elementDict.end())
     {
         // an element with that name already exists
@@ -232,6 +245,8 @@ void Elements::setShellConstantsFile(const std::string & mainShellName, \
     std::map<std::string, double > tmpDict;
     std::string msg;
 
+    this->revision++;
+
     if ((mainShellName == "K") || (mainShellName == "L") || (mainShellName == "M"))
     {
         // We have received a valid main shell and not a subshell
@@ -339,6 +354,8 @@ void Elements::setShellNonradiativeTransitionsFile(const std::string & mainShell
     std::string subshell;
     std::string msg;
 
+    this->revision++;
+
     if ((mainShellName == "K") || (mainShellName == "L") || (mainShellName == "M"))
     {
         // We have received a valid main shell and not a subshell
@@ -435,6 +452,8 @@ void Elements::setShellRadiativeTransitionsFile(const std::string & mainShellNam
     std::string subshell;
     std::string msg;
 
+    this->revision++;
+
     if ((mainShellName == "K") || (mainShellName == "L") || (mainShellName == "M"))
     {
         // We have received a valid main shell and not a subshell
@@ -531,6 +550,8 @@ void Elements::setMassAttenuationCoefficientsFile(const std::string & fileName)
     std::vector<double> muPhotoelectric;
     std::string key;
 
+    this->revision++;
+
     sf = SimpleSpecfile(fileName);
     nScans = sf.getNumberOfScans();
     if (nScans < 1)
@@ -637,6 +658,7 @@ void Elements::setMassAttenuationCoefficients(const std::string & name,
     double tmpDouble;
     int atomicNumber, idx;
 
+    this->revision++;
 
     if (this->elementDict.find(name) == this->elementDict.end())
     {
@@ -921,18 +943,122 @@ std::map<std::string, std::vector<double> > Elements::getMassAttenuationCoeffici
                                                 std::map<std::string, double> inputFormulaDict,\
                                                                 std::vector<double> energy) const
 {
-    std::string element, msg, name;
-    double total, massFraction;
+    std::map<std::string, std::vector<double> > result;
+
+    this->getMassAttenuationCoefficients(inputFormulaDict, energy, result);
+    return result;
+}
+
+void Elements::getMassAttenuationCoefficients(const std::string & name, \
+                                              const std::vector<double> & energy, \
+                                              std::map<std::string, std::vector<double> > & result) const
+{
+    std::vector<double> & energyResult = result["energy"];
+    std::vector<double> & coherent = result["coherent"];
+    std::vector<double> & compton = result["compton"];
+    std::vector<double> & pair = result["pair"];
+    std::vector<double> & photoelectric = result["photoelectric"];
+    std::vector<double> & total = result["total"];
+
+    energyResult = energy;
+    coherent.resize(energy.size());
+    compton.resize(energy.size());
+    pair.resize(energy.size());
+    photoelectric.resize(energy.size());
+    total.resize(energy.size());
+    // the name is validated even without energies
+    this->getMassAttenuationCoefficients(name, \
+                                         energy.size() ? &energy[0] : NULL, (int) energy.size(), \
+                                         energy.size() ? &total[0] : NULL, \
+                                         energy.size() ? &photoelectric[0] : NULL, \
+                                         energy.size() ? &coherent[0] : NULL, \
+                                         energy.size() ? &compton[0] : NULL, \
+                                         energy.size() ? &pair[0] : NULL);
+}
+
+void Elements::getMassAttenuationCoefficients(const std::map<std::string, double> & inputFormulaDict, \
+                                              const std::vector<double> & energy, \
+                                              std::map<std::string, std::vector<double> > & result) const
+{
+    std::vector<double> & energyResult = result["energy"];
+    std::vector<double> & coherent = result["coherent"];
+    std::vector<double> & compton = result["compton"];
+    std::vector<double> & pair = result["pair"];
+    std::vector<double> & photoelectric = result["photoelectric"];
+    std::vector<double> & total = result["total"];
+
+    energyResult = energy;
+    coherent.resize(energy.size());
+    compton.resize(energy.size());
+    pair.resize(energy.size());
+    photoelectric.resize(energy.size());
+    total.resize(energy.size());
+    // the composition is validated even without energies
+    this->getMassAttenuationCoefficients(inputFormulaDict, \
+                                         energy.size() ? &energy[0] : NULL, (int) energy.size(), \
+                                         energy.size() ? &total[0] : NULL, \
+                                         energy.size() ? &photoelectric[0] : NULL, \
+                                         energy.size() ? &coherent[0] : NULL, \
+                                         energy.size() ? &compton[0] : NULL, \
+                                         energy.size() ? &pair[0] : NULL);
+}
+
+void Elements::getMassAttenuationCoefficients(const std::string & name, \
+                                              const double * energy, const int & nEnergies, \
+                                              double * total, double * photoelectric, double * coherent, \
+                                              double * compton, double * pair) const
+{
+    std::string msg;
+    std::map<std::string, double> composition;
+    std::map<std::string, int>::const_iterator c_it;
+    int n;
+    InterpolationCursor cursor;
+
+    c_it = this->elementDict.find(name);
+    if (c_it == this->elementDict.end())
+    {
+        composition = this->getComposition(name);
+        if (composition.size() < 1)
+        {
+            msg = "Name " + name + " not accepted as element, material or chemical formula";
+            throw std::invalid_argument(msg);
+        }
+        this->getMassAttenuationCoefficients(composition, energy, nEnergies, \
+                                             total, photoelectric, coherent, compton, pair);
+        return;
+    }
+    if (nEnergies < 1)
+    {
+        return;
+    }
+    this->elementList[c_it->second].getMassAttenuationCoefficients(energy, nEnergies, \
+                                                cursor, coherent, compton, pair, photoelectric);
+    for (n = 0; n < nEnergies; n++)
+    {
+        total[n] = photoelectric[n] + coherent[n] + compton[n] + pair[n];
+    }
+}
+
+void Elements::getMassAttenuationCoefficients(const std::map<std::string, double> & inputFormulaDict, \
+                                              const double * energy, const int & nEnergies, \
+                                              double * total, double * photoelectric, double * coherent, \
+                                              double * compton, double * pair) const
+{
+    std::string msg, name;
+    double totalMassFraction, massFraction;
+    double values[4];
     std::map<std::string, double>::const_iterator c_it;
     std::map<std::string, double> composition;
-    std::map<std::string, double> tmpResult;
-    std::map<std::string, std::vector<double> > result;
-    std::map<std::string, std::vector<double> >::size_type n;
+    int n;
+    std::vector<const Element *> elementPointers;
+    std::vector<double> elementMassFractions;
+    std::vector<InterpolationCursor> cursors;
+    std::vector<double>::size_type i;
     std::map<std::string, double> elementsDict;
     std::map<std::string, double>::iterator it;
     std::map<std::string , int>::const_iterator mapIterator;
 
-    total = 0.0;
+    totalMassFraction = 0.0;
     for (c_it = inputFormulaDict.begin(); c_it != inputFormulaDict.end(); ++c_it)
     {
         massFraction = c_it->second;
@@ -943,7 +1069,6 @@ std::map<std::string, std::vector<double> > Elements::getMassAttenuationCoeffici
         }
         // we may have received formulas ...
         name = c_it->first;
-        //composition = this->getCompositionFromFormula(name);
         composition = this->getComposition(name);
         if (composition.size() < 1)
         {
@@ -959,46 +1084,43 @@ std::map<std::string, std::vector<double> > Elements::getMassAttenuationCoeffici
             }
             elementsDict[it->first] += composition[it->first];
         }
-        total += massFraction;
+        totalMassFraction += massFraction;
     }
 
-    if (total <= 0.0)
+    if (totalMassFraction <= 0.0)
     {
         msg = "Sum of mass fractions is less or equal to 0";
         throw std::invalid_argument(msg);
     }
 
-    result["energy"].resize(energy.size());
-    result["coherent"].resize(energy.size());
-    result["compton"].resize(energy.size());
-    result["pair"].resize(energy.size());
-    result["photoelectric"].resize(energy.size());
-    result["total"].resize(energy.size());
+    // resolve the elements once, each one keeps its own interpolation cursor
+    for (c_it = elementsDict.begin(); c_it != elementsDict.end(); ++c_it)
+    {
+        mapIterator = this->elementDict.find(c_it->first);
+        elementPointers.push_back(&(this->elementList[mapIterator->second]));
+        elementMassFractions.push_back(c_it->second / totalMassFraction);
+    }
+    cursors.resize(elementPointers.size());
 
-    for (n = 0; n < result["energy"].size(); n++)
+    for (n = 0; n < nEnergies; n++)
     {
-        result["energy"][n] = energy[n];
-        result["coherent"][n] = 0.0;
-        result["compton"][n] = 0.0;
-        result["pair"][n] = 0.0;
-        result["photoelectric"][n] = 0.0;
-        for (c_it = elementsDict.begin(); c_it != elementsDict.end(); ++c_it)
+        coherent[n] = 0.0;
+        compton[n] = 0.0;
+        pair[n] = 0.0;
+        photoelectric[n] = 0.0;
+        for (i = 0; i < elementPointers.size(); i++)
         {
-
-            massFraction = c_it->second / total;
-            element = c_it->first;
-            mapIterator = this->elementDict.find(element);
-            tmpResult = this->elementList[mapIterator->second].getMassAttenuationCoefficients(energy[n]);
-            result["coherent"][n] += tmpResult["coherent"] * massFraction;
-            result["compton"][n] += tmpResult["compton"] * massFraction;
-            result["pair"][n] += tmpResult["pair"] * massFraction;
-            result["photoelectric"][n] += tmpResult["photoelectric"] * massFraction;
+            massFraction = elementMassFractions[i];
+            elementPointers[i]->getMassAttenuationCoefficients(&energy[n], 1, cursors[i], \
+                                                &values[0], &values[1], &values[2], &values[3]);
+            coherent[n] += values[0] * massFraction;
+            compton[n] += values[1] * massFraction;
+            pair[n] += values[2] * massFraction;
+            photoelectric[n] += values[3] * massFraction;
         }
 
-        result["total"] [n] = (result["coherent"][n] + result["compton"][n]) + \
-                               result["pair"][n] + result["photoelectric"][n];
+        total[n] = (coherent[n] + compton[n]) + pair[n] + photoelectric[n];
     }
-    return result;
 }
 
 
@@ -1027,6 +1149,8 @@ void Elements::addMaterial(const std::string & name, const double & density, \
     Material material;
     std::map<std::string, double> composition;
 
+    this->revision++;
+
     if (this->getMaterialIndexFromName(name) < this->materialList.size())
     {
         if (errorOnReplace)
@@ -1057,6 +1181,8 @@ void Elements::setMaterialComposition(const std::string & materialName, \
     std::string msg;
     std::vector<Material>::size_type i;
 
+    this->revision++;
+
     i = this->getMaterialIndexFromName(materialName);
     if (i == this->materialList.size())
     {
@@ -1072,6 +1198,8 @@ void Elements::setMaterialComposition(const std::string & materialName, \
     std::string msg;
     std::vector<Material>::size_type i;
 
+    this->revision++;
+
     i = this->getMaterialIndexFromName(materialName);
     if (i >= this->materialList.size())
     {
@@ -1116,6 +1244,7 @@ void Elements::addMaterial(const Material & material, const int & errorOnReplace
     std::string materialName;
     std::vector<Material>::size_type i;
 
+    this->revision++;
 
     materialName = material.getName();
 
@@ -1145,6 +1274,7 @@ void Elements::addMaterial(const Material & material, const int & errorOnReplace
 
 void Elements::removeMaterials()
 {
+    this->revision++;
     this->materialList.clear();
 }
 
@@ -1278,6 +1408,53 @@ std::map<std::string, std::map<std::string, double> > Elements::getExcitationFac
     return this->getExcitationFactors(element, energies, weights)[0];
 }
 
+void Elements::getExcitationFactors(const std::string & element, \
+                                    const double * energies, const double * weights, const int & nEnergies, \
+                                    std::map<std::string, std::vector<double> > & rates, \
+                                    std::map<std::string, double> & lineEnergies) const
+{
+    const Element & elementObject = this->getElement(element);
+    std::vector<double> energyVector;
+    std::vector<double> weightVector;
+    std::vector<std::map<std::string, std::map<std::string, double> > > factors;
+    std::map<std::string, std::map<std::string, double> >::const_iterator c_it;
+    std::map<std::string, std::vector<double> >::iterator it;
+    int i;
+
+    if (nEnergies > 0)
+    {
+        energyVector.assign(energies, energies + nEnergies);
+        if (weights == NULL)
+        {
+            weightVector.resize(nEnergies, 1.0);
+        }
+        else
+        {
+            weightVector.assign(weights, weights + nEnergies);
+        }
+        factors = elementObject.getPhotoelectricExcitationFactors(energyVector, weightVector);
+    }
+
+    for (it = rates.begin(); it != rates.end(); ++it)
+    {
+        it->second.assign(nEnergies, 0.0);
+    }
+    lineEnergies.clear();
+    for (i = 0; i < (int) factors.size(); i++)
+    {
+        for (c_it = factors[i].begin(); c_it != factors[i].end(); ++c_it)
+        {
+            it = rates.find(c_it->first);
+            if (it == rates.end())
+            {
+                it = rates.insert(std::make_pair(c_it->first, std::vector<double>(nEnergies, 0.0))).first;
+            }
+            it->second[i] = c_it->second.find("rate")->second;
+            lineEnergies[c_it->first] = c_it->second.find("energy")->second;
+        }
+    }
+}
+
 std::map<std::string, double> Elements::parseFormula(const std::string & formula) const
 {
     std::map<std::string, double> composition;
@@ -1539,6 +1716,7 @@ std::vector<std::pair<std::string, double> > Elements::getPeakFamilies( \
                             const std::vector<std::string> & elementList, const double & energy) const
 {
     std::map<std::string, double>::const_iterator c_it;
+    std::map<std::string, double>::const_iterator omega_it;
     std::vector<std::string>::size_type i, j;
     std::vector<std::string> shells;
     std::vector<std::pair<std::string, double> >result;
@@ -1556,7 +1734,10 @@ std::vector<std::pair<std::string, double> > Elements::getPeakFamilies( \
                 c_it = bindingEnergies.find(shells[j]);
                 if ((shells[j][0] == 'K') || (shells[j][0] == 'L') || (shells[j][0] == 'M'))
                 {
-                    if (getElement(elementList[i]).getShellConstants(shells[j])["omega"] > 0.0)
+                    const std::map<std::string, double> & shellConstants = \
+                                getElement(elementList[i]).getShellConstants(shells[j]);
+                    omega_it = shellConstants.find("omega");
+                    if ((omega_it != shellConstants.end()) && (omega_it->second > 0.0))
                     {
                         result.push_back(std::make_pair(elementList[i] + " " + shells[j], c_it->second));
                     }
@@ -1600,6 +1781,11 @@ std::vector<std::pair<std::string, double> > Elements::getPeakFamilies( \
 }
 
 
+const unsigned long & Elements::getRevision() const
+{
+    return this->revision;
+}
+
 bool Elements::stringToDouble(const std::string& str, double& number)
 {
 
@@ -1740,6 +1926,8 @@ void Elements::removeMaterial(const std::string & name)
 {
     std::string msg;
     std::vector<Material>::size_type i;
+
+    this->revision++;
     i = this->getMaterialIndexFromName(name);
     if ( i >= this->materialList.size())
     {
@@ -1802,4 +1990,120 @@ void Elements::emptyElementCascadeCache(const std::string & elementName)
         throw std::invalid_argument("Invalid element: " + elementName);
 }
 
+void Elements::getSnapshot(std::vector<char> & buffer) const
+{
+    BinaryWriter writer(buffer);
+    std::vector<Element>::size_type i;
+
+    buffer.clear();
+    writer.writeHeader(ELEMENTS_SNAPSHOT_TAG, ELEMENTS_SNAPSHOT_VERSION);
+    this->epdl97.writeBinary(writer);
+    writer.write(this->elementDict);
+    writer.write((int) this->elementList.size());
+    for (i = 0; i < this->elementList.size(); i++)
+    {
+        this->elementList[i].writeBinary(writer);
+    }
+    writer.write(this->shellConstantsFile);
+    writer.write(this->shellRadiativeTransitionsFile);
+    writer.write(this->shellNonradiativeTransitionsFile);
+}
+
+void Elements::setSnapshot(const char * buffer, const std::size_t & size)
+{
+    BinaryReader reader(buffer, size);
+    EPDL97 newEpdl97;
+    std::map<std::string, int> newElementDict;
+    std::vector<Element> newElementList;
+    std::map<std::string, std::string> newShellConstantsFile;
+    std::map<std::string, std::string> newShellRadiativeTransitionsFile;
+    std::map<std::string, std::string> newShellNonradiativeTransitionsFile;
+    std::map<std::string, int>::const_iterator c_it;
+    std::vector<Element>::size_type i;
+    int n;
+
+    this->revision++;
+
+    if (reader.readHeader(ELEMENTS_SNAPSHOT_TAG) != ELEMENTS_SNAPSHOT_VERSION)
+    {
+        throw std::runtime_error("Elements::setSnapshot. Unsupported snapshot version");
+    }
+    // decode everything before touching the instance
+    newEpdl97.readBinary(reader);
+    reader.read(newElementDict);
+    reader.read(n);
+    if ((n < 0) || (n != (int) newElementDict.size()))
+    {
+        throw std::runtime_error("Elements::setSnapshot. Inconsistent number of elements");
+    }
+    newElementList.resize(n);
+    for (i = 0; i < newElementList.size(); i++)
+    {
+        newElementList[i].readBinary(reader);
+    }
+    for (c_it = newElementDict.begin(); c_it != newElementDict.end(); ++c_it)
+    {
+        if ((c_it->second < 0) || (c_it->second >= n))
+        {
+            throw std::runtime_error("Elements::setSnapshot. Invalid element index");
+        }
+    }
+    reader.read(newShellConstantsFile);
+    reader.read(newShellRadiativeTransitionsFile);
+    reader.read(newShellNonradiativeTransitionsFile);
+
+    this->epdl97 = newEpdl97;
+    this->elementDict.swap(newElementDict);
+    this->elementList.swap(newElementList);
+    this->shellConstantsFile.swap(newShellConstantsFile);
+    this->shellRadiativeTransitionsFile.swap(newShellRadiativeTransitionsFile);
+    this->shellNonradiativeTransitionsFile.swap(newShellNonradiativeTransitionsFile);
+}
+
+void Elements::saveSnapshot(const std::string & fileName) const
+{
+    std::vector<char> buffer;
+    std::ofstream outputFile;
+
+    this->getSnapshot(buffer);
+    outputFile.open(fileName.c_str(), std::ios::out | std::ios::binary);
+    if (!outputFile.is_open())
+    {
+        throw std::ios_base::failure("Cannot open file " + fileName);
+    }
+    outputFile.write(&buffer[0], buffer.size());
+    outputFile.close();
+    if (outputFile.fail())
+    {
+        throw std::ios_base::failure("Error writing file " + fileName);
+    }
+}
+
+void Elements::loadSnapshot(const std::string & fileName)
+{
+    std::vector<char> buffer;
+    std::ifstream inputFile;
+    std::streamoff size;
+
+    inputFile.open(fileName.c_str(), std::ios::in | std::ios::binary);
+    if (!inputFile.is_open())
+    {
+        throw std::ios_base::failure("Cannot open file " + fileName);
+    }
+    inputFile.seekg(0, std::ios::end);
+    size = inputFile.tellg();
+    inputFile.seekg(0, std::ios::beg);
+    if (size < 1)
+    {
+        throw std::ios_base::failure("Empty snapshot file " + fileName);
+    }
+    buffer.resize((std::vector<char>::size_type) size);
+    inputFile.read(&buffer[0], size);
+    if (inputFile.fail())
+    {
+        throw std::ios_base::failure("Error reading file " + fileName);
+    }
+    this->setSnapshot(&buffer[0], buffer.size());
+}
+
 } // namespace fisx
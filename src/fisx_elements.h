@@ -24,11 +24,20 @@ namespace fisx
 
    This class initializes a default library of physical properties and allows the user
    to modify and to access those properties.
+
+   The const methods do not modify the instance and can be called concurrently from several
+   threads. The non const methods (adding materials, loading files, enabling caches, ...) must
+   not be called while other threads are using the instance.
  */
 class Elements
 {
 
 public:
+    /*!
+    Empty library. It has to be initialized with setSnapshot or loadSnapshot.
+    */
+    Elements();
+
     /*!
     Initialize the library from the EPDL97 data files found in the provided directory.
     */
@@ -178,6 +187,34 @@ public:
                                                 std::vector<double> energies) const;
 
 
+    /*!
+    Same as above but the coherent, compton, pair, photoelectric, total and energy vectors are
+    written into the supplied map. Vectors already present in the map are resized in place, so
+    a map reused between calls with the same number of energies does not allocate memory for them.
+    */
+    void getMassAttenuationCoefficients(const std::string & formula, \
+                                        const std::vector<double> & energies, \
+                                        std::map<std::string, std::vector<double> > & result) const;
+
+    void getMassAttenuationCoefficients(const std::map<std::string, double> & elementMassFractions, \
+                                        const std::vector<double> & energies, \
+                                        std::map<std::string, std::vector<double> > & result) const;
+
+    /*!
+    Same as above for nEnergies contiguous energies. The coefficients are written into the supplied
+    arrays, each one with room for nEnergies values. Intended for callers owning their buffers
+    (NumPy arrays, ...).
+    */
+    void getMassAttenuationCoefficients(const std::string & formula, \
+                                        const double * energies, const int & nEnergies, \
+                                        double * total, double * photoelectric, double * coherent, \
+                                        double * compton, double * pair) const;
+
+    void getMassAttenuationCoefficients(const std::map<std::string, double> & elementMassFractions, \
+                                        const double * energies, const int & nEnergies, \
+                                        double * total, double * photoelectric, double * coherent, \
+                                        double * compton, double * pair) const;
+
     /*!
     Convenience method.
     Given an element or formula and an energy, give back the mass attenuation coefficients at the
@@ -294,6 +331,18 @@ public:
                             const double & energy, \
                             const double & weights = 1.0) const;
 
+    /*!
+    Same as above for nEnergies contiguous energies and weights, arranged by emission line.
+    If weights is NULL, a weight of 1.0 is used for every energy.
+    On output, rates[line] holds the rate of the line at each of the incident energies (0.0 where the
+    line is not excited) and lineEnergies[line] the energy of the line. Vectors already present in
+    rates are resized in place.
+    */
+    void getExcitationFactors(const std::string & element, \
+                              const double * energies, const double * weights, const int & nEnergies, \
+                              std::map<std::string, std::vector<double> > & rates, \
+                              std::map<std::string, double> & lineEnergies) const;
+
     /*!
     Given an element, formula or material return an ordered vector of pairs. The first element
     is the peak family ("Si K", "Pb L1", ...) and the second the binding energy.
@@ -354,6 +403,33 @@ public:
     void fillElementCascadeCache(const std::string & elementName);
     void emptyElementCascadeCache(const std::string & elementName);
 
+    /*!
+    Serialize the library into a flat buffer: elements, shell constants and transitions, cross
+    sections, cascade caches and the EPDL97 tables. User defined materials are not included.
+    The buffer does not contain pointers. It can be written to a file or to a shared memory
+    segment and used by other processes to initialize their own instance without reading and
+    parsing the data files.
+    */
+    void getSnapshot(std::vector<char> & buffer) const;
+
+    /*!
+    Replace the library contents by those of a buffer obtained from getSnapshot on the same
+    platform. The defined materials are kept. The buffer is not referenced after the call.
+    */
+    void setSnapshot(const char * buffer, const std::size_t & size);
+
+    /*!
+    Convenience methods to write and read a snapshot file.
+    */
+    void saveSnapshot(const std::string & fileName) const;
+    void loadSnapshot(const std::string & fileName);
+
+    /*!
+    Number increased by every change of the physical data or of the defined materials. Together
+    with the address of the instance, it allows to detect that results cached from it are outdated.
+    */
+    const unsigned long & getRevision() const;
+
     /*!
     Utility to convert from string to double.
     */
@@ -381,6 +457,9 @@ private:
     // The vector of defined Materials
     std::vector<Material> materialList;
 
+    // See getRevision
+    unsigned long revision;
+
     // Utility function
     const std::vector<Material>::size_type getMaterialIndexFromName(const std::string & name) const;
 
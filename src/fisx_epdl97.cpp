@@ -1,7 +1,7 @@
 #include "fisx_epdl97.h"
 #include "fisx_simplespecfile.h"
+#include "fisx_logger.h"
 #include <stdexcept>
-#include <iostream>
 #include <math.h>
 
 
@@ -168,7 +168,8 @@ void EPDL97::loadCrossSections(std::string fileName)
     nScans = sf.getNumberOfScans();
     if (nScans < 99)
     {
-        std::cout << "Reading filename " << fileName << " Number of scans = " << nScans << std::endl;
+        FISX_LOG_DEBUG("EPDL97::loadCrossSections", "Reading filename " << fileName << \
+                       " Number of scans = " << nScans);
         throw std::ios_base::failure("EPDL97: Not enough scans in cross sections file");
     }
 
@@ -238,8 +239,8 @@ void EPDL97::loadCrossSections(std::string fileName)
         // check if the labels are the same (they should)
         if (tmpLabels.size() != nLabels)
         {
-            std::cout << "Scan " << i <<\
-                " does not have the same amount of labels as " << (i + 1) << std::endl;
+            FISX_LOG_DEBUG("EPDL97::loadCrossSections", "Scan " << i << \
+                           " does not have the same amount of labels as " << (i + 1));
             throw std::length_error("EPDL97: All scans do not have the same number of labels");
         }
         for (j = 0; j < nLabels; j++)
@@ -331,6 +332,13 @@ const std::map<std::string, double> & EPDL97::getBindingEnergies(const int & z)
 
 
 std::map<std::string, double> EPDL97::getMassAttenuationCoefficients(const int & z, const double & energy) const
+{
+    InterpolationCursor cursor;
+    return this->getMassAttenuationCoefficients(z, energy, cursor);
+}
+
+std::map<std::string, double> EPDL97::getMassAttenuationCoefficients(const int & z, const double & energy, \
+                                                                     InterpolationCursor & cursor) const
 {
     std::pair<long, long> indices;
     long i1, i2, i1w, i2w;
@@ -361,7 +369,7 @@ std::map<std::string, double> EPDL97::getMassAttenuationCoefficients(const int &
     }
 
 
-    indices = this->getInterpolationIndices(this->muEnergy[zHelp], energy);
+    indices = cursor.getIndices(this->muEnergy[zHelp], energy);
 
     i1 = indices.first;
     i2 = indices.second;
@@ -414,8 +422,7 @@ std::map<std::string, double> EPDL97::getMassAttenuationCoefficients(const int &
                     cStrDoubleIt = this->bindingEnergy[zHelp].find(key);
                     if (cStrDoubleIt == this->bindingEnergy[zHelp].end())
                     {
-                        std::cout << "Key not found " << key << std::endl;
-                        throw std::runtime_error("Key not found");
+                        throw std::runtime_error("Key not found " + key);
                     }
                     if ((energy >=  cStrDoubleIt->second) && \
                        (cStrDoubleIt->second > 0.0))
@@ -502,8 +509,7 @@ std::map<std::string, double> EPDL97::getMassAttenuationCoefficients(const int &
                 cStrDoubleIt = this->bindingEnergy[zHelp].find(key);
                 if (cStrDoubleIt == this->bindingEnergy[zHelp].end())
                 {
-                    std::cout << "Key not found " << key << std::endl;
-                    throw std::runtime_error("Key not found");
+                    throw std::runtime_error("Key not found " + key);
                 }
                 if ((energy >= cStrDoubleIt->second) && \
                     (cStrDoubleIt->second > 0.0))
@@ -557,12 +563,13 @@ std::map<std::string, std::vector<double> > EPDL97::getMassAttenuationCoefficien
     std::map<std::string, double> tmpResult;
     std::map<std::string, std::vector<double> > result;
     std::map<std::string, double>::const_iterator c_it;
+    InterpolationCursor cursor;
 
     length = energy.size();
 
     for (i = 0; i < length; i++)
     {
-        tmpResult = this->getMassAttenuationCoefficients(z, energy[i]);
+        tmpResult = this->getMassAttenuationCoefficients(z, energy[i], cursor);
         if (i == 0)
         {
             for (c_it = tmpResult.begin(); c_it != tmpResult.end(); ++c_it)
@@ -649,6 +656,14 @@ std::map< std::string, std::vector<double> > EPDL97::getMassAttenuationCoefficie
 
 std::map<std::string, double> EPDL97::getPhotoelectricWeights(const int & z, \
                                                               const double & energy)
+{
+    InterpolationCursor cursor;
+    return this->getPhotoelectricWeights(z, energy, cursor);
+}
+
+std::map<std::string, double> EPDL97::getPhotoelectricWeights(const int & z, \
+                                                              const double & energy, \
+                                                              InterpolationCursor & cursor)
 {
     // Given an excitation energy and an optional list of shells to consider
     // gives back the ratio mu(shell, energy)/mu(energy) where mu refers to the photoelectric
@@ -665,7 +680,7 @@ std::map<std::string, double> EPDL97::getPhotoelectricWeights(const int & z, \
     double muPhotoelectric;
 
     // get the mass attenuation coefficients
-    tmpResult = this->getMassAttenuationCoefficients(z, energy);
+    tmpResult = this->getMassAttenuationCoefficients(z, energy, cursor);
 
     for (c_it = tmpResult.begin(); c_it != tmpResult.end(); ++c_it)
     {
@@ -701,12 +716,13 @@ std::map<std::string, std::vector<double> > EPDL97::getPhotoelectricWeights(cons
     std::map<std::string, double> tmpResult;
     std::map<std::string, std::vector<double> > result;
     std::map<std::string, double>::const_iterator c_it;
+    InterpolationCursor cursor;
 
     length = energy.size();
 
     for (i = 0; i < length; i++)
     {
-        tmpResult = this->getPhotoelectricWeights(z, energy[i]);
+        tmpResult = this->getPhotoelectricWeights(z, energy[i], cursor);
         if (i == 0)
         {
             for (c_it = tmpResult.begin(); c_it != tmpResult.end(); ++c_it)
@@ -734,66 +750,37 @@ std::string EPDL97::toUpperCaseString(const std::string & str) const
 
 std::pair<long, long> EPDL97::getInterpolationIndices(const std::vector<double> & vec, const double & x) const
 {
-    static long lastI0 = 0L;
-    std::vector<double>::size_type length, iMin, iMax, distance;
-    int counter;
-    std::pair<long, long> result;
-
-    // try if last point is of any use
-    length = vec.size();
-    if (lastI0 >= (int) length)
-    {
-        lastI0 = (long) (length - 1);
-    }
-    if (x < vec[lastI0])
-    {
-        iMax = lastI0;
-        iMin = 0;
-    }
-    else
-    {
-        iMin = lastI0;
-        iMax = length - 1;
-        // try a point that is close?
-        if ((length - iMin) > 21)
-        {
-            lastI0 = (long) (iMin + 20);
-            if (x < vec[lastI0])
-            {
-                iMax = lastI0;
-            }
-        }
-    }
+    InterpolationCursor cursor;
+    return cursor.getIndices(vec, x);
+}
 
-    counter = 0;
-    distance = iMax - iMin;
-    while (distance > 1)
-    {
-        // divide the distance by two
-        if (distance > 2)
-        {
-            distance = distance >> 1;
-        }
-        else
-        {
-            distance -= 1;
-        }
-        lastI0 = (long) (iMin + distance);
-        if (x > vec[lastI0])
-        {
-            iMin = lastI0;
-        }
-        else
-        {
-            iMax = lastI0;
-        }
-        distance = iMax - iMin;
-        counter++;
-    }
-    // std::cout << "Needed " << counter << " iterations " << std::endl;
-    result.first = (long) iMin;
-    result.second = (long) iMax;
-    return result;
+void EPDL97::writeBinary(BinaryWriter & writer) const
+{
+    writer.write((int) this->initialized);
+    writer.write(this->directoryName);
+    writer.write(this->bindingEnergiesFile);
+    writer.write(this->crossSectionsFile);
+    writer.write(this->bindingEnergy);
+    writer.write(this->muInputLabels);
+    writer.write(this->muLabelToIndex);
+    writer.write(this->muInputValues);
+    writer.write(this->muEnergy);
+}
+
+void EPDL97::readBinary(BinaryReader & reader)
+{
+    int flag;
+
+    reader.read(flag);
+    this->initialized = (flag != 0);
+    reader.read(this->directoryName);
+    reader.read(this->bindingEnergiesFile);
+    reader.read(this->crossSectionsFile);
+    reader.read(this->bindingEnergy);
+    reader.read(this->muInputLabels);
+    reader.read(this->muLabelToIndex);
+    reader.read(this->muInputValues);
+    reader.read(this->muEnergy);
 }
 
 } // namespace fisx
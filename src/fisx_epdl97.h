@@ -4,6 +4,8 @@
 #include <ctype.h>
 #include <vector>
 #include <map>
+#include "fisx_interpolationcursor.h"
+#include "fisx_binarystream.h"
 
 namespace fisx
 {
@@ -22,6 +24,9 @@ public:
 
     // the actual mass attenuation related functions
     std::map<std::string, double> getMassAttenuationCoefficients(const int & z, const double & energy) const;
+    // same as above reusing the search state of previous calls (see InterpolationCursor)
+    std::map<std::string, double> getMassAttenuationCoefficients(const int & z, const double & energy, \
+                                                                 InterpolationCursor & cursor) const;
     std::map<std::string, std::vector<double> > getMassAttenuationCoefficients(const int & z,\
                                                 const std::vector<double> & energy) const;
 
@@ -30,6 +35,9 @@ public:
     // the vacancy distribution related functions
     std::map<std::string, double> getPhotoelectricWeights(const int & z, \
                                                           const double & energy);
+    std::map<std::string, double> getPhotoelectricWeights(const int & z, \
+                                                          const double & energy, \
+                                                          InterpolationCursor & cursor);
 
     std::map<std::string, std::vector<double> > getPhotoelectricWeights(const int & z, \
                                                 const std::vector<double> & energy);
@@ -38,6 +46,12 @@ public:
     std::string toUpperCaseString(const std::string &) const;
     std::pair<long, long> getInterpolationIndices(const std::vector<double> &,  const double &) const;
 
+    /*!
+    Write or read the complete state of the instance (see Elements::getSnapshot).
+    */
+    void writeBinary(BinaryWriter & writer) const;
+    void readBinary(BinaryReader & reader);
+
 private:
     // internal function to load the data
     bool initialized;
@@ -0,0 +1,349 @@
+#include "fisx_influencecoefficients.h"
+#include <cmath>
+#include <stdexcept>
+#include <algorithm>
+
+namespace fisx
+{
+
+void InfluenceCoefficients::evaluateGrid(const CompositionEngine & engine, const int & nSteps, \
+                                         const int & ternary, std::vector<int> & analyte, \
+                                         std::vector<double> & compositions, \
+                                         std::vector<std::vector<double>::size_type> & offsets, \
+                                         std::vector<double> & rates)
+{
+    const std::vector<std::string> & elementList = engine.getElementList();
+    const std::vector<std::string> & familyList = engine.getElementFamilyList();
+    std::vector<double>::size_type nElements, nFamilies;
+    std::vector<double>::size_type iFamily, jElement, kElement, offset;
+    std::string elementName;
+    int iStep, jStep;
+    double ci;
+
+    if (nSteps < 2)
+    {
+        throw std::invalid_argument("InfluenceCoefficients. At least two steps needed");
+    }
+    nElements = elementList.size();
+    nFamilies = familyList.size();
+    analyte.clear();
+    for (iFamily = 0; iFamily < nFamilies; iFamily++)
+    {
+        elementName = familyList[iFamily].substr(0, familyList[iFamily].find(' '));
+        analyte.push_back((int) (std::find(elementList.begin(), elementList.end(), elementName) - \
+                                 elementList.begin()));
+    }
+
+    // for each analyte, the pure analyte followed by the binary and the ternary grids
+    compositions.clear();
+    offsets.clear();
+    offset = 0;
+    for (iFamily = 0; iFamily < nFamilies; iFamily++)
+    {
+        offsets.push_back(offset);
+        compositions.resize((offset + 1) * nElements, 0.0);
+        compositions[offset * nElements + analyte[iFamily]] = 1.0;
+        offset++;
+        for (jElement = 0; jElement < nElements; jElement++)
+        {
+            if ((int) jElement == analyte[iFamily])
+            {
+                continue;
+            }
+            for (iStep = 1; iStep < nSteps; iStep++)
+            {
+                ci = ((double) iStep) / nSteps;
+                compositions.resize((offset + 1) * nElements, 0.0);
+                compositions[offset * nElements + analyte[iFamily]] = ci;
+                compositions[offset * nElements + jElement] = 1.0 - ci;
+                offset++;
+            }
+        }
+        if (!ternary)
+        {
+            continue;
+        }
+        for (jElement = 0; jElement < nElements; jElement++)
+        {
+            if ((int) jElement == analyte[iFamily])
+            {
+                continue;
+            }
+            for (kElement = jElement + 1; kElement < nElements; kElement++)
+            {
+                if ((int) kElement == analyte[iFamily])
+                {
+                    continue;
+                }
+                for (iStep = 1; iStep < nSteps; iStep++)
+                {
+                    for (jStep = 1; (iStep + jStep) < nSteps; jStep++)
+                    {
+                        compositions.resize((offset + 1) * nElements, 0.0);
+                        compositions[offset * nElements + analyte[iFamily]] = ((double) iStep) / nSteps;
+                        compositions[offset * nElements + jElement] = ((double) jStep) / nSteps;
+                        compositions[offset * nElements + kElement] = \
+                                                        ((double) (nSteps - iStep - jStep)) / nSteps;
+                        offset++;
+                    }
+                }
+            }
+        }
+    }
+    offsets.push_back(offset);
+    rates.resize(offset * nFamilies);
+    engine.getRates(&compositions[0], (int) offset, &rates[0]);
+    for (iFamily = 0; iFamily < nFamilies; iFamily++)
+    {
+        if (rates[offsets[iFamily] * nFamilies + iFamily] <= 0.0)
+        {
+            throw std::runtime_error("InfluenceCoefficients. Family " + familyList[iFamily] + \
+                                     " not excited");
+        }
+    }
+}
+
+void InfluenceCoefficients::solveLeastSquares(const std::vector<double> & design, \
+                                              const std::vector<double> & values, \
+                                              std::vector<double> & parameters)
+{
+    std::vector<double> normal, rhs;
+    std::vector<double>::size_type n, nRows, i, j, k, pivot;
+    double factor;
+
+    // normal equations solved by Gaussian elimination with partial pivoting, the systems have
+    // as many unknowns as elements and their columns have similar scales
+    n = parameters.size();
+    nRows = values.size();
+    normal.resize(n * n, 0.0);
+    rhs.resize(n, 0.0);
+    for (k = 0; k < nRows; k++)
+    {
+        for (i = 0; i < n; i++)
+        {
+            rhs[i] += design[k * n + i] * values[k];
+            for (j = 0; j < n; j++)
+            {
+                normal[i * n + j] += design[k * n + i] * design[k * n + j];
+            }
+        }
+    }
+    for (i = 0; i < n; i++)
+    {
+        pivot = i;
+        for (k = i + 1; k < n; k++)
+        {
+            if (std::fabs(normal[k * n + i]) > std::fabs(normal[pivot * n + i]))
+            {
+                pivot = k;
+            }
+        }
+        if (!(std::fabs(normal[pivot * n + i]) > 0.0))
+        {
+            throw std::runtime_error("InfluenceCoefficients. Singular system");
+        }
+        if (pivot != i)
+        {
+            for (j = 0; j < n; j++)
+            {
+                std::swap(normal[i * n + j], normal[pivot * n + j]);
+            }
+            std::swap(rhs[i], rhs[pivot]);
+        }
+        for (k = i + 1; k < n; k++)
+        {
+            factor = normal[k * n + i] / normal[i * n + i];
+            for (j = i; j < n; j++)
+            {
+                normal[k * n + j] -= factor * normal[i * n + j];
+            }
+            rhs[k] -= factor * rhs[i];
+        }
+    }
+    for (i = n; i > 0; i--)
+    {
+        factor = rhs[i - 1];
+        for (j = i; j < n; j++)
+        {
+            factor -= normal[(i - 1) * n + j] * parameters[j];
+        }
+        parameters[i - 1] = factor / normal[(i - 1) * n + (i - 1)];
+    }
+}
+
+std::map<std::string, std::map<std::string, std::map<std::string, double> > > \
+        InfluenceCoefficients::getLachanceTraill(const CompositionEngine & engine, const int & nSteps, \
+                                                 const int & ternary)
+{
+    const std::vector<std::string> & elementList = engine.getElementList();
+    const std::vector<std::string> & familyList = engine.getElementFamilyList();
+    std::map<std::string, std::map<std::string, std::map<std::string, double> > > result;
+    std::vector<int> analyte;
+    std::vector<double> compositions, rates, design, values, alpha, predicted;
+    std::vector<std::vector<double>::size_type> offsets;
+    std::vector<double>::size_type nElements, nFamilies;
+    std::vector<double>::size_type iFamily, jElement, iPoint;
+    double relative, error, sumError, maximumError;
+    int nPoints;
+
+    evaluateGrid(engine, nSteps, ternary, analyte, compositions, offsets, rates);
+    nElements = elementList.size();
+    nFamilies = familyList.size();
+    for (iFamily = 0; iFamily < nFamilies; iFamily++)
+    {
+        // least squares fit through the origin of C_i / R_i - 1 = sum_{j != i} alpha_j * C_j, the
+        // pure analyte carries no information
+        design.clear();
+        values.clear();
+        for (iPoint = offsets[iFamily] + 1; iPoint < offsets[iFamily + 1]; iPoint++)
+        {
+            relative = rates[iPoint * nFamilies + iFamily] / rates[offsets[iFamily] * nFamilies + iFamily];
+            for (jElement = 0; jElement < nElements; jElement++)
+            {
+                if ((int) jElement != analyte[iFamily])
+                {
+                    design.push_back(compositions[iPoint * nElements + jElement]);
+                }
+            }
+            values.push_back(compositions[iPoint * nElements + analyte[iFamily]] / relative - 1.0);
+        }
+        alpha.resize(nElements - 1);
+        solveLeastSquares(design, values, alpha);
+        alpha.insert(alpha.begin() + analyte[iFamily], 0.0);
+
+        // concentration predicted at each grid point
+        predicted.clear();
+        for (iPoint = offsets[iFamily] + 1; iPoint < offsets[iFamily + 1]; iPoint++)
+        {
+            relative = rates[iPoint * nFamilies + iFamily] / rates[offsets[iFamily] * nFamilies + iFamily];
+            error = 1.0;
+            for (jElement = 0; jElement < nElements; jElement++)
+            {
+                error += alpha[jElement] * compositions[iPoint * nElements + jElement];
+            }
+            predicted.push_back(relative * error - compositions[iPoint * nElements + analyte[iFamily]]);
+        }
+        for (jElement = 0; jElement < nElements; jElement++)
+        {
+            if ((int) jElement == analyte[iFamily])
+            {
+                continue;
+            }
+            sumError = 0.0;
+            maximumError = 0.0;
+            nPoints = 0;
+            for (iPoint = offsets[iFamily] + 1; iPoint < offsets[iFamily + 1]; iPoint++)
+            {
+                if (compositions[iPoint * nElements + jElement] > 0.0)
+                {
+                    error = predicted[iPoint - offsets[iFamily] - 1];
+                    sumError += error * error;
+                    maximumError = std::max(maximumError, std::fabs(error));
+                    nPoints++;
+                }
+            }
+            result[familyList[iFamily]][elementList[jElement]]["alpha"] = alpha[jElement];
+            result[familyList[iFamily]][elementList[jElement]]["rms"] = std::sqrt(sumError / nPoints);
+            result[familyList[iFamily]][elementList[jElement]]["maximum"] = maximumError;
+            result[familyList[iFamily]][elementList[jElement]]["points"] = nPoints;
+        }
+    }
+    return result;
+}
+
+std::map<std::string, std::map<std::string, std::map<std::string, double> > > \
+        InfluenceCoefficients::getDeJongh(const CompositionEngine & engine, \
+                                          const std::string & eliminatedElement, \
+                                          const int & nSteps, const int & ternary)
+{
+    const std::vector<std::string> & elementList = engine.getElementList();
+    const std::vector<std::string> & familyList = engine.getElementFamilyList();
+    std::map<std::string, std::map<std::string, std::map<std::string, double> > > result;
+    std::vector<int> analyte;
+    std::vector<double> compositions, rates, design, values, parameters, predicted;
+    std::vector<std::vector<double>::size_type> offsets;
+    std::vector<double>::size_type nElements, nFamilies;
+    std::vector<double>::size_type iFamily, jElement, iPoint, eliminated, column;
+    double relative, error, sumError, maximumError;
+    int nPoints;
+
+    eliminated = std::find(elementList.begin(), elementList.end(), eliminatedElement) - \
+                 elementList.begin();
+    if (eliminated >= elementList.size())
+    {
+        throw std::invalid_argument("InfluenceCoefficients. Eliminated element " + eliminatedElement + \
+                                    " not in the element list");
+    }
+    evaluateGrid(engine, nSteps, ternary, analyte, compositions, offsets, rates);
+    nElements = elementList.size();
+    nFamilies = familyList.size();
+    for (iFamily = 0; iFamily < nFamilies; iFamily++)
+    {
+        // least squares fit of C_i / R_i = E + sum_{j != e} b_j * C_j, with d_j = b_j / E
+        design.clear();
+        values.clear();
+        for (iPoint = offsets[iFamily]; iPoint < offsets[iFamily + 1]; iPoint++)
+        {
+            relative = rates[iPoint * nFamilies + iFamily] / rates[offsets[iFamily] * nFamilies + iFamily];
+            design.push_back(1.0);
+            for (jElement = 0; jElement < nElements; jElement++)
+            {
+                if (jElement != eliminated)
+                {
+                    design.push_back(compositions[iPoint * nElements + jElement]);
+                }
+            }
+            values.push_back(compositions[iPoint * nElements + analyte[iFamily]] / relative);
+        }
+        parameters.resize(nElements);
+        solveLeastSquares(design, values, parameters);
+
+        // concentration predicted at each grid point
+        predicted.clear();
+        for (iPoint = offsets[iFamily]; iPoint < offsets[iFamily + 1]; iPoint++)
+        {
+            relative = rates[iPoint * nFamilies + iFamily] / rates[offsets[iFamily] * nFamilies + iFamily];
+            error = parameters[0];
+            column = 1;
+            for (jElement = 0; jElement < nElements; jElement++)
+            {
+                if (jElement != eliminated)
+                {
+                    error += parameters[column] * compositions[iPoint * nElements + jElement];
+                    column++;
+                }
+            }
+            predicted.push_back(relative * error - compositions[iPoint * nElements + analyte[iFamily]]);
+        }
+        column = 1;
+        for (jElement = 0; jElement < nElements; jElement++)
+        {
+            if (jElement == eliminated)
+            {
+                continue;
+            }
+            sumError = 0.0;
+            maximumError = 0.0;
+            nPoints = 0;
+            for (iPoint = offsets[iFamily]; iPoint < offsets[iFamily + 1]; iPoint++)
+            {
+                if (compositions[iPoint * nElements + jElement] > 0.0)
+                {
+                    error = predicted[iPoint - offsets[iFamily]];
+                    sumError += error * error;
+                    maximumError = std::max(maximumError, std::fabs(error));
+                    nPoints++;
+                }
+            }
+            result[familyList[iFamily]][elementList[jElement]]["d"] = parameters[column] / parameters[0];
+            result[familyList[iFamily]][elementList[jElement]]["E"] = parameters[0];
+            result[familyList[iFamily]][elementList[jElement]]["rms"] = std::sqrt(sumError / nPoints);
+            result[familyList[iFamily]][elementList[jElement]]["maximum"] = maximumError;
+            result[familyList[iFamily]][elementList[jElement]]["points"] = nPoints;
+            column++;
+        }
+    }
+    return result;
+}
+
+} // namespace fisx
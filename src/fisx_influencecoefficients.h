@@ -0,0 +1,91 @@
+#ifndef FISX_INFLUENCECOEFFICIENTS_H
+#define FISX_INFLUENCECOEFFICIENTS_H
+#include <string>
+#include <vector>
+#include <map>
+#include "fisx_compositionengine.h"
+
+namespace fisx
+{
+
+/*!
+  \class InfluenceCoefficients
+  \brief Empirical matrix correction coefficients derived from fundamental parameters
+
+   The Lachance-Traill model relates the concentration C_i of an analyte to its intensity relative
+   to the pure element R_i through the influence coefficients alpha_ij of the other elements:
+
+       C_i = R_i * (1 + sum_j alpha_ij * C_j)
+
+   The de Jongh model eliminates one element e, usually the base of the matrix, using that the
+   concentrations add up to one, and it keeps a coefficient for the analyte itself:
+
+       C_i = R_i * E_i * (1 + sum_{j != e} d_ij * C_j)
+
+   The coefficients of each analyte are obtained together by linear least squares over a grid of
+   compositions evaluated by a CompositionEngine. The grid contains the binary compositions of the
+   analyte with each of the other elements and, optionally, the ternary compositions of the analyte
+   with each pair of them. All the grid points are evaluated in a single batch, in parallel when
+   the library is compiled with OpenMP.
+ */
+class InfluenceCoefficients
+{
+public:
+    /*!
+    Calculate the Lachance-Traill coefficients of each analyte family of the engine with respect
+    to each of the other elements of the engine.
+
+    nSteps - Number of intervals of the composition grid. The concentrations of the grid points are
+             multiples of 1/nSteps.
+    ternary - If non zero, the ternary compositions of the analyte with each pair of the other
+              elements are added to the binary ones.
+
+    Return a map of the form [family][element][key] with the keys:
+    "alpha" - Influence coefficient
+    "rms" - Root mean square error of the concentration predicted by the model over the grid
+            points containing the element
+    "maximum" - Maximum absolute error of the concentration predicted by the model over the same
+                points
+    "points" - Number of grid points containing the element
+    */
+    static std::map<std::string, std::map<std::string, std::map<std::string, double> > > \
+                getLachanceTraill(const CompositionEngine & engine, const int & nSteps = 20, \
+                                  const int & ternary = 0);
+
+    /*!
+    Calculate the de Jongh coefficients of each analyte family of the engine with respect to each
+    element of the engine other than the eliminated one, the analyte included.
+
+    eliminatedElement - Element of the engine not appearing in the correction.
+    nSteps, ternary - As in getLachanceTraill. The pure analyte is also part of the grid.
+
+    Return a map of the form [family][element][key] with the keys:
+    "d" - Influence coefficient
+    "E" - Proportionality constant of the analyte, the same for all its entries
+    "rms", "maximum", "points" - As in getLachanceTraill
+    */
+    static std::map<std::string, std::map<std::string, std::map<std::string, double> > > \
+                getDeJongh(const CompositionEngine & engine, const std::string & eliminatedElement, \
+                           const int & nSteps = 20, const int & ternary = 0);
+
+private:
+    /*!
+    Evaluate the grid of each analyte family. On output, offsets[i] is the index of the first
+    composition of family i (its pure analyte) and offsets[i + 1] that of the next family.
+    */
+    static void evaluateGrid(const CompositionEngine & engine, const int & nSteps, const int & ternary, \
+                             std::vector<int> & analyte, std::vector<double> & compositions, \
+                             std::vector<std::vector<double>::size_type> & offsets, \
+                             std::vector<double> & rates);
+
+    /*!
+    Least squares solution of the overdetermined system design * parameters = values, the design
+    matrix being given in row-major order with parameters.size() columns.
+    */
+    static void solveLeastSquares(const std::vector<double> & design, const std::vector<double> & values, \
+                                  std::vector<double> & parameters);
+};
+
+} // namespace fisx
+
+#endif // FISX_INFLUENCECOEFFICIENTS_H
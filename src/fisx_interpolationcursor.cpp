@@ -0,0 +1,88 @@
+#include "fisx_interpolationcursor.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace fisx
+{
+
+InterpolationCursor::InterpolationCursor()
+{
+    this->lastIndex.clear();
+}
+
+void InterpolationCursor::reset()
+{
+    this->lastIndex.clear();
+}
+
+std::pair<long, long> InterpolationCursor::getIndices(const std::vector<double> & vec, const double & x, \
+                                                      const int & table)
+{
+    std::vector<double>::size_type length, hint, i;
+    std::vector<double>::const_iterator it;
+
+    length = vec.size();
+    if (length < 1)
+    {
+        throw std::invalid_argument("InterpolationCursor. Empty table");
+    }
+    if (table < 0)
+    {
+        throw std::invalid_argument("InterpolationCursor. Negative table index");
+    }
+    if (length == 1)
+    {
+        return std::pair<long, long>(0L, 0L);
+    }
+    if (x <= vec[0])
+    {
+        // below the table the first two points are used to extrapolate
+        return std::pair<long, long>(0L, 1L);
+    }
+    if (this->lastIndex.size() <= (std::vector<double>::size_type) table)
+    {
+        this->lastIndex.resize(table + 1, 0);
+    }
+    hint = this->lastIndex[table];
+    if (hint >= length)
+    {
+        hint = length - 1;
+    }
+
+    // i will be the first index with vec[i] >= x
+    if (vec[hint] < x)
+    {
+        // walk a few points forward before falling back to a binary search
+        i = hint + 1;
+        while ((i < length) && (i < (hint + 4)) && (vec[i] < x))
+        {
+            i++;
+        }
+        if ((i < length) && (vec[i] < x))
+        {
+            it = std::lower_bound(vec.begin() + i, vec.end(), x);
+            i = it - vec.begin();
+        }
+    }
+    else
+    {
+        if ((hint == 0) || (vec[hint - 1] < x))
+        {
+            i = hint;
+        }
+        else
+        {
+            it = std::lower_bound(vec.begin(), vec.begin() + hint, x);
+            i = it - vec.begin();
+        }
+    }
+
+    if (i == length)
+    {
+        i = length - 1;
+    }
+    this->lastIndex[table] = i - 1;
+    return std::pair<long, long>((long) (i - 1), (long) i);
+}
+
+} // namespace fisx
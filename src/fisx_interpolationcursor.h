@@ -0,0 +1,46 @@
+#ifndef FISX_INTERPOLATIONCURSOR_H
+#define FISX_INTERPOLATIONCURSOR_H
+#include <vector>
+#include <utility>
+
+namespace fisx
+{
+
+/*!
+  \class InterpolationCursor
+  \brief Search state for repeated interpolations in sorted tables
+
+   The cursor remembers, for each table it is used with, the position of the last lookup.
+   Lookups at increasing (or nearby) energies start from that position and cost amortised O(1)
+   instead of a full binary search. The result does not depend on the remembered position, it
+   only affects the speed.
+
+   A cursor is not shared. Hold one per element and per sweep (and therefore one per thread).
+   The table argument distinguishes the different tables of the same owner, for instance the
+   total and the partial photoelectric tables of an element.
+*/
+class InterpolationCursor
+{
+public:
+    InterpolationCursor();
+
+    /*!
+    Forget all the remembered positions.
+    */
+    void reset();
+
+    /*!
+    Indices (i1, i2) of the points of the sorted vector vec bracketing x:
+    vec[i1] < x <= vec[i2] with i2 = i1 + 1.
+    Outside the table the first or the last two indices are returned.
+    */
+    std::pair<long, long> getIndices(const std::vector<double> & vec, const double & x, \
+                                     const int & table = 0);
+
+private:
+    std::vector<std::vector<double>::size_type> lastIndex;
+};
+
+} // namespace fisx
+
+#endif // FISX_INTERPOLATIONCURSOR_H
@@ -152,12 +152,60 @@ double Layer::getTransmission(const double & energy, const Elements & elements,
     return (1.0 - this->funnyFactor) + (this->funnyFactor * std::exp(-(tmpDouble * muTotal)));
 }
 
+void Layer::getMassAttenuationCoefficients(const std::vector<double> & energy, \
+                                           const Elements & elements, \
+                                           std::map<std::string, std::vector<double> > & result) const
+{
+    if (this->hasMaterial)
+    {
+        elements.getMassAttenuationCoefficients(this->material.getComposition(), energy, result);
+    }
+    else
+    {
+        elements.getMassAttenuationCoefficients(this->materialName, energy, result);
+    }
+}
+
+void Layer::getMassAttenuationCoefficients(const double * energy, const int & nEnergies, \
+                                           const Elements & elements, \
+                                           double * total, double * photoelectric, double * coherent, \
+                                           double * compton, double * pair) const
+{
+    if (this->hasMaterial)
+    {
+        elements.getMassAttenuationCoefficients(this->material.getComposition(), energy, nEnergies, \
+                                                total, photoelectric, coherent, compton, pair);
+    }
+    else
+    {
+        elements.getMassAttenuationCoefficients(this->materialName, energy, nEnergies, \
+                                                total, photoelectric, coherent, compton, pair);
+    }
+}
+
 std::vector<double> Layer::getTransmission(const std::vector<double> & energy, const Elements & elements, \
                                            const double & angle) const
 {
-    const double PI = std::acos(-1.0);
-    std::vector<double>::size_type i;
     std::vector<double> tmpDoubleVector;
+
+    this->getTransmission(energy, elements, angle, tmpDoubleVector);
+    return tmpDoubleVector;
+}
+
+void Layer::getTransmission(const std::vector<double> & energy, const Elements & elements, \
+                            const double & angle, std::vector<double> & result) const
+{
+    result.resize(energy.size());
+    this->getTransmission(energy.size() ? &energy[0] : NULL, (int) energy.size(), elements, angle, \
+                          energy.size() ? &result[0] : NULL);
+}
+
+void Layer::getTransmission(const double * energy, const int & nEnergies, const Elements & elements, \
+                            const double & angle, double * result) const
+{
+    const double PI = std::acos(-1.0);
+    int i, n;
+    std::vector<double> buffer;
     double tmpDouble;
 
     if (angle == 90.0)
@@ -180,20 +228,16 @@ std::vector<double> Layer::getTransmission(const std::vector<double> & energy, c
         throw std::runtime_error( msg );
     }
 
-    if (this->hasMaterial)
-    {
-        tmpDoubleVector = elements.getMassAttenuationCoefficients(this->material.getComposition(), energy)["total"];
-    }
-    else
+    // the total goes directly into the result, the individual processes are not needed
+    n = (nEnergies > 0) ? nEnergies : 0;
+    buffer.resize(4 * n + 1);
+    this->getMassAttenuationCoefficients(energy, nEnergies, elements, result, \
+                                         &buffer[0], &buffer[n], &buffer[2 * n], &buffer[3 * n]);
+    for (i = 0; i < nEnergies; i++)
     {
-        tmpDoubleVector = elements.getMassAttenuationCoefficients(this->materialName, energy)["total"];
+        result[i] = (1.0 - this->funnyFactor) + \
+                    (this->funnyFactor * exp(-(tmpDouble * result[i])));
     }
-    for (i = 0; i < tmpDoubleVector.size(); i++)
-    {
-        tmpDoubleVector[i] = (1.0 - this->funnyFactor) + \
-                              (this->funnyFactor * exp(-(tmpDouble * tmpDoubleVector[i])));
-    }
-    return tmpDoubleVector;
 }
 
 std::vector<std::pair<std::string, double> > Layer::getPeakFamilies(const double & energy, \
@@ -226,6 +270,31 @@ std::vector<std::pair<std::string, double> > Layer::getPeakFamilies(const double
     }
 }
 
+void Layer::writeBinary(BinaryWriter & writer) const
+{
+    writer.write(this->name);
+    writer.write(this->materialName);
+    writer.write((int) this->hasMaterial);
+    this->material.writeBinary(writer);
+    writer.write(this->funnyFactor);
+    writer.write(this->density);
+    writer.write(this->thickness);
+}
+
+void Layer::readBinary(BinaryReader & reader)
+{
+    int flag;
+
+    reader.read(this->name);
+    reader.read(this->materialName);
+    reader.read(flag);
+    this->hasMaterial = (flag != 0);
+    this->material.readBinary(reader);
+    reader.read(this->funnyFactor);
+    reader.read(this->density);
+    reader.read(this->thickness);
+}
+
 std::ostream& operator<< (std::ostream& o, Layer const & layer)
 {
     o << "Layer: " << layer.getMaterialName();
@@ -67,6 +67,23 @@ public:
                                                                 const std::vector<double> & energies,
                                                                 const Elements & elements) const;
 
+    /*!
+    Same as above writing into the supplied map. Its vectors are resized in place and therefore
+    do not allocate memory when the map is reused with the same number of energies.
+    */
+    void getMassAttenuationCoefficients(const std::vector<double> & energies, \
+                                        const Elements & elements, \
+                                        std::map<std::string, std::vector<double> > & result) const;
+
+    /*!
+    Same as above for nEnergies contiguous energies, writing each coefficient into the supplied
+    arrays (see Elements::getMassAttenuationCoefficients).
+    */
+    void getMassAttenuationCoefficients(const double * energies, const int & nEnergies, \
+                                        const Elements & elements, \
+                                        double * total, double * photoelectric, double * coherent, \
+                                        double * compton, double * pair) const;
+
 
     /*!
     Get the layer transmissions at the given energies using the elements library
@@ -77,6 +94,20 @@ public:
     std::vector<double> getTransmission(const std::vector<double> & energy,
                                 const Elements & elements, const double & angle = 90.0) const;
 
+    /*!
+    Same as above writing the transmissions into the supplied vector. It is resized in place and
+    therefore does not allocate memory when reused with the same number of energies.
+    */
+    void getTransmission(const std::vector<double> & energy, const Elements & elements, \
+                         const double & angle, std::vector<double> & result) const;
+
+    /*!
+    Same as above for nEnergies contiguous energies. The transmissions are written into the supplied
+    array, with room for nEnergies values.
+    */
+    void getTransmission(const double * energy, const int & nEnergies, const Elements & elements, \
+                         const double & angle, double * result) const;
+
     /*!
     Return true if material composition was specified.
     Returns false if only the name or formula of the material was given.
@@ -101,6 +132,12 @@ public:
 
     std::map<std::string, double> getComposition(const Elements & elements);
 
+    /*!
+    Write or read the complete state of the instance (see XRFConfig::getSnapshot).
+    */
+    void writeBinary(BinaryWriter & writer) const;
+    void readBinary(BinaryReader & reader);
+
 private:
     std::string materialName;
     bool hasMaterial;
@@ -0,0 +1,172 @@
+#include "fisx_logger.h"
+#include "fisx_profile.h"
+#include <iostream>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+namespace fisx
+{
+
+namespace
+{
+
+// The logger state is shared by all the threads, OpenMP or not (the Python wrappers release the GIL)
+#ifdef _WIN32
+SRWLOCK loggerMutex = SRWLOCK_INIT;
+#else
+pthread_mutex_t loggerMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+class LoggerLock
+{
+public:
+    LoggerLock()
+    {
+#ifdef _WIN32
+        AcquireSRWLockExclusive(&loggerMutex);
+#else
+        pthread_mutex_lock(&loggerMutex);
+#endif
+    }
+
+    ~LoggerLock()
+    {
+#ifdef _WIN32
+        ReleaseSRWLockExclusive(&loggerMutex);
+#else
+        pthread_mutex_unlock(&loggerMutex);
+#endif
+    }
+};
+
+} // namespace
+
+int Logger::level = Logger::LEVEL_WARNING;
+Logger::Sink Logger::sink = NULL;
+void * Logger::userData = NULL;
+int Logger::maximumMessages = 10;
+double Logger::interval = 1.0;
+std::map<std::string, Logger::SourceHistory> Logger::history;
+
+void Logger::setSink(Sink sink, void * userData)
+{
+    LoggerLock lock;
+    Logger::sink = sink;
+    Logger::userData = userData;
+}
+
+void Logger::setLevel(const int & level)
+{
+    if (level < LEVEL_DEBUG)
+    {
+        Logger::level = LEVEL_DEBUG;
+    }
+    else if (level > LEVEL_NONE)
+    {
+        Logger::level = LEVEL_NONE;
+    }
+    else
+    {
+        Logger::level = level;
+    }
+}
+
+int Logger::getLevel()
+{
+    return Logger::level;
+}
+
+int Logger::getCompiledLevel()
+{
+    return FISX_LOG_LEVEL;
+}
+
+void Logger::setRateLimit(const int & maximumMessages, const double & interval)
+{
+    LoggerLock lock;
+    Logger::maximumMessages = maximumMessages;
+    Logger::interval = interval;
+    Logger::history.clear();
+}
+
+void Logger::reset()
+{
+    LoggerLock lock;
+    Logger::history.clear();
+}
+
+std::string Logger::getLevelName(const int & level)
+{
+    switch (level)
+    {
+    case LEVEL_DEBUG:
+        return "DEBUG";
+    case LEVEL_INFO:
+        return "INFO";
+    case LEVEL_WARNING:
+        return "WARNING";
+    case LEVEL_ERROR:
+        return "ERROR";
+    default:
+        return "NONE";
+    }
+}
+
+void Logger::log(const int & level, const std::string & source, const std::string & message)
+{
+    if (!Logger::isEnabled(level))
+    {
+        return;
+    }
+    {
+        LoggerLock lock;
+        Sink target;
+        bool accepted;
+        double now;
+        std::ostringstream suppressedMessage;
+
+        target = (Logger::sink == NULL) ? Logger::defaultSink : Logger::sink;
+        accepted = true;
+        if (Logger::maximumMessages > 0)
+        {
+            SourceHistory & sourceHistory = Logger::history[source];
+            now = Profile::getWallTime();
+            if ((sourceHistory.accepted == 0) || ((now - sourceHistory.start) > Logger::interval))
+            {
+                if (sourceHistory.suppressed > 0)
+                {
+                    suppressedMessage << sourceHistory.suppressed << " similar messages suppressed";
+                    target(level, source, suppressedMessage.str(), Logger::userData);
+                }
+                sourceHistory.start = now;
+                sourceHistory.accepted = 0;
+                sourceHistory.suppressed = 0;
+            }
+            if (sourceHistory.accepted < Logger::maximumMessages)
+            {
+                sourceHistory.accepted++;
+            }
+            else
+            {
+                sourceHistory.suppressed++;
+                accepted = false;
+            }
+        }
+        if (accepted)
+        {
+            target(level, source, message, Logger::userData);
+        }
+    }
+}
+
+void Logger::defaultSink(const int & level, const std::string & source, \
+                         const std::string & message, void * userData)
+{
+    (void) userData;
+    std::cerr << "fisx " << Logger::getLevelName(level) << " " << source << ": " << message << std::endl;
+}
+
+} // namespace fisx
@@ -0,0 +1,159 @@
+#ifndef FISX_LOGGER_H
+#define FISX_LOGGER_H
+#include <string>
+#include <map>
+#include <sstream>
+
+/*
+ Message levels. They are plain preprocessor constants in order to be usable in #if directives.
+*/
+#define FISX_LOG_LEVEL_DEBUG 0
+#define FISX_LOG_LEVEL_INFO 1
+#define FISX_LOG_LEVEL_WARNING 2
+#define FISX_LOG_LEVEL_ERROR 3
+#define FISX_LOG_LEVEL_NONE 4
+
+/*
+ Messages below this level are not compiled (python setup.py build --log-level=N).
+*/
+#ifndef FISX_LOG_LEVEL
+#define FISX_LOG_LEVEL FISX_LOG_LEVEL_INFO
+#endif
+
+namespace fisx
+{
+
+/*!
+  \class Logger
+  \brief Level controlled and rate limited diagnostic messages
+
+   The library does not write to the standard streams directly. Diagnostics go through the
+   FISX_LOG_* macros, which are compiled out when below FISX_LOG_LEVEL and otherwise check the
+   run time level before formatting the message.
+
+   Accepted messages are passed to a sink. The default sink writes them to std::cerr. Messages
+   coming from the same source are rate limited: at most a given number of them are accepted per
+   time interval and the number of suppressed ones is reported when the interval expires.
+*/
+class Logger
+{
+public:
+    enum Level
+    {
+        LEVEL_DEBUG = FISX_LOG_LEVEL_DEBUG,
+        LEVEL_INFO = FISX_LOG_LEVEL_INFO,
+        LEVEL_WARNING = FISX_LOG_LEVEL_WARNING,
+        LEVEL_ERROR = FISX_LOG_LEVEL_ERROR,
+        LEVEL_NONE = FISX_LOG_LEVEL_NONE
+    };
+
+    /*!
+    Signature of a message sink. It is called with the level, the source (usually the calling
+    method) and the message. It may be called from several threads, but never concurrently.
+    The sink must not log messages itself.
+    */
+    typedef void (*Sink)(const int & level, const std::string & source, \
+                         const std::string & message, void * userData);
+
+    /*!
+    Set the function receiving the accepted messages. A NULL sink restores the default one.
+    The user data pointer is passed unchanged to the sink.
+    */
+    static void setSink(Sink sink, void * userData = NULL);
+
+    /*!
+    Set the minimum level of the messages to be passed to the sink. Default is LEVEL_WARNING.
+    Messages below the compiled level (see getCompiledLevel) are never emitted.
+    */
+    static void setLevel(const int & level);
+    static int getLevel();
+
+    /*!
+    Minimum level compiled into the library (FISX_LOG_LEVEL).
+    */
+    static int getCompiledLevel();
+
+    /*!
+    Accept at most maximumMessages messages per source during each interval (in seconds).
+    A non positive maximumMessages disables the rate limiting. Default is 10 messages per second.
+    */
+    static void setRateLimit(const int & maximumMessages, const double & interval = 1.0);
+
+    /*!
+    Return true if a message of the given level would be passed to the sink.
+    */
+    static bool isEnabled(const int & level) {return (level >= Logger::level) && (level < LEVEL_NONE);};
+
+    /*!
+    Pass the message to the sink if its level is enabled and the rate limit of the source
+    is not exceeded.
+    */
+    static void log(const int & level, const std::string & source, const std::string & message);
+
+    /*!
+    Name of the level ("DEBUG", "INFO", "WARNING", "ERROR").
+    */
+    static std::string getLevelName(const int & level);
+
+    /*!
+    Forget the rate limiting history.
+    */
+    static void reset();
+
+private:
+    struct SourceHistory
+    {
+        double start;
+        int accepted;
+        int suppressed;
+    };
+
+    static void defaultSink(const int & level, const std::string & source, \
+                            const std::string & message, void * userData);
+
+    static int level;
+    static Sink sink;
+    static void * userData;
+    static int maximumMessages;
+    static double interval;
+    static std::map<std::string, SourceHistory> history;
+};
+
+} // namespace fisx
+
+#define FISX_LOG_MESSAGE(level, source, message) \
+    do \
+    { \
+        if (fisx::Logger::isEnabled(level)) \
+        { \
+            std::ostringstream fisxLogStream; \
+            fisxLogStream << message; \
+            fisx::Logger::log((level), (source), fisxLogStream.str()); \
+        } \
+    } while (0)
+
+#if FISX_LOG_LEVEL <= FISX_LOG_LEVEL_DEBUG
+#define FISX_LOG_DEBUG(source, message) FISX_LOG_MESSAGE(FISX_LOG_LEVEL_DEBUG, source, message)
+#else
+#define FISX_LOG_DEBUG(source, message) do {} while (0)
+#endif
+
+#if FISX_LOG_LEVEL <= FISX_LOG_LEVEL_INFO
+#define FISX_LOG_INFO(source, message) FISX_LOG_MESSAGE(FISX_LOG_LEVEL_INFO, source, message)
+#else
+#define FISX_LOG_INFO(source, message) do {} while (0)
+#endif
+
+#if FISX_LOG_LEVEL <= FISX_LOG_LEVEL_WARNING
+#define FISX_LOG_WARNING(source, message) FISX_LOG_MESSAGE(FISX_LOG_LEVEL_WARNING, source, message)
+#else
+#define FISX_LOG_WARNING(source, message) do {} while (0)
+#endif
+
+#if FISX_LOG_LEVEL <= FISX_LOG_LEVEL_ERROR
+#define FISX_LOG_ERROR(source, message) FISX_LOG_MESSAGE(FISX_LOG_LEVEL_ERROR, source, message)
+#else
+#define FISX_LOG_ERROR(source, message) do {} while (0)
+#endif
+
+#endif // FISX_LOGGER_H
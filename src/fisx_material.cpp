@@ -1,6 +1,6 @@
 #include <stdexcept>
 #include "fisx_material.h"
-#include <iostream>
+#include "fisx_logger.h"
 
 namespace fisx
 {
@@ -89,11 +89,11 @@ void Material::setComposition(const std::vector<std::string> & names, const std:
     {
         for(i = 0; i < names.size(); i++)
         {
-            std::cout << i << " name " << names[i] << std::endl;
+            FISX_LOG_DEBUG("Material::setComposition", i << " name " << names[i]);
         }
         for(i = 0; i < amounts.size(); i++)
         {
-            std::cout << i << " amount " << amounts[i] << std::endl;
+            FISX_LOG_DEBUG("Material::setComposition", i << " amount " << amounts[i]);
         }
         throw std::invalid_argument("Number of substances does not match number of amounts");
     }
@@ -133,4 +133,27 @@ std::string Material::getComment() const
     return this->comment;
 }
 
+void Material::writeBinary(BinaryWriter & writer) const
+{
+    writer.write(this->name);
+    writer.write((int) this->initialized);
+    writer.write(this->composition);
+    writer.write(this->defaultDensity);
+    writer.write(this->defaultThickness);
+    writer.write(this->comment);
+}
+
+void Material::readBinary(BinaryReader & reader)
+{
+    int flag;
+
+    reader.read(this->name);
+    reader.read(flag);
+    this->initialized = (flag != 0);
+    reader.read(this->composition);
+    reader.read(this->defaultDensity);
+    reader.read(this->defaultThickness);
+    reader.read(this->comment);
+}
+
 } // namespace fisx
@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include "fisx_binarystream.h"
 
 namespace fisx
 {
@@ -54,6 +55,12 @@ public:
     double getDefaultDensity(){return this->defaultDensity;};
     double getDefaultThickness(){return this->defaultThickness;};
 
+    /*!
+    Write or read the complete state of the instance (see XRFConfig::getSnapshot).
+    */
+    void writeBinary(BinaryWriter & writer) const;
+    void readBinary(BinaryReader & reader);
+
 private:
     std::string name;
     bool initialized;
@@ -2,7 +2,9 @@
 #include <cmath>
 #include <cfloat>
 #include <stdexcept>
-#include <iostream>
+#include <vector>
+#include <algorithm>
+#include "fisx_logger.h"
 
 namespace fisx
 {
@@ -130,7 +132,7 @@ double Math::AS_5_1_56(const double & x)
 }
 
 double Math::deBoerD(const double & x)
-{
+{
 
 #ifndef NDEBUG
     // AS 5.1.19
@@ -154,11 +156,10 @@ double Math::deBoerD(const double & x)
     limit1 = std::log(1 + 1.0 /x);
     if ((tmpResult < limit0) || (tmpResult > limit1))
     {
-        std::cout << "deBoerD error with x = " << x << std::endl;
-        std::cout << "old result = " << Math::AS_5_1_56(x) / x << std::endl;
-        std::cout << "new result = " << Math::_deBoerD(x, 1.0e-5) << std::endl;
-        std::cout << "limit0 = " << limit0 << std::endl;
-        std::cout << "limit1 = " << limit1 << std::endl;
+        FISX_LOG_DEBUG("Math::deBoerD", "Result out of limits with x = " << x << \
+                       " old result = " << Math::AS_5_1_56(x) / x << \
+                       " new result = " << Math::_deBoerD(x, 1.0e-5) << \
+                       " limit0 = " << limit0 << " limit1 = " << limit1);
         return Math::_deBoerD(x, 1.0e-5);
     }
     return tmpResult;
@@ -183,26 +184,26 @@ double Math::deBoerL0(const double & mu1, const double & mu2, const double & muj
     double d;
     double tmpDouble;
 
+#ifndef FISX_UNCHECKED
     if (!Math::isFiniteNumber(mu1))
     {
-        std::cout << "mu1 = " << mu1 << std::endl;
+        FISX_LOG_DEBUG("Math::deBoerL0", "mu1 = " << mu1);
         throw std::runtime_error("Math::deBoerL0. Received not finite mu1 < 0");
     }
     if (!Math::isFiniteNumber(mu2))
     {
-        std::cout << "mu2 = " << mu2 << std::endl;
+        FISX_LOG_DEBUG("Math::deBoerL0", "mu2 = " << mu2);
         throw std::runtime_error("Math::deBoerL0. Received not finite mu2 < 0");
     }
     if (!Math::isFiniteNumber(muj))
     {
-        std::cout << "muj = " << muj << std::endl;
+        FISX_LOG_DEBUG("Math::deBoerL0", "muj = " << muj);
         throw std::runtime_error("Math::deBoerL0. Received non finite muj < 0");
     }
+#endif
     if ((mu1 <= 0.0) || (mu2 <= 0.0) || (muj <= 0.0))
     {
-        std::cout << "mu1 = " << mu1 << std::endl;
-        std::cout << "mu2 = " << mu2 << std::endl;
-        std::cout << "muj = " << muj << std::endl;
+        FISX_LOG_DEBUG("Math::deBoerL0", "mu1 = " << mu1 << " mu2 = " << mu2 << " muj = " << muj);
         throw std::runtime_error("Math::deBoerL0 received negative input");
     }
 
@@ -215,13 +216,9 @@ double Math::deBoerL0(const double & mu1, const double & mu2, const double & muj
         //std::cout << "THICK TARGET = " << tmpDouble << std::endl;
         if (!Math::isFiniteNumber(tmpDouble))
         {
-            std::cout << "Math::deBoerL0. Thick target. Not a finite result" << std::endl;
-            std::cout << "Received parameters " << std::endl;
-            std::cout << "mu1 = " << mu1 << std::endl;
-            std::cout << "mu2 = " << mu2 << std::endl;
-            std::cout << "muj = " << muj << std::endl;
-            std::cout << "thickness = " << thickness << std::endl;
-            std::cout << "density = " << density << std::endl;
+            FISX_LOG_DEBUG("Math::deBoerL0", "Thick target. Not a finite result with mu1 = " << mu1 << \
+                           " mu2 = " << mu2 << " muj = " << muj << \
+                           " thickness = " << thickness << " density = " << density);
             throw std::runtime_error("Math::deBoerL0. Thick target. Non-finite result");
         }
         return tmpDouble;
@@ -266,20 +263,14 @@ double Math::deBoerL0(const double & mu1, const double & mu2, const double & muj
     }
     if (tmpDouble < 0)
     {
-        std::cout << " Math::deBoerL0 CALCULATED = " << tmpDouble << std::endl;
-        std::cout << " mu1 = " << mu1 << std::endl;
-        std::cout << " mu2 = " << mu2 << std::endl;
-        std::cout << " muj = " << muj << std::endl;
-        std::cout << " d = " << d << std::endl;
+        FISX_LOG_DEBUG("Math::deBoerL0", "Calculated " << tmpDouble << " with mu1 = " << mu1 << \
+                       " mu2 = " << mu2 << " muj = " << muj << " d = " << d);
         throw std::runtime_error("Math::deBoerL0. Negative result");
     }
     if (!Math::isFiniteNumber(tmpDouble))
     {
-        std::cout << " Math::deBoerL0 CALCULATED = " << tmpDouble << std::endl;
-        std::cout << " mu1 = " << mu1 << std::endl;
-        std::cout << " mu2 = " << mu2 << std::endl;
-        std::cout << " muj = " << muj << std::endl;
-        std::cout << " d = " << d << std::endl;
+        FISX_LOG_DEBUG("Math::deBoerL0", "Calculated " << tmpDouble << " with mu1 = " << mu1 << \
+                       " mu2 = " << mu2 << " muj = " << muj << " d = " << d);
         throw std::runtime_error("Math::deBoerL0. Non-finite result");
     }
     return tmpDouble;
@@ -298,48 +289,23 @@ double Math::deBoerX(const double & p, const double & q, const double & d1, cons
         if (d1 < 0.01)
         {
             // VERY THIN CASE:
-            std::cout << " THIN CASE " << std::endl;
-            std::cout << " EXPECTED = " << (d1 / p) * std::log(1 + p / mu2j) << std::endl;
-            std::cout << " MEASURED = " << result << std::endl;
-            std::cout << " V(d1,inf) = " << Math::deBoerV(p, q, d1, d2, mu1j, mu2j, mubj_dt) << std::endl;
-            std::cout << " V(d1, 0) = " << Math::deBoerV(p, q, d1, 0.0, mu1j, mu2j, mubj_dt) << std::endl;
-            std::cout << " V(0, d2) = " << Math::deBoerV(p, q, 0.0, d2, mu1j, mu2j, mubj_dt) << std::endl;
-            std::cout << " V(0.0, 0) = " << Math::deBoerV(p, q, 0.0, 0.0, mu1j, mu2j, mubj_dt) << std::endl;
-        }
-        else
-        {
-            std::cout << "NOT THIN CASE " << std::endl;
+            FISX_LOG_DEBUG("Math::deBoerX", "Thin case. Expected = " << (d1 / p) * std::log(1 + p / mu2j) << \
+                " measured = " << result << \
+                " V(d1,inf) = " << Math::deBoerV(p, q, d1, d2, mu1j, mu2j, mubj_dt) << \
+                " V(d1, 0) = " << Math::deBoerV(p, q, d1, 0.0, mu1j, mu2j, mubj_dt) << \
+                " V(0, d2) = " << Math::deBoerV(p, q, 0.0, d2, mu1j, mu2j, mubj_dt) << \
+                " V(0.0, 0) = " << Math::deBoerV(p, q, 0.0, 0.0, mu1j, mu2j, mubj_dt));
         }
         if (result < 0)
         {
-            std::cout << "p    " << p << std::endl;
-            std::cout << "q    " << q << std::endl;
-            std::cout << "d1   " << d1 << std::endl;
-            std::cout << "d2   " << d2 << std::endl;
-            std::cout << "mu1j " << mu1j << std::endl;
-            std::cout << "mu2j " << mu2j << std::endl;
-            std::cout << "mubjdt " << mubj_dt << std::endl;
-            std::cout << " error  " << std::endl;
+            FISX_LOG_DEBUG("Math::deBoerX", "p = " << p << " q = " << q << " d1 = " << d1 << \
+                " d2 = " << d2 << " mu1j = " << mu1j << " mu2j = " << mu2j << " mubjdt = " << mubj_dt);
             throw std::runtime_error("negative contribution");
         }
         if (!Math::isFiniteNumber(result))
         {
-            std::cout << "p    " << p << std::endl;
-            std::cout << "q    " << q << std::endl;
-            std::cout << "d1   " << d1 << std::endl;
-            std::cout << "d2   " << d2 << std::endl;
-            std::cout << "mu1j " << mu1j << std::endl;
-            std::cout << "mu2j " << mu2j << std::endl;
-            std::cout << "mubjdt " << mubj_dt << std::endl;
-            std::cout << " error  " << std::endl;
-            std::cout << "Math::deBoerV(p, q, d1, d2, mu1j, mu2j, mubj_dt) = ";
-            std::cout << Math::deBoerV(p, q, d1, d2, mu1j, mu2j, mubj_dt) << std::endl;
-            std::cout << "Math::deBoerV(p, q, d1, 0.0, mu1j, mu2j, mubj_dt) = ";
-            std::cout << Math::deBoerV(p, q, d1, 0.0, mu1j, mu2j, mubj_dt) << std::endl;
-            std::cout << "Math::deBoerV(p, q, 0.0, d2, mu1j, mu2j, mubj_dt) = ";
-            std::cout << Math::deBoerV(p, q, 0.0, d2, mu1j, mu2j, mubj_dt) << std::endl;
-            std::cout << "Math::deBoerV(p, q, 0.0, 0.0, mu1j, mu2j, mubj_dt) = ";
-            std::cout << Math::deBoerV(p, q, 0.0, 0.0, mu1j, mu2j, mubj_dt)<< std::endl;
+            FISX_LOG_DEBUG("Math::deBoerX", "p = " << p << " q = " << q << " d1 = " << d1 << \
+                " d2 = " << d2 << " mu1j = " << mu1j << " mu2j = " << mu2j << " mubjdt = " << mubj_dt);
             throw std::runtime_error("Not finite contribution");
         }
         return result;
@@ -376,18 +342,10 @@ double Math::deBoerV(const double & p, const double & q, const double & d1, cons
         tmpHelp = -tmpHelp / (p * mu1j + q * mu2j);
         if (!Math::isFiniteNumber(tmpHelp))
         {
-            std::cout << "p    " << p << std::endl;
-            std::cout << "q    " << q << std::endl;
-            std::cout << "d1   " << d1 << std::endl;
-            std::cout << "d2   " << d2 << std::endl;
-            std::cout << "mu1j " << mu1j << std::endl;
-            std::cout << "mu2j " << mu2j << std::endl;
-            std::cout << "mubjdt " << mubjdt << std::endl;
-            std::cout << "1.0 + (p / mu2j) = " << 1.0 + (p / mu2j) << std::endl;
-            std::cout << "tmpDouble1 = " << tmpDouble1 << std::endl;
-            std::cout << "tmpDouble2 = " << tmpDouble2 << std::endl;
-            std::cout << "p * mu1j + q * mu2j = " << p * mu1j + q * mu2j << std::endl;
-            std::cout << "Error 0" << std::endl;
+            FISX_LOG_DEBUG("Math::deBoerV", "p = " << p << " q = " << q << \
+                " mu1j = " << mu1j << " mu2j = " << mu2j << \
+                " tmpDouble1 = " << tmpDouble1 << " tmpDouble2 = " << tmpDouble2 << \
+                " p * mu1j + q * mu2j = " << p * mu1j + q * mu2j);
             throw std::runtime_error("Error 0: Error on V(0,0) with no intermediate layer");
         }
         return tmpHelp;
@@ -404,14 +362,8 @@ double Math::deBoerV(const double & p, const double & q, const double & d1, cons
                  Math::deBoerD((1.0 + (p / mu2j)) * (mu1j*d1 + mubjdt + mu2j*d2));
     if (!Math::isFiniteNumber(tmpDouble1))
     {
-        std::cout << "p    " << p << std::endl;
-        std::cout << "q    " << q << std::endl;
-        std::cout << "d1   " << d1 << std::endl;
-        std::cout << "d2   " << d2 << std::endl;
-        std::cout << "mu1j " << mu1j << std::endl;
-        std::cout << "mu2j " << mu2j << std::endl;
-        std::cout << "mubjdt " << mubjdt << std::endl;
-        std::cout << " error 1 " << std::endl;
+        FISX_LOG_DEBUG("Math::deBoerV", "p = " << p << " q = " << q << " d1 = " << d1 << \
+                       " d2 = " << d2 << " mu1j = " << mu1j << " mu2j = " << mu2j << " mubjdt = " << mubjdt);
         throw std::runtime_error("error1");
     }
 
@@ -420,45 +372,23 @@ double Math::deBoerV(const double & p, const double & q, const double & d1, cons
                   Math::deBoerD(( 1.0 - (q / mu1j)) * tmpHelp);
     if (!Math::isFiniteNumber(tmpDouble2))
     {
-        std::cout << "p    " << p << std::endl;
-        std::cout << "q    " << q << std::endl;
-        std::cout << "d1   " << d1 << std::endl;
-        std::cout << "d2   " << d2 << std::endl;
-        std::cout << "mu1j " << mu1j << std::endl;
-        std::cout << "mu2j " << mu2j << std::endl;
-        std::cout << "mubjdt " << mubjdt << std::endl;
-        std::cout << " error 3 " << std::endl;
+        FISX_LOG_DEBUG("Math::deBoerV", "p = " << p << " q = " << q << " d1 = " << d1 << \
+                       " d2 = " << d2 << " mu1j = " << mu1j << " mu2j = " << mu2j << " mubjdt = " << mubjdt);
         throw std::runtime_error("error3");
     }
 
     tmpDouble2 -= Math::deBoerD(tmpHelp)/(p * q);
     if (!Math::isFiniteNumber(tmpDouble2))
     {
-        std::cout << "p    " << p << std::endl;
-        std::cout << "q    " << q << std::endl;
-        std::cout << "d1   " << d1 << std::endl;
-        std::cout << "d2   " << d2 << std::endl;
-        std::cout << "mu1j " << mu1j << std::endl;
-        std::cout << "mu2j " << mu2j << std::endl;
-        std::cout << "mubjdt " << mubjdt << std::endl;
-        std::cout << " error 4 " << std::endl;
+        FISX_LOG_DEBUG("Math::deBoerV", "p = " << p << " q = " << q << " d1 = " << d1 << \
+                       " d2 = " << d2 << " mu1j = " << mu1j << " mu2j = " << mu2j << " mubjdt = " << mubjdt);
         throw std::runtime_error("error4");
     }
     tmpHelp = std::exp((q - mu1j) * d1 - (p + mu2j) * d2 - mubjdt) * (tmpDouble1 + tmpDouble2);
     if (!Math::isFiniteNumber(tmpHelp))
     {
-        std::cout << "p    " << p << std::endl;
-        std::cout << "q    " << q << std::endl;
-        std::cout << "d1   " << d1 << std::endl;
-        std::cout << "d2   " << d2 << std::endl;
-        std::cout << "mu1j " << mu1j << std::endl;
-        std::cout << "mu2j " << mu2j << std::endl;
-        std::cout << "mubjdt " << mubjdt << std::endl;
-        std::cout << "(q - mu1j) * d1 - (p + mu2j) * d2 - mubjdt = " ;
-        std::cout << (q - mu1j) * d1 - (p + mu2j) * d2 - mubjdt << std::endl;
-        std::cout << "exp((q - mu1j) * d1 - (p + mu2j) * d2 - mubjdt) = " ;
-        std::cout << exp((q - mu1j) * d1 - (p + mu2j) * d2 - mubjdt) << std::endl;
-        std::cout << " error 5 " << std::endl;
+        FISX_LOG_DEBUG("Math::deBoerV", "p = " << p << " q = " << q << " d1 = " << d1 << \
+                       " d2 = " << d2 << " mu1j = " << mu1j << " mu2j = " << mu2j << " mubjdt = " << mubjdt);
         throw std::runtime_error("error5");
     }
     return tmpHelp;
@@ -476,19 +406,19 @@ bool Math::isFiniteNumber(const double & x)
 
 double Math::_deBoerD(const double &x, const double & epsilon, const int & maxIter)
 {
-    // Evaluate exp(x) * E1(x) for x > 1
+    // Evaluate exp(x) * E1(x) for x > 1
     //
     // Adapted from continued fraction expression of En(x) from Mathematica wb site
     //
-    // Modified Lentz algorithm following Numerical Recipes description
+    // Modified Lentz algorithm following Numerical Recipes description
     //
     double f, D, C;
     // double tiny = 1.0e-30; not needed, we never get 0 denominator.
     double a, b, delta;
-
+
     if (x <= 1)
     {
-        std::cout << "x = " << x << std::endl;
+        FISX_LOG_DEBUG("Math::_deBoerD", "x = " << x);
         throw std::runtime_error("_deBoerD algorithm converges for x > 1");
     }
 
@@ -520,7 +450,7 @@ double Math::_deBoerD(const double &x, const double & epsilon, const int & maxIt
         }
     }
 
-    std::cout << " Continued fraction failed to converge for x = " << x << std::endl;
+    FISX_LOG_WARNING("Math::_deBoerD", "Continued fraction failed to converge for x = " << x);
     // return average of quoted values
     double limit0, limit1;
     limit0 = 0.5 * log(1 + 2.0/x);
@@ -598,7 +528,7 @@ double Math::hypermet(const double & x, \
     z2 = 0.5 * (z0 * z0) / (sigma * sigma);
     if (fwhm <= 0.0)
     {
-        std::cout << "FWHM = " << fwhm << std::endl;
+        FISX_LOG_WARNING("Math::hypermet", "FWHM = " << fwhm);
         std::runtime_error("FWHM should be strictly positive.");
     }
     if (z2 < 612)
@@ -649,4 +579,239 @@ double Math::hypermet(const double & x, \
 
 }
 
+void Math::gaussQuadrature(const double * x, const double * w, const int & nPoints, \
+                           const int & nNodes, double * nodes, double * weights)
+{
+    std::vector<double> t, p0, p1, p2, alpha, beta, z;
+    double xMin, xMax, center, halfWidth, total, norm, tmpDouble;
+    double g, r, s, c, p, f, b;
+    int i, k, l, m, iter;
+
+    if ((nNodes < 1) || (nPoints < nNodes))
+    {
+        throw std::invalid_argument("Math::gaussQuadrature. Not enough points for the requested nodes");
+    }
+    // work on [-1, 1] for the conditioning of the recurrence
+    xMin = x[0];
+    xMax = x[0];
+    total = 0.0;
+    for (i = 0; i < nPoints; i++)
+    {
+        if (x[i] < xMin)
+            xMin = x[i];
+        if (x[i] > xMax)
+            xMax = x[i];
+        total += w[i];
+    }
+    if (!(total > 0.0))
+    {
+        throw std::invalid_argument("Math::gaussQuadrature. Weights must be positive");
+    }
+    center = 0.5 * (xMax + xMin);
+    halfWidth = 0.5 * (xMax - xMin);
+    if ((nNodes == 1) || (halfWidth <= 0.0))
+    {
+        tmpDouble = 0.0;
+        for (i = 0; i < nPoints; i++)
+        {
+            tmpDouble += w[i] * x[i];
+        }
+        nodes[0] = tmpDouble / total;
+        weights[0] = total;
+        for (k = 1; k < nNodes; k++)
+        {
+            nodes[k] = nodes[0];
+            weights[k] = 0.0;
+        }
+        return;
+    }
+    t.resize(nPoints);
+    p0.resize(nPoints);
+    p1.resize(nPoints);
+    p2.resize(nPoints);
+    for (i = 0; i < nPoints; i++)
+    {
+        t[i] = (x[i] - center) / halfWidth;
+        p0[i] = 0.0;
+        p1[i] = 1.0;
+    }
+
+    // orthonormal polynomials of the measure normalized to unit mass
+    alpha.resize(nNodes);
+    beta.resize(nNodes);
+    norm = 1.0;
+    for (k = 0; k < nNodes; k++)
+    {
+        tmpDouble = 0.0;
+        for (i = 0; i < nPoints; i++)
+        {
+            tmpDouble += w[i] * t[i] * p1[i] * p1[i];
+        }
+        alpha[k] = tmpDouble / total;
+        if (k == (nNodes - 1))
+        {
+            break;
+        }
+        norm = 0.0;
+        for (i = 0; i < nPoints; i++)
+        {
+            p2[i] = (t[i] - alpha[k]) * p1[i] - beta[k] * p0[i];
+            norm += w[i] * p2[i] * p2[i];
+        }
+        beta[k + 1] = std::sqrt(norm / total);
+        if (!(beta[k + 1] > 0.0))
+        {
+            throw std::invalid_argument("Math::gaussQuadrature. Not enough distinct abscissas");
+        }
+        for (i = 0; i < nPoints; i++)
+        {
+            p0[i] = p1[i];
+            p1[i] = p2[i] / beta[k + 1];
+        }
+    }
+
+    // eigenvalues of the Jacobi matrix and first component of its eigenvectors (implicit QL)
+    z.resize(nNodes);
+    for (k = 0; k < nNodes; k++)
+    {
+        nodes[k] = alpha[k];
+        z[k] = (k == 0) ? 1.0 : 0.0;
+    }
+    for (k = 0; k < (nNodes - 1); k++)
+    {
+        beta[k] = beta[k + 1];
+    }
+    beta[nNodes - 1] = 0.0;
+    for (l = 0; l < nNodes; l++)
+    {
+        iter = 0;
+        do
+        {
+            for (m = l; m < (nNodes - 1); m++)
+            {
+                tmpDouble = std::fabs(nodes[m]) + std::fabs(nodes[m + 1]);
+                if (std::fabs(beta[m]) <= DBL_EPSILON * tmpDouble)
+                    break;
+            }
+            if (m != l)
+            {
+                if (iter++ == 60)
+                {
+                    throw std::runtime_error("Math::gaussQuadrature. No convergence");
+                }
+                g = (nodes[l + 1] - nodes[l]) / (2.0 * beta[l]);
+                r = std::sqrt(g * g + 1.0);
+                g = nodes[m] - nodes[l] + beta[l] / (g + ((g >= 0.0) ? r : -r));
+                s = 1.0;
+                c = 1.0;
+                p = 0.0;
+                for (i = m - 1; i >= l; i--)
+                {
+                    f = s * beta[i];
+                    b = c * beta[i];
+                    r = std::sqrt(f * f + g * g);
+                    beta[i + 1] = r;
+                    if (r == 0.0)
+                    {
+                        nodes[i + 1] -= p;
+                        beta[m] = 0.0;
+                        break;
+                    }
+                    s = f / r;
+                    c = g / r;
+                    g = nodes[i + 1] - p;
+                    r = (nodes[i] - g) * s + 2.0 * c * b;
+                    p = s * r;
+                    nodes[i + 1] = g + p;
+                    g = c * r - b;
+                    f = z[i + 1];
+                    z[i + 1] = s * z[i] + c * f;
+                    z[i] = c * z[i] - s * f;
+                }
+                if ((r == 0.0) && (i >= l))
+                    continue;
+                nodes[l] -= p;
+                beta[l] = g;
+                beta[m] = 0.0;
+            }
+        } while (m != l);
+    }
+
+    // order the nodes and go back to the original abscissas
+    for (k = 0; k < nNodes; k++)
+    {
+        weights[k] = total * z[k] * z[k];
+    }
+    for (k = 1; k < nNodes; k++)
+    {
+        for (l = k; (l > 0) && (nodes[l] < nodes[l - 1]); l--)
+        {
+            std::swap(nodes[l], nodes[l - 1]);
+            std::swap(weights[l], weights[l - 1]);
+        }
+    }
+    for (k = 0; k < nNodes; k++)
+    {
+        nodes[k] = center + halfWidth * nodes[k];
+    }
+}
+
+void Math::fft(double * real, double * imaginary, const int & n, const int & inverse)
+{
+    const double MY_PI = 3.141592653589793;
+    int i, j, k, length, half;
+    double angle, wr, wi, tr, ti;
+
+    if ((n < 1) || ((n & (n - 1)) != 0))
+    {
+        throw std::invalid_argument("Math::fft. The number of values must be a power of two");
+    }
+    // bit reversal permutation
+    j = 0;
+    for (i = 1; i < n; i++)
+    {
+        k = n >> 1;
+        while (j & k)
+        {
+            j ^= k;
+            k >>= 1;
+        }
+        j |= k;
+        if (i < j)
+        {
+            std::swap(real[i], real[j]);
+            std::swap(imaginary[i], imaginary[j]);
+        }
+    }
+    // butterflies
+    for (length = 2; length <= n; length <<= 1)
+    {
+        half = length >> 1;
+        angle = (inverse ? 2.0 : -2.0) * MY_PI / length;
+        for (k = 0; k < half; k++)
+        {
+            wr = std::cos(angle * k);
+            wi = std::sin(angle * k);
+            for (i = k; i < n; i += length)
+            {
+                j = i + half;
+                tr = wr * real[j] - wi * imaginary[j];
+                ti = wr * imaginary[j] + wi * real[j];
+                real[j] = real[i] - tr;
+                imaginary[j] = imaginary[i] - ti;
+                real[i] += tr;
+                imaginary[i] += ti;
+            }
+        }
+    }
+    if (inverse)
+    {
+        for (i = 0; i < n; i++)
+        {
+            real[i] /= n;
+            imaginary[i] /= n;
+        }
+    }
+}
+
 } // namespace fisx
@@ -12,6 +12,9 @@ namespace fisx
 
    This class implements the formulae contained in the article:
    D.K.G. de Boer, X-Ray Spectrometry, Vol. 19, (1990) 145 - 154.
+
+   The finiteness of the arguments received by the kernels is verified unless the library is
+   compiled with FISX_UNCHECKED defined (python setup.py build --unchecked).
  */
 
 class Math
@@ -149,6 +152,23 @@ class Math
                                const double & longTailSlope = 1.0, \
                                const double & stepHeight = 0.0);
 
+        /*!
+        Nodes and weights of the nNodes points Gaussian quadrature of the discrete measure given
+        by nPoints abscissas x with positive weights w: the sums of w * f(x) and weights * f(nodes)
+        are equal for any polynomial f of degree below 2 * nNodes. The nodes are ordered and lie
+        within the range of x. nNodes has to be smaller than the number of distinct abscissas.
+        The recurrence coefficients are obtained with the Stieltjes procedure and the nodes with
+        the Golub-Welsch algorithm.
+        */
+        static void gaussQuadrature(const double * x, const double * w, const int & nPoints, \
+                                    const int & nNodes, double * nodes, double * weights);
+
+        /*!
+        In place discrete Fourier transform of the n complex values (real, imaginary).
+        n has to be a power of two. The inverse transform includes the 1 / n normalization.
+        */
+        static void fft(double * real, double * imaginary, const int & n, const int & inverse = 0);
+
 
     private:
         /*!
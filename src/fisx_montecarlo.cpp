@@ -0,0 +1,1033 @@
+#include "fisx_montecarlo.h"
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace fisx
+{
+
+namespace
+{
+// contributions kept for each tally
+const int PRIMARY = 0;
+const int SECONDARY = 1;
+const int TERTIARY = 2;
+const int SCATTERING = 3;
+const int N_CONTRIBUTIONS = 4;
+const char * CONTRIBUTION_NAMES[N_CONTRIBUTIONS] = {"primary", "secondary", "tertiary", "scattering"};
+
+// histories are combined in this number of chunks, independently of the number of threads
+const long MAXIMUM_NUMBER_OF_CHUNKS = 100;
+// histories followed together inside a chunk
+const int BLOCK_SIZE = 256;
+const double POINTS_PER_DECADE = 200.0;
+const double MINIMUM_WEIGHT = 1.0e-3;
+const int MAXIMUM_NUMBER_OF_INTERACTIONS = 1000;
+const double ELECTRON_MASS = 510.998950;
+const unsigned long MASK = 0xFFFFFFFFUL;
+
+// 32 x 32 -> 64 bit product using 16 bit limbs, unsigned long is only guaranteed to have 32 bits
+inline void multiplyHighLow(const unsigned long & a, const unsigned long & b, \
+                            unsigned long & high, unsigned long & low)
+{
+    unsigned long a0, a1, b0, b1, p00, p01, p10, p11, middle;
+
+    a0 = a & 0xFFFFUL;
+    a1 = (a >> 16) & 0xFFFFUL;
+    b0 = b & 0xFFFFUL;
+    b1 = (b >> 16) & 0xFFFFUL;
+    p00 = a0 * b0;
+    p01 = a0 * b1;
+    p10 = a1 * b0;
+    p11 = a1 * b1;
+    middle = (p00 >> 16) + (p01 & 0xFFFFUL) + (p10 & 0xFFFFUL);
+    low = ((p00 & 0xFFFFUL) | ((middle & 0xFFFFUL) << 16)) & MASK;
+    high = (p11 + (p01 >> 16) + (p10 >> 16) + (middle >> 16)) & MASK;
+}
+
+// photons of one block of histories stored by component
+struct Block
+{
+    std::vector<long> history;
+    std::vector<unsigned long> counter;
+    std::vector<double> random;
+    std::vector<int> used;
+    std::vector<double> energy;
+    std::vector<double> z;
+    std::vector<double> ux;
+    std::vector<double> uy;
+    std::vector<double> uz;
+    std::vector<double> weight;
+    std::vector<int> contribution;
+    std::vector<int> layer;
+    std::vector<int> interactions;
+    std::vector<int> gridIndex;
+    std::vector<double> gridFraction;
+    std::vector<double> mu;
+    std::vector<int> active;
+
+    void resize(const int & n)
+    {
+        history.resize(n);
+        counter.resize(n);
+        random.resize(4 * n);
+        used.resize(n);
+        energy.resize(n);
+        z.resize(n);
+        ux.resize(n);
+        uy.resize(n);
+        uz.resize(n);
+        weight.resize(n);
+        contribution.resize(n);
+        layer.resize(n);
+        interactions.resize(n);
+        gridIndex.resize(n);
+        gridFraction.resize(n);
+        mu.resize(n);
+        active.reserve(n);
+    }
+
+    // next number of the stream of the history followed by photon i, in the open interval (0, 1)
+    double uniform(const int & i, const unsigned long key[2])
+    {
+        unsigned long count[4];
+        unsigned long values[4];
+        int k;
+
+        if (used[i] > 3)
+        {
+            count[0] = counter[i];
+            count[1] = ((unsigned long) history[i]) & MASK;
+            count[2] = ((((unsigned long) history[i]) >> 16) >> 16) & MASK;
+            count[3] = 0;
+            MonteCarlo::philox(key, count, values);
+            for (k = 0; k < 4; k++)
+            {
+                random[4 * i + k] = (values[k] + 0.5) / 4294967296.0;
+            }
+            counter[i] = (counter[i] + 1) & MASK;
+            used[i] = 0;
+        }
+        used[i]++;
+        return random[4 * i + used[i] - 1];
+    }
+};
+
+// new direction after a deflection of polar cosine c and azimuth phi
+inline void rotate(double & ux, double & uy, double & uz, const double & c, const double & phi)
+{
+    double s, cosPhi, sinPhi, t, x, y;
+
+    s = std::sqrt(std::max(0.0, 1.0 - c * c));
+    cosPhi = std::cos(phi);
+    sinPhi = std::sin(phi);
+    if (std::fabs(uz) > 0.99999)
+    {
+        ux = s * cosPhi;
+        uy = s * sinPhi;
+        uz = (uz > 0.0) ? c : -c;
+        return;
+    }
+    t = std::sqrt(1.0 - uz * uz);
+    x = s * (ux * uz * cosPhi - uy * sinPhi) / t + ux * c;
+    y = s * (uy * uz * cosPhi + ux * sinPhi) / t + uy * c;
+    uz = -s * cosPhi * t + uz * c;
+    ux = x;
+    uy = y;
+}
+
+} // anonymous namespace
+
+MonteCarlo::MonteCarlo()
+{
+    this->cutoffEnergy = 0.0;
+    this->sinAlphaOut = 1.0;
+    this->beamUx = 0.0;
+    this->beamUz = 1.0;
+    this->beamWeight = 0.0;
+}
+
+void MonteCarlo::setConfiguration(const XRFConfig & configuration)
+{
+    this->xrf.setConfiguration(configuration);
+}
+
+const XRFConfig & MonteCarlo::getConfiguration() const
+{
+    return this->xrf.getConfiguration();
+}
+
+void MonteCarlo::philox(const unsigned long key[2], const unsigned long counter[4], unsigned long values[4])
+{
+    unsigned long k0, k1, c0, c1, c2, c3, high0, low0, high1, low1;
+    int round;
+
+    k0 = key[0] & MASK;
+    k1 = key[1] & MASK;
+    c0 = counter[0] & MASK;
+    c1 = counter[1] & MASK;
+    c2 = counter[2] & MASK;
+    c3 = counter[3] & MASK;
+    for (round = 0; round < 10; round++)
+    {
+        if (round > 0)
+        {
+            k0 = (k0 + 0x9E3779B9UL) & MASK;
+            k1 = (k1 + 0xBB67AE85UL) & MASK;
+        }
+        multiplyHighLow(0xD2511F53UL, c0, high0, low0);
+        multiplyHighLow(0xCD9E8D57UL, c2, high1, low1);
+        c0 = high1 ^ c1 ^ k0;
+        c1 = low1;
+        c2 = high0 ^ c3 ^ k1;
+        c3 = low0;
+    }
+    values[0] = c0;
+    values[1] = c1;
+    values[2] = c2;
+    values[3] = c3;
+}
+
+void MonteCarlo::locate(const double & energy, int & index, double & fraction) const
+{
+    int n;
+
+    n = (int) this->grid.size();
+    index = (int) (std::upper_bound(this->grid.begin(), this->grid.end(), energy) - this->grid.begin()) - 1;
+    if (index < 0)
+    {
+        index = 0;
+    }
+    if (index > (n - 2))
+    {
+        index = n - 2;
+    }
+    fraction = (std::log(energy) - this->logGrid[index]) / (this->logGrid[index + 1] - this->logGrid[index]);
+}
+
+double MonteCarlo::interpolate(const std::vector<double> & values, const int & index, \
+                               const double & fraction) const
+{
+    const double & a = values[index];
+    const double & b = values[index + 1];
+
+    // the energies of the beam and of the emission lines are grid points
+    if (fraction <= 0.0)
+    {
+        return a;
+    }
+    if (fraction >= 1.0)
+    {
+        return b;
+    }
+    if ((a > 0.0) && (b > 0.0))
+    {
+        return a * std::exp(fraction * std::log(b / a));
+    }
+    return a + fraction * (b - a);
+}
+
+void MonteCarlo::prepare(const std::vector<std::string> & elementList, \
+                         const std::vector<std::string> & familyList, \
+                         const std::vector<int> & layerList, \
+                         const Elements & elementsLibrary, \
+                         const int & useMassFractions)
+{
+    const XRFConfig & configuration = this->xrf.getConfiguration();
+    const std::vector<Layer> & filters = configuration.getBeamFilters();
+    const std::vector<Layer> & sample = configuration.getSample();
+    const double PI = acos(-1.0);
+    double sinAlphaIn, alphaIn, top, energy, maximumEnergy, threshold;
+    std::vector<std::vector<double> > rays;
+    std::vector<double> transmission, total, photoelectric, coherent, compton, pair;
+    std::map<std::string, int> elementIndex;
+    std::map<std::string, int>::const_iterator e_it;
+    std::map<std::string, double> composition;
+    std::map<std::string, double>::const_iterator c_it;
+    std::map<std::string, std::vector<double> > rates;
+    std::map<std::string, std::vector<double> >::const_iterator r_it;
+    std::map<std::string, double> lineEnergies, lines;
+    std::map<std::string, int> tallyIndex;
+    std::string family, lineKey, tallyKey;
+    std::ostringstream tallyStream;
+    std::vector<double>::size_type i;
+    std::vector<std::string>::size_type iItem;
+    std::vector<Layer>::size_type iLayer;
+    int j, k, nGrid, firstLayer, lastLayer;
+    Tally tally;
+
+    if (sample.size() < 1)
+    {
+        throw std::invalid_argument("MonteCarlo. Sample not defined");
+    }
+    alphaIn = configuration.getAlphaIn();
+    sinAlphaIn = sin(alphaIn * (PI / 180.));
+    this->sinAlphaOut = sin(configuration.getAlphaOut() * (PI / 180.));
+    if ((sinAlphaIn <= 0.0) || (this->sinAlphaOut <= 0.0))
+    {
+        throw std::invalid_argument("MonteCarlo. Incident and outgoing angles must be positive");
+    }
+    this->beamUz = sinAlphaIn;
+    this->beamUx = cos(alphaIn * (PI / 180.));
+
+    // beam after the filters, the histories start with the filtered intensity
+    configuration.getBeam().getBeamAsDoubleVectors(rays);
+    if (rays.size() < 2 || rays[0].size() < 1)
+    {
+        throw std::invalid_argument("MonteCarlo. Beam not defined");
+    }
+    this->beamEnergies = rays[0];
+    this->beamCumulative = rays[1];
+    for (iLayer = 0; iLayer < filters.size(); iLayer++)
+    {
+        filters[iLayer].getTransmission(this->beamEnergies, elementsLibrary, 90.0, transmission);
+        for (i = 0; i < this->beamEnergies.size(); i++)
+        {
+            this->beamCumulative[i] *= transmission[i];
+        }
+    }
+    for (i = 1; i < this->beamCumulative.size(); i++)
+    {
+        this->beamCumulative[i] += this->beamCumulative[i - 1];
+    }
+    this->beamWeight = this->beamCumulative.back();
+    maximumEnergy = *std::max_element(this->beamEnergies.begin(), this->beamEnergies.end());
+
+    // the photons below the lowest excitation threshold of the requested lines cannot contribute
+    this->cutoffEnergy = maximumEnergy;
+    for (iItem = 0; iItem < elementList.size(); iItem++)
+    {
+        family = familyList[iItem];
+        if ((family == "Ka") || (family == "Kb"))
+        {
+            family = "K";
+        }
+        else if (family.size() > 0)
+        {
+            family = family.substr(0, 1);
+        }
+        threshold = this->xrf.getEnergyThreshold(elementList[iItem], family, elementsLibrary);
+        if ((threshold > 0.0) && (threshold < this->cutoffEnergy))
+        {
+            this->cutoffEnergy = threshold;
+        }
+    }
+
+    // elements of the sample and requested elements
+    this->elements.clear();
+    this->layers.clear();
+    this->layers.resize(sample.size());
+    for (iLayer = 0; iLayer < sample.size(); iLayer++)
+    {
+        composition = sample[iLayer].getComposition(elementsLibrary);
+        for (c_it = composition.begin(); c_it != composition.end(); ++c_it)
+        {
+            if (elementIndex.find(c_it->first) == elementIndex.end())
+            {
+                elementIndex[c_it->first] = (int) elementIndex.size();
+            }
+            this->layers[iLayer].elements.push_back(elementIndex[c_it->first]);
+            this->layers[iLayer].massFractions.push_back(c_it->second);
+        }
+    }
+    for (iItem = 0; iItem < elementList.size(); iItem++)
+    {
+        if (elementIndex.find(elementList[iItem]) == elementIndex.end())
+        {
+            elementIndex[elementList[iItem]] = (int) elementIndex.size();
+        }
+    }
+    this->elements.resize(elementIndex.size());
+
+    // energy grid including the energies of the beam, the emission lines and both sides of the edges
+    this->grid.clear();
+    for (energy = this->cutoffEnergy; energy < maximumEnergy; \
+         energy *= std::pow(10.0, 1.0 / POINTS_PER_DECADE))
+    {
+        this->grid.push_back(energy);
+    }
+    this->grid.push_back(maximumEnergy);
+    if (this->cutoffEnergy >= maximumEnergy)
+    {
+        this->grid.push_back(maximumEnergy * 1.001);
+    }
+    for (i = 0; i < this->beamEnergies.size(); i++)
+    {
+        if (this->beamEnergies[i] >= this->cutoffEnergy)
+        {
+            this->grid.push_back(this->beamEnergies[i]);
+        }
+    }
+    for (e_it = elementIndex.begin(); e_it != elementIndex.end(); ++e_it)
+    {
+        const std::map<std::string, double> & bindingEnergies = elementsLibrary.getBindingEnergies(e_it->first);
+        for (c_it = bindingEnergies.begin(); c_it != bindingEnergies.end(); ++c_it)
+        {
+            if ((c_it->second > this->cutoffEnergy) && (c_it->second < maximumEnergy))
+            {
+                this->grid.push_back(c_it->second * (1.0 - 1.0e-7));
+                this->grid.push_back(c_it->second);
+            }
+        }
+        lines = elementsLibrary.getElement(e_it->first).getEmittedXRayLines(maximumEnergy);
+        for (c_it = lines.begin(); c_it != lines.end(); ++c_it)
+        {
+            if ((c_it->second >= this->cutoffEnergy) && (c_it->second <= maximumEnergy))
+            {
+                this->grid.push_back(c_it->second);
+            }
+        }
+    }
+    std::sort(this->grid.begin(), this->grid.end());
+    this->grid.erase(std::unique(this->grid.begin(), this->grid.end()), this->grid.end());
+    nGrid = (int) this->grid.size();
+    this->logGrid.resize(nGrid);
+    for (j = 0; j < nGrid; j++)
+    {
+        this->logGrid[j] = std::log(this->grid[j]);
+    }
+
+    // tabulate the layers and the elements
+    total.resize(nGrid);
+    photoelectric.resize(nGrid);
+    coherent.resize(nGrid);
+    compton.resize(nGrid);
+    pair.resize(nGrid);
+    top = 0.0;
+    for (iLayer = 0; iLayer < sample.size(); iLayer++)
+    {
+        LayerData & layer = this->layers[iLayer];
+        layer.density = sample[iLayer].getDensity();
+        layer.top = top;
+        top += sample[iLayer].getThickness();
+        layer.bottom = top;
+        sample[iLayer].getMassAttenuationCoefficients(&this->grid[0], nGrid, elementsLibrary, \
+                                                      &total[0], &photoelectric[0], &coherent[0], \
+                                                      &compton[0], &pair[0]);
+        layer.total = total;
+        layer.coherent = coherent;
+        layer.compton = compton;
+        layer.tallies.clear();
+    }
+    for (e_it = elementIndex.begin(); e_it != elementIndex.end(); ++e_it)
+    {
+        ElementData & element = this->elements[e_it->second];
+        element.name = e_it->first;
+        elementsLibrary.getMassAttenuationCoefficients(e_it->first, &this->grid[0], nGrid, \
+                                                       &total[0], &photoelectric[0], &coherent[0], \
+                                                       &compton[0], &pair[0]);
+        element.photoelectric = photoelectric;
+        rates.clear();
+        elementsLibrary.getExcitationFactors(e_it->first, &this->grid[0], NULL, nGrid, rates, lineEnergies);
+        element.lineNames.clear();
+        element.lineEnergies.clear();
+        element.lineRates.clear();
+        element.transportLines.clear();
+        for (r_it = rates.begin(); r_it != rates.end(); ++r_it)
+        {
+            if (r_it->second.back() <= 0.0)
+            {
+                // not excited by the beam
+                continue;
+            }
+            if (lineEnergies[r_it->first] >= this->cutoffEnergy)
+            {
+                element.transportLines.push_back((int) element.lineNames.size());
+            }
+            element.lineNames.push_back(r_it->first);
+            element.lineEnergies.push_back(lineEnergies[r_it->first]);
+            element.lineRates.push_back(r_it->second);
+        }
+    }
+
+    // requested lines of each layer
+    this->tallyKeys.clear();
+    this->tallyLayers.clear();
+    this->tallyLines.clear();
+    this->tallyEnergies.clear();
+    this->tallyMassFractions.clear();
+    for (iItem = 0; iItem < elementList.size(); iItem++)
+    {
+        const ElementData & element = this->elements[elementIndex[elementList[iItem]]];
+        const std::string & lineFamily = familyList[iItem];
+        family = lineFamily;
+        if (lineFamily == "Ka")
+        {
+            family = "KL";
+        }
+        if (lineFamily == "Kb")
+        {
+            family = "KM";
+        }
+        firstLayer = 0;
+        lastLayer = (int) sample.size() - 1;
+        if (layerList[iItem] >= 0)
+        {
+            if (layerList[iItem] >= (int) sample.size())
+            {
+                throw std::invalid_argument("MonteCarlo. Requested layer does not exist");
+            }
+            firstLayer = layerList[iItem];
+            lastLayer = layerList[iItem];
+        }
+        for (k = 0; k < (int) element.lineNames.size(); k++)
+        {
+            const std::string & line = element.lineNames[k];
+            if ((line.compare(0, family.length(), family) != 0) && \
+                (!((lineFamily == "Kb") && (line[0] == 'K') && (line[1] != 'L'))))
+            {
+                continue;
+            }
+            if (lineFamily.size() == 0)
+            {
+                lineKey = element.name + " " + line.substr(0, 1);
+            }
+            else
+            {
+                lineKey = element.name + " " + lineFamily;
+            }
+            for (j = firstLayer; j <= lastLayer; j++)
+            {
+                LayerData & layer = this->layers[j];
+                tallyStream.str("");
+                tallyStream << lineKey << "\n" << line << "\n" << j;
+                tallyKey = tallyStream.str();
+                if (tallyIndex.find(tallyKey) != tallyIndex.end())
+                {
+                    continue;
+                }
+                tally.element = elementIndex[elementList[iItem]];
+                tally.line = k;
+                tally.index = (int) this->tallyKeys.size();
+                tally.mu = 0.0;
+                tally.factor = 0.0;
+                for (i = 0; i < layer.elements.size(); i++)
+                {
+                    if (layer.elements[i] == tally.element)
+                    {
+                        tally.factor = layer.massFractions[i];
+                    }
+                }
+                this->tallyMassFractions.push_back(tally.factor);
+                if (!useMassFractions)
+                {
+                    tally.factor = 1.0;
+                }
+                // self absorption on the way out of the layer per unit depth
+                tally.mu = sample[j].getMassAttenuationCoefficients(element.lineEnergies[k], \
+                                                                    elementsLibrary)["total"] * \
+                           layer.density / this->sinAlphaOut;
+                tallyIndex[tallyKey] = tally.index;
+                layer.tallies.push_back(tally);
+                this->tallyKeys.push_back(lineKey);
+                this->tallyLayers.push_back(j);
+                this->tallyLines.push_back(line);
+                this->tallyEnergies.push_back(element.lineEnergies[k]);
+            }
+        }
+    }
+}
+
+void MonteCarlo::runChunk(const long & firstHistory, const long & lastHistory, \
+                          const unsigned long & seed, const int & scattering, \
+                          std::vector<double> & sums) const
+{
+    const double PI = acos(-1.0);
+    const int nLayers = (int) this->layers.size();
+    const unsigned long key[2] = {seed & MASK, ((seed >> 16) >> 16) & MASK};
+    Block block;
+    std::vector<double> layerMu(nLayers);
+    std::vector<int>::size_type a;
+    long first;
+    int i, n, j, k, l, index, nActive;
+    double u, tau, remaining, probability, position, fraction, value, sum;
+    double muTotal, muCoherent, muCompton, ratio, c, f, p;
+    bool alive;
+
+    block.resize(BLOCK_SIZE);
+    for (first = firstHistory; first < lastHistory; first += BLOCK_SIZE)
+    {
+        n = (int) std::min((long) BLOCK_SIZE, lastHistory - first);
+        block.active.clear();
+        // incident photons
+        for (i = 0; i < n; i++)
+        {
+            block.history[i] = first + i;
+            block.counter[i] = 0;
+            block.used[i] = 4;
+            u = block.uniform(i, key) * this->beamWeight;
+            index = (int) (std::upper_bound(this->beamCumulative.begin(), this->beamCumulative.end(), u) - \
+                           this->beamCumulative.begin());
+            if (index >= (int) this->beamCumulative.size())
+            {
+                index = (int) this->beamCumulative.size() - 1;
+            }
+            block.energy[i] = this->beamEnergies[index];
+            block.weight[i] = this->beamWeight;
+            block.z[i] = 0.0;
+            block.layer[i] = 0;
+            block.ux[i] = this->beamUx;
+            block.uy[i] = 0.0;
+            block.uz[i] = this->beamUz;
+            block.contribution[i] = PRIMARY;
+            block.interactions[i] = 0;
+            if ((block.energy[i] >= this->cutoffEnergy) && (this->beamWeight > 0.0))
+            {
+                block.active.push_back(i);
+            }
+        }
+        while (block.active.size() > 0)
+        {
+            nActive = (int) block.active.size();
+            // cross section lookup
+            for (a = 0; a < (std::vector<int>::size_type) nActive; a++)
+            {
+                i = block.active[a];
+                this->locate(block.energy[i], block.gridIndex[i], block.gridFraction[i]);
+            }
+            // flight forced to end inside the sample
+            for (a = 0; a < (std::vector<int>::size_type) nActive; a++)
+            {
+                i = block.active[a];
+                for (l = 0; l < nLayers; l++)
+                {
+                    layerMu[l] = this->layers[l].density * \
+                                 this->interpolate(this->layers[l].total, block.gridIndex[i], block.gridFraction[i]);
+                }
+                l = block.layer[i];
+                if (std::fabs(block.uz[i]) < 1.0e-12)
+                {
+                    // travelling parallel to the surface inside an infinite layer
+                    if (!(layerMu[l] > 0.0))
+                    {
+                        block.weight[i] = 0.0;
+                    }
+                    block.mu[i] = layerMu[l];
+                    continue;
+                }
+                if (block.uz[i] > 0.0)
+                {
+                    tau = layerMu[l] * (this->layers[l].bottom - block.z[i]);
+                    for (k = l + 1; k < nLayers; k++)
+                    {
+                        tau += layerMu[k] * (this->layers[k].bottom - this->layers[k].top);
+                    }
+                    tau /= block.uz[i];
+                }
+                else
+                {
+                    tau = layerMu[l] * (block.z[i] - this->layers[l].top);
+                    for (k = l - 1; k >= 0; k--)
+                    {
+                        tau += layerMu[k] * (this->layers[k].bottom - this->layers[k].top);
+                    }
+                    tau /= -block.uz[i];
+                }
+                if (!(tau > 0.0))
+                {
+                    block.weight[i] = 0.0;
+                    continue;
+                }
+                probability = 1.0 - std::exp(-tau);
+                block.weight[i] *= probability;
+                remaining = -std::log(1.0 - block.uniform(i, key) * probability);
+                position = block.z[i];
+                k = l;
+                while (true)
+                {
+                    if (block.uz[i] > 0.0)
+                    {
+                        value = layerMu[k] * (this->layers[k].bottom - position) / block.uz[i];
+                    }
+                    else
+                    {
+                        value = layerMu[k] * (position - this->layers[k].top) / (-block.uz[i]);
+                    }
+                    if ((layerMu[k] > 0.0) && ((remaining < value) || \
+                        ((block.uz[i] > 0.0) && (k == nLayers - 1)) || ((block.uz[i] < 0.0) && (k == 0))))
+                    {
+                        position += std::min(remaining, value) * block.uz[i] / layerMu[k];
+                        break;
+                    }
+                    remaining -= value;
+                    if (block.uz[i] > 0.0)
+                    {
+                        position = this->layers[k].bottom;
+                        k++;
+                    }
+                    else
+                    {
+                        position = this->layers[k].top;
+                        k--;
+                    }
+                    if ((k < 0) || (k >= nLayers))
+                    {
+                        // only possible through rounding
+                        k = std::max(0, std::min(nLayers - 1, k));
+                        break;
+                    }
+                }
+                block.z[i] = std::max(this->layers[k].top, std::min(this->layers[k].bottom, position));
+                block.layer[i] = k;
+                block.mu[i] = layerMu[k];
+                if (!(block.mu[i] > 0.0))
+                {
+                    block.weight[i] = 0.0;
+                }
+            }
+            // expected emission of the requested lines towards the detector
+            for (a = 0; a < (std::vector<int>::size_type) nActive; a++)
+            {
+                i = block.active[a];
+                if (!(block.weight[i] > 0.0))
+                {
+                    continue;
+                }
+                const LayerData & layer = this->layers[block.layer[i]];
+                muTotal = block.mu[i] / layer.density;
+                for (j = 0; j < (int) layer.tallies.size(); j++)
+                {
+                    const Tally & tally = layer.tallies[j];
+                    value = this->interpolate(this->elements[tally.element].lineRates[tally.line], \
+                                              block.gridIndex[i], block.gridFraction[i]);
+                    if (value > 0.0)
+                    {
+                        sums[N_CONTRIBUTIONS * tally.index + block.contribution[i]] += \
+                                block.weight[i] * tally.factor * value / muTotal * \
+                                std::exp(-tally.mu * (block.z[i] - layer.top));
+                    }
+                }
+            }
+            // interaction
+            for (a = 0; a < (std::vector<int>::size_type) nActive; a++)
+            {
+                i = block.active[a];
+                alive = block.weight[i] > 0.0;
+                if (alive)
+                {
+                    const LayerData & layer = this->layers[block.layer[i]];
+                    muTotal = block.mu[i] / layer.density;
+                    muCoherent = this->interpolate(layer.coherent, block.gridIndex[i], block.gridFraction[i]);
+                    muCompton = this->interpolate(layer.compton, block.gridIndex[i], block.gridFraction[i]);
+                    u = block.uniform(i, key) * muTotal;
+                    if (u < (muCoherent + muCompton))
+                    {
+                        if (scattering)
+                        {
+                            if (u < muCoherent)
+                            {
+                                // Thomson angular distribution
+                                do
+                                {
+                                    c = 2.0 * block.uniform(i, key) - 1.0;
+                                } while ((2.0 * block.uniform(i, key)) > (1.0 + c * c));
+                            }
+                            else
+                            {
+                                // Klein-Nishina angular distribution
+                                ratio = block.energy[i] / ELECTRON_MASS;
+                                do
+                                {
+                                    c = 2.0 * block.uniform(i, key) - 1.0;
+                                    p = 1.0 / (1.0 + ratio * (1.0 - c));
+                                    f = p * p * (p + 1.0 / p - 1.0 + c * c);
+                                } while ((2.0 * block.uniform(i, key)) > f);
+                                block.energy[i] *= p;
+                            }
+                            rotate(block.ux[i], block.uy[i], block.uz[i], c, 2.0 * PI * block.uniform(i, key));
+                            block.contribution[i] = SCATTERING;
+                        }
+                        else
+                        {
+                            alive = false;
+                        }
+                    }
+                    else
+                    {
+                        // photoelectric absorption followed by the emission of one transported line
+                        sum = 0.0;
+                        for (j = 0; j < (int) layer.elements.size(); j++)
+                        {
+                            sum += layer.massFractions[j] * \
+                                   this->interpolate(this->elements[layer.elements[j]].photoelectric, \
+                                                     block.gridIndex[i], block.gridFraction[i]);
+                        }
+                        if (!(sum > 0.0))
+                        {
+                            block.weight[i] = 0.0;
+                            continue;
+                        }
+                        u = block.uniform(i, key) * sum;
+                        for (j = 0; j < (int) layer.elements.size() - 1; j++)
+                        {
+                            u -= layer.massFractions[j] * \
+                                 this->interpolate(this->elements[layer.elements[j]].photoelectric, \
+                                                   block.gridIndex[i], block.gridFraction[i]);
+                            if (u < 0.0)
+                            {
+                                break;
+                            }
+                        }
+                        const ElementData & element = this->elements[layer.elements[j]];
+                        sum = 0.0;
+                        for (k = 0; k < (int) element.transportLines.size(); k++)
+                        {
+                            sum += this->interpolate(element.lineRates[element.transportLines[k]], \
+                                                     block.gridIndex[i], block.gridFraction[i]);
+                        }
+                        value = this->interpolate(element.photoelectric, block.gridIndex[i], block.gridFraction[i]);
+                        if ((sum > 0.0) && (value > 0.0))
+                        {
+                            u = block.uniform(i, key) * sum;
+                            for (k = 0; k < (int) element.transportLines.size() - 1; k++)
+                            {
+                                u -= this->interpolate(element.lineRates[element.transportLines[k]], \
+                                                       block.gridIndex[i], block.gridFraction[i]);
+                                if (u < 0.0)
+                                {
+                                    break;
+                                }
+                            }
+                            // the weight carries the fluorescence yield of the transported lines
+                            block.weight[i] *= sum / value;
+                            block.energy[i] = element.lineEnergies[element.transportLines[k]];
+                            block.uz[i] = 2.0 * block.uniform(i, key) - 1.0;
+                            fraction = std::sqrt(std::max(0.0, 1.0 - block.uz[i] * block.uz[i]));
+                            value = 2.0 * PI * block.uniform(i, key);
+                            block.ux[i] = fraction * std::cos(value);
+                            block.uy[i] = fraction * std::sin(value);
+                            if (block.contribution[i] == PRIMARY)
+                            {
+                                block.contribution[i] = SECONDARY;
+                            }
+                            else if (block.contribution[i] == SECONDARY)
+                            {
+                                block.contribution[i] = TERTIARY;
+                            }
+                        }
+                        else
+                        {
+                            alive = false;
+                        }
+                    }
+                }
+                if (alive)
+                {
+                    block.interactions[i]++;
+                    if ((block.energy[i] < this->cutoffEnergy) || \
+                        (block.interactions[i] >= MAXIMUM_NUMBER_OF_INTERACTIONS))
+                    {
+                        alive = false;
+                    }
+                    else if (block.weight[i] < (MINIMUM_WEIGHT * this->beamWeight))
+                    {
+                        // russian roulette
+                        if ((block.uniform(i, key) * MINIMUM_WEIGHT * this->beamWeight) < block.weight[i])
+                        {
+                            block.weight[i] = MINIMUM_WEIGHT * this->beamWeight;
+                        }
+                        else
+                        {
+                            alive = false;
+                        }
+                    }
+                }
+                if (!alive)
+                {
+                    block.weight[i] = 0.0;
+                }
+            }
+            // keep the photons still alive
+            k = 0;
+            for (a = 0; a < (std::vector<int>::size_type) nActive; a++)
+            {
+                i = block.active[a];
+                if (block.weight[i] > 0.0)
+                {
+                    block.active[k] = i;
+                    k++;
+                }
+            }
+            block.active.resize(k);
+        }
+    }
+}
+
+MonteCarlo::Result MonteCarlo::getMultilayerFluorescence(const std::vector<std::string> & elementFamilyLayer, \
+                                                         const Elements & elementsLibrary, \
+                                                         const long & nHistories, \
+                                                         const unsigned long & seed, \
+                                                         const int & useGeometricEfficiency, \
+                                                         const int & useMassFractions, \
+                                                         const int & scattering, \
+                                                         const int & nThreads)
+{
+    const XRFConfig & configuration = this->xrf.getConfiguration();
+    const std::vector<Layer> & sample = configuration.getSample();
+    const std::vector<Layer> & attenuators = configuration.getAttenuators();
+    Detector detector = configuration.getDetector();
+    std::vector<std::string> elementList;
+    std::vector<std::string> familyList;
+    std::vector<int> layerList;
+    std::vector<std::vector<double> > chunkSums;
+    std::vector<long> chunkStart;
+    std::vector<std::string> errors;
+    std::map<std::string, std::map<std::string, double> > escapeRates;
+    std::map<std::string, std::map<std::string, double> >::const_iterator c_it;
+    Result result;
+    long nChunks, iChunk;
+    int t, m, j, nTallies;
+    double energy, efficiency, totalEscape, mean, variance, chunkValue, histories;
+    std::vector<double> values;
+
+    if (nHistories < 1)
+    {
+        throw std::invalid_argument("MonteCarlo. The number of histories must be positive");
+    }
+    XRF::parseElementFamilyLayer(elementFamilyLayer, elementList, familyList, layerList);
+    if (layerList.size() != elementList.size())
+    {
+        layerList.resize(elementList.size(), layerList.size() ? layerList[0] : -1);
+    }
+    this->prepare(elementList, familyList, layerList, elementsLibrary, useMassFractions);
+    nTallies = (int) this->tallyKeys.size();
+
+    // the chunks only depend on the number of histories
+    nChunks = std::min(nHistories, MAXIMUM_NUMBER_OF_CHUNKS);
+    chunkStart.resize(nChunks + 1);
+    for (iChunk = 0; iChunk <= nChunks; iChunk++)
+    {
+        chunkStart[iChunk] = (nHistories / nChunks) * iChunk + std::min(iChunk, nHistories % nChunks);
+    }
+    chunkSums.resize(nChunks);
+    errors.resize(nChunks);
+
+#ifdef _OPENMP
+    int actualThreads;
+    actualThreads = (nThreads > 0) ? nThreads : omp_get_max_threads();
+    if (actualThreads > nChunks)
+    {
+        actualThreads = (int) nChunks;
+    }
+    #pragma omp parallel for num_threads(actualThreads) schedule(dynamic, 1)
+#else
+    (void) nThreads;
+#endif
+    for (iChunk = 0; iChunk < nChunks; iChunk++)
+    {
+        try
+        {
+            chunkSums[iChunk].assign(N_CONTRIBUTIONS * nTallies, 0.0);
+            this->runChunk(chunkStart[iChunk], chunkStart[iChunk + 1], seed, scattering, chunkSums[iChunk]);
+        }
+        catch (const std::exception & exc)
+        {
+            errors[iChunk] = exc.what();
+        }
+    }
+    for (iChunk = 0; iChunk < nChunks; iChunk++)
+    {
+        if (errors[iChunk].size())
+        {
+            throw std::runtime_error("MonteCarlo. " + errors[iChunk]);
+        }
+    }
+
+    // means and standard errors from the spread among chunks
+    histories = (double) nHistories;
+    values.resize(N_CONTRIBUTIONS + 1);
+    for (t = 0; t < nTallies; t++)
+    {
+        std::map<std::string, double> & line = result[this->tallyKeys[t]][this->tallyLayers[t]][this->tallyLines[t]];
+        energy = this->tallyEnergies[t];
+        j = this->tallyLayers[t];
+        efficiency = 1.0;
+        for (m = 0; m < j; m++)
+        {
+            efficiency *= sample[m].getTransmission(energy, elementsLibrary, configuration.getAlphaOut());
+        }
+        for (m = 0; m < (int) attenuators.size(); m++)
+        {
+            efficiency *= attenuators[m].getTransmission(energy, elementsLibrary, 90.0);
+        }
+        if (useGeometricEfficiency != 0)
+        {
+            efficiency *= this->xrf.getGeometricEfficiency(j);
+        }
+        totalEscape = 0.0;
+        if (detector.hasMaterialComposition() || (detector.getMaterialName().size() > 0))
+        {
+            if ((detector.getDensity() > 0.0) && (detector.getThickness() > 0.0))
+            {
+                efficiency *= (1.0 - detector.getTransmission(energy, elementsLibrary, 90.0));
+            }
+            escapeRates = detector.getEscape(energy, elementsLibrary, this->tallyLines[t], 1);
+            for (c_it = escapeRates.begin(); c_it != escapeRates.end(); ++c_it)
+            {
+                totalEscape += c_it->second.find("rate")->second;
+            }
+        }
+        values[N_CONTRIBUTIONS] = 0.0;
+        for (m = 0; m < N_CONTRIBUTIONS; m++)
+        {
+            values[m] = 0.0;
+            for (iChunk = 0; iChunk < nChunks; iChunk++)
+            {
+                values[m] += chunkSums[iChunk][N_CONTRIBUTIONS * t + m];
+            }
+            values[N_CONTRIBUTIONS] += values[m];
+        }
+        for (m = 0; m <= N_CONTRIBUTIONS; m++)
+        {
+            mean = values[m] / histories;
+            variance = 0.0;
+            for (iChunk = 0; iChunk < nChunks; iChunk++)
+            {
+                if (m < N_CONTRIBUTIONS)
+                {
+                    chunkValue = chunkSums[iChunk][N_CONTRIBUTIONS * t + m];
+                }
+                else
+                {
+                    chunkValue = 0.0;
+                    for (j = 0; j < N_CONTRIBUTIONS; j++)
+                    {
+                        chunkValue += chunkSums[iChunk][N_CONTRIBUTIONS * t + j];
+                    }
+                }
+                histories = (double) (chunkStart[iChunk + 1] - chunkStart[iChunk]);
+                chunkValue = chunkValue / histories - mean;
+                variance += histories * chunkValue * chunkValue;
+            }
+            histories = (double) nHistories;
+            if (nChunks > 1)
+            {
+                variance /= (nChunks - 1) * histories;
+            }
+            else
+            {
+                variance = 0.0;
+            }
+            if (m < N_CONTRIBUTIONS)
+            {
+                line[CONTRIBUTION_NAMES[m]] = mean;
+                line[std::string(CONTRIBUTION_NAMES[m]) + "_error"] = std::sqrt(variance);
+            }
+            else
+            {
+                line["rate"] = mean * efficiency * (1.0 - totalEscape);
+                line["rate_error"] = std::sqrt(variance) * efficiency * (1.0 - totalEscape);
+            }
+        }
+        line["energy"] = energy;
+        line["efficiency"] = efficiency;
+        line["massFraction"] = this->tallyMassFractions[t];
+    }
+    return result;
+}
+
+} // namespace fisx
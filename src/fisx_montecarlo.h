@@ -0,0 +1,160 @@
+#ifndef FISX_MONTECARLO_H
+#define FISX_MONTECARLO_H
+#include <string>
+#include <vector>
+#include <map>
+#include "fisx_xrf.h"
+
+namespace fisx
+{
+
+/*!
+  \class MonteCarlo
+  \brief Photon transport reference for the analytic fluorescence calculation
+
+   The incident photons are followed through the sample layers using the cross sections and the
+   emission data of the same Elements instance and the geometry of the same XRFConfig used by
+   XRF::getMultilayerFluorescence. Fluorescence photons are transported as well, so the result
+   includes secondary and higher order excitation as well as the fluorescence excited by
+   coherently and incoherently scattered photons.
+
+   The sample layers are laterally infinite. The direction towards the detector is the one given
+   by alphaOut, as in the analytic calculation, and every interaction scores the expected
+   emission of the requested lines in that direction. The output is therefore directly
+   comparable with the one of XRF::getMultilayerFluorescence. Every flight is forced to interact
+   inside the sample and low weight photons are subjected to russian roulette.
+
+   The scattering angles follow the Thomson and the Klein-Nishina distributions, the beam is
+   unpolarized and its divergency is ignored.
+
+   Each history draws its random numbers from its own counter based stream, determined by the
+   seed and by the history index. The histories are evaluated in fixed chunks whose results are
+   combined in order, so that the output does not depend on the number of threads. The chunks also
+   provide the statistical error of each result. When the library is compiled with OpenMP, the
+   chunks are distributed among the threads.
+*/
+class MonteCarlo
+{
+public:
+    typedef std::map<std::string, std::map<int, std::map<std::string, std::map<std::string, double> > > > \
+            Result;
+
+    MonteCarlo();
+
+    /*!
+    Beam, beam filters, sample, attenuators, detector and geometry to be simulated.
+    */
+    void setConfiguration(const XRFConfig & configuration);
+    const XRFConfig & getConfiguration() const;
+
+    /*!
+    Follow nHistories incident photons and return the detected fluorescence.
+    \param elementFamilyLayer - Information requested in the form "Cr", "Cr K" or "Cr K 0"
+    (see XRF::getMultilayerFluorescence)
+    \param elementsLibrary - Instance of library to be used for all the Physical constants.
+    It is not modified and it must not be modified by other threads during the calculation.
+    \param nHistories - Number of incident photons
+    \param seed - Seed of the random number streams. The same seed gives the same result.
+    \param useGeometricEfficiency - Take into account solid angle or not.
+    \param useMassFractions - If 0 the rates correspond to a mass fraction of one of the element
+    in the layer, as in XRF::getMultilayerFluorescence.
+    \param scattering - If 0 the scattered photons are not followed.
+    \param nThreads - Number of threads to be used. Zero or negative uses the OpenMP default.
+    Ignored if the library is compiled without OpenMP.
+
+    Return a map of the form [Element Family][Layer][line][key] with the keys:
+    energy - Energy of the line
+    rate - Detected rate per incident photon
+    primary - Emission excited by unscattered incident photons
+    secondary - Emission excited by fluorescence of the primary emission
+    tertiary - Emission excited by fluorescence of higher orders
+    scattering - Emission excited by photons scattered at least once
+    efficiency - Detection efficiency
+    massFraction - Mass fraction of the element in the layer
+    The primary, secondary, tertiary and scattering contributions are given prior to correct by
+    the detection efficiency, as in XRF::getMultilayerFluorescence. Each of rate, primary,
+    secondary, tertiary and scattering comes with its standard error in the key of the same name
+    followed by "_error".
+    */
+    Result getMultilayerFluorescence(const std::vector<std::string> & elementFamilyLayer, \
+                                     const Elements & elementsLibrary, \
+                                     const long & nHistories, \
+                                     const unsigned long & seed = 0, \
+                                     const int & useGeometricEfficiency = 1, \
+                                     const int & useMassFractions = 0, \
+                                     const int & scattering = 1, \
+                                     const int & nThreads = 0);
+
+    /*!
+    Fill values with the four 32 bit numbers of the Philox4x32-10 counter based generator for the
+    given key and counter. Exposed for testing purposes.
+    */
+    static void philox(const unsigned long key[2], const unsigned long counter[4], unsigned long values[4]);
+
+private:
+    struct Tally
+    {
+        int element;
+        int line;
+        int index;
+        double factor;
+        double mu;
+    };
+
+    struct LayerData
+    {
+        double density;
+        double top;
+        double bottom;
+        std::vector<double> total;
+        std::vector<double> coherent;
+        std::vector<double> compton;
+        std::vector<int> elements;
+        std::vector<double> massFractions;
+        std::vector<Tally> tallies;
+    };
+
+    struct ElementData
+    {
+        std::string name;
+        std::vector<std::string> lineNames;
+        std::vector<double> lineEnergies;
+        std::vector<std::vector<double> > lineRates;
+        std::vector<double> photoelectric;
+        // lines energetic enough to excite any of the requested lines
+        std::vector<int> transportLines;
+    };
+
+    void prepare(const std::vector<std::string> & elementList, \
+                 const std::vector<std::string> & familyList, \
+                 const std::vector<int> & layerList, \
+                 const Elements & elementsLibrary, \
+                 const int & useMassFractions);
+    void runChunk(const long & firstHistory, const long & lastHistory, \
+                  const unsigned long & seed, const int & scattering, \
+                  std::vector<double> & sums) const;
+    void locate(const double & energy, int & index, double & fraction) const;
+    double interpolate(const std::vector<double> & values, const int & index, const double & fraction) const;
+
+    XRF xrf;
+    double cutoffEnergy;
+    double sinAlphaOut;
+    double beamUx;
+    double beamUz;
+    std::vector<double> beamEnergies;
+    std::vector<double> beamCumulative;
+    double beamWeight;
+    std::vector<double> grid;
+    std::vector<double> logGrid;
+    std::vector<LayerData> layers;
+    std::vector<ElementData> elements;
+    std::vector<std::string> tallyKeys;
+    std::vector<int> tallyLayers;
+    std::vector<std::string> tallyLines;
+    std::vector<double> tallyEnergies;
+    std::vector<double> tallyMassFractions;
+};
+
+} // namespace fisx
+
+#endif // FISX_MONTECARLO_H
@@ -1,8 +1,8 @@
 #include "fisx_xrf.h"
 #include "fisx_math.h"
+#include "fisx_logger.h"
 #include <cmath>
 #include <stdexcept>
-//#include <iostream>
 #include <sstream>
 #include <iomanip>
 
@@ -17,90 +17,199 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
                                                const int & secondary, \
                                                const int & useGeometricEfficiency,
                                                const int & useMassFractions, \
-                                               const double & secondaryCalculationLimit)
+                                               const double & secondaryCalculationLimit, \
+                                               const int & detailLevel)
+{
+    MultilayerWorkspace workspace;
+
+    return this->getMultilayerFluorescence(elementList, elementsLibrary, layerList, familyList, \
+                                           workspace, secondary, useGeometricEfficiency, \
+                                           useMassFractions, secondaryCalculationLimit, detailLevel);
+}
+
+std::map<std::string, std::map<int, std::map<std::string, std::map<std::string, double> > > > \
+                XRF::getMultilayerFluorescence(const std::vector<std::string> & elementList,
+                                               const Elements & elementsLibrary, \
+                                               const std::vector<int> & layerList, \
+                                               const std::vector<std::string> &  familyList, \
+                                               MultilayerWorkspace & workspace, \
+                                               const int & secondary, \
+                                               const int & useGeometricEfficiency,
+                                               const int & useMassFractions, \
+                                               const double & secondaryCalculationLimit, \
+                                               const int & detailLevel)
+{
+    std::vector<expectedLayerEmissionType> results;
+
+    this->calculateMultilayerFluorescence(elementList, elementsLibrary, layerList, familyList, \
+                                          workspace, 1, secondary, useGeometricEfficiency, \
+                                          useMassFractions, secondaryCalculationLimit, detailLevel, \
+                                          results);
+    return results[0];
+}
+
+std::vector<std::map<std::string, std::map<int, std::map<std::string, std::map<std::string, double> > > > > \
+                XRF::getMultiDetectorFluorescence(const std::vector<std::string> & elementFamilyLayer, \
+                                                  const Elements & elementsLibrary, \
+                                                  const int & secondary, \
+                                                  const int & useGeometricEfficiency, \
+                                                  const int & useMassFractions, \
+                                                  const double & secondaryCalculationLimit, \
+                                                  const int & detailLevel)
+{
+    std::vector<std::string> elementList;
+    std::vector<std::string> familyList;
+    std::vector<int> layerList;
+    MultilayerWorkspace workspace;
+    std::vector<expectedLayerEmissionType> results;
+
+    XRF::parseElementFamilyLayer(elementFamilyLayer, elementList, familyList, layerList);
+    this->calculateMultilayerFluorescence(elementList, elementsLibrary, layerList, familyList, \
+                                          workspace, this->configuration.getNumberOfDetectors(), \
+                                          secondary, useGeometricEfficiency, useMassFractions, \
+                                          secondaryCalculationLimit, detailLevel, results);
+    return results;
+}
+
+void XRF::calculateMultilayerFluorescence(const std::vector<std::string> & elementList, \
+                                          const Elements & elementsLibrary, \
+                                          const std::vector<int> & layerList, \
+                                          const std::vector<std::string> & familyList, \
+                                          MultilayerWorkspace & workspace, \
+                                          const int & nDetectors, \
+                                          const int & secondary, \
+                                          const int & useGeometricEfficiency, \
+                                          const int & useMassFractions, \
+                                          const double & secondaryCalculationLimit, \
+                                          const int & detailLevel, \
+                                          std::vector<expectedLayerEmissionType> & actualResult)
 {
     // get all the needed configuration
-    const Beam & beam = this->configuration.getBeam();
-    std::vector<std::vector<double> >actualRays = beam.getBeamAsDoubleVectors();
+    const Beam & beam = this->getExcitationBeam(elementsLibrary);
+    std::vector<std::vector<double> > & actualRays = workspace.actualRays;
+    beam.getBeamAsDoubleVectors(actualRays);
     std::vector<double>::size_type iRay;
     const std::vector<Layer> & filters = this->configuration.getBeamFilters();;
     const std::vector<Layer> & sample = this->configuration.getSample();
-    const std::vector<Layer> & attenuators = this->configuration.getAttenuators();
     const Layer* layerPtr;
     std::vector<Layer>::size_type iLayer;
     std::vector<Layer>::size_type jLayer;
     std::vector<Layer>::size_type bLayer;
-    Detector detector = this->configuration.getDetector();
     std::string msg;
     const double PI = acos(-1.0);
     const double & alphaIn = this->configuration.getAlphaIn();
-    const double & alphaOut = this->configuration.getAlphaOut();
-    std::vector<double> geometricEfficiency;
     double sinAlphaIn = sin(alphaIn*(PI/180.));
-    double sinAlphaOut = sin(alphaOut*(PI/180.));
+    // everything depending on the outgoing path is evaluated for each detector
+    int iDetector;
+    std::vector<Detector> detectors;
+    std::vector<const std::vector<Layer> *> detectorAttenuators;
+    std::vector<double> alphaOut;
+    std::vector<double> sinAlphaOut;
+    std::vector<std::vector<double> > & geometricEfficiency = workspace.geometricEfficiency;
     double tmpDouble;
     const std::vector<double> & energies = actualRays[0];
-    std::vector<double> weights;
-    std::vector<double> doubleVector;
-    std::map<std::string, std::map<std::string, double> > result;
-    std::map<std::string, std::map<int, std::map<std::string, std::map<std::string, double> > > > actualResult;
-    std::vector<double> energyThresholdList;
+    std::vector<double> & weights = workspace.weights;
+    std::vector<double> & doubleVector = workspace.transmission;
+    std::vector<std::map<std::string, std::map<std::string, double> > > result;
+    std::vector<double> & energyThresholdList = workspace.energyThresholdList;
+    // the tertiary approximation needs the per source secondary contributions
+    bool keepSecondarySources;
+
+    if ((detailLevel < 0) || (detailLevel > 2))
+    {
+        throw std::invalid_argument("Detail level must be 0, 1 or 2");
+    }
+    keepSecondarySources = (detailLevel > 1) || (secondary > 1);
+    if ((nDetectors < 1) || (nDetectors > this->configuration.getNumberOfDetectors()))
+    {
+        throw std::invalid_argument("Invalid number of detectors");
+    }
+    for (iDetector = 0; iDetector < nDetectors; iDetector++)
+    {
+        detectors.push_back(this->configuration.getDetector(iDetector));
+        detectorAttenuators.push_back(&this->configuration.getAttenuators(iDetector));
+        alphaOut.push_back(this->configuration.getAlphaOut(iDetector));
+        sinAlphaOut.push_back(sin(alphaOut[iDetector]*(PI/180.)));
+    }
+    result.resize(nDetectors);
+    actualResult.clear();
+    actualResult.resize(nDetectors);
+
+    this->profile.reset();
+    FISX_PROFILE_START(totalTimer);
 
     energyThresholdList.clear();
     // beam is ordered
     // maxEnergy = energies[energies.size() - 1];
 
     // get the beam after the beam filters
-    std::vector<double> muTotal;
+    std::vector<double> & muTotal = workspace.muTotal;
     muTotal.resize(energies.size());
     doubleVector.resize(energies.size());
     std::fill(muTotal.begin(), muTotal.end(), 0.0);
+    FISX_PROFILE_START(filtersTimer);
     for (iLayer = 0; iLayer < filters.size(); iLayer++)
     {
-        doubleVector = filters[iLayer].getTransmission(energies, elementsLibrary);
+        filters[iLayer].getTransmission(energies, elementsLibrary, 90.0, doubleVector);
+        FISX_PROFILE_COUNT(this->profile, MASS_ATTENUATION_LOOKUPS, energies.size());
         for (iRay = 0; iRay < energies.size(); iRay++)
         {
             actualRays[1][iRay] *= doubleVector[iRay];
         }
     }
+    FISX_PROFILE_STOP(this->profile, BEAM_FILTERS, filtersTimer);
 
     // we can already calculate the geometric efficiency
-    geometricEfficiency.resize(sample.size());
-    if (useGeometricEfficiency != 0)
+    geometricEfficiency.resize(nDetectors);
+    for (iDetector = 0; iDetector < nDetectors; iDetector++)
     {
-        for (iLayer = 0; iLayer < sample.size(); iLayer++)
+        geometricEfficiency[iDetector].resize(sample.size());
+        if (useGeometricEfficiency != 0)
         {
-            geometricEfficiency[iLayer] = this->getGeometricEfficiency(iLayer);
+            for (iLayer = 0; iLayer < sample.size(); iLayer++)
+            {
+                geometricEfficiency[iDetector][iLayer] = this->getGeometricEfficiency(iLayer, iDetector);
+            }
         }
-    }
-    else
-    {
-        for (iLayer = 0; iLayer < sample.size(); iLayer++)
+        else
         {
-            geometricEfficiency[iLayer] = 1.0;
+            for (iLayer = 0; iLayer < sample.size(); iLayer++)
+            {
+                geometricEfficiency[iDetector][iLayer] = 1.0;
+            }
         }
     }
 
-    std::vector<std::vector<double> >sampleLayerEnergies;
-    std::vector<std::vector<std::string> > sampleLayerEnergyNames;
-    std::vector<std::vector<double> >sampleLayerRates;
-    std::vector<std::vector<double> >sampleLayerMuTotal;
+    std::vector<std::vector<double> > & sampleLayerEnergies = workspace.sampleLayerEnergies;
+    std::vector<std::vector<std::string> > & sampleLayerEnergyNames = workspace.sampleLayerEnergyNames;
+    std::vector<std::vector<double> > & sampleLayerRates = workspace.sampleLayerRates;
+    std::vector<std::vector<double> > & sampleLayerMuTotal = workspace.sampleLayerMuTotal;
+    // [jLayer][bLayer][iLambda] total mass attenuation of bLayer at the energy iLambda emitted by jLayer
+    std::vector<std::vector<std::vector<double> > > & sampleLayerMuMatrix = workspace.sampleLayerMuMatrix;
+    // [jLayer][bLayer][iLambda] sum of density * thickness * mu of the layers above bLayer at that energy
+    std::vector<std::vector<std::vector<double> > > & sampleLayerAttenuationSum = \
+                                                                workspace.sampleLayerAttenuationSum;
+    std::map<std::string, std::vector<double> > & muMap = workspace.muMap;
     std::map<std::string, double> sampleLayerComposition;
     std::vector<double>::size_type iLambda;
-    std::vector<std::string> sampleLayerFamilies;
-    std::vector<std::vector<std::pair<std::string, double> > >sampleLayerPeakFamilies;
+    std::vector<std::string> & sampleLayerFamilies = workspace.sampleLayerFamilies;
+    std::vector<std::vector<std::pair<std::string, double> > > & sampleLayerPeakFamilies = \
+                                                                workspace.sampleLayerPeakFamilies;
     std::vector<std::pair<std::string, double> >::size_type iPeakFamily;
-    std::vector<double> sampleLayerDensity;
-    std::vector<double> sampleLayerThickness;
-    std::vector<double> sampleLayerWeight;
+    std::vector<double> & sampleLayerDensity = workspace.sampleLayerDensity;
+    std::vector<double> & sampleLayerThickness = workspace.sampleLayerThickness;
+    std::vector<double> & sampleLayerWeight = workspace.sampleLayerWeight;
     std::map< std::string, std::map<std::string, double> > escapeRates;
 
     // * implement a cache
     std::map< std::string, std::map< double, std::map<std::string, std::map<std::string, double> > > > \
                                         excitationFactorsCache;
 
-    int updateEscape;
-    updateEscape = 1;
+    // energy thresholds of the K, L and M families of the elements requested without family
+    std::map<std::string, std::map<std::string, double> > familyThresholdCache;
+
+    // each detector keeps its own escape cache
+    std::vector<int> updateEscape(nDetectors, 1);
 
     sampleLayerEnergies.resize(sample.size());
     sampleLayerEnergyNames.resize(sample.size());
@@ -108,6 +217,8 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
     sampleLayerFamilies.resize(sample.size());
     sampleLayerPeakFamilies.resize(sample.size());
     sampleLayerMuTotal.resize(sample.size());
+    sampleLayerMuMatrix.resize(sample.size());
+    sampleLayerAttenuationSum.resize(sample.size());
     sampleLayerDensity.resize(sample.size());
     sampleLayerThickness.resize(sample.size());
     sampleLayerWeight.resize(sample.size());
@@ -137,6 +248,7 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
             continue;
         }
         weights[iRay] = actualRays[1][iRay];
+        FISX_PROFILE_START(attenuationTimer);
         tmpDouble = 0.0;
         for(iLayer = 0; iLayer < sample.size(); iLayer++)
         {
@@ -155,6 +267,8 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
             tmpDouble += sampleLayerDensity[iLayer] * sampleLayerThickness[iLayer] *\
                          muTotal[iLayer]/sinAlphaIn;
         }
+        FISX_PROFILE_COUNT(this->profile, MASS_ATTENUATION_LOOKUPS, sample.size());
+        FISX_PROFILE_STOP(this->profile, LAYER_ATTENUATION, attenuationTimer);
 
         if (secondary > 0)
         {
@@ -166,6 +280,7 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
                 sampleLayerRates[iLayer].clear();
                 sampleLayerFamilies[iLayer].clear();
                 sampleLayerMuTotal[iLayer].clear();
+                FISX_PROFILE_START(peakFamiliesTimer);
                 layerPtr = &sample[iLayer];
                 sampleLayerPeakFamilies[iLayer] = (*layerPtr).getPeakFamilies(energies[iRay], elementsLibrary);
                 // They are ordered by increasing increasing binding energy
@@ -188,6 +303,7 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
                     tmpResult = elementsLibrary.getExcitationFactors(ele, \
                                                                      energies[iRay], \
                                                                      weights[iRay] * sampleLayerWeight[iLayer]);
+                    FISX_PROFILE_COUNT(this->profile, EXCITATION_FACTORS, 1);
                     // and add the energies and rates to the sampleLayerLines
                     for (c_it = tmpResult.begin(); c_it != tmpResult.end(); ++c_it)
                     {
@@ -215,16 +331,56 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
                 // incident beam
                 sampleLayerEnergyNames[iLayer].push_back("coherent scattering");
                 sampleLayerEnergies[iLayer].push_back(energies[iRay]);
+                FISX_PROFILE_STOP(this->profile, PEAK_FAMILIES, peakFamiliesTimer);
                 // calculate sample mu total at all those energies
-                std::map<std::string, std::vector<double> > tmpStringDoubleVecMap;
-                tmpStringDoubleVecMap = (*layerPtr).getMassAttenuationCoefficients( \
-                                                                sampleLayerEnergies[iLayer], \
-                                                                elementsLibrary);
-                sampleLayerMuTotal[iLayer] = tmpStringDoubleVecMap["total"];
+                FISX_PROFILE_START(sourcesAttenuationTimer);
+                (*layerPtr).getMassAttenuationCoefficients(sampleLayerEnergies[iLayer], \
+                                                           elementsLibrary, muMap);
+                FISX_PROFILE_COUNT(this->profile, MASS_ATTENUATION_LOOKUPS, sampleLayerEnergies[iLayer].size());
+                FISX_PROFILE_STOP(this->profile, LAYER_ATTENUATION, sourcesAttenuationTimer);
+                sampleLayerMuTotal[iLayer] = muMap["total"];
 
                 sampleLayerRates[iLayer].push_back((weights[iRay] * sampleLayerWeight[iLayer])*\
-                      tmpStringDoubleVecMap["coherent"].back() / tmpStringDoubleVecMap["total"].back());
+                      muMap["coherent"].back() / muMap["total"].back());
             }
+            // the interlayer terms need the attenuation of every layer at the energies emitted by the
+            // other layers. Evaluate them once per ray instead of once per element, line and layer pair.
+            FISX_PROFILE_START(matrixTimer);
+            if (sample.size() > 1)
+            {
+                for (jLayer = 0; jLayer < sample.size(); jLayer++)
+                {
+                    sampleLayerMuMatrix[jLayer].resize(sample.size());
+                    sampleLayerAttenuationSum[jLayer].resize(sample.size() + 1);
+                    sampleLayerAttenuationSum[jLayer][0].resize(sampleLayerEnergies[jLayer].size());
+                    std::fill(sampleLayerAttenuationSum[jLayer][0].begin(), \
+                              sampleLayerAttenuationSum[jLayer][0].end(), 0.0);
+                    for (bLayer = 0; bLayer < sample.size(); bLayer++)
+                    {
+                        if (bLayer == jLayer)
+                        {
+                            sampleLayerMuMatrix[jLayer][bLayer] = sampleLayerMuTotal[jLayer];
+                        }
+                        else
+                        {
+                            sample[bLayer].getMassAttenuationCoefficients(sampleLayerEnergies[jLayer], \
+                                                                          elementsLibrary, muMap);
+                            sampleLayerMuMatrix[jLayer][bLayer] = muMap["total"];
+                            FISX_PROFILE_COUNT(this->profile, MASS_ATTENUATION_LOOKUPS, \
+                                               sampleLayerEnergies[jLayer].size());
+                        }
+                        sampleLayerAttenuationSum[jLayer][bLayer + 1].resize(sampleLayerEnergies[jLayer].size());
+                        for (iLambda = 0; iLambda < sampleLayerEnergies[jLayer].size(); iLambda++)
+                        {
+                            sampleLayerAttenuationSum[jLayer][bLayer + 1][iLambda] = \
+                                    sampleLayerAttenuationSum[jLayer][bLayer][iLambda] + \
+                                    sampleLayerDensity[bLayer] * sampleLayerThickness[bLayer] * \
+                                    sampleLayerMuMatrix[jLayer][bLayer][iLambda];
+                        }
+                    }
+                }
+            }
+            FISX_PROFILE_STOP(this->profile, LAYER_ATTENUATION, matrixTimer);
         }
         // we start calculation
         // mu_1_lambda = Mass attenuation coefficient of iLayer at incident energy
@@ -261,7 +417,9 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
         std::map<std::string, double> muTotalFluo;
         double detectionEfficiency;
         double energy;
+        double lineEnergyThreshold;
         std::string key;
+        std::string lineKey;
         std::string tmpString;
         std::ostringstream tmpStringStream;
         for (std::vector<std::string>::size_type iElement = 0; iElement < elementList.size(); iElement++)
@@ -269,6 +427,7 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
             const std::string & elementName = elementList[iElement];
             const std::string & lineFamily = familyList[iElement];
             int calculationLayer;
+            bool allFamilies;
             std::string actualLineFamily;
             if (layerList.size() > 1)
                 calculationLayer = layerList[iElement];
@@ -284,9 +443,18 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
                 // carefull, the actual condition is to start by K and not to be followed by L
                 actualLineFamily = "KM";
             }
-            if (actualLineFamily == "")
+            // without family all the excited K, L and M lines are calculated in one go, sharing
+            // the excitation factors and the secondary sources. Each line is then reported under
+            // its own "Element Family" key.
+            allFamilies = (actualLineFamily == "");
+            if (allFamilies && (familyThresholdCache.find(elementName) == familyThresholdCache.end()))
             {
-                throw std::runtime_error("All line families case not implemented yet!!!");
+                familyThresholdCache[elementName]["K"] = this->getEnergyThreshold(elementName, "K", \
+                                                                                  elementsLibrary);
+                familyThresholdCache[elementName]["L"] = this->getEnergyThreshold(elementName, "L", \
+                                                                                  elementsLibrary);
+                familyThresholdCache[elementName]["M"] = this->getEnergyThreshold(elementName, "M", \
+                                                                                  elementsLibrary);
             }
             if (iElement < energyThresholdList.size())
             {
@@ -304,9 +472,12 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
             {
                 continue;
             }
+            FISX_PROFILE_START(primaryFactorsTimer);
             primaryExcitationFactors = elementsLibrary.getExcitationFactors(elementName, \
                                                                         energies[iRay], \
                                                                         weights[iRay]);
+            FISX_PROFILE_COUNT(this->profile, EXCITATION_FACTORS, 1);
+            FISX_PROFILE_STOP(this->profile, PRIMARY, primaryFactorsTimer);
             for (iLayer = 0; iLayer < sample.size(); iLayer++)
             {
                 double elementMassFractionFactor;
@@ -338,7 +509,10 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
                 // here I should loop for all elements and families
                 key = elementName + " " + lineFamily;
                 // we need to calculate the layer mass attenuation coefficients at the fluorescent energies
-                result.clear();
+                for (iDetector = 0; iDetector < nDetectors; iDetector++)
+                {
+                    result[iDetector].clear();
+                }
                 if (elementMassFractionFactor == 0.0)
                     continue;
                 for (c_it = primaryExcitationFactors.begin(); c_it != primaryExcitationFactors.end(); ++c_it)
@@ -349,7 +523,7 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
                         mapIt = c_it->second.find("factor");
                         if (mapIt == c_it->second.end())
                         {
-                            std::cout << "Key <factor> not found in excitation factor" << std::endl;
+                            throw std::runtime_error("Key <factor> not found in excitation factor");
                         }
                         if (mapIt->second <= 0.0)
                         {
@@ -358,97 +532,142 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
                         }
                         mapIt = c_it->second.find("energy");
                         energy = mapIt->second;
-                        result[c_it->first]["energy"] = energy;
-                        mapIt = c_it->second.find("rate");
-                        result[c_it->first]["rate"] = mapIt->second;
-                        mapIt = c_it->second.find("factor");
-                        result[c_it->first]["factor"] = mapIt->second;
-                        if (actualResult[key][iLayer].find(c_it->first) == actualResult[key][iLayer].end())
+                        for (iDetector = 0; iDetector < nDetectors; iDetector++)
+                        {
+                            result[iDetector][c_it->first]["energy"] = energy;
+                            mapIt = c_it->second.find("rate");
+                            result[iDetector][c_it->first]["rate"] = mapIt->second;
+                            mapIt = c_it->second.find("factor");
+                            result[iDetector][c_it->first]["factor"] = mapIt->second;
+                        }
+                        if (allFamilies)
+                        {
+                            lineKey = elementName + " " + c_it->first.substr(0, 1);
+                        }
+                        else
+                        {
+                            lineKey = key;
+                        }
+                        if (actualResult[0][lineKey][iLayer].find(c_it->first) == actualResult[0][lineKey][iLayer].end())
                         {
                             // calculate layer mu total at fluorescent energy
+                            FISX_PROFILE_START(efficiencyTimer);
                             // std::cout << "CALCULATING mu_1_i for " << c_it->first << " ";
                             // std::cout << "energy " << energy;
-                            result[c_it->first]["mu_1_i"] = \
-                                    sample[iLayer].getMassAttenuationCoefficients(energy, \
-                                                                                elementsLibrary) ["total"];
-                            // calculate detection efficiency of fluorescent energy
-                            detectionEfficiency = 1.0;
-                            // transmission through upper layers
-                            jLayer = iLayer;
-                            while (jLayer > 0)
+                            mu_1_i = sample[iLayer].getMassAttenuationCoefficients(energy, \
+                                                                                   elementsLibrary) ["total"];
+                            FISX_PROFILE_COUNT(this->profile, MASS_ATTENUATION_LOOKUPS, 1);
+                            if (allFamilies)
                             {
-                                jLayer--;
-                                layerPtr = &sample[jLayer];
-                                detectionEfficiency *= (*layerPtr).getTransmission(energy, \
-                                                                                   elementsLibrary, \
-                                                                                   alphaOut);
+                                lineEnergyThreshold = familyThresholdCache[elementName][c_it->first.substr(0, 1)];
                             }
-                            // transmission through attenuators
-                            for (jLayer = 0; jLayer < attenuators.size(); jLayer++)
+                            else
                             {
-                                layerPtr = &attenuators[jLayer];
-                                detectionEfficiency *= (*layerPtr).getTransmission(energy, \
-                                                                                   elementsLibrary, \
-                                                                                   90.0);
+                                lineEnergyThreshold = energyThreshold;
                             }
+                            for (iDetector = 0; iDetector < nDetectors; iDetector++)
+                            {
+                                const Detector & detector = detectors[iDetector];
+                                const std::vector<Layer> & attenuators = *detectorAttenuators[iDetector];
+                                // calculate detection efficiency of fluorescent energy
+                                detectionEfficiency = 1.0;
+                                // transmission through upper layers
+                                jLayer = iLayer;
+                                while (jLayer > 0)
+                                {
+                                    jLayer--;
+                                    layerPtr = &sample[jLayer];
+                                    detectionEfficiency *= (*layerPtr).getTransmission(energy, \
+                                                                                       elementsLibrary, \
+                                                                                       alphaOut[iDetector]);
+                                }
+                                // transmission through attenuators
+                                for (jLayer = 0; jLayer < attenuators.size(); jLayer++)
+                                {
+                                    layerPtr = &attenuators[jLayer];
+                                    detectionEfficiency *= (*layerPtr).getTransmission(energy, \
+                                                                                       elementsLibrary, \
+                                                                                       90.0);
+                                }
 
-                            // detection efficiency decomposed in geometric and intrinsic
-                            detectionEfficiency *= geometricEfficiency[iLayer];
+                                // detection efficiency decomposed in geometric and intrinsic
+                                detectionEfficiency *= geometricEfficiency[iDetector][iLayer];
 
-                            if (detector.hasMaterialComposition() || (detector.getMaterialName().size() > 0 ))
-                            {
-                                if ((detector.getDensity() > 0.0) && (detector.getThickness() > 0.0))
+                                if (detector.hasMaterialComposition() || (detector.getMaterialName().size() > 0 ))
                                 {
-                                    // calculate intrinsic efficiency
-                                    // assuming normal incidence on detector surface
-                                    detectionEfficiency *= (1.0 - detector.getTransmission(energy, \
-                                                                                elementsLibrary, \
-                                                                                90.0));
+                                    if ((detector.getDensity() > 0.0) && (detector.getThickness() > 0.0))
+                                    {
+                                        // calculate intrinsic efficiency
+                                        // assuming normal incidence on detector surface
+                                        detectionEfficiency *= (1.0 - detector.getTransmission(energy, \
+                                                                                    elementsLibrary, \
+                                                                                    90.0));
+                                        FISX_PROFILE_COUNT(this->profile, MASS_ATTENUATION_LOOKUPS, 1);
+                                    }
                                 }
-                                // calculate escape ratio assuming normal incidence on detector surface
-                                escapeRates = detector.getEscape(energy, \
-                                                                 elementsLibrary, \
-                                                                 c_it->first, \
-                                                                 updateEscape);
-                                updateEscape = 0;
-                            }
+                                FISX_PROFILE_COUNT(this->profile, MASS_ATTENUATION_LOOKUPS, \
+                                                   iLayer + attenuators.size());
 
+                                result[iDetector][c_it->first]["mu_1_i"] = mu_1_i;
+                                result[iDetector][c_it->first]["energy_threshold"] = lineEnergyThreshold;
+                                result[iDetector][c_it->first]["efficiency"] = detectionEfficiency;
+                                actualResult[iDetector][lineKey][iLayer][c_it->first]["efficiency"] = detectionEfficiency;
+                                actualResult[iDetector][lineKey][iLayer][c_it->first]["energy"] = energy;
+                                actualResult[iDetector][lineKey][iLayer][c_it->first]["energy_threshold"] = \
+                                                                                        lineEnergyThreshold;
+                                actualResult[iDetector][lineKey][iLayer][c_it->first]["mu_1_i"] = mu_1_i;
+                                actualResult[iDetector][lineKey][iLayer][c_it->first]["rate"] = 0.0;
+                                actualResult[iDetector][lineKey][iLayer][c_it->first]["primary"] = 0.0;
+                                actualResult[iDetector][lineKey][iLayer][c_it->first]["secondary"] = 0.0;
+                            }
+                            FISX_PROFILE_STOP(this->profile, DETECTOR_EFFICIENCY, efficiencyTimer);
 
-                            result[c_it->first]["energy_threshold"] = energyThreshold;
-                            result[c_it->first]["efficiency"] = detectionEfficiency;
-                            actualResult[key][iLayer][c_it->first]["efficiency"] = detectionEfficiency;
-                            actualResult[key][iLayer][c_it->first]["energy"] = energy;
-                            actualResult[key][iLayer][c_it->first]["energy_threshold"] = energyThreshold;
-                            actualResult[key][iLayer][c_it->first]["mu_1_i"] = result[c_it->first]["mu_1_i"];
-                            actualResult[key][iLayer][c_it->first]["rate"] = 0.0;
-                            actualResult[key][iLayer][c_it->first]["primary"] = 0.0;
-                            actualResult[key][iLayer][c_it->first]["secondary"] = 0.0;
+                            for (iDetector = 0; iDetector < nDetectors; iDetector++)
+                            {
+                                Detector & detector = detectors[iDetector];
+                                if (detector.hasMaterialComposition() || (detector.getMaterialName().size() > 0 ))
+                                {
+                                    // calculate escape ratio assuming normal incidence on detector surface
+                                    FISX_PROFILE_START(escapeTimer);
+                                    escapeRates = detector.getEscape(energy, \
+                                                                     elementsLibrary, \
+                                                                     c_it->first, \
+                                                                     updateEscape[iDetector]);
+                                    updateEscape[iDetector] = 0;
+                                    FISX_PROFILE_STOP(this->profile, ESCAPE, escapeTimer);
+                                }
+                            }
                         }
                         else
                         {
                             // std::cout << "USING mu_1_i for " << c_it->first << " ";
                             // std::cout << "energy " << energy;
-                            result[c_it->first]["efficiency"] = \
-                                        actualResult[key][iLayer][c_it->first]["efficiency"];
-                            result[c_it->first]["energy"] = actualResult[key][iLayer][c_it->first]["energy"];
-                            result[c_it->first]["energy_threshold"] = \
-                                                    actualResult[key][iLayer][c_it->first]["energy_threshold"];
-                            result[c_it->first]["mu_1_i"] = actualResult[key][iLayer][c_it->first]["mu_1_i"];
+                            for (iDetector = 0; iDetector < nDetectors; iDetector++)
+                            {
+                                std::map<std::string, double> & previous = \
+                                                        actualResult[iDetector][lineKey][iLayer][c_it->first];
+                                result[iDetector][c_it->first]["efficiency"] = previous["efficiency"];
+                                result[iDetector][c_it->first]["energy"] = previous["energy"];
+                                result[iDetector][c_it->first]["energy_threshold"] = previous["energy_threshold"];
+                                result[iDetector][c_it->first]["mu_1_i"] = previous["mu_1_i"];
+                            }
                         }
                     }
                 }
-                if (result.size() == 0)
+                if (result[0].size() == 0)
                 {
                     // no need to calculate anything
                     continue;
                 }
                 // primary
+                FISX_PROFILE_START(primaryTimer);
                 mu_1_lambda = sample[iLayer].getMassAttenuationCoefficients( \
                                                                 energies[iRay], \
                                                                 elementsLibrary)["total"];
+                FISX_PROFILE_COUNT(this->profile, MASS_ATTENUATION_LOOKUPS, 1);
                 density_1 = sample[iLayer].getDensity();
                 thickness_1 = sample[iLayer].getThickness();
-                for (c_it = result.begin(); c_it != result.end(); ++c_it)
+                for (c_it = result[0].begin(); c_it != result[0].end(); ++c_it)
                 {
                     mapIt = c_it->second.find("mu_1_i");
                     if (mapIt == c_it->second.end())
@@ -456,39 +675,44 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
                         throw std::runtime_error("Mass attenuation coefficient not calculated!!!");
                     }
                     mu_1_i = mapIt->second;
-                    tmpDouble = (mu_1_lambda / sinAlphaIn) + (mu_1_i / sinAlphaOut);
-                    // keep factor for deciding if secondary excitation is to be considered or not
-                    tmpDouble = (1.0 - exp( - tmpDouble * density_1 * thickness_1)) / tmpDouble;
-                    //result[c_it->first]["criterium"] = tmpDouble;
-                    tmpDouble *= (elementMassFractionFactor / sinAlphaIn);
-                    result[c_it->first]["primary"] = tmpDouble * \
-                                                     primaryExcitationFactors[c_it->first]["rate"] * \
-                                                     sampleLayerWeight[iLayer];
-                    result[c_it->first]["rate"] = result[c_it->first]["primary"] * \
-                                                  result[c_it->first]["efficiency"];
-                    result[c_it->first]["secondary"] = 0.0;
+                    for (iDetector = 0; iDetector < nDetectors; iDetector++)
+                    {
+                        tmpDouble = (mu_1_lambda / sinAlphaIn) + (mu_1_i / sinAlphaOut[iDetector]);
+                        // keep factor for deciding if secondary excitation is to be considered or not
+                        tmpDouble = (1.0 - exp( - tmpDouble * density_1 * thickness_1)) / tmpDouble;
+                        //result[c_it->first]["criterium"] = tmpDouble;
+                        tmpDouble *= (elementMassFractionFactor / sinAlphaIn);
+                        result[iDetector][c_it->first]["primary"] = tmpDouble * \
+                                                         primaryExcitationFactors[c_it->first]["rate"] * \
+                                                         sampleLayerWeight[iLayer];
+                        result[iDetector][c_it->first]["rate"] = result[iDetector][c_it->first]["primary"] * \
+                                                      result[iDetector][c_it->first]["efficiency"];
+                        result[iDetector][c_it->first]["secondary"] = 0.0;
+                    }
                     //std::cout << c_it->first << "efficiency = " << result[c_it->first]["efficiency"] << std::endl;
                     //std::cout << c_it->first << "primary = " << result[c_it->first]["primary"] << std::endl;
                     //std::cout << c_it->first << "energy = " << result[c_it->first]["energy"] << std::endl;
                     //std::cout << c_it->first << "mu_1_i = " << result[c_it->first]["mu_1_i"] << std::endl;
                     if (false && (c_it->first == "KL2") && (iLayer == 0))
                     {
-                        std::cout << c_it->first << "efficiency = " << result[c_it->first]["efficiency"] << std::endl;
-                        std::cout << c_it->first << "primary = " << result[c_it->first]["primary"] << std::endl;
-                        std::cout << c_it->first << "sampleLayerWeight = " << sampleLayerWeight[iLayer] << std::endl;
-                        std::cout << c_it->first << "Excitation E = " << energies[iRay] << std::endl;
-                        std::cout << c_it->first << "FLuoresnce E = " << result[c_it->first]["energy"] << std::endl;
-                        std::cout << c_it->first << "mu_1_i = " << mu_1_i << std::endl;
-                        std::cout << c_it->first << "mu_1_lambda = " << mu_1_lambda<< std::endl;
-                        std::cout << c_it->first << "d * t = " << density_1 * thickness_1 << std::endl;
-                        std::cout << c_it->first << "mu_1_lambda/sinALphain = " << mu_1_lambda / sinAlphaIn<< std::endl;
-                        std::cout << c_it->first << "mu_1_i/sinALphaOut = " << mu_1_i / sinAlphaOut<< std::endl;
+                        FISX_LOG_DEBUG("XRF::getMultilayerFluorescence", c_it->first << \
+                            " efficiency = " << result[0][c_it->first]["efficiency"] << \
+                            " primary = " << result[0][c_it->first]["primary"] << \
+                            " sampleLayerWeight = " << sampleLayerWeight[iLayer] << \
+                            " excitation energy = " << energies[iRay] << \
+                            " fluorescence energy = " << result[0][c_it->first]["energy"] << \
+                            " mu_1_i = " << mu_1_i << " mu_1_lambda = " << mu_1_lambda << \
+                            " d * t = " << density_1 * thickness_1 << \
+                            " mu_1_lambda/sinAlphaIn = " << mu_1_lambda / sinAlphaIn << \
+                            " mu_1_i/sinAlphaOut = " << mu_1_i / sinAlphaOut[0]);
                     }
                 }
+                FISX_PROFILE_STOP(this->profile, PRIMARY, primaryTimer);
 
                 if (secondary > 0)
                 {
                     // calculate secondary
+                    FISX_PROFILE_START(secondaryTimer);
                     for (jLayer = 0; jLayer < sample.size(); jLayer++)
                     {
                         if (iLayer == jLayer)
@@ -503,8 +727,10 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
                                 if (sampleLayerRates[jLayer][iLambda] < (secondaryCalculationLimit * sampleLayerWeight[iLayer]))
                                 {
                                     //std::cout << "Skipping due to weight " << std::endl;
+                                    FISX_PROFILE_COUNT(this->profile, SECONDARY_SOURCES_SKIPPED, 1);
                                     continue;
                                 }
+                                FISX_PROFILE_COUNT(this->profile, SECONDARY_SOURCES, 1);
                                 bool calculate;
                                 calculate = true;
                                 if (excitationFactorsCache.find(elementName) != excitationFactorsCache.end())
@@ -517,46 +743,75 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
                                 }
                                 if (calculate)
                                 {
+                                    FISX_PROFILE_COUNT(this->profile, EXCITATION_CACHE_MISSES, 1);
+                                    FISX_PROFILE_COUNT(this->profile, EXCITATION_FACTORS, 1);
                                     excitationFactorsCache[elementName] \
                                                 [sampleLayerEnergies[jLayer][iLambda]] = \
                                                         elementsLibrary.getExcitationFactors(elementName, \
                                                         sampleLayerEnergies[jLayer][iLambda], \
                                                         1.0);
                                 }
+                                else
+                                {
+                                    FISX_PROFILE_COUNT(this->profile, EXCITATION_CACHE_HITS, 1);
+                                }
                                 tmpExcitationFactors = excitationFactorsCache[elementName] \
                                                         [sampleLayerEnergies[jLayer][iLambda]];
-                                for (c_it = result.begin(); c_it != result.end(); ++c_it)
+                                for (c_it = result[0].begin(); c_it != result[0].end(); ++c_it)
                                 {
                                     if (tmpExcitationFactors.find(c_it->first) == tmpExcitationFactors.end())
                                     {
                                         continue;
                                     }
-                                    mapIt = result[c_it->first].find("mu_1_i");
-                                    if (mapIt == result[c_it->first].end())
+                                    if (allFamilies && (result[0][c_it->first]["energy_threshold"] > \
+                                                        sampleLayerEnergies[jLayer][iLambda]))
+                                    {
+                                        continue;
+                                    }
+                                    mapIt = result[0][c_it->first].find("mu_1_i");
+                                    if (mapIt == result[0][c_it->first].end())
                                         throw std::runtime_error(" mu_1_i key. Mass attenuation not present???");
                                     mu_1_i = mapIt->second;
-                                    tmpDouble = Math::deBoerL0(mu_1_lambda / sinAlphaIn,
-                                                               mu_1_i / sinAlphaOut,
-                                                               sampleLayerMuTotal[jLayer][iLambda],
-                                                               density_1,
-                                                               thickness_1);
-                                    tmpDouble += Math::deBoerL0(mu_1_i / sinAlphaOut,
-                                                               mu_1_lambda / sinAlphaIn,
-                                                               sampleLayerMuTotal[jLayer][iLambda],
-                                                               density_1,
-                                                               thickness_1);
-                                    tmpDouble *= elementMassFractionFactor * (0.5/sinAlphaIn);
-                                    tmpDouble *= tmpExcitationFactors[c_it->first]["rate"] * \
-                                                    sampleLayerRates[jLayer][iLambda];
-                                    tmpStringStream.str(std::string());
-                                    tmpStringStream.clear();
-                                    tmpStringStream << std::setfill('0') << std::setw(2) << jLayer;
-                                    tmpString = sampleLayerEnergyNames[jLayer][iLambda] + " " + tmpStringStream.str();
-                                    actualResult[elementName + " " + lineFamily][iLayer][c_it->first][tmpString] = \
-                                                                                                    tmpDouble;
-                                    result[c_it->first]["secondary"] += tmpDouble;
-                                    result[c_it->first]["rate"] += tmpDouble * \
-                                                                   result[c_it->first]["efficiency"];
+                                    if (keepSecondarySources)
+                                    {
+                                        tmpStringStream.str(std::string());
+                                        tmpStringStream.clear();
+                                        tmpStringStream << std::setfill('0') << std::setw(2) << jLayer;
+                                        tmpString = sampleLayerEnergyNames[jLayer][iLambda] + " " + \
+                                                    tmpStringStream.str();
+                                        if (allFamilies)
+                                        {
+                                            lineKey = elementName + " " + c_it->first.substr(0, 1);
+                                        }
+                                        else
+                                        {
+                                            lineKey = key;
+                                        }
+                                    }
+                                    for (iDetector = 0; iDetector < nDetectors; iDetector++)
+                                    {
+                                        FISX_PROFILE_COUNT(this->profile, DEBOER_CALLS, 2);
+                                        tmpDouble = Math::deBoerL0(mu_1_lambda / sinAlphaIn,
+                                                                   mu_1_i / sinAlphaOut[iDetector],
+                                                                   sampleLayerMuTotal[jLayer][iLambda],
+                                                                   density_1,
+                                                                   thickness_1);
+                                        tmpDouble += Math::deBoerL0(mu_1_i / sinAlphaOut[iDetector],
+                                                                   mu_1_lambda / sinAlphaIn,
+                                                                   sampleLayerMuTotal[jLayer][iLambda],
+                                                                   density_1,
+                                                                   thickness_1);
+                                        tmpDouble *= elementMassFractionFactor * (0.5/sinAlphaIn);
+                                        tmpDouble *= tmpExcitationFactors[c_it->first]["rate"] * \
+                                                        sampleLayerRates[jLayer][iLambda];
+                                        if (keepSecondarySources)
+                                        {
+                                            actualResult[iDetector][lineKey][iLayer][c_it->first][tmpString] = tmpDouble;
+                                        }
+                                        result[iDetector][c_it->first]["secondary"] += tmpDouble;
+                                        result[iDetector][c_it->first]["rate"] += tmpDouble * \
+                                                                       result[iDetector][c_it->first]["efficiency"];
+                                    }
                                 }
                             }
                         }
@@ -581,8 +836,10 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
                                     if (sampleLayerRates[jLayer][iLambda] < (secondaryCalculationLimit * sampleLayerWeight[iLayer]))
                                     {
                                         //std::cout << "Skipping due to weight " << std::endl;
+                                        FISX_PROFILE_COUNT(this->profile, SECONDARY_SOURCES_SKIPPED, 1);
                                         continue;
                                     }
+                                    FISX_PROFILE_COUNT(this->profile, SECONDARY_SOURCES, 1);
                                     bool calculate;
                                     calculate = true;
                                     if (excitationFactorsCache.find(elementName) != excitationFactorsCache.end())
@@ -595,15 +852,21 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
                                     }
                                     if (calculate)
                                     {
+                                        FISX_PROFILE_COUNT(this->profile, EXCITATION_CACHE_MISSES, 1);
+                                        FISX_PROFILE_COUNT(this->profile, EXCITATION_FACTORS, 1);
                                         excitationFactorsCache[elementName] \
                                                     [sampleLayerEnergies[jLayer][iLambda]] = \
                                                             elementsLibrary.getExcitationFactors(elementName, \
                                                             sampleLayerEnergies[jLayer][iLambda], \
                                                             1.0);
                                     }
+                                    else
+                                    {
+                                        FISX_PROFILE_COUNT(this->profile, EXCITATION_CACHE_HITS, 1);
+                                    }
                                     tmpExcitationFactors = excitationFactorsCache[elementName] \
                                                             [sampleLayerEnergies[jLayer][iLambda]];
-                                    for (c_it = result.begin(); c_it != result.end(); ++c_it)
+                                    for (c_it = result[0].begin(); c_it != result[0].end(); ++c_it)
                                     {
                                         if (tmpExcitationFactors.find(c_it->first) == tmpExcitationFactors.end())
                                         {
@@ -617,46 +880,59 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
                                         {
                                             continue;
                                         }
-                                        mapIt = result[c_it->first].find("mu_1_i");
-                                        if (mapIt == result[c_it->first].end())
+                                        if (allFamilies && (result[0][c_it->first]["energy_threshold"] > energy))
+                                        {
+                                            continue;
+                                        }
+                                        mapIt = result[0][c_it->first].find("mu_1_i");
+                                        if (mapIt == result[0][c_it->first].end())
                                             throw std::runtime_error(" mu_1_i key. Mass attenuation not present???");
                                         mu_1_i = mapIt->second;
-                                        mu_1_j = \
-                                            sample[iLayer].getMassAttenuationCoefficients(energy, \
-                                                                                elementsLibrary)["total"];
+                                        mu_1_j = sampleLayerMuMatrix[jLayer][iLayer][iLambda];
                                         mu_2_j = sampleLayerMuTotal[jLayer][iLambda];
-                                        bLayer = iLayer + 1;
-                                        mu_b_j_d_t = 0.0;
-                                        while (bLayer < jLayer)
+                                        // layers between iLayer and jLayer
+                                        mu_b_j_d_t = sampleLayerAttenuationSum[jLayer][jLayer][iLambda] - \
+                                                     sampleLayerAttenuationSum[jLayer][iLayer + 1][iLambda];
+                                        if (keepSecondarySources)
                                         {
-                                            mu_b_j_d_t += sampleLayerDensity[bLayer] * \
-                                                          sampleLayerThickness[bLayer] * \
-                                                          sample[bLayer].getMassAttenuationCoefficients(energy, \
-                                                                                    elementsLibrary)["total"];
-                                            bLayer++;
+                                            tmpStringStream.str(std::string());
+                                            tmpStringStream.clear();
+                                            tmpStringStream << std::setfill('0') << std::setw(2) << jLayer;
+                                            tmpString = sampleLayerEnergyNames[jLayer][iLambda] + " " + \
+                                                        tmpStringStream.str();
+                                            if (allFamilies)
+                                            {
+                                                lineKey = elementName + " " + c_it->first.substr(0, 1);
+                                            }
+                                            else
+                                            {
+                                                lineKey = key;
+                                            }
+                                        }
+                                        for (iDetector = 0; iDetector < nDetectors; iDetector++)
+                                        {
+                                            tmpDouble = std::exp(-mu_1_i * density_1 * thickness_1/sinAlphaOut[iDetector]);
+                                            if (tmpDouble < 0.001)
+                                                continue;
+                                            tmpDouble *= sampleLayerRates[jLayer][iLambda];
+                                            FISX_PROFILE_COUNT(this->profile, DEBOER_CALLS, 1);
+                                            tmpDouble *= Math::deBoerX(mu_2_lambda/sinAlphaIn, \
+                                                                      mu_1_i/sinAlphaOut[iDetector], \
+                                                                      density_1 * thickness_1, \
+                                                                      density_2 * thickness_2, \
+                                                                      mu_1_j, \
+                                                                      mu_2_j, \
+                                                                      mu_b_j_d_t);
+                                            tmpDouble *= elementMassFractionFactor * (0.5/sinAlphaIn);
+                                            tmpDouble *= tmpExcitationFactors[c_it->first]["rate"];
+                                            if (keepSecondarySources)
+                                            {
+                                                actualResult[iDetector][lineKey][iLayer][c_it->first][tmpString] = tmpDouble;
+                                            }
+                                            result[iDetector][c_it->first]["secondary"] += tmpDouble;
+                                            result[iDetector][c_it->first]["rate"] += tmpDouble * \
+                                                                       result[iDetector][c_it->first]["efficiency"];
                                         }
-                                        tmpDouble = std::exp(-mu_1_i * density_1 * thickness_1/sinAlphaOut);
-                                        if (tmpDouble < 0.001)
-                                            continue;
-                                        tmpDouble *= sampleLayerRates[jLayer][iLambda];
-                                        tmpDouble *= Math::deBoerX(mu_2_lambda/sinAlphaIn, \
-                                                                  mu_1_i/sinAlphaOut, \
-                                                                  density_1 * thickness_1, \
-                                                                  density_2 * thickness_2, \
-                                                                  mu_1_j, \
-                                                                  mu_2_j, \
-                                                                  mu_b_j_d_t);
-                                        tmpDouble *= elementMassFractionFactor * (0.5/sinAlphaIn);
-                                        tmpDouble *= tmpExcitationFactors[c_it->first]["rate"];
-                                        tmpStringStream.str(std::string());
-                                        tmpStringStream.clear();
-                                        tmpStringStream << std::setfill('0') << std::setw(2) << jLayer;
-                                        tmpString = sampleLayerEnergyNames[jLayer][iLambda] + " " + tmpStringStream.str();
-                                        actualResult[elementName + " " + lineFamily][iLayer][c_it->first][tmpString] = \
-                                                                                                        tmpDouble;
-                                        result[c_it->first]["secondary"] += tmpDouble;
-                                        result[c_it->first]["rate"] += tmpDouble * \
-                                                                       result[c_it->first]["efficiency"];
                                     }
                                 }
                             }
@@ -683,8 +959,10 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
                                     if (sampleLayerRates[jLayer][iLambda] < (secondaryCalculationLimit * sampleLayerWeight[iLayer]))
                                     {
                                         //std::cout << "Skipping due to weight " << std::endl;
+                                        FISX_PROFILE_COUNT(this->profile, SECONDARY_SOURCES_SKIPPED, 1);
                                         continue;
                                     }
+                                    FISX_PROFILE_COUNT(this->profile, SECONDARY_SOURCES, 1);
                                     bool calculate;
                                     calculate = true;
                                     if (excitationFactorsCache.find(elementName) != excitationFactorsCache.end())
@@ -697,15 +975,21 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
                                     }
                                     if (calculate)
                                     {
+                                        FISX_PROFILE_COUNT(this->profile, EXCITATION_CACHE_MISSES, 1);
+                                        FISX_PROFILE_COUNT(this->profile, EXCITATION_FACTORS, 1);
                                         excitationFactorsCache[elementName] \
                                                     [sampleLayerEnergies[jLayer][iLambda]] = \
                                                             elementsLibrary.getExcitationFactors(elementName, \
                                                             sampleLayerEnergies[jLayer][iLambda], \
                                                             1.0);
                                     }
+                                    else
+                                    {
+                                        FISX_PROFILE_COUNT(this->profile, EXCITATION_CACHE_HITS, 1);
+                                    }
                                     tmpExcitationFactors = excitationFactorsCache[elementName] \
                                                             [sampleLayerEnergies[jLayer][iLambda]];
-                                    for (c_it = result.begin(); c_it != result.end(); ++c_it)
+                                    for (c_it = result[0].begin(); c_it != result[0].end(); ++c_it)
                                     {
                                         if (tmpExcitationFactors.find(c_it->first) == tmpExcitationFactors.end())
                                         {
@@ -719,105 +1003,138 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
                                         {
                                             continue;
                                         }
-                                        mapIt = result[c_it->first].find("mu_1_i");
-                                        if (mapIt == result[c_it->first].end())
+                                        if (allFamilies && (result[0][c_it->first]["energy_threshold"] > energy))
+                                        {
+                                            continue;
+                                        }
+                                        mapIt = result[0][c_it->first].find("mu_1_i");
+                                        if (mapIt == result[0][c_it->first].end())
                                             throw std::runtime_error(" mu_1_i key. Mass attenuation not present???");
                                         mu_1_i = mapIt->second;
-                                        mu_1_j = \
-                                            sample[iLayer].getMassAttenuationCoefficients(energy, \
-                                                                                elementsLibrary)["total"];
+                                        mu_1_j = sampleLayerMuMatrix[jLayer][iLayer][iLambda];
                                         mu_2_j = sampleLayerMuTotal[jLayer][iLambda];
-                                        bLayer = jLayer + 1;
-                                        mu_b_j_d_t = 0.0;
-                                        while (bLayer < iLayer)
+                                        // layers between jLayer and iLayer
+                                        mu_b_j_d_t = sampleLayerAttenuationSum[jLayer][iLayer][iLambda] - \
+                                                     sampleLayerAttenuationSum[jLayer][jLayer + 1][iLambda];
+                                        if (keepSecondarySources)
                                         {
-                                            mu_b_j_d_t += sampleLayerDensity[bLayer] * \
-                                                          sampleLayerThickness[bLayer] * \
-                                                          sample[bLayer].getMassAttenuationCoefficients(energy, \
-                                                                                    elementsLibrary)["total"];
-                                            bLayer++;
+                                            tmpStringStream.str(std::string());
+                                            tmpStringStream.clear();
+                                            tmpStringStream << std::setfill('0') << std::setw(2) << jLayer;
+                                            tmpString = sampleLayerEnergyNames[jLayer][iLambda] + " " + \
+                                                        tmpStringStream.str();
+                                            if (allFamilies)
+                                            {
+                                                lineKey = elementName + " " + c_it->first.substr(0, 1);
+                                            }
+                                            else
+                                            {
+                                                lineKey = key;
+                                            }
+                                        }
+                                        for (iDetector = 0; iDetector < nDetectors; iDetector++)
+                                        {
+                                            tmpDouble = layerFactor * sampleLayerRates[jLayer][iLambda];
+                                            FISX_PROFILE_COUNT(this->profile, DEBOER_CALLS, 1);
+                                            tmpDouble *= Math::deBoerX(-mu_2_lambda/sinAlphaIn, \
+                                                                      -mu_1_i/sinAlphaOut[iDetector], \
+                                                                      density_1 * thickness_1, \
+                                                                      density_2 * thickness_2, \
+                                                                      mu_1_j, \
+                                                                      mu_2_j, \
+                                                                      mu_b_j_d_t);
+                                            tmpDouble *= elementMassFractionFactor * (0.5/sinAlphaIn);
+                                            tmpDouble *= tmpExcitationFactors[c_it->first]["rate"];
+                                            if (keepSecondarySources)
+                                            {
+                                                actualResult[iDetector][lineKey][iLayer][c_it->first][tmpString] = tmpDouble;
+                                            }
+                                            result[iDetector][c_it->first]["secondary"] += tmpDouble;
+                                            result[iDetector][c_it->first]["rate"] += tmpDouble * \
+                                                                       result[iDetector][c_it->first]["efficiency"];
                                         }
-                                        tmpDouble = layerFactor * sampleLayerRates[jLayer][iLambda];
-                                        tmpDouble *= Math::deBoerX(-mu_2_lambda/sinAlphaIn, \
-                                                                  -mu_1_i/sinAlphaOut, \
-                                                                  density_1 * thickness_1, \
-                                                                  density_2 * thickness_2, \
-                                                                  mu_1_j, \
-                                                                  mu_2_j, \
-                                                                  mu_b_j_d_t);
-                                        tmpDouble *= elementMassFractionFactor * (0.5/sinAlphaIn);
-                                        tmpDouble *= tmpExcitationFactors[c_it->first]["rate"];
-                                        tmpStringStream.str(std::string());
-                                        tmpStringStream.clear();
-                                        tmpStringStream << std::setfill('0') << std::setw(2) << jLayer;
-                                        tmpString = sampleLayerEnergyNames[jLayer][iLambda] + " " + tmpStringStream.str();
-                                        actualResult[elementName + " " + lineFamily][iLayer][c_it->first][tmpString] = \
-                                                                                                        tmpDouble;
-                                        result[c_it->first]["secondary"] += tmpDouble;
-                                        result[c_it->first]["rate"] += tmpDouble * \
-                                                                       result[c_it->first]["efficiency"];
                                     }
                                 }
                             }
                         }
                     }
+                    FISX_PROFILE_STOP(this->profile, SECONDARY, secondaryTimer);
                 }
 
                 // here we are done for the element and the layer
-                key = elementName + " " + lineFamily;
-                for (c_it = result.begin(); c_it != result.end(); ++c_it)
+                for (iDetector = 0; iDetector < nDetectors; iDetector++)
                 {
-                    double totalEscape = 0.0;
-                    if (detector.hasMaterialComposition() || (detector.getMaterialName().size() > 0 ))
+                    Detector & detector = detectors[iDetector];
+                    for (c_it = result[iDetector].begin(); c_it != result[iDetector].end(); ++c_it)
                     {
-                        // calculate (if needed) escape ratio
-                        escapeRates = detector.getEscape(energy, \
-                                                         elementsLibrary, \
-                                                         c_it->first, \
-                                                         updateEscape);
-                        if (escapeRates.size())
+                        double totalEscape = 0.0;
+                        if (allFamilies)
+                        {
+                            lineKey = elementName + " " + c_it->first.substr(0, 1);
+                        }
+                        else
+                        {
+                            lineKey = key;
+                        }
+                        std::map<std::string, std::map<std::string, double> > & layerResult = \
+                                                                        actualResult[iDetector][lineKey][iLayer];
+                        if (detector.hasMaterialComposition() || (detector.getMaterialName().size() > 0 ))
                         {
-                            updateEscape = 0;
-                            std::map<std::string, std::map<std::string, double> >::const_iterator c_it2;
-     //                       std::map<std::string, double>::const_iterator mapIt;
-                            for( c_it2 = escapeRates.begin(); c_it2!= escapeRates.end(); ++c_it2)
+                            // calculate (if needed) escape ratio
+                            FISX_PROFILE_START(escapeTimer);
+                            escapeRates = detector.getEscape(energy, \
+                                                             elementsLibrary, \
+                                                             c_it->first, \
+                                                             updateEscape[iDetector]);
+                            if (escapeRates.size())
                             {
-                                tmpString = c_it->first + " "+ c_it2->first;
-                                if (actualResult[key][iLayer].find(tmpString) == actualResult[key][iLayer].end())
+                                updateEscape[iDetector] = 0;
+                                std::map<std::string, std::map<std::string, double> >::const_iterator c_it2;
+                                for( c_it2 = escapeRates.begin(); c_it2!= escapeRates.end(); ++c_it2)
                                 {
-                                    mapIt = c_it2->second.find("energy");
+                                    tmpString = c_it->first + " "+ c_it2->first;
+                                    if (layerResult.find(tmpString) == layerResult.end())
+                                    {
+                                        mapIt = c_it2->second.find("energy");
+                                        if (mapIt == c_it2->second.end())
+                                        {
+                                            throw std::runtime_error("Missing energy key in escape peak information!");
+                                        }
+                                        layerResult[tmpString]["energy"] = mapIt->second;
+                                        layerResult[tmpString]["rate"] = 0.0;
+                                        layerResult[tmpString]["primary"] = 0.0;
+                                        layerResult[tmpString]["secondary"] = 0.0;
+                                    }
+                                    mapIt = c_it2->second.find("rate");
                                     if (mapIt == c_it2->second.end())
                                     {
-                                        throw std::runtime_error("Missing energy key in escape peak information!");
+                                        throw std::runtime_error("Missing rate key in escape peak information!");
                                     }
-                                    actualResult[key][iLayer][tmpString]["energy"] = mapIt->second;
-                                    actualResult[key][iLayer][tmpString]["rate"] = 0.0;
-                                    actualResult[key][iLayer][tmpString]["primary"] = 0.0;
-                                    actualResult[key][iLayer][tmpString]["secondary"] = 0.0;
-                                }
-                                mapIt = c_it2->second.find("rate");
-                                if (mapIt == c_it2->second.end())
-                                {
-                                    throw std::runtime_error("Missing rate key in escape peak information!");
+                                    totalEscape += mapIt->second;
+                                    layerResult[tmpString]["rate"] += mapIt->second * \
+                                                                      result[iDetector][c_it->first]["rate"];
+                                    // The only meaning of filling "primary" and "secondary" for a escape peak is in order to
+                                    // be able to evaluate the ratio without having to refer to the actual parent line.
+                                    layerResult[tmpString]["primary"] += mapIt->second * \
+                                                                         result[iDetector][c_it->first]["primary"];
+                                    layerResult[tmpString]["secondary"] += mapIt->second * \
+                                                                           result[iDetector][c_it->first]["secondary"];
                                 }
-                                totalEscape += mapIt->second;
-                                actualResult[key][iLayer][tmpString]["rate"] += mapIt->second * result[c_it->first]["rate"];
-                                // The only meaning of filling "primary" and "secondary" for a escape peak is in order to
-                                // be able to evaluate the ratio without having to refer to the actual parent line.
-                                actualResult[key][iLayer][tmpString]["primary"] += mapIt->second * result[c_it->first]["primary"];
-                                actualResult[key][iLayer][tmpString]["secondary"] += mapIt->second * result[c_it->first]["secondary"];
                             }
+                            FISX_PROFILE_STOP(this->profile, ESCAPE, escapeTimer);
                         }
+                        layerResult[c_it->first]["rate"] += (1.0 - totalEscape) * \
+                                                            result[iDetector][c_it->first]["rate"];
+                        // primary and secondary are the same independently of having escape or not.
+                        layerResult[c_it->first]["primary"] += result[iDetector][c_it->first]["primary"];
+                        layerResult[c_it->first]["secondary"] += result[iDetector][c_it->first]["secondary"];
+                        layerResult[c_it->first]["massFraction"] = elementMassFraction;
                     }
-                    actualResult[key][iLayer][c_it->first]["rate"] += (1.0 - totalEscape) * result[c_it->first]["rate"];
-                    // primary and secondary are the same independently of having escape or not.
-                    actualResult[key][iLayer][c_it->first]["primary"] += result[c_it->first]["primary"];
-                    actualResult[key][iLayer][c_it->first]["secondary"] += result[c_it->first]["secondary"];
-                    actualResult[key][iLayer][c_it->first]["massFraction"] = elementMassFraction;
                 }
             }
         }
     }
+    FISX_PROFILE_START(tertiaryTimer);
     if (secondary > 1)
     {
         // std::cout << "WARNING: Tertiary excitation under development " << std::endl;
@@ -834,92 +1151,138 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
         double factorFirst;
         double tertiary;
         std::string ele;
-        for (actualResultIt = actualResult.begin(); actualResultIt != actualResult.end(); ++actualResultIt)
+        for (iDetector = 0; iDetector < nDetectors; iDetector++)
         {
-            ele = actualResultIt->first.substr(0, actualResultIt->first.find(' '));
-            for (iLayer = 0; iLayer < actualResultIt->second.size(); iLayer++)
+            contributingKeys.clear();
+            for (actualResultIt = actualResult[iDetector].begin(); \
+                 actualResultIt != actualResult[iDetector].end(); ++actualResultIt)
             {
-                for (it = actualResultIt->second[iLayer].begin(); \
-                     it != actualResultIt->second[iLayer].end(); ++it)
+                ele = actualResultIt->first.substr(0, actualResultIt->first.find(' '));
+                for (iLayer = 0; iLayer < actualResultIt->second.size(); iLayer++)
                 {
-                    //std::cout << it->first << std::endl;
-                    if (it->first.find("esc") != std::string::npos)
-                    {
-                        // this is a escape line -> Ignore it
-                        continue;
-                    }
-                    if (it->second["massFraction"] < 1.0E-2)
+                    for (it = actualResultIt->second[iLayer].begin(); \
+                         it != actualResultIt->second[iLayer].end(); ++it)
                     {
-                        // one should be able to neglect tertiary excitation from elements
-                        // with less than 1 % concentration
-                        break;
-                    }
-                    factorFirst = 1.0;
-                    if (it->second["primary"] > 0.0)
-                    {
-                        factorFirst = (it->second["primary"] + it->second["secondary"]) / \
-                                     it->second["primary"];
-                    }
-                    if (factorFirst < 1.01)
-                    {
-                        // tertiary contribution should already be less than 1 % -> Ignore it
-                        continue;
+                        //std::cout << it->first << std::endl;
+                        if (it->first.find("esc") != std::string::npos)
+                        {
+                            // this is a escape line -> Ignore it
+                            continue;
+                        }
+                        if (it->second["massFraction"] < 1.0E-2)
+                        {
+                            // one should be able to neglect tertiary excitation from elements
+                            // with less than 1 % concentration
+                            break;
+                        }
+                        factorFirst = 1.0;
+                        if (it->second["primary"] > 0.0)
+                        {
+                            factorFirst = (it->second["primary"] + it->second["secondary"]) / \
+                                         it->second["primary"];
+                        }
+                        if (factorFirst < 1.01)
+                        {
+                            // tertiary contribution should already be less than 1 % -> Ignore it
+                            continue;
+                        }
+                        else
+                        {
+                            tmpStringStream.str(std::string());
+                            tmpStringStream.clear();
+                            tmpStringStream << std::setfill('0') << std::setw(2) << iLayer;
+                            key = ele + " " + it->first + " " + tmpStringStream.str();
+                            contributingKeys[key] = factorFirst;
+                            // the factor will be the same for all lines starting by KL2, being escape or not
+                        }
                     }
-                    else
+                }
+            }
+
+            for (actualResultIt = actualResult[iDetector].begin(); \
+                 actualResultIt != actualResult[iDetector].end(); ++actualResultIt)
+            {
+                for (iLayer = 0; iLayer < actualResultIt->second.size(); iLayer++)
+                {
+                    for (it = actualResultIt->second[iLayer].begin(); \
+                         it != actualResultIt->second[iLayer].end(); ++it)
                     {
-                        tmpStringStream.str(std::string());
-                        tmpStringStream.clear();
-                        tmpStringStream << std::setfill('0') << std::setw(2) << iLayer;
-                        key = ele + " " + it->first + " " + tmpStringStream.str();
-                        contributingKeys[key] = factorFirst;
-                        // the factor will be the same for all lines starting by KL2, being escape or not
+                        factorFirst = 1.0;
+                        tertiary = 0.0;
+                        if (it->second["primary"] > 0.0)
+                        {
+                            factorFirst = (it->second["primary"] + it->second["secondary"]) / \
+                                         it->second["primary"];
+                        }
+                        if (factorFirst < 1.01)
+                        {
+                            // It had less than 1 % secondary, we assume tertiary will be even less
+                            it->second["tertiary"] = 0.0;
+                            continue;
+                        }
+                        for (contributingKeysIt = contributingKeys.begin(); \
+                             contributingKeysIt != contributingKeys.end(); ++contributingKeysIt)
+                        {
+                            if (it->second.find(contributingKeysIt->first) != it->second.end())
+                            {
+                                tertiary += it->second[contributingKeysIt->first] * \
+                                            (contributingKeysIt->second - 1.0);
+                            }
+                        }
+                        it->second["tertiary"] = tertiary;
+                        // update the total rate to account for primary, secondary and tertiary
+                        // rate was equal to (primary + secondary) times a certain efficiency factor
+                        // rate = A * (primary + secondary) therefore  now we must update the rate to
+                        // account for tertiary rate = A * (primary + secondary + tertiary)
+                        it->second["rate"] *= (tertiary + it->second["primary"] + it->second["secondary"]) \
+                                              / (it->second["primary"] + it->second["secondary"]);
                     }
                 }
             }
         }
-
-        for (actualResultIt = actualResult.begin(); actualResultIt != actualResult.end(); ++actualResultIt)
+    }
+    FISX_PROFILE_STOP(this->profile, TERTIARY, tertiaryTimer);
+    if ((detailLevel == 0) || ((detailLevel == 1) && keepSecondarySources))
+    {
+        // remove the information not requested by the caller
+        std::map<std::string, std::map<int, std::map<std::string, std::map<std::string, double> > > >::iterator actualResultIt;
+        std::map<int, std::map<std::string, std::map<std::string, double> > >::iterator layerIt;
+        std::map<std::string, std::map<std::string, double> >::iterator lineIt;
+        std::map<std::string, double>::iterator keyIt;
+        for (iDetector = 0; iDetector < nDetectors; iDetector++)
         {
-            for (iLayer = 0; iLayer < actualResultIt->second.size(); iLayer++)
+            for (actualResultIt = actualResult[iDetector].begin(); \
+                 actualResultIt != actualResult[iDetector].end(); ++actualResultIt)
             {
-                for (it = actualResultIt->second[iLayer].begin(); \
-                     it != actualResultIt->second[iLayer].end(); ++it)
+                for (layerIt = actualResultIt->second.begin(); layerIt != actualResultIt->second.end(); ++layerIt)
                 {
-                    factorFirst = 1.0;
-                    tertiary = 0.0;
-                    if (it->second["primary"] > 0.0)
+                    for (lineIt = layerIt->second.begin(); lineIt != layerIt->second.end(); ++lineIt)
                     {
-                        factorFirst = (it->second["primary"] + it->second["secondary"]) / \
-                                     it->second["primary"];
-                    }
-                    if (factorFirst < 1.01)
-                    {
-                        // It had less than 1 % secondary, we assume tertiary will be even less
-                        it->second["tertiary"] = 0.0;
-                        continue;
-                    }
-                    for (contributingKeysIt = contributingKeys.begin(); \
-                         contributingKeysIt != contributingKeys.end(); ++contributingKeysIt)
-                    {
-                        if (it->second.find(contributingKeysIt->first) != it->second.end())
+                        keyIt = lineIt->second.begin();
+                        while (keyIt != lineIt->second.end())
                         {
-                            tertiary += it->second[contributingKeysIt->first] * \
-                                        (contributingKeysIt->second - 1.0);
+                            if ((keyIt->first == "energy") || (keyIt->first == "rate") || \
+                                (keyIt->first == "efficiency") || (keyIt->first == "massFraction") || \
+                                ((detailLevel > 0) && ((keyIt->first == "primary") || \
+                                                       (keyIt->first == "secondary") || \
+                                                       (keyIt->first == "tertiary") || \
+                                                       (keyIt->first == "mu_1_i") || \
+                                                       (keyIt->first == "energy_threshold"))))
+                            {
+                                ++keyIt;
+                            }
+                            else
+                            {
+                                lineIt->second.erase(keyIt++);
+                            }
                         }
                     }
-                    it->second["tertiary"] = tertiary;
-                    // update the total rate to account for primary, secondary and tertiary
-                    // rate was equal to (primary + secondary) times a certain efficiency factor
-                    // rate = A * (primary + secondary) therefore  now we must update the rate to
-                    // account for tertiary rate = A * (primary + secondary + tertiary)
-                    it->second["rate"] *= (tertiary + it->second["primary"] + it->second["secondary"]) \
-                                          / (it->second["primary"] + it->second["secondary"]);
                 }
             }
         }
     }
-    this->lastMultilayerFluorescence = actualResult;
-    return actualResult;
+    FISX_PROFILE_STOP(this->profile, TOTAL, totalTimer);
+    this->lastMultilayerFluorescence = actualResult[0];
 }
 
 } // namespace fisx
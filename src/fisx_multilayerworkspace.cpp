@@ -0,0 +1,34 @@
+#include "fisx_multilayerworkspace.h"
+
+namespace fisx
+{
+
+MultilayerWorkspace::MultilayerWorkspace()
+{
+}
+
+void MultilayerWorkspace::clear()
+{
+    // std::vector::clear keeps the capacity, swapping with empty containers releases it
+    MultilayerWorkspace empty;
+    this->actualRays.swap(empty.actualRays);
+    this->weights.swap(empty.weights);
+    this->transmission.swap(empty.transmission);
+    this->muTotal.swap(empty.muTotal);
+    this->geometricEfficiency.swap(empty.geometricEfficiency);
+    this->sampleLayerDensity.swap(empty.sampleLayerDensity);
+    this->sampleLayerThickness.swap(empty.sampleLayerThickness);
+    this->sampleLayerWeight.swap(empty.sampleLayerWeight);
+    this->sampleLayerEnergies.swap(empty.sampleLayerEnergies);
+    this->sampleLayerEnergyNames.swap(empty.sampleLayerEnergyNames);
+    this->sampleLayerRates.swap(empty.sampleLayerRates);
+    this->sampleLayerMuTotal.swap(empty.sampleLayerMuTotal);
+    this->sampleLayerFamilies.swap(empty.sampleLayerFamilies);
+    this->sampleLayerPeakFamilies.swap(empty.sampleLayerPeakFamilies);
+    this->sampleLayerMuMatrix.swap(empty.sampleLayerMuMatrix);
+    this->sampleLayerAttenuationSum.swap(empty.sampleLayerAttenuationSum);
+    this->muMap.swap(empty.muMap);
+    this->energyThresholdList.swap(empty.energyThresholdList);
+}
+
+} // namespace fisx
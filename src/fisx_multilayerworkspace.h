@@ -0,0 +1,64 @@
+#ifndef FISX_MULTILAYERWORKSPACE_H
+#define FISX_MULTILAYERWORKSPACE_H
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+
+namespace fisx
+{
+
+/*!
+  \class MultilayerWorkspace
+  \brief Scratch buffers of XRF::getMultilayerFluorescence
+
+   The multilayer calculation fills a set of per layer and per ray temporaries. Passing the same
+   workspace to successive calls keeps the memory of those buffers instead of allocating and
+   releasing it on every call, what matters when many small calculations are performed, for
+   instance inside a fitting loop.
+
+   The workspace does not carry any result between calls, it can be used with different
+   configurations and libraries. It is not shared, use one per thread.
+*/
+class MultilayerWorkspace
+{
+    friend class XRF;
+
+public:
+    MultilayerWorkspace();
+
+    /*!
+    Release the memory held by the buffers.
+    */
+    void clear();
+
+private:
+    // beam after the beam filters and its weights
+    std::vector<std::vector<double> > actualRays;
+    std::vector<double> weights;
+    std::vector<double> transmission;
+    // per sample layer values at the incident energy
+    std::vector<double> muTotal;
+    // [iDetector][iLayer] solid angle of each detector seen from each sample layer
+    std::vector<std::vector<double> > geometricEfficiency;
+    std::vector<double> sampleLayerDensity;
+    std::vector<double> sampleLayerThickness;
+    std::vector<double> sampleLayerWeight;
+    // secondary sources of each layer
+    std::vector<std::vector<double> > sampleLayerEnergies;
+    std::vector<std::vector<std::string> > sampleLayerEnergyNames;
+    std::vector<std::vector<double> > sampleLayerRates;
+    std::vector<std::vector<double> > sampleLayerMuTotal;
+    std::vector<std::string> sampleLayerFamilies;
+    std::vector<std::vector<std::pair<std::string, double> > > sampleLayerPeakFamilies;
+    // [jLayer][bLayer][iLambda] attenuation of the layers at the energies emitted by the other layers
+    std::vector<std::vector<std::vector<double> > > sampleLayerMuMatrix;
+    std::vector<std::vector<std::vector<double> > > sampleLayerAttenuationSum;
+    // mass attenuation coefficients of a layer at a set of energies
+    std::map<std::string, std::vector<double> > muMap;
+    std::vector<double> energyThresholdList;
+};
+
+} // namespace fisx
+
+#endif // FISX_MULTILAYERWORKSPACE_H
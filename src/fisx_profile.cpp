@@ -0,0 +1,80 @@
+#include "fisx_profile.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+namespace fisx
+{
+
+Profile::Profile()
+{
+    this->reset();
+}
+
+bool Profile::isEnabled()
+{
+#ifdef FISX_PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+double Profile::getWallTime()
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return ((double) counter.QuadPart) / ((double) frequency.QuadPart);
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return ((double) tv.tv_sec) + 1.0e-6 * ((double) tv.tv_usec);
+#endif
+}
+
+void Profile::reset()
+{
+    int i;
+
+    for (i = 0; i < N_PHASES; i++)
+    {
+        this->times[i] = 0.0;
+    }
+    for (i = 0; i < N_COUNTERS; i++)
+    {
+        this->counts[i] = 0.0;
+    }
+}
+
+std::map<std::string, double> Profile::getValues() const
+{
+    std::map<std::string, double> result;
+
+    if (!Profile::isEnabled())
+    {
+        return result;
+    }
+    result["beam_filters_time"] = this->times[BEAM_FILTERS];
+    result["layer_attenuation_time"] = this->times[LAYER_ATTENUATION];
+    result["peak_families_time"] = this->times[PEAK_FAMILIES];
+    result["primary_time"] = this->times[PRIMARY];
+    result["secondary_time"] = this->times[SECONDARY];
+    result["tertiary_time"] = this->times[TERTIARY];
+    result["detector_efficiency_time"] = this->times[DETECTOR_EFFICIENCY];
+    result["escape_time"] = this->times[ESCAPE];
+    result["total_time"] = this->times[TOTAL];
+    result["mass_attenuation_lookups"] = this->counts[MASS_ATTENUATION_LOOKUPS];
+    result["excitation_factors"] = this->counts[EXCITATION_FACTORS];
+    result["excitation_cache_hits"] = this->counts[EXCITATION_CACHE_HITS];
+    result["excitation_cache_misses"] = this->counts[EXCITATION_CACHE_MISSES];
+    result["deboer_calls"] = this->counts[DEBOER_CALLS];
+    result["secondary_sources"] = this->counts[SECONDARY_SOURCES];
+    result["secondary_sources_skipped"] = this->counts[SECONDARY_SOURCES_SKIPPED];
+    return result;
+}
+
+} // namespace fisx
@@ -0,0 +1,90 @@
+#ifndef FISX_PROFILE_H
+#define FISX_PROFILE_H
+#include <string>
+#include <map>
+
+namespace fisx
+{
+
+/*!
+  \class Profile
+  \brief Wall time per calculation phase and operation counters
+
+   The instrumentation is only compiled when the library is built with FISX_PROFILE defined
+   (python setup.py build --profile). Otherwise the FISX_PROFILE_* macros expand to nothing,
+   the values stay at zero and getValues returns an empty map.
+*/
+class Profile
+{
+public:
+    enum Phase
+    {
+        BEAM_FILTERS = 0,
+        LAYER_ATTENUATION,
+        PEAK_FAMILIES,
+        PRIMARY,
+        SECONDARY,
+        TERTIARY,
+        DETECTOR_EFFICIENCY,
+        ESCAPE,
+        TOTAL,
+        N_PHASES
+    };
+
+    enum Counter
+    {
+        MASS_ATTENUATION_LOOKUPS = 0,
+        EXCITATION_FACTORS,
+        EXCITATION_CACHE_HITS,
+        EXCITATION_CACHE_MISSES,
+        DEBOER_CALLS,
+        SECONDARY_SOURCES,
+        SECONDARY_SOURCES_SKIPPED,
+        N_COUNTERS
+    };
+
+    Profile();
+
+    /*!
+    Return true if the library was compiled with the instrumentation.
+    */
+    static bool isEnabled();
+
+    /*!
+    Wall time in seconds from an arbitrary origin.
+    */
+    static double getWallTime();
+
+    void reset();
+
+    void addTime(const Phase & phase, const double & seconds) {this->times[phase] += seconds;};
+    void addCount(const Counter & counter, const double & n = 1.0) {this->counts[counter] += n;};
+
+    double getTime(const Phase & phase) const {return this->times[phase];};
+    double getCount(const Counter & counter) const {return this->counts[counter];};
+
+    /*!
+    Times (keys ending in "_time", in seconds) and counters as a map.
+    Empty if the library was compiled without instrumentation.
+    */
+    std::map<std::string, double> getValues() const;
+
+private:
+    double times[N_PHASES];
+    double counts[N_COUNTERS];
+};
+
+} // namespace fisx
+
+#ifdef FISX_PROFILE
+#define FISX_PROFILE_START(timer) double timer = fisx::Profile::getWallTime()
+#define FISX_PROFILE_STOP(profile, phase, timer) \
+                    (profile).addTime(fisx::Profile::phase, fisx::Profile::getWallTime() - (timer))
+#define FISX_PROFILE_COUNT(profile, counter, n) (profile).addCount(fisx::Profile::counter, (n))
+#else
+#define FISX_PROFILE_START(timer)
+#define FISX_PROFILE_STOP(profile, phase, timer)
+#define FISX_PROFILE_COUNT(profile, counter, n)
+#endif
+
+#endif // FISX_PROFILE_H
@@ -0,0 +1,338 @@
+#include "fisx_quantifier.h"
+#include <cmath>
+#include <stdexcept>
+#include <algorithm>
+
+namespace fisx
+{
+
+Quantifier::Quantifier()
+{
+    this->balanceElement = -1;
+    this->flux = 1.0;
+    this->maxIterations = 50;
+    this->tolerance = 1.0e-5;
+    this->damping = 1.0;
+}
+
+Quantifier::Quantifier(const XRFConfig & configuration, \
+                       const Elements & elementsLibrary, \
+                       const std::vector<std::string> & elementList, \
+                       const std::vector<std::string> & elementFamilyList, \
+                       const int & layerIndex, \
+                       const int & secondary, \
+                       const int & useGeometricEfficiency)
+{
+    this->balanceElement = -1;
+    this->flux = 1.0;
+    this->maxIterations = 50;
+    this->tolerance = 1.0e-5;
+    this->damping = 1.0;
+    this->update(configuration, elementsLibrary, elementList, elementFamilyList, \
+                 layerIndex, secondary, useGeometricEfficiency);
+}
+
+void Quantifier::update(const XRFConfig & configuration, \
+                        const Elements & elementsLibrary, \
+                        const std::vector<std::string> & elementList, \
+                        const std::vector<std::string> & elementFamilyList, \
+                        const int & layerIndex, \
+                        const int & secondary, \
+                        const int & useGeometricEfficiency)
+{
+    std::vector<std::string>::size_type i, j;
+    std::string elementName;
+
+    this->engine.update(configuration, elementsLibrary, elementList, elementFamilyList, \
+                        layerIndex, secondary, useGeometricEfficiency);
+    this->familyElement.clear();
+    for (i = 0; i < elementFamilyList.size(); i++)
+    {
+        // the engine has already checked the syntax and the presence of the element
+        elementName = elementFamilyList[i].substr(0, elementFamilyList[i].find(' '));
+        for (j = 0; j < elementList.size(); j++)
+        {
+            if (elementList[j] == elementName)
+            {
+                if (std::find(this->familyElement.begin(), this->familyElement.end(), (int) j) != \
+                    this->familyElement.end())
+                {
+                    throw std::invalid_argument("Quantifier. Element " + elementName + \
+                                                " quantified by more than one family");
+                }
+                this->familyElement.push_back((int) j);
+                break;
+            }
+        }
+    }
+    if (std::find(this->familyElement.begin(), this->familyElement.end(), this->balanceElement) != \
+        this->familyElement.end())
+    {
+        this->balanceElement = -1;
+    }
+}
+
+const CompositionEngine & Quantifier::getCompositionEngine() const
+{
+    return this->engine;
+}
+
+void Quantifier::setFlux(const double & flux)
+{
+    if (flux <= 0.0)
+    {
+        throw std::invalid_argument("Quantifier. Flux must be positive");
+    }
+    this->flux = flux;
+}
+
+const double & Quantifier::getFlux() const
+{
+    return this->flux;
+}
+
+void Quantifier::setBalanceElement(const std::string & elementName)
+{
+    const std::vector<std::string> & elementList = this->engine.getElementList();
+    std::vector<std::string>::size_type i;
+
+    if (elementName.size() == 0)
+    {
+        this->balanceElement = -1;
+        return;
+    }
+    for (i = 0; i < elementList.size(); i++)
+    {
+        if (elementList[i] == elementName)
+        {
+            if (std::find(this->familyElement.begin(), this->familyElement.end(), (int) i) != \
+                this->familyElement.end())
+            {
+                throw std::invalid_argument("Quantifier. Balance element cannot be a quantified element");
+            }
+            this->balanceElement = (int) i;
+            return;
+        }
+    }
+    throw std::invalid_argument("Quantifier. Balance element " + elementName + " not in element list");
+}
+
+std::string Quantifier::getBalanceElement() const
+{
+    if (this->balanceElement < 0)
+    {
+        return "";
+    }
+    return this->engine.getElementList()[this->balanceElement];
+}
+
+void Quantifier::setConvergence(const int & maxIterations, const double & tolerance, const double & damping)
+{
+    if (maxIterations < 1)
+    {
+        throw std::invalid_argument("Quantifier. Maximum number of iterations must be positive");
+    }
+    if (tolerance <= 0.0)
+    {
+        throw std::invalid_argument("Quantifier. Tolerance must be positive");
+    }
+    if ((damping <= 0.0) || (damping > 1.0))
+    {
+        throw std::invalid_argument("Quantifier. Damping factor must be in (0, 1]");
+    }
+    this->maxIterations = maxIterations;
+    this->tolerance = tolerance;
+    this->damping = damping;
+}
+
+int Quantifier::iterate(const double * areas, double * composition) const
+{
+    const int nElements = (int) this->engine.getElementList().size();
+    const int nFamilies = (int) this->familyElement.size();
+    std::vector<double> rates;
+    double measured, value, total;
+    bool converged;
+    int iteration, iFamily, iElement;
+
+    rates.resize(nFamilies);
+
+    // a zero starting value would remain zero
+    for (iFamily = 0; iFamily < nFamilies; iFamily++)
+    {
+        iElement = this->familyElement[iFamily];
+        if (areas[iFamily] <= 0.0)
+        {
+            composition[iElement] = 0.0;
+        }
+        else if (composition[iElement] <= 0.0)
+        {
+            composition[iElement] = 0.01;
+        }
+    }
+
+    for (iteration = 1; iteration <= this->maxIterations; iteration++)
+    {
+        if (this->balanceElement > -1)
+        {
+            total = 0.0;
+            for (iElement = 0; iElement < nElements; iElement++)
+            {
+                if (iElement != this->balanceElement)
+                {
+                    total += composition[iElement];
+                }
+            }
+            composition[this->balanceElement] = std::max(1.0 - total, 0.0);
+        }
+        // serial evaluation, the pixels may already be processed in parallel
+        this->engine.getBlockRates(composition, 1, &rates[0]);
+        converged = true;
+        for (iFamily = 0; iFamily < nFamilies; iFamily++)
+        {
+            iElement = this->familyElement[iFamily];
+            measured = areas[iFamily] / this->flux;
+            if ((measured <= 0.0) || (rates[iFamily] <= 0.0))
+            {
+                // nothing measured or nothing that can be excited
+                continue;
+            }
+            value = composition[iElement] * measured / rates[iFamily];
+            value = composition[iElement] + this->damping * (value - composition[iElement]);
+            if (std::fabs(value - composition[iElement]) > (this->tolerance * value))
+            {
+                converged = false;
+            }
+            composition[iElement] = value;
+        }
+        if (converged)
+        {
+            break;
+        }
+    }
+    if (this->balanceElement > -1)
+    {
+        total = 0.0;
+        for (iElement = 0; iElement < nElements; iElement++)
+        {
+            if (iElement != this->balanceElement)
+            {
+                total += composition[iElement];
+            }
+        }
+        composition[this->balanceElement] = std::max(1.0 - total, 0.0);
+    }
+    if (iteration > this->maxIterations)
+    {
+        return -1;
+    }
+    return iteration;
+}
+
+int Quantifier::quantify(const double * areas, const double * initialComposition, double * composition) const
+{
+    const int nElements = (int) this->engine.getElementList().size();
+
+    if (nElements < 1)
+    {
+        throw std::runtime_error("Quantifier. Not initialized");
+    }
+    std::copy(initialComposition, initialComposition + nElements, composition);
+    return this->iterate(areas, composition);
+}
+
+void Quantifier::quantify(const double * areas, \
+                          const int & nPixels, \
+                          const double * initialCompositions, \
+                          double * compositions, \
+                          int * iterations, \
+                          const int & warmStart) const
+{
+    const int nElements = (int) this->engine.getElementList().size();
+    const int nFamilies = (int) this->familyElement.size();
+    const int blockSize = 16;
+    int nBlocks;
+    int iBlock;
+    bool failed;
+    std::string errorMessage;
+
+    if (nElements < 1)
+    {
+        throw std::runtime_error("Quantifier. Not initialized");
+    }
+    nBlocks = (nPixels + blockSize - 1) / blockSize;
+    failed = false;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (iBlock = 0; iBlock < nBlocks; iBlock++)
+    {
+        int iPixel, iFamily, iElement;
+        int first, last;
+        double * composition;
+        first = iBlock * blockSize;
+        last = std::min(first + blockSize, nPixels);
+        try
+        {
+            for (iPixel = first; iPixel < last; iPixel++)
+            {
+                composition = compositions + iPixel * nElements;
+                std::copy(initialCompositions + iPixel * nElements, \
+                          initialCompositions + (iPixel + 1) * nElements, composition);
+                if (warmStart && (iPixel > first) && (iterations[iPixel - 1] > 0))
+                {
+                    for (iFamily = 0; iFamily < nFamilies; iFamily++)
+                    {
+                        iElement = this->familyElement[iFamily];
+                        composition[iElement] = compositions[(iPixel - 1) * nElements + iElement];
+                    }
+                }
+                iterations[iPixel] = this->iterate(areas + iPixel * nFamilies, composition);
+            }
+        }
+        catch (const std::exception & exc)
+        {
+#ifdef _OPENMP
+            #pragma omp critical
+#endif
+            {
+                failed = true;
+                errorMessage = exc.what();
+            }
+        }
+    }
+    if (failed)
+    {
+        throw std::runtime_error(errorMessage);
+    }
+}
+
+std::vector<double> Quantifier::quantify(const std::vector<double> & areas, \
+                                         const std::vector<double> & initialCompositions, \
+                                         std::vector<int> & iterations, \
+                                         const int & warmStart) const
+{
+    std::vector<double> compositions;
+    std::vector<double>::size_type nElements, nFamilies;
+    int nPixels;
+
+    nElements = this->engine.getElementList().size();
+    nFamilies = this->familyElement.size();
+    if ((nFamilies < 1) || (areas.size() % nFamilies))
+    {
+        throw std::invalid_argument("Quantifier. Areas size not a multiple of the number of families");
+    }
+    nPixels = (int) (areas.size() / nFamilies);
+    if (initialCompositions.size() != (nPixels * nElements))
+    {
+        throw std::invalid_argument("Quantifier. Initial compositions size does not match number of pixels");
+    }
+    compositions.resize(initialCompositions.size());
+    iterations.resize(nPixels);
+    if (nPixels > 0)
+    {
+        this->quantify(&areas[0], nPixels, &initialCompositions[0], &compositions[0], &iterations[0], warmStart);
+    }
+    return compositions;
+}
+
+} // namespace fisx
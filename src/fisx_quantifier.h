@@ -0,0 +1,121 @@
+#ifndef FISX_QUANTIFIER_H
+#define FISX_QUANTIFIER_H
+#include <string>
+#include <vector>
+#include "fisx_compositionengine.h"
+
+namespace fisx
+{
+
+/*!
+  \class Quantifier
+  \brief Fundamental parameters quantification of one sample layer
+
+   Measured peak family areas are converted into mass fractions by iterating on the forward
+   calculation of a CompositionEngine. Each measured family determines the mass fraction of its
+   element. The remaining elements keep the mass fraction supplied as starting composition unless
+   one of them is declared as balance, in which case it completes the composition to unity.
+
+   Each iteration applies the damped fixed-point update
+
+       w_new = w + damping * (w * measured / calculated - w)
+
+   until the relative change of all the quantified mass fractions is below the tolerance.
+*/
+class Quantifier
+{
+public:
+    Quantifier();
+
+    /*!
+    Same arguments as the CompositionEngine constructor. Each element family must belong to a
+    different element.
+    */
+    Quantifier(const XRFConfig & configuration, \
+               const Elements & elementsLibrary, \
+               const std::vector<std::string> & elementList, \
+               const std::vector<std::string> & elementFamilyList, \
+               const int & layerIndex = 0, \
+               const int & secondary = 1, \
+               const int & useGeometricEfficiency = 1);
+
+    void update(const XRFConfig & configuration, \
+                const Elements & elementsLibrary, \
+                const std::vector<std::string> & elementList, \
+                const std::vector<std::string> & elementFamilyList, \
+                const int & layerIndex = 0, \
+                const int & secondary = 1, \
+                const int & useGeometricEfficiency = 1);
+
+    const CompositionEngine & getCompositionEngine() const;
+
+    /*!
+    Factor converting rates (per incident photon) into measured areas. It accounts for
+    the incident flux, the acquisition time and any other calibration constant.
+    Default is 1.0
+    */
+    void setFlux(const double & flux);
+    const double & getFlux() const;
+
+    /*!
+    Element adjusted to make the mass fractions sum to one. An empty string (default) disables it.
+    The balance element cannot be a quantified element.
+    */
+    void setBalanceElement(const std::string & elementName);
+    std::string getBalanceElement() const;
+
+    /*!
+    Iteration control. The damping factor must be in (0, 1]. Defaults are 50, 1.0e-5 and 1.0
+    */
+    void setConvergence(const int & maxIterations, const double & tolerance, const double & damping = 1.0);
+
+    /*!
+    Quantify nPixels pixels.
+
+    areas - nPixels x elementFamilyList.size() measured areas
+    initialCompositions - nPixels x elementList.size() starting mass fractions. Non quantified elements
+                          keep these values (except the balance element).
+    compositions - nPixels x elementList.size() output mass fractions
+    iterations - nPixels output number of iterations, -1 if the pixel did not converge.
+
+    If warmStart is set, each pixel starts from the quantified mass fractions of the previous pixel
+    instead of its own initial ones. Neighbouring pixels of maps usually have similar compositions
+    and converge in fewer iterations. When compiled with OpenMP, blocks of pixels are processed
+    in parallel and warm starting happens within each block.
+    */
+    void quantify(const double * areas, \
+                  const int & nPixels, \
+                  const double * initialCompositions, \
+                  double * compositions, \
+                  int * iterations, \
+                  const int & warmStart = 1) const;
+
+    /*!
+    Quantify a single pixel. Returns the number of iterations or -1 if it did not converge.
+    */
+    int quantify(const double * areas, const double * initialComposition, double * composition) const;
+
+    /*!
+    Convenience method. The number of pixels is deduced from the size of the areas.
+    */
+    std::vector<double> quantify(const std::vector<double> & areas, \
+                                 const std::vector<double> & initialCompositions, \
+                                 std::vector<int> & iterations, \
+                                 const int & warmStart = 1) const;
+
+private:
+    int iterate(const double * areas, double * composition) const;
+
+    CompositionEngine engine;
+    // index in the element list of the element of each family
+    std::vector<int> familyElement;
+    int balanceElement;
+    double flux;
+    int maxIterations;
+    double tolerance;
+    double damping;
+};
+
+} // namespace fisx
+
+#endif // FISX_QUANTIFIER_H
@@ -1,10 +1,9 @@
 #include <ctype.h>
 #include <sstream>
-#include <iostream>
 #include <stdexcept>
 #include <cstdlib> // needed for atoi
 #include "fisx_shell.h"
-// #include <iostream>
+#include "fisx_logger.h"
 
 namespace fisx
 {
@@ -71,7 +70,7 @@ Shell::Shell(std::string name)
         }
         if ((shellMainIndex == 1) && (idx > 3))
         {
-            std::cout << "INDEX = " << idx << " Obtained from " << name.substr(1, 1) << std::endl;
+            FISX_LOG_DEBUG("Shell::Shell", "Index = " << idx << " obtained from " << name.substr(1, 1));
             throw std::invalid_argument("Incompatible L subshell index");
         }
         if ((shellMainIndex == 2) && (idx > 5))
@@ -579,7 +578,7 @@ std::map<std::string, double> Shell::getDirectVacancyTransferRatios(const std::s
     {
         for (it = this->shellConstants.begin(); it != this->shellConstants.end(); ++it)
         {
-            std::cout << it->first << " = " << it->second << std::endl;
+            FISX_LOG_DEBUG("Shell::getDirectVacancyTransferRatios", it->first << " = " << it->second);
         }
         throw std::domain_error("Sum of CosterKronig and Fluorescence yields greater than 1.0");
     }
@@ -647,4 +646,30 @@ bool Shell::StringToInteger(const std::string& str, int & number)
     return true;
 }
 
+void Shell::writeBinary(BinaryWriter & writer) const
+{
+    writer.write(this->name);
+    writer.write(this->shellMainIndex);
+    writer.write(this->subshellIndex);
+    writer.write(this->shellConstants);
+    writer.write(this->radiativeTransitions);
+    writer.write(this->nonradiativeTransitions);
+    writer.write(this->augerRatios);
+    writer.write(this->costerKronigRatios);
+    writer.write(this->fluorescenceRatios);
+}
+
+void Shell::readBinary(BinaryReader & reader)
+{
+    reader.read(this->name);
+    reader.read(this->shellMainIndex);
+    reader.read(this->subshellIndex);
+    reader.read(this->shellConstants);
+    reader.read(this->radiativeTransitions);
+    reader.read(this->nonradiativeTransitions);
+    reader.read(this->augerRatios);
+    reader.read(this->costerKronigRatios);
+    reader.read(this->fluorescenceRatios);
+}
+
 } // namespace fisx
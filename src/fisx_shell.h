@@ -4,6 +4,7 @@
 #include <ctype.h>
 #include <vector>
 #include <map>
+#include "fisx_binarystream.h"
 
 
 namespace fisx
@@ -88,6 +89,12 @@ public:
 
     double getFluorescenceYield() const;
 
+    /*!
+    Write or read the complete state of the instance (see Elements::getSnapshot).
+    */
+    void writeBinary(BinaryWriter & writer) const;
+    void readBinary(BinaryReader & reader);
+
 private:
     std::string  name;
     int shellMainIndex;
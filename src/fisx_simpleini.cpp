@@ -1,12 +1,31 @@
 #include "fisx_simpleini.h"
-#include <iostream>
+#include "fisx_logger.h"
 #include <fstream>
 #include <stdexcept>
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <locale.h>
+#include <limits.h>
+#include <math.h>
 
 namespace fisx
 {
 
+static inline bool isTrimmed(const char & c)
+{
+    return (c == ' ') || (c == '\n') || (c == '\r') || (c == '\t');
+}
+
+static inline std::string::size_type skipSpaces(const std::string & s, std::string::size_type i)
+{
+    while ((i < s.size()) && isspace(s[i]))
+    {
+        i++;
+    }
+    return i;
+}
+
 SimpleIni::SimpleIni()
 {
     this->fileName = "";
@@ -21,179 +40,208 @@ SimpleIni::SimpleIni(std::string fileName)
 
 
 void SimpleIni::readFileName(std::string fileName)
+{
+    std::ifstream fileInstance(fileName.c_str(), std::ios::in | std::ios::binary);
+    std::vector<char> buffer;
+    std::streamoff size;
+
+    // read the whole file at once, the parsing works on the memory buffer
+    if (fileInstance.is_open())
+    {
+        fileInstance.seekg(0, std::ios::end);
+        size = fileInstance.tellg();
+        fileInstance.seekg(0, std::ios::beg);
+        if (size > 0)
+        {
+            buffer.resize((std::size_t) size);
+            fileInstance.read(&buffer[0], size);
+            buffer.resize((std::size_t) fileInstance.gcount());
+        }
+        fileInstance.close();
+    }
+    if (buffer.size() > 0)
+    {
+        this->parseBuffer(&buffer[0], buffer.size());
+    }
+    else
+    {
+        this->parseBuffer(NULL, 0);
+    }
+    this->fileName = fileName;
+}
+
+void SimpleIni::parseBuffer(const char * buffer, const std::size_t & size)
 {
     std::string mainKey;
+    std::string foldedKey;
     std::string key;
-    std::string line;
-    std::string trimmedLine;
     std::string tmpString;
-    std::string content;
-    std::string::size_type i;
-    // I should use streampos instead of size_type
-    std::string::size_type p0, p1, length;
+    std::map<std::string, std::string> * section;
+    const char * end;
+    const char * lineStart;
+    const char * lineEnd;
+    const char * first;
+    const char * last;
+    const char * p;
+    const char * closing;
     int nQuotes;
     int nItems;
-    int equalPosition;
+    std::string::size_type equalPosition;
     long numberOfLines;
-    std::streampos position;
-    std::ifstream fileInstance(fileName.c_str(), std::ios::in | std::ios::binary);
     std::string msg;
 
+    this->sectionContents.clear();
     this->sections.clear();
+    this->foldedSections.clear();
+    this->sectionIndex.clear();
     this->sectionPositions.clear();
-    position = 0;
+    section = NULL;
     numberOfLines = -1;
-    while (std::getline(fileInstance, line))
+    end = buffer + size;
+    lineStart = buffer;
+    while (lineStart < end)
     {
-        // std::cout << " INPUT <" << line << ">" << std::endl;
+        lineEnd = static_cast<const char *>(memchr(lineStart, '\n', end - lineStart));
+        if (lineEnd == NULL)
+        {
+            lineEnd = end;
+        }
         ++numberOfLines;
 
-        trimmedLine = "";
-        if((line.size() > 0))
+        // trim leading and trailing spaces
+        first = lineStart;
+        last = lineEnd;
+        while ((first < last) && isTrimmed(*first))
         {
-            // trim leading and trailing spaces
-            p1 = line.find_last_not_of(" \n\r\t");
-            if (p1 != line.npos)
-            {
-                trimmedLine = line.substr(0, p1 + 1);
-                p0 = trimmedLine.find_first_not_of(" \n\r\t");
-                trimmedLine = trimmedLine.substr(p0);
-            }
+            first++;
+        }
+        while ((last > first) && isTrimmed(*(last - 1)))
+        {
+            last--;
         }
-        if (trimmedLine.size() > 0)
+        if (first == last)
         {
-            if (trimmedLine[0] == '[')
+            // empty line
+            lineStart = lineEnd + 1;
+            continue;
+        }
+        if (*first == '[')
+        {
+            if (first != lineStart)
             {
-                if (p0 != 0)
-                {
-                    msg = "Main key not as first line character";
-                    std::cout << "WARNING: " << msg;
-                    std::cout << " line = <" << line << ">" << std::endl;
-                }
-                mainKey = "";
-                p0 = 0;
-                p1 = 0;
-                nItems = 1;
-                for (i = 1; i < trimmedLine.size(); i++)
-                {
-                    if (trimmedLine[i] == '[')
-                    {
-                        msg = "Invalid line: <" + line + ">";
-                        throw std::invalid_argument(msg);
-                    }
-                    else
-                    {
-                        if (trimmedLine[i] == ']')
-                        {
-                            nItems++;
-                            p1 = i;
-                        }
-                    }
-                }
-                length = p1 - p0 - 1;
-                if ((nItems != 2) || (length < 1))
-                {
-                    msg = "Invalid line: <" + line + ">";
-                    throw std::invalid_argument(msg);
-                }
-                mainKey = trimmedLine.substr(p0 + 1, length);
-                this->sections.push_back(mainKey);
-                this->sectionPositions[mainKey] = numberOfLines;
-                continue;
+                msg = "Main key not as first line character";
+                FISX_LOG_WARNING("SimpleIni::readFileName", msg << " line = <" << \
+                                 std::string(lineStart, lineEnd) << ">");
             }
-
-            tmpString = "";
-            nQuotes = 0;
-            equalPosition = 0;
-            for(i=0; i < trimmedLine.size(); i++)
+            nItems = 1;
+            closing = first;
+            for (p = first + 1; p < last; p++)
             {
-                if (trimmedLine[i] == '"')
+                if (*p == '[')
                 {
-                    nQuotes++;
-                    tmpString += trimmedLine[i];
-                    continue;
-                }
-                if (nQuotes && (nQuotes % 2))
-                {
-                    // in between quotes
-                    tmpString += trimmedLine[i];
-                    continue;
+                    msg = "Invalid line: <" + std::string(lineStart, lineEnd) + ">";
+                    throw std::invalid_argument(msg);
                 }
-                else
+                if (*p == ']')
                 {
-                    if ((trimmedLine[i] == '#') || (trimmedLine[i] == ';'))
-                    {
-                        i = trimmedLine.size();
-                    }
-                    if (equalPosition == 0)
-                    {
-                        if (!isspace(trimmedLine[i]))
-                        {
-                            tmpString += trimmedLine[i];
-                        }
-                    }
-                    else
-                    {
-                        tmpString += trimmedLine[i];
-                    }
-                    if(trimmedLine[i] == '=')
-                    {
-                        if (equalPosition == 0)
-                        {
-                            equalPosition = tmpString.size() - 1;
-                        }
-                    }
+                    nItems++;
+                    closing = p;
                 }
             }
-            if (nQuotes % 2)
+            if ((nItems != 2) || ((closing - first) < 2))
             {
-                msg = "Unmatched double quotes in line: <" + line + ">";
+                msg = "Invalid line: <" + std::string(lineStart, lineEnd) + ">";
                 throw std::invalid_argument(msg);
             }
-            // std::cout << " tmpString <" << tmpString << ">" << std::endl;
+            mainKey.assign(first + 1, closing);
+            foldedKey = mainKey;
+            SimpleIni::foldCase(foldedKey);
+            this->sections.push_back(mainKey);
+            this->foldedSections.push_back(foldedKey);
+            // the first section wins when several only differ in case
+            this->sectionIndex.insert(std::make_pair(foldedKey, mainKey));
+            this->sectionPositions[mainKey] = numberOfLines;
+            section = NULL;
+            lineStart = lineEnd + 1;
+            continue;
+        }
 
-            if (tmpString.size() < 1)
+        tmpString.clear();
+        nQuotes = 0;
+        equalPosition = 0;
+        for (p = first; p < last; p++)
+        {
+            if (*p == '"')
             {
-                // empty line
-                key = "";
+                nQuotes++;
+                tmpString += *p;
                 continue;
             }
-            if(equalPosition > 0)
+            if (nQuotes % 2)
             {
-                // we have a key
-                key = "";
-                p0 = 0;
-                p1 = equalPosition;
-                length = p1 - p0;
-                if (length < 1)
+                // in between quotes
+                tmpString += *p;
+                continue;
+            }
+            if ((*p == '#') || (*p == ';'))
+            {
+                // comment until the end of the line
+                break;
+            }
+            if (equalPosition == 0)
+            {
+                if (!isspace(*p))
                 {
-                    msg = "Invalid line: <" + line + ">";
-                    throw std::invalid_argument(msg);
+                    tmpString += *p;
+                    if ((*p == '=') && (tmpString.size() > 1))
+                    {
+                        equalPosition = tmpString.size() - 1;
+                    }
                 }
-                key = tmpString.substr(p0, length);
-                content = tmpString.substr(p1 + 1, tmpString.size() - p1 - 1);
-                this->sectionContents[mainKey][key] = content;
             }
             else
             {
-                // continuation line
-                if ((key.size() > 0) && (mainKey.size() > 0))
-                {
-                    this->sectionContents[mainKey][key] += tmpString;
-                }
-                else
-                {
-                    std::cout << "Ignored line: <" + line + ">";
-                }
+                tmpString += *p;
             }
         }
+        if (nQuotes % 2)
+        {
+            msg = "Unmatched double quotes in line: <" + std::string(lineStart, lineEnd) + ">";
+            throw std::invalid_argument(msg);
+        }
+
+        if (tmpString.size() < 1)
+        {
+            // comment line, it ends any continuation
+            key.clear();
+            lineStart = lineEnd + 1;
+            continue;
+        }
+        if (section == NULL)
+        {
+            section = &(this->sectionContents[mainKey]);
+        }
+        if(equalPosition > 0)
+        {
+            // we have a key
+            key.assign(tmpString, 0, equalPosition);
+            (*section)[key].assign(tmpString, equalPosition + 1, std::string::npos);
+        }
+        else
+        {
+            // continuation line
+            if ((key.size() > 0) && (mainKey.size() > 0))
+            {
+                (*section)[key] += tmpString;
+            }
+            else
+            {
+                FISX_LOG_WARNING("SimpleIni::readFileName", "Ignored line: <" << \
+                                 std::string(lineStart, lineEnd) << ">");
+            }
+        }
+        lineStart = lineEnd + 1;
     }
-    fileInstance.clear();
-    if (fileInstance.is_open())
-    {
-        fileInstance.close();
-    }
-    this->fileName = fileName;
 }
 
 
@@ -207,48 +255,33 @@ void SimpleIni::getSubsections(const std::string & parent, \
                                const bool & caseSensitive)
 {
     std::string targetString;
-    std::string instanceString;
-    std::locale loc;
     std::vector<std::string>::size_type i;
 
     destination.clear();
     if (parent.size() == 0)
     {
-        destination.resize(this->sections.size());
-        for (i = 0; i < this->sections.size(); i++)
-        {
-            destination[i] = this->sections[i];
-        }
+        destination = this->sections;
         return;
     }
+    targetString = parent + ".";
     if (caseSensitive)
     {
-        targetString = parent + ".";
         for (i = 0; i < this->sections.size(); i++)
         {
-            if (this->sections[i].size() == targetString.size())
+            if (SimpleIni::startsWith(this->sections[i], targetString))
             {
-                if (this->sections[i].substr(0, targetString.size()) == targetString)
-                {
-                    destination.push_back(this->sections[i]);
-                }
+                destination.push_back(this->sections[i]);
             }
         }
     }
     else
     {
-        targetString = parent + ".";
-        this->toUpper(targetString, loc);
-        for (i = 0; i < this->sections.size(); i++)
+        SimpleIni::foldCase(targetString);
+        for (i = 0; i < this->foldedSections.size(); i++)
         {
-            instanceString = this->sections[i];
-            if (instanceString.size() >= targetString.size())
+            if (SimpleIni::startsWith(this->foldedSections[i], targetString))
             {
-                this->toUpper(instanceString, loc);
-                if (instanceString.substr(0, targetString.size()) == targetString)
-                {
-                    destination.push_back(this->sections[i]);
-                }
+                destination.push_back(this->sections[i]);
             }
         }
     }
@@ -257,45 +290,155 @@ void SimpleIni::getSubsections(const std::string & parent, \
 const std::map<std::string, std::string > & SimpleIni::readSection(const std::string & key, \
                                                                    const bool & caseSensitive)
 {
-    std::string inputKey;
-    std::string tmpKey;
-    std::locale loc;
-    std::vector<std::string>::size_type i, j;
+    std::map<std::string, std::map<std::string, std::string> >::const_iterator c_it;
+    std::map<std::string, std::string>::const_iterator i_it;
+    std::string foldedKey;
 
-    if (this->sectionContents.find(key) == this->sectionContents.end())
+    c_it = this->sectionContents.find(key);
+    if ((c_it == this->sectionContents.end()) && (!caseSensitive))
     {
-        if (!caseSensitive)
+        foldedKey = key;
+        SimpleIni::foldCase(foldedKey);
+        i_it = this->sectionIndex.find(foldedKey);
+        if (i_it != this->sectionIndex.end())
         {
-            inputKey = key;
-            for (i = 0; i < key.size(); i++)
-            {
-                inputKey[i] = std::toupper(inputKey[i], loc);
-            }
-            for (i = 0; i < this->sections.size(); i++)
-            {
-                tmpKey = this->sections[i];
-                if (tmpKey.size() == inputKey.size())
-                {
-                    j = 0;
-                    while (std::toupper(tmpKey[j], loc) == inputKey[j])
-                    {
-                        j++;
-                        if (j == inputKey.size())
-                        {
-                            break;
-                        }
-                    }
-                    if (j < inputKey.size())
-                    {
-                        return this->sectionContents[tmpKey];
-                    }
-                }
-            }
+            c_it = this->sectionContents.find(i_it->second);
         }
+    }
+    if (c_it == this->sectionContents.end())
+    {
         this->defaultContent.clear();
         return this->defaultContent;
     }
-    return this->sectionContents[key];
+    return c_it->second;
+}
+
+void SimpleIni::foldCase(std::string & s)
+{
+    std::string::size_type i;
+
+    // section names are plain ASCII, no need to go through the locale
+    for (i = 0; i < s.size(); i++)
+    {
+        if ((s[i] >= 'a') && (s[i] <= 'z'))
+        {
+            s[i] = s[i] - 'a' + 'A';
+        }
+    }
+}
+
+bool SimpleIni::stringConverter(const std::string& str, double & number)
+{
+    std::string::size_type i, first, nDigits;
+    std::string text;
+    const char * decimalPoint;
+    double value;
+
+    // find the extent of the number as the stream conversion would do
+    i = skipSpaces(str, 0);
+    first = i;
+    if ((i < str.size()) && ((str[i] == '+') || (str[i] == '-')))
+    {
+        i++;
+    }
+    nDigits = 0;
+    while ((i < str.size()) && isdigit(str[i]))
+    {
+        i++;
+        nDigits++;
+    }
+    if ((i < str.size()) && (str[i] == '.'))
+    {
+        i++;
+        while ((i < str.size()) && isdigit(str[i]))
+        {
+            i++;
+            nDigits++;
+        }
+    }
+    if (nDigits == 0)
+    {
+        return false;
+    }
+    if ((i < str.size()) && ((str[i] == 'e') || (str[i] == 'E')))
+    {
+        i++;
+        if ((i < str.size()) && ((str[i] == '+') || (str[i] == '-')))
+        {
+            i++;
+        }
+        nDigits = 0;
+        while ((i < str.size()) && isdigit(str[i]))
+        {
+            i++;
+            nDigits++;
+        }
+        if (nDigits == 0)
+        {
+            // incomplete exponent
+            return false;
+        }
+    }
+
+    // strtod follows the C locale of the program
+    text.assign(str, first, i - first);
+    decimalPoint = localeconv()->decimal_point;
+    if ((decimalPoint[0] != '.') || (decimalPoint[1] != '\0'))
+    {
+        i = text.find('.');
+        if (i != std::string::npos)
+        {
+            text.replace(i, 1, decimalPoint);
+        }
+    }
+    value = strtod(text.c_str(), NULL);
+    if ((value == HUGE_VAL) || (value == -HUGE_VAL))
+    {
+        // out of range
+        return false;
+    }
+    number = value;
+    return true;
+}
+
+bool SimpleIni::stringConverter(const std::string& str, int & number)
+{
+    std::string::size_type i;
+    unsigned long value, limit;
+    bool negative;
+
+    i = skipSpaces(str, 0);
+    negative = false;
+    if ((i < str.size()) && ((str[i] == '+') || (str[i] == '-')))
+    {
+        negative = (str[i] == '-');
+        i++;
+    }
+    if ((i >= str.size()) || (!isdigit(str[i])))
+    {
+        return false;
+    }
+    limit = negative ? ((unsigned long) INT_MAX) + 1 : (unsigned long) INT_MAX;
+    value = 0;
+    while ((i < str.size()) && isdigit(str[i]))
+    {
+        value = 10 * value + (str[i] - '0');
+        if (value > limit)
+        {
+            // out of range
+            return false;
+        }
+        i++;
+    }
+    if (negative)
+    {
+        number = (value > (unsigned long) INT_MAX) ? INT_MIN : -((int) value);
+    }
+    else
+    {
+        number = (int) value;
+    }
+    return true;
 }
 
 } // namespace fisx
@@ -4,11 +4,20 @@
 #include <vector>
 #include <map>
 #include <sstream>
+#include <cstddef>
 #include <locale>  // std::locale, std::tolower, std::toupper
 
 namespace fisx
 {
 
+/*!
+  \class SimpleIni
+  \brief Reader of the configuration files written by PyMca
+
+   The file is read at once and parsed in a single pass. The values are kept as strings and
+   they are only converted when requested through the parse methods. Case insensitive section
+   lookups use an index of the upper case section names built while parsing.
+*/
 class SimpleIni
 {
 public:
@@ -68,9 +77,7 @@ public:
                                   T & destination,
                                   const T & defaultValue)
     {
-        std::stringstream stream(keyContent);
-        stream >> destination;
-        if (stream.fail())
+        if (!SimpleIni::stringConverter(keyContent, destination))
         {
             destination = defaultValue;
         }
@@ -82,16 +89,25 @@ public:
                                             const T & defaultValue,
                                             const char & separator = ',')
     {
-        std::stringstream ss(keyContent);
+        std::string::size_type start, end;
         T result;
         std::string item;
         destination.clear();
-        while (std::getline(ss, item, separator))
+        start = 0;
+        // same items as std::getline would give: no item after a trailing separator
+        while (start < keyContent.size())
         {
+            end = keyContent.find(separator, start);
+            if (end == std::string::npos)
+            {
+                end = keyContent.size();
+            }
+            item.assign(keyContent, start, end - start);
             if (SimpleIni::stringConverter(item, result))
                 destination.push_back(result);
             else
                 destination.push_back(defaultValue);
+            start = end + 1;
         }
     };
 
@@ -107,6 +123,15 @@ public:
         return true;
     };
 
+    /*!
+    Fast conversion of the numeric values found in configuration files. They accept the same
+    input as the stream based conversion in the "C" locale (leading white space, trailing
+    characters ignored) but they do not construct a stream and they are not affected by the
+    locale of the calling program.
+    */
+    static bool stringConverter(const std::string& str, double & number);
+    static bool stringConverter(const std::string& str, int & number);
+
     /*!
     Utility function (from Kleist in stackoverflow) to check if a string starts with testString
     */
@@ -116,9 +141,14 @@ public:
 }
 
 private:
+    void parseBuffer(const char * buffer, const std::size_t & size);
+    static void foldCase(std::string & s);
     std::string fileName;
     std::map<std::string, std::map<std::string, std::string> > sectionContents;
     std::vector<std::string> sections;
+    // upper case section names in file order and index of the first section with each of them
+    std::vector<std::string> foldedSections;
+    std::map<std::string, std::string> sectionIndex;
     std::map<std::string, long> sectionPositions;
     std::map<std::string, std::string>  defaultContent;
 };
@@ -0,0 +1,532 @@
+#include "fisx_spectrumfitter.h"
+#include "fisx_xrf.h"
+#include "fisx_simpleini.h"
+#include <cmath>
+#include <stdexcept>
+#include <algorithm>
+#include <sstream>
+
+namespace fisx
+{
+
+SpectrumFitter::SpectrumFitter()
+{
+    this->backgroundDegree = -1;
+}
+
+void SpectrumFitter::setChannels(const std::vector<double> & channels)
+{
+    if (channels == this->channels)
+    {
+        return;
+    }
+    this->channels = channels;
+    this->update();
+}
+
+const std::vector<double> & SpectrumFitter::getChannels() const
+{
+    return this->channels;
+}
+
+void SpectrumFitter::setDetectorParameters(const std::map<std::string, double> & detectorParameters)
+{
+    std::map<std::string, double>::const_iterator c_it;
+    std::map<std::string, double> parameters;
+    std::string key;
+
+    // the pile-up does not keep the model linear in the areas
+    for (c_it = detectorParameters.begin(); c_it != detectorParameters.end(); ++c_it)
+    {
+        key = c_it->first;
+        SimpleIni::toUpper(key);
+        if ((key != "COUNTRATE") && (key != "PILEUPTIME") && (key != "PILEUPORDER"))
+        {
+            parameters[c_it->first] = c_it->second;
+        }
+    }
+    if (parameters == this->detectorParameters)
+    {
+        return;
+    }
+    this->detectorParameters = parameters;
+    this->update();
+}
+
+const std::map<std::string, double> & SpectrumFitter::getDetectorParameters() const
+{
+    return this->detectorParameters;
+}
+
+void SpectrumFitter::setShapeParameters(const std::map<std::string, double> & shapeParameters)
+{
+    if (shapeParameters == this->shapeParameters)
+    {
+        return;
+    }
+    this->shapeParameters = shapeParameters;
+    this->update();
+}
+
+const std::map<std::string, double> & SpectrumFitter::getShapeParameters() const
+{
+    return this->shapeParameters;
+}
+
+void SpectrumFitter::setPeakFamilies(const std::vector<std::string> & peakFamilies, \
+                         const std::map<std::string, std::map<int, std::map<std::string, \
+                                        std::map<std::string, double> > > > & emissionRatios)
+{
+    std::vector<std::string>::size_type i;
+
+    for (i = 0; i < peakFamilies.size(); i++)
+    {
+        if (std::count(peakFamilies.begin(), peakFamilies.end(), peakFamilies[i]) > 1)
+        {
+            throw std::invalid_argument("SpectrumFitter. Peak family " + peakFamilies[i] + \
+                                        " given more than once");
+        }
+    }
+    if ((peakFamilies == this->peakFamilies) && (emissionRatios == this->emissionRatios))
+    {
+        return;
+    }
+    this->peakFamilies = peakFamilies;
+    this->emissionRatios = emissionRatios;
+    this->update();
+}
+
+const std::vector<std::string> & SpectrumFitter::getPeakFamilies() const
+{
+    return this->peakFamilies;
+}
+
+void SpectrumFitter::setBackgroundDegree(const int & degree)
+{
+    int value;
+
+    value = (degree < 0) ? -1 : degree;
+    if (value == this->backgroundDegree)
+    {
+        return;
+    }
+    this->backgroundDegree = value;
+    this->update();
+}
+
+int SpectrumFitter::getBackgroundDegree() const
+{
+    return this->backgroundDegree;
+}
+
+std::vector<std::string> SpectrumFitter::getParameterNames() const
+{
+    std::vector<std::string> names;
+    int i;
+
+    names = this->peakFamilies;
+    for (i = 0; i <= this->backgroundDegree; i++)
+    {
+        std::ostringstream name;
+        name << "background " << i;
+        names.push_back(name.str());
+    }
+    return names;
+}
+
+const std::vector<std::vector<double> > & SpectrumFitter::getTemplates() const
+{
+    return this->templates;
+}
+
+void SpectrumFitter::update()
+{
+    const double SIGNIFICANT = 1.0e-10;
+    std::vector<std::string>::size_type iFamily;
+    std::vector<double>::size_type i, j, k, nChannels, nTemplates;
+    std::map<std::string, double>::const_iterator c_it;
+    std::map<std::string, double> areas;
+    std::map<std::string, std::vector<double> > spectrum;
+    std::string key;
+    double gain, maximum, t, binomial;
+    int degree;
+    XRF xrf;
+
+    this->templates.clear();
+    this->firstChannel.clear();
+    this->lastChannel.clear();
+    this->gram.clear();
+    nChannels = this->channels.size();
+    if (nChannels < 1)
+    {
+        return;
+    }
+    nTemplates = this->peakFamilies.size() + (this->backgroundDegree + 1);
+    this->templates.resize(nTemplates);
+    this->firstChannel.resize(nTemplates, 0);
+    this->lastChannel.resize(nTemplates, (int) nChannels);
+
+    // XRF::getSpectrum gives counts per keV
+    if (this->peakFamilies.size() > 0)
+    {
+        gain = 1.0;
+        for (c_it = this->detectorParameters.begin(); c_it != this->detectorParameters.end(); ++c_it)
+        {
+            key = c_it->first;
+            SimpleIni::toUpper(key);
+            if (key == "GAIN")
+            {
+                gain = c_it->second;
+            }
+        }
+        for (iFamily = 0; iFamily < this->peakFamilies.size(); iFamily++)
+        {
+            areas[this->peakFamilies[iFamily]] = 1.0;
+        }
+        spectrum = xrf.getSpectrum(this->channels, this->detectorParameters, this->shapeParameters, \
+                                   areas, this->emissionRatios);
+        for (iFamily = 0; iFamily < this->peakFamilies.size(); iFamily++)
+        {
+            std::vector<double> & values = this->templates[iFamily];
+            values = spectrum[this->peakFamilies[iFamily]];
+            maximum = 0.0;
+            for (i = 0; i < nChannels; i++)
+            {
+                values[i] *= std::fabs(gain);
+                if (std::fabs(values[i]) > maximum)
+                {
+                    maximum = std::fabs(values[i]);
+                }
+            }
+            // keep the part of the channels where the template is significant
+            i = 0;
+            while ((i < nChannels) && (std::fabs(values[i]) <= SIGNIFICANT * maximum))
+            {
+                values[i] = 0.0;
+                i++;
+            }
+            j = nChannels;
+            while ((j > i) && (std::fabs(values[j - 1]) <= SIGNIFICANT * maximum))
+            {
+                values[j - 1] = 0.0;
+                j--;
+            }
+            this->firstChannel[iFamily] = (int) i;
+            this->lastChannel[iFamily] = (int) j;
+        }
+    }
+
+    // Bernstein polynomials over the channel range
+    degree = this->backgroundDegree;
+    if (degree >= 0)
+    {
+        double cMin, cMax;
+        cMin = *std::min_element(this->channels.begin(), this->channels.end());
+        cMax = *std::max_element(this->channels.begin(), this->channels.end());
+        for (k = 0; k <= (std::vector<double>::size_type) degree; k++)
+        {
+            std::vector<double> & values = this->templates[this->peakFamilies.size() + k];
+            values.resize(nChannels);
+            binomial = 1.0;
+            for (j = 0; j < k; j++)
+            {
+                binomial = binomial * (degree - j) / (j + 1);
+            }
+            for (i = 0; i < nChannels; i++)
+            {
+                t = (cMax > cMin) ? (this->channels[i] - cMin) / (cMax - cMin) : 0.5;
+                values[i] = binomial * std::pow(t, (double) k) * std::pow(1.0 - t, (double) (degree - k));
+            }
+        }
+    }
+
+    this->gram.resize(nTemplates * nTemplates, 0.0);
+    for (j = 0; j < nTemplates; j++)
+    {
+        for (k = j; k < nTemplates; k++)
+        {
+            double sum = 0.0;
+            int first, last, iChannel;
+            first = std::max(this->firstChannel[j], this->firstChannel[k]);
+            last = std::min(this->lastChannel[j], this->lastChannel[k]);
+            for (iChannel = first; iChannel < last; iChannel++)
+            {
+                sum += this->templates[j][iChannel] * this->templates[k][iChannel];
+            }
+            this->gram[j * nTemplates + k] = sum;
+            this->gram[k * nTemplates + j] = sum;
+        }
+    }
+}
+
+double SpectrumFitter::solve(const double * spectrum, double * areas) const
+{
+    const int n = (int) this->templates.size();
+    const int nChannels = (int) this->channels.size();
+    const double * gram = &(this->gram[0]);
+    std::vector<double> projections, gradient, solution, cholesky;
+    std::vector<int> passive, active, blocked;
+    double spectrumNorm, tolerance, maximum, alpha, value, sum, chiSquare;
+    int i, j, k, l, m, nPassive, iteration, best, limiting;
+    bool feasible;
+
+    projections.resize(n);
+    gradient.resize(n);
+    solution.resize(n);
+    cholesky.resize(n * n);
+    active.resize(n, 0);
+    blocked.resize(n, 0);
+    passive.reserve(n);
+
+    spectrumNorm = 0.0;
+    for (i = 0; i < nChannels; i++)
+    {
+        spectrumNorm += spectrum[i] * spectrum[i];
+    }
+    maximum = 0.0;
+    for (j = 0; j < n; j++)
+    {
+        const double * values = &(this->templates[j][0]);
+        sum = 0.0;
+        for (i = this->firstChannel[j]; i < this->lastChannel[j]; i++)
+        {
+            sum += values[i] * spectrum[i];
+        }
+        projections[j] = sum;
+        maximum = std::max(maximum, std::fabs(sum));
+        areas[j] = 0.0;
+    }
+    tolerance = 1.0e-12 * maximum;
+
+    // Lawson and Hanson active set algorithm on the normal equations
+    iteration = 0;
+    while (iteration < 3 * n)
+    {
+        // gradient of the objective and most promising variable out of the passive set
+        best = -1;
+        for (j = 0; j < n; j++)
+        {
+            sum = projections[j];
+            for (k = 0; k < n; k++)
+            {
+                sum -= gram[j * n + k] * areas[k];
+            }
+            gradient[j] = sum;
+            if ((!active[j]) && (!blocked[j]) && (sum > tolerance) && \
+                ((best < 0) || (sum > gradient[best])))
+            {
+                best = j;
+            }
+        }
+        if (best < 0)
+        {
+            break;
+        }
+        active[best] = 1;
+        passive.push_back(best);
+
+        while (iteration < 3 * n)
+        {
+            iteration++;
+            // unconstrained solution in the passive set by Cholesky decomposition
+            nPassive = (int) passive.size();
+            feasible = true;
+            for (l = 0; (l < nPassive) && feasible; l++)
+            {
+                for (m = 0; m <= l; m++)
+                {
+                    sum = gram[passive[l] * n + passive[m]];
+                    for (k = 0; k < m; k++)
+                    {
+                        sum -= cholesky[l * n + k] * cholesky[m * n + k];
+                    }
+                    if (m == l)
+                    {
+                        if (sum <= 1.0e-12 * gram[passive[l] * n + passive[l]])
+                        {
+                            feasible = false;
+                            break;
+                        }
+                        cholesky[l * n + l] = std::sqrt(sum);
+                    }
+                    else
+                    {
+                        cholesky[l * n + m] = sum / cholesky[m * n + m];
+                    }
+                }
+            }
+            if (!feasible)
+            {
+                // linearly dependent on the passive templates
+                active[best] = 0;
+                blocked[best] = 1;
+                passive.pop_back();
+                break;
+            }
+            for (l = 0; l < nPassive; l++)
+            {
+                sum = projections[passive[l]];
+                for (k = 0; k < l; k++)
+                {
+                    sum -= cholesky[l * n + k] * solution[k];
+                }
+                solution[l] = sum / cholesky[l * n + l];
+            }
+            for (l = nPassive - 1; l >= 0; l--)
+            {
+                sum = solution[l];
+                for (k = l + 1; k < nPassive; k++)
+                {
+                    sum -= cholesky[k * n + l] * solution[k];
+                }
+                solution[l] = sum / cholesky[l * n + l];
+            }
+
+            // step towards the solution until the first variable reaches zero
+            alpha = 1.0;
+            limiting = -1;
+            for (l = 0; l < nPassive; l++)
+            {
+                if (solution[l] <= 0.0)
+                {
+                    j = passive[l];
+                    value = areas[j] / (areas[j] - solution[l]);
+                    if (value < alpha)
+                    {
+                        alpha = value;
+                        limiting = j;
+                    }
+                }
+            }
+            for (l = 0; l < nPassive; l++)
+            {
+                j = passive[l];
+                areas[j] += alpha * (solution[l] - areas[j]);
+            }
+            if (limiting < 0)
+            {
+                break;
+            }
+            if ((limiting == best) && (nPassive == (int) passive.size()) && (areas[best] <= 0.0))
+            {
+                // rounding made the entering variable useless
+                blocked[best] = 1;
+            }
+            areas[limiting] = 0.0;
+            // move the variables reaching zero out of the passive set
+            m = 0;
+            for (l = 0; l < nPassive; l++)
+            {
+                j = passive[l];
+                if (areas[j] <= 0.0)
+                {
+                    areas[j] = 0.0;
+                    active[j] = 0;
+                }
+                else
+                {
+                    passive[m] = j;
+                    m++;
+                }
+            }
+            passive.resize(m);
+        }
+    }
+
+    chiSquare = spectrumNorm;
+    for (j = 0; j < n; j++)
+    {
+        sum = 0.0;
+        for (k = 0; k < n; k++)
+        {
+            sum += gram[j * n + k] * areas[k];
+        }
+        chiSquare += areas[j] * (sum - 2.0 * projections[j]);
+    }
+    return (chiSquare > 0.0) ? chiSquare : 0.0;
+}
+
+double SpectrumFitter::fit(const double * spectrum, double * areas) const
+{
+    if (this->templates.size() < 1)
+    {
+        throw std::runtime_error("SpectrumFitter. Not initialized");
+    }
+    return this->solve(spectrum, areas);
+}
+
+void SpectrumFitter::fit(const double * spectra, const int & nSpectra, double * areas, double * chiSquare) const
+{
+    const int nChannels = (int) this->channels.size();
+    const int nParameters = (int) this->templates.size();
+    const int blockSize = 64;
+    int nBlocks;
+    int iBlock;
+    bool failed;
+    std::string errorMessage;
+
+    if (nParameters < 1)
+    {
+        throw std::runtime_error("SpectrumFitter. Not initialized");
+    }
+    nBlocks = (nSpectra + blockSize - 1) / blockSize;
+    failed = false;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (iBlock = 0; iBlock < nBlocks; iBlock++)
+    {
+        int iSpectrum, first, last;
+        double value;
+        first = iBlock * blockSize;
+        last = std::min(first + blockSize, nSpectra);
+        try
+        {
+            for (iSpectrum = first; iSpectrum < last; iSpectrum++)
+            {
+                value = this->solve(spectra + iSpectrum * nChannels, areas + iSpectrum * nParameters);
+                if (chiSquare != NULL)
+                {
+                    chiSquare[iSpectrum] = value;
+                }
+            }
+        }
+        catch (const std::exception & exc)
+        {
+#ifdef _OPENMP
+            #pragma omp critical
+#endif
+            {
+                failed = true;
+                errorMessage = exc.what();
+            }
+        }
+    }
+    if (failed)
+    {
+        throw std::runtime_error(errorMessage);
+    }
+}
+
+std::vector<double> SpectrumFitter::fit(const std::vector<double> & spectra, std::vector<double> & chiSquare) const
+{
+    std::vector<double> areas;
+    std::vector<double>::size_type nChannels;
+    int nSpectra;
+
+    nChannels = this->channels.size();
+    if ((nChannels < 1) || (spectra.size() % nChannels))
+    {
+        throw std::invalid_argument("SpectrumFitter. Spectra size not a multiple of the number of channels");
+    }
+    nSpectra = (int) (spectra.size() / nChannels);
+    areas.resize(nSpectra * this->templates.size());
+    chiSquare.resize(nSpectra);
+    if (nSpectra > 0)
+    {
+        this->fit(&spectra[0], nSpectra, &areas[0], &chiSquare[0]);
+    }
+    return areas;
+}
+
+} // namespace fisx
@@ -0,0 +1,124 @@
+#ifndef FISX_SPECTRUMFITTER_H
+#define FISX_SPECTRUMFITTER_H
+#include <string>
+#include <vector>
+#include <map>
+
+namespace fisx
+{
+
+/*!
+  \class SpectrumFitter
+  \brief Linear fit of peak family areas in measured spectra
+
+   Each peak family ("Fe K" or "Fe K 0") is described by a template: the spectrum of unit area
+   given by XRF::getSpectrum for the line ratios of XRF::getMultilayerFluorescence and the detector
+   response. The templates, the part of the channel range where each of them is significant and
+   their Gram matrix are computed once and kept until the channels, the calibration, the shape
+   parameters or the peak families change. Fitting a spectrum then reduces to the projections of
+   the spectrum on the templates and to a non-negative least squares problem of the size of the
+   number of templates, solved with the active set algorithm of Lawson and Hanson working on the
+   Gram matrix.
+
+   The background can be described by Bernstein polynomials over the fitted channels. Their
+   non-negative combinations cover smooth non-negative backgrounds. Otherwise the spectra are
+   expected to be background subtracted.
+
+   Once configured, the fitter is read-only and it can be shared by several threads.
+*/
+class SpectrumFitter
+{
+public:
+    SpectrumFitter();
+
+    /*!
+    Channels of the points of the spectra to be fitted.
+    */
+    void setChannels(const std::vector<double> & channels);
+    const std::vector<double> & getChannels() const;
+
+    /*!
+    Calibration and resolution of the detector: Zero, Gain, Noise, Fano and QuantumEnergy
+    (see XRF::getSpectrum). Pile-up parameters are not taken into account.
+    */
+    void setDetectorParameters(const std::map<std::string, double> & detectorParameters);
+    const std::map<std::string, double> & getDetectorParameters() const;
+
+    /*!
+    Peak shape parameters (see XRF::getSpectrum).
+    */
+    void setShapeParameters(const std::map<std::string, double> & shapeParameters);
+    const std::map<std::string, double> & getShapeParameters() const;
+
+    /*!
+    Peak families to be fitted, in the form "Fe K" or "Fe K 0", and the output of
+    XRF::getMultilayerFluorescence providing their line energies and ratios.
+    */
+    void setPeakFamilies(const std::vector<std::string> & peakFamilies, \
+                         const std::map<std::string, std::map<int, std::map<std::string, \
+                                        std::map<std::string, double> > > > & emissionRatios);
+    const std::vector<std::string> & getPeakFamilies() const;
+
+    /*!
+    Degree of the Bernstein polynomials describing the background. A negative value (default)
+    means no background.
+    */
+    void setBackgroundDegree(const int & degree);
+    int getBackgroundDegree() const;
+
+    /*!
+    Names of the fitted parameters: the peak families followed by "background 0",
+    "background 1", ... when the background is fitted.
+    */
+    std::vector<std::string> getParameterNames() const;
+
+    /*!
+    Templates of the fitted parameters, one vector of counts per channel for each of them.
+    The peak family templates correspond to a unit family area.
+    */
+    const std::vector<std::vector<double> > & getTemplates() const;
+
+    /*!
+    Fit nSpectra spectra.
+
+    spectra - nSpectra x channels.size() counts
+    areas - nSpectra x getParameterNames().size() output non-negative areas
+    chiSquare - nSpectra output sums of the squared residuals. It can be NULL.
+
+    When compiled with OpenMP, blocks of spectra are fitted in parallel.
+    */
+    void fit(const double * spectra, const int & nSpectra, double * areas, double * chiSquare = NULL) const;
+
+    /*!
+    Fit a single spectrum. Returns the sum of the squared residuals.
+    */
+    double fit(const double * spectrum, double * areas) const;
+
+    /*!
+    Convenience method. The number of spectra is deduced from the size of spectra.
+    */
+    std::vector<double> fit(const std::vector<double> & spectra, std::vector<double> & chiSquare) const;
+
+private:
+    void update();
+    double solve(const double * spectrum, double * areas) const;
+
+    std::vector<double> channels;
+    std::map<std::string, double> detectorParameters;
+    std::map<std::string, double> shapeParameters;
+    std::vector<std::string> peakFamilies;
+    std::map<std::string, std::map<int, std::map<std::string, std::map<std::string, double> > > > \
+        emissionRatios;
+    int backgroundDegree;
+
+    std::vector<std::vector<double> > templates;
+    // channel range [first, last) where each template is significant
+    std::vector<int> firstChannel;
+    std::vector<int> lastChannel;
+    // row-major Gram matrix of the templates
+    std::vector<double> gram;
+};
+
+} // namespace fisx
+
+#endif // FISX_SPECTRUMFITTER_H
@@ -0,0 +1,350 @@
+#include "fisx_stackresponse.h"
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+namespace fisx
+{
+
+StackResponse::StackResponse()
+{
+    this->energies.clear();
+    this->logEnergies.clear();
+    this->filterAttenuation.clear();
+    this->attenuatorAttenuation.clear();
+    this->detectorAttenuation.clear();
+    this->hasDetector = false;
+}
+
+StackResponse::StackResponse(const std::vector<Layer> & beamFilters, \
+                             const std::vector<Layer> & attenuators, \
+                             const Detector & detector, \
+                             const Elements & elementsLibrary, \
+                             const double & minimumEnergy, \
+                             const double & maximumEnergy, \
+                             const int & pointsPerDecade)
+{
+    this->update(beamFilters, attenuators, detector, elementsLibrary, \
+                 minimumEnergy, maximumEnergy, pointsPerDecade);
+}
+
+void StackResponse::update(const std::vector<Layer> & beamFilters, \
+                           const std::vector<Layer> & attenuators, \
+                           const Detector & detector, \
+                           const Elements & elementsLibrary, \
+                           const double & minimumEnergy, \
+                           const double & maximumEnergy, \
+                           const int & pointsPerDecade)
+{
+    std::vector<Layer>::size_type iLayer;
+    std::vector<double>::size_type i;
+    std::vector<double>::size_type nPoints;
+    std::vector<double> transmission;
+    double step;
+
+    if ((minimumEnergy <= 0.0) || (maximumEnergy <= minimumEnergy))
+    {
+        throw std::invalid_argument("StackResponse. Invalid energy range");
+    }
+    if (pointsPerDecade < 1)
+    {
+        throw std::invalid_argument("StackResponse. Number of points per decade must be positive");
+    }
+
+    this->hasDetector = false;
+    if (detector.hasMaterialComposition() || (detector.getMaterialName().size() > 0 ))
+    {
+        if ((detector.getDensity() > 0.0) && (detector.getThickness() > 0.0))
+        {
+            this->hasDetector = true;
+        }
+    }
+
+    // logarithmic grid
+    nPoints = (std::vector<double>::size_type) \
+                    std::ceil(std::log10(maximumEnergy / minimumEnergy) * pointsPerDecade);
+    step = std::log(maximumEnergy / minimumEnergy) / nPoints;
+    this->energies.clear();
+    for (i = 0; i < nPoints; i++)
+    {
+        this->energies.push_back(minimumEnergy * std::exp(step * i));
+    }
+    this->energies.push_back(maximumEnergy);
+
+    // absorption edges
+    for (iLayer = 0; iLayer < beamFilters.size(); iLayer++)
+    {
+        this->addEdges(beamFilters[iLayer], elementsLibrary, minimumEnergy, maximumEnergy);
+    }
+    for (iLayer = 0; iLayer < attenuators.size(); iLayer++)
+    {
+        this->addEdges(attenuators[iLayer], elementsLibrary, minimumEnergy, maximumEnergy);
+    }
+    if (this->hasDetector)
+    {
+        this->addEdges(detector, elementsLibrary, minimumEnergy, maximumEnergy);
+    }
+    std::sort(this->energies.begin(), this->energies.end());
+    this->energies.erase(std::unique(this->energies.begin(), this->energies.end()), this->energies.end());
+
+    this->logEnergies.resize(this->energies.size());
+    for (i = 0; i < this->energies.size(); i++)
+    {
+        this->logEnergies[i] = std::log(this->energies[i]);
+    }
+
+    // tabulate -log(transmission)
+    this->filterAttenuation.resize(this->energies.size());
+    this->attenuatorAttenuation.resize(this->energies.size());
+    this->detectorAttenuation.resize(this->energies.size());
+    std::fill(this->filterAttenuation.begin(), this->filterAttenuation.end(), 0.0);
+    std::fill(this->attenuatorAttenuation.begin(), this->attenuatorAttenuation.end(), 0.0);
+    std::fill(this->detectorAttenuation.begin(), this->detectorAttenuation.end(), 0.0);
+    for (iLayer = 0; iLayer < beamFilters.size(); iLayer++)
+    {
+        transmission = beamFilters[iLayer].getTransmission(this->energies, elementsLibrary, 90.0);
+        for (i = 0; i < transmission.size(); i++)
+        {
+            this->filterAttenuation[i] -= std::log(std::max(transmission[i], 1.0e-300));
+        }
+    }
+    for (iLayer = 0; iLayer < attenuators.size(); iLayer++)
+    {
+        transmission = attenuators[iLayer].getTransmission(this->energies, elementsLibrary, 90.0);
+        for (i = 0; i < transmission.size(); i++)
+        {
+            this->attenuatorAttenuation[i] -= std::log(std::max(transmission[i], 1.0e-300));
+        }
+    }
+    if (this->hasDetector)
+    {
+        transmission = detector.getTransmission(this->energies, elementsLibrary, 90.0);
+        for (i = 0; i < transmission.size(); i++)
+        {
+            this->detectorAttenuation[i] = -std::log(std::max(transmission[i], 1.0e-300));
+        }
+    }
+}
+
+void StackResponse::addEdges(const Layer & layer, const Elements & elementsLibrary, \
+                             const double & minimumEnergy, const double & maximumEnergy)
+{
+    std::map<std::string, double> composition;
+    std::map<std::string, double>::const_iterator c_it;
+    std::map<std::string, std::vector<double> >::const_iterator muIt;
+    std::vector<double>::size_type i;
+    std::vector<double>::size_type n;
+    double energy;
+
+    composition = layer.getComposition(elementsLibrary);
+    for (c_it = composition.begin(); c_it != composition.end(); ++c_it)
+    {
+        const std::map<std::string, std::vector<double> > & mu = \
+                            elementsLibrary.getElement(c_it->first).getMassAttenuationCoefficients();
+        muIt = mu.find("energy");
+        if (muIt == mu.end())
+        {
+            continue;
+        }
+        // the edges are given as repeated energies in the mass attenuation tables
+        n = muIt->second.size();
+        for (i = 0; i < n; i++)
+        {
+            energy = muIt->second[i];
+            if ((energy <= minimumEnergy) || (energy >= maximumEnergy))
+            {
+                continue;
+            }
+            if (((i + 1) < n) && (muIt->second[i + 1] == energy))
+            {
+                // sample both sides of the jump, the interpolated coefficients at the edge
+                // energy itself do not correspond to either of them
+                this->energies.push_back(energy * (1.0 - 1.0e-7));
+                this->energies.push_back(energy * (1.0 + 1.0e-7));
+            }
+            else if ((i == 0) || (muIt->second[i - 1] != energy))
+            {
+                // the library interpolates between the tabulated points, the curves have a
+                // kink at each of them
+                this->energies.push_back(energy);
+            }
+        }
+    }
+}
+
+const std::vector<double> & StackResponse::getEnergies() const
+{
+    return this->energies;
+}
+
+std::vector<double>::size_type StackResponse::getIndex(const double & energy, \
+                                                       std::vector<double>::size_type hint) const
+{
+    std::vector<double>::const_iterator it;
+
+    if ((energy < this->energies[0]) || (energy > this->energies.back()))
+    {
+        throw std::invalid_argument("StackResponse. Energy outside tabulated range");
+    }
+    if ((hint + 1) < this->energies.size())
+    {
+        if ((this->energies[hint] <= energy) && (energy < this->energies[hint + 1]))
+        {
+            return hint;
+        }
+        if ((hint + 2) < this->energies.size())
+        {
+            if ((this->energies[hint + 1] <= energy) && (energy < this->energies[hint + 2]))
+            {
+                return hint + 1;
+            }
+        }
+    }
+    it = std::upper_bound(this->energies.begin(), this->energies.end(), energy);
+    if (it == this->energies.end())
+    {
+        // energy equal to the last point
+        return this->energies.size() - 2;
+    }
+    return (it - this->energies.begin()) - 1;
+}
+
+double StackResponse::interpolate(const std::vector<double> & attenuation, const double & energy, \
+                                  std::vector<double>::size_type & hint) const
+{
+    std::vector<double>::size_type i;
+    double x;
+    double y0, y1;
+
+    if (this->energies.size() < 2)
+    {
+        return 0.0;
+    }
+    i = this->getIndex(energy, hint);
+    hint = i;
+    y0 = attenuation[i];
+    y1 = attenuation[i + 1];
+    x = (std::log(energy) - this->logEnergies[i]) / (this->logEnergies[i + 1] - this->logEnergies[i]);
+    if ((y0 > 0.0) && (y1 > 0.0))
+    {
+        // log-log interpolation
+        return std::exp(std::log(y0) + x * (std::log(y1) - std::log(y0)));
+    }
+    return y0 + x * (y1 - y0);
+}
+
+void StackResponse::interpolate(const std::vector<double> & attenuation, const std::vector<double> & energy, \
+                                std::vector<double> & result) const
+{
+    std::vector<double>::size_type i;
+    std::vector<double>::size_type hint;
+
+    result.resize(energy.size());
+    hint = 0;
+    for (i = 0; i < energy.size(); i++)
+    {
+        result[i] = this->interpolate(attenuation, energy[i], hint);
+    }
+}
+
+double StackResponse::getBeamFilterTransmission(const double & energy) const
+{
+    std::vector<double>::size_type hint = 0;
+    return std::exp(-this->interpolate(this->filterAttenuation, energy, hint));
+}
+
+double StackResponse::getAttenuatorTransmission(const double & energy) const
+{
+    std::vector<double>::size_type hint = 0;
+    return std::exp(-this->interpolate(this->attenuatorAttenuation, energy, hint));
+}
+
+double StackResponse::getDetectorEfficiency(const double & energy) const
+{
+    std::vector<double>::size_type hint = 0;
+    if (!this->hasDetector)
+    {
+        return 1.0;
+    }
+    return 1.0 - std::exp(-this->interpolate(this->detectorAttenuation, energy, hint));
+}
+
+double StackResponse::getDetectionEfficiency(const double & energy) const
+{
+    return this->getAttenuatorTransmission(energy) * this->getDetectorEfficiency(energy);
+}
+
+void StackResponse::getBeamFilterTransmission(const std::vector<double> & energy, \
+                                              std::vector<double> & result) const
+{
+    std::vector<double>::size_type i;
+
+    this->interpolate(this->filterAttenuation, energy, result);
+    for (i = 0; i < result.size(); i++)
+    {
+        result[i] = std::exp(-result[i]);
+    }
+}
+
+void StackResponse::getAttenuatorTransmission(const std::vector<double> & energy, \
+                                              std::vector<double> & result) const
+{
+    std::vector<double>::size_type i;
+
+    this->interpolate(this->attenuatorAttenuation, energy, result);
+    for (i = 0; i < result.size(); i++)
+    {
+        result[i] = std::exp(-result[i]);
+    }
+}
+
+void StackResponse::getDetectorEfficiency(const std::vector<double> & energy, \
+                                          std::vector<double> & result) const
+{
+    std::vector<double>::size_type i;
+
+    if (!this->hasDetector)
+    {
+        result.resize(energy.size());
+        std::fill(result.begin(), result.end(), 1.0);
+        return;
+    }
+    this->interpolate(this->detectorAttenuation, energy, result);
+    for (i = 0; i < result.size(); i++)
+    {
+        result[i] = 1.0 - std::exp(-result[i]);
+    }
+}
+
+void StackResponse::getDetectionEfficiency(const std::vector<double> & energy, \
+                                           std::vector<double> & result) const
+{
+    std::vector<double> detector;
+    std::vector<double>::size_type i;
+
+    this->getAttenuatorTransmission(energy, result);
+    this->getDetectorEfficiency(energy, detector);
+    for (i = 0; i < result.size(); i++)
+    {
+        result[i] *= detector[i];
+    }
+}
+
+std::map<std::string, std::vector<double> > StackResponse::getCurves() const
+{
+    return this->getCurves(this->energies);
+}
+
+std::map<std::string, std::vector<double> > StackResponse::getCurves(const std::vector<double> & energies) const
+{
+    std::map<std::string, std::vector<double> > result;
+
+    result["energy"] = energies;
+    this->getBeamFilterTransmission(energies, result["filters"]);
+    this->getAttenuatorTransmission(energies, result["attenuators"]);
+    this->getDetectorEfficiency(energies, result["detector"]);
+    this->getDetectionEfficiency(energies, result["efficiency"]);
+    return result;
+}
+
+} // namespace fisx
@@ -0,0 +1,122 @@
+#ifndef FISX_STACKRESPONSE_H
+#define FISX_STACKRESPONSE_H
+#include <string>
+#include <vector>
+#include <map>
+#include "fisx_elements.h"
+#include "fisx_layer.h"
+#include "fisx_detector.h"
+
+namespace fisx
+{
+
+/*!
+  \class StackResponse
+  \brief Tabulated transmission of the beam filters, attenuators and detector of a configuration
+
+   The transmissions are evaluated once on a logarithmic energy grid that also contains the energies
+   of the mass attenuation tables and both sides of the absorption edges of all the involved elements. Any other energy is obtained by interpolation, what makes
+   repeated and batch queries cheap. The table has to be rebuilt if the filters, the attenuators,
+   the detector or the underlying library change.
+*/
+class StackResponse
+{
+public:
+    /*!
+    Create an empty instance. All the transmissions will be one.
+    */
+    StackResponse();
+
+    /*!
+    Tabulate the response of the given stack between minimumEnergy and maximumEnergy (in keV)
+    using pointsPerDecade points per decade of energy plus the energies of the mass attenuation
+    tables of the involved elements, with two points at each absorption edge.
+    */
+    StackResponse(const std::vector<Layer> & beamFilters, \
+                  const std::vector<Layer> & attenuators, \
+                  const Detector & detector, \
+                  const Elements & elementsLibrary, \
+                  const double & minimumEnergy = 1.0, \
+                  const double & maximumEnergy = 100.0, \
+                  const int & pointsPerDecade = 500);
+
+    /*!
+    Rebuild the tables. Same arguments as the constructor.
+    */
+    void update(const std::vector<Layer> & beamFilters, \
+                const std::vector<Layer> & attenuators, \
+                const Detector & detector, \
+                const Elements & elementsLibrary, \
+                const double & minimumEnergy = 1.0, \
+                const double & maximumEnergy = 100.0, \
+                const int & pointsPerDecade = 500);
+
+    /*!
+    Energies (in keV) at which the response is tabulated.
+    */
+    const std::vector<double> & getEnergies() const;
+
+    /*!
+    Fraction of the incoming beam transmitted through the beam filters.
+    */
+    double getBeamFilterTransmission(const double & energy) const;
+
+    /*!
+    Fraction of the emitted photons transmitted through the attenuators.
+    */
+    double getAttenuatorTransmission(const double & energy) const;
+
+    /*!
+    Intrinsic efficiency of the detector (1 - transmission) assuming normal incidence.
+    It is one when the detector has no material or no thickness.
+    */
+    double getDetectorEfficiency(const double & energy) const;
+
+    /*!
+    Product of the attenuators transmission and the intrinsic detector efficiency.
+    Geometric efficiency and sample self-absorption are not included.
+    */
+    double getDetectionEfficiency(const double & energy) const;
+
+    /*!
+    Batch versions of the above. The output vector is resized to the size of the input.
+    Ordered energies are the most efficient input.
+    */
+    void getBeamFilterTransmission(const std::vector<double> & energy, std::vector<double> & result) const;
+    void getAttenuatorTransmission(const std::vector<double> & energy, std::vector<double> & result) const;
+    void getDetectorEfficiency(const std::vector<double> & energy, std::vector<double> & result) const;
+    void getDetectionEfficiency(const std::vector<double> & energy, std::vector<double> & result) const;
+
+    /*!
+    The tabulated curves, for instance to plot or export them.
+    The keys are "energy", "filters", "attenuators", "detector" and "efficiency".
+    */
+    std::map<std::string, std::vector<double> > getCurves() const;
+
+    /*!
+    Same curves interpolated at the given energies, in increasing order.
+    */
+    std::map<std::string, std::vector<double> > getCurves(const std::vector<double> & energies) const;
+
+private:
+    void addEdges(const Layer & layer, const Elements & elementsLibrary, \
+                  const double & minimumEnergy, const double & maximumEnergy);
+    std::vector<double>::size_type getIndex(const double & energy, \
+                                            std::vector<double>::size_type hint) const;
+    double interpolate(const std::vector<double> & attenuation, const double & energy, \
+                       std::vector<double>::size_type & hint) const;
+    void interpolate(const std::vector<double> & attenuation, const std::vector<double> & energy, \
+                     std::vector<double> & result) const;
+
+    std::vector<double> energies;
+    std::vector<double> logEnergies;
+    // The tables contain -log(transmission), a smooth function between absorption edges
+    std::vector<double> filterAttenuation;
+    std::vector<double> attenuatorAttenuation;
+    std::vector<double> detectorAttenuation;
+    bool hasDetector;
+};
+
+} // namespace fisx
+
+#endif // FISX_STACKRESPONSE_H
@@ -1,11 +1,14 @@
 #include "fisx_xrf.h"
 #include "fisx_math.h"
 #include "fisx_simpleini.h"
+#include "fisx_compositionengine.h"
+#include "fisx_logger.h"
 #include <cmath>
 #include <stdexcept>
-#include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <set>
+#include <algorithm>
 
 namespace fisx
 {
@@ -15,23 +18,33 @@ XRF::XRF()
     // initialize geometry with default parameters
     this->configuration = XRFConfig();
     this->setGeometry(45., 45.);
+    this->beamCompressionTolerance = 0.0;
+    this->beamCompressionError = 0.0;
+    this->compressedBeamLibrary = NULL;
+    this->compressedBeamRevision = 0;
     //this->elements = NULL;
 };
 
 XRF::XRF(const std::string & fileName)
 {
+    this->beamCompressionTolerance = 0.0;
+    this->beamCompressionError = 0.0;
+    this->compressedBeamLibrary = NULL;
+    this->compressedBeamRevision = 0;
     this->readConfigurationFromFile(fileName);
     //this->elements = NULL;
 }
 
 void XRF::readConfigurationFromFile(const std::string & fileName)
 {
+    this->compressedBeamLibrary = NULL;
     this->recentBeam = true;
     this->configuration.readConfigurationFromFile(fileName);
 }
 
 void XRF::setGeometry(const double & alphaIn, const double & alphaOut, const double & scatteringAngle)
 {
+    this->compressedBeamLibrary = NULL;
     this->recentBeam = true;
     if (scatteringAngle < 0.0)
     {
@@ -45,12 +58,14 @@ void XRF::setGeometry(const double & alphaIn, const double & alphaOut, const dou
 
 void XRF::setBeam(const Beam & beam)
 {
+    this->compressedBeamLibrary = NULL;
     this->recentBeam = true;
     this->configuration.setBeam(beam);
 }
 
 void XRF::setBeam(const double & energy, const double & divergency)
 {
+    this->compressedBeamLibrary = NULL;
     this->recentBeam = true;
     this->configuration.setBeam(energy, divergency);
 }
@@ -60,17 +75,20 @@ void XRF::setBeam(const std::vector<double> & energies, \
                  const std::vector<int> & characteristic, \
                  const std::vector<double> & divergency)
 {
+    this->compressedBeamLibrary = NULL;
     this->configuration.setBeam(energies, weight, characteristic, divergency);
 }
 
 void XRF::setBeamFilters(const std::vector<Layer> &layers)
 {
+    this->compressedBeamLibrary = NULL;
     this->recentBeam = true;
     this->configuration.setBeamFilters(layers);
 }
 
 void XRF::setSample(const std::vector<Layer> & layers, const int & referenceLayer)
 {
+    this->compressedBeamLibrary = NULL;
     this->configuration.setSample(layers, referenceLayer);
 }
 
@@ -79,6 +97,8 @@ void XRF::setSample(const std::string & name, \
                    const double & thickness)
 {
     std::vector<Layer> vLayer;
+
+    this->compressedBeamLibrary = NULL;
     vLayer.push_back(Layer(name, density, thickness, 1.0));
     this->configuration.setSample(vLayer, 0);
 }
@@ -86,6 +106,8 @@ void XRF::setSample(const std::string & name, \
 void XRF::setSample(const Layer & layer)
 {
     std::vector<Layer> vLayer;
+
+    this->compressedBeamLibrary = NULL;
     vLayer.push_back(layer);
     this->configuration.setSample(vLayer, 0);
 }
@@ -93,14 +115,212 @@ void XRF::setSample(const Layer & layer)
 
 void XRF::setAttenuators(const std::vector<Layer> & attenuators)
 {
+    this->compressedBeamLibrary = NULL;
     this->configuration.setAttenuators(attenuators);
 }
 
 void XRF::setDetector(const Detector & detector)
 {
+    this->compressedBeamLibrary = NULL;
     this->configuration.setDetector(detector);
 }
 
+void XRF::addDetector(const Detector & detector, const double & alphaOut, \
+                      const std::vector<Layer> & attenuators)
+{
+    this->configuration.addDetector(detector, alphaOut, attenuators);
+}
+
+void XRF::clearAdditionalDetectors()
+{
+    this->configuration.clearAdditionalDetectors();
+}
+
+const XRFConfig & XRF::getConfiguration() const
+{
+    return this->configuration;
+}
+
+void XRF::setConfiguration(const XRFConfig & configuration)
+{
+    this->compressedBeamLibrary = NULL;
+    this->recentBeam = true;
+    this->configuration = configuration;
+}
+
+void XRF::setBeamCompression(const double & tolerance)
+{
+    if (tolerance < 0.0)
+    {
+        throw std::invalid_argument("XRF::setBeamCompression. Tolerance cannot be negative");
+    }
+    this->beamCompressionTolerance = tolerance;
+    this->beamCompressionError = 0.0;
+    this->compressedBeamLibrary = NULL;
+}
+
+const double & XRF::getBeamCompression() const
+{
+    return this->beamCompressionTolerance;
+}
+
+const double & XRF::getBeamCompressionErrorEstimate() const
+{
+    return this->beamCompressionError;
+}
+
+const Beam & XRF::getExcitationBeam(const Elements & elementsLibrary)
+{
+    if (this->beamCompressionTolerance <= 0.0)
+    {
+        this->beamCompressionError = 0.0;
+        return this->configuration.getBeam();
+    }
+    // the setters reset the library, the library revision tracks its own changes
+    if ((this->compressedBeamLibrary != &elementsLibrary) || \
+        (this->compressedBeamRevision != elementsLibrary.getRevision()))
+    {
+        this->compressedBeam = this->getCompressedBeam(elementsLibrary, this->beamCompressionTolerance, \
+                                                       this->beamCompressionError);
+        this->compressedBeamLibrary = &elementsLibrary;
+        this->compressedBeamRevision = elementsLibrary.getRevision();
+    }
+    return this->compressedBeam;
+}
+
+Beam XRF::getCompressedBeam(const Elements & elementsLibrary, const double & tolerance, \
+                            double & estimatedError) const
+{
+    Beam beam = this->configuration.getBeam();
+    std::vector<std::vector<double> > rays;
+    const std::vector<Layer> & filters = this->configuration.getBeamFilters();
+    const std::vector<Layer> & sample = this->configuration.getSample();
+    const std::vector<Layer> & attenuators = this->configuration.getAttenuators();
+    std::vector<const Layer *> layers;
+    std::vector<const Layer *>::size_type iLayer;
+    std::map<std::string, double> composition;
+    std::map<std::string, double>::const_iterator c_it;
+    std::map<std::string, double>::const_iterator e_it;
+    std::vector<double> edges;
+    std::vector<double> filterTransmission, transmission, opticalDepth, mu, absorbed;
+    std::vector<double> photoelectric, coherent, compton, pair, total;
+    std::vector<std::vector<double> > responses, elementPhotoelectric;
+    std::vector<std::vector<double> >::size_type j;
+    std::set<std::string> elementNames;
+    std::set<std::string>::const_iterator n_it;
+    std::vector<double>::size_type i, nEnergies;
+    const double PI = acos(-1.0);
+    double sinAlphaIn = sin(this->configuration.getAlphaIn() * (PI / 180.));
+    double depth;
+
+    estimatedError = 0.0;
+    beam.getBeamAsDoubleVectors(rays);
+    const std::vector<double> & energies = rays[0];
+    nEnergies = energies.size();
+    if (nEnergies < 2)
+    {
+        return beam;
+    }
+
+    // absorption edges of every element met by the beam or by the fluorescence
+    for (i = 0; i < filters.size(); i++)
+        layers.push_back(&filters[i]);
+    for (i = 0; i < sample.size(); i++)
+        layers.push_back(&sample[i]);
+    for (i = 0; i < attenuators.size(); i++)
+        layers.push_back(&attenuators[i]);
+    layers.push_back(&this->configuration.getDetector());
+    for (iLayer = 0; iLayer < layers.size(); iLayer++)
+    {
+        if ((!layers[iLayer]->hasMaterialComposition()) && (layers[iLayer]->getMaterialName().size() == 0))
+        {
+            continue;
+        }
+        composition = layers[iLayer]->getComposition(elementsLibrary);
+        for (c_it = composition.begin(); c_it != composition.end(); ++c_it)
+        {
+            const std::map<std::string, double> & bindingEnergies = \
+                                                elementsLibrary.getBindingEnergies(c_it->first);
+            for (e_it = bindingEnergies.begin(); e_it != bindingEnergies.end(); ++e_it)
+            {
+                if (e_it->second > 0.0)
+                {
+                    edges.push_back(e_it->second);
+                }
+            }
+        }
+    }
+
+    // photoelectric absorption in each layer of the sample of every element present in any layer,
+    // the fluorescence of an element can be requested from a layer not containing it
+    elementNames.clear();
+    for (iLayer = 0; iLayer < sample.size(); iLayer++)
+    {
+        composition = sample[iLayer].getComposition(elementsLibrary);
+        for (c_it = composition.begin(); c_it != composition.end(); ++c_it)
+        {
+            elementNames.insert(c_it->first);
+        }
+    }
+    photoelectric.resize(nEnergies);
+    coherent.resize(nEnergies);
+    compton.resize(nEnergies);
+    pair.resize(nEnergies);
+    total.resize(nEnergies);
+    elementPhotoelectric.clear();
+    for (n_it = elementNames.begin(); n_it != elementNames.end(); ++n_it)
+    {
+        elementsLibrary.getMassAttenuationCoefficients(*n_it, &energies[0], (int) nEnergies, \
+                                                       &total[0], &photoelectric[0], &coherent[0], \
+                                                       &compton[0], &pair[0]);
+        elementPhotoelectric.push_back(photoelectric);
+    }
+    filterTransmission.resize(nEnergies, 1.0);
+    for (iLayer = 0; iLayer < filters.size(); iLayer++)
+    {
+        filters[iLayer].getTransmission(energies, elementsLibrary, 90.0, transmission);
+        for (i = 0; i < nEnergies; i++)
+        {
+            filterTransmission[i] *= transmission[i];
+        }
+    }
+    opticalDepth.resize(nEnergies, 0.0);
+    mu.resize(nEnergies);
+    absorbed.resize(nEnergies);
+    for (iLayer = 0; iLayer < sample.size(); iLayer++)
+    {
+        sample[iLayer].getMassAttenuationCoefficients(&energies[0], (int) nEnergies, elementsLibrary, \
+                                                      &mu[0], &photoelectric[0], &coherent[0], \
+                                                      &compton[0], &pair[0]);
+        depth = sample[iLayer].getDensity() * sample[iLayer].getThickness() / sinAlphaIn;
+        for (i = 0; i < nEnergies; i++)
+        {
+            absorbed[i] = filterTransmission[i] * exp(-opticalDepth[i]);
+            if (mu[i] > 0.0)
+            {
+                absorbed[i] *= (1.0 - exp(-mu[i] * depth)) / mu[i];
+            }
+            opticalDepth[i] += mu[i] * depth;
+        }
+        // the tolerance applies to each response, there is no need to scale by the mass fraction
+        for (j = 0; j < elementPhotoelectric.size(); j++)
+        {
+            responses.push_back(std::vector<double>(nEnergies));
+            for (i = 0; i < nEnergies; i++)
+            {
+                responses.back()[i] = elementPhotoelectric[j][i] * absorbed[i];
+            }
+        }
+    }
+    estimatedError = beam.compress(edges, tolerance, responses);
+    return beam;
+}
+
+const Profile & XRF::getProfile() const
+{
+    return this->profile;
+}
+
 std::map<std::string, std::map<std::string, double> > XRF::getFluorescence(const std::string & elementName, \
                 const Elements & elementsLibrary, const int & sampleLayerIndex, \
                 const std::string & lineFamily, const int & secondary, const int & useGeometricEfficiency)
@@ -129,7 +349,7 @@ std::map<std::string, std::map<std::string, double> > XRF::getFluorescence(const
     double tmpDouble;
     std::string tmpString;
 
-    std::cout << "WARNING: This method is obsolete. Use any of the getMultilayerFluorescnce ones" << std::endl;
+    FISX_LOG_WARNING("XRF::getFluorescence", "This method is obsolete. Use any of the getMultilayerFluorescence ones");
     if (actualRays.size() == 0)
     {
         // no excitation beam
@@ -160,7 +380,8 @@ std::map<std::string, std::map<std::string, double> > XRF::getFluorescence(const
         }
         else if ((lineFamily == "L") || (lineFamily == "M"))
         {
-            std::cout << "I should assume an initial vacancy distribution given by the jumps. " << std::endl;
+            FISX_LOG_DEBUG("XRF::getFluorescence", \
+                           "I should assume an initial vacancy distribution given by the jumps");
             msg = "Excitation energy needed in order to properly calculate intensity ratios.";
             throw std::invalid_argument( msg );
         }
@@ -413,11 +634,11 @@ std::map<std::string, std::map<std::string, double> > XRF::getFluorescence(const
     return actualResult;
 }
 
-double XRF::getGeometricEfficiency(const int & sampleLayerIndex) const
+double XRF::getGeometricEfficiency(const int & sampleLayerIndex, const int & detectorIndex) const
 {
-    const Detector & detector = this->configuration.getDetector();
+    const Detector & detector = this->configuration.getDetector(detectorIndex);
     const double PI = acos(-1.0);
-    const double & sinAlphaOut = sin(this->configuration.getAlphaOut()*(PI/180.));
+    const double & sinAlphaOut = sin(this->configuration.getAlphaOut(detectorIndex)*(PI/180.));
     const double & detectorDistance = detector.getDistance();
     const double & detectorDiameter = detector.getDiameter();
     double distance;
@@ -468,7 +689,7 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
                 const Elements & elementsLibrary, const int & sampleLayerIndex, \
                 const std::string & lineFamily, const int & secondary, \
                 const int & useGeometricEfficiency, const int & useMassFractions, \
-                const double & optimizationFactor )
+                const double & optimizationFactor, const int & detailLevel)
 {
     std::vector<std::string> elementList;
     std::vector<std::string> familyList;
@@ -478,11 +699,6 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
     std::vector<std::string> tmpStringVector;
 
     elementList.push_back(elementName);
-
-    if (lineFamily == "")
-    {
-        throw std::invalid_argument("Please specify K, L or M as peak family");
-    }
     familyList.push_back(lineFamily);
     if (sampleLayerIndex < 0)
     {
@@ -491,7 +707,7 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
     layerList.push_back(sampleLayerIndex);
     return this->getMultilayerFluorescence(elementList, elementsLibrary, layerList, familyList, \
                                            secondary, useGeometricEfficiency, useMassFractions, \
-                                           optimizationFactor);
+                                           optimizationFactor, detailLevel);
 }
 
 double XRF::getEnergyThreshold(const std::string & elementName, const std::string & family, \
@@ -523,21 +739,171 @@ double XRF::getEnergyThreshold(const std::string & elementName, const std::strin
             return binding["M2"];
         return binding["M1"]; // It can be 0.0
     }
+
+    if (family == "")
+    {
+        // the lowest energy at which any of the K, L or M families is excited
+        double threshold;
+        double familyThreshold;
+        std::string families[3] = {"K", "L", "M"};
+        threshold = 0.0;
+        for (int i = 0; i < 3; i++)
+        {
+            familyThreshold = this->getEnergyThreshold(elementName, families[i], elementsLibrary);
+            if ((familyThreshold > 0.0) && ((threshold == 0.0) || (familyThreshold < threshold)))
+            {
+                threshold = familyThreshold;
+            }
+        }
+        return threshold;
+    }
     return 0.0;
 }
 
+StackResponse XRF::getStackResponse(const Elements & elementsLibrary, \
+                                    const double & minimumEnergy, \
+                                    const double & maximumEnergy, \
+                                    const int & pointsPerDecade) const
+{
+    return StackResponse(this->configuration.getBeamFilters(), \
+                         this->configuration.getAttenuators(), \
+                         this->configuration.getDetector(), \
+                         elementsLibrary, \
+                         minimumEnergy, maximumEnergy, pointsPerDecade);
+}
+
+std::map<std::string, std::vector<double> > XRF::getFluorescenceScan(const std::vector<double> & energies, \
+                                          const std::vector<std::string> & elementFamilyList, \
+                                          const Elements & elementsLibrary, \
+                                          const int & layerIndex, \
+                                          const int & secondary, \
+                                          const int & useGeometricEfficiency) const
+{
+    std::map<std::string, std::vector<double> > result;
+    std::map<std::string, double> composition;
+    std::map<std::string, double>::const_iterator c_it;
+    std::vector<std::string> elementList;
+    std::vector<double> massFractions;
+    std::vector<double> rates;
+    std::vector<double>::size_type i, iFamily;
+    XRFConfig scanConfiguration;
+    CompositionEngine engine;
+
+    if ((layerIndex < 0) || (layerIndex >= (int) this->configuration.getSample().size()))
+    {
+        throw std::invalid_argument("getFluorescenceScan. Invalid sample layer index");
+    }
+    if ((secondary < 0) || (secondary > 1))
+    {
+        throw std::invalid_argument("getFluorescenceScan. Secondary must be 0 or 1");
+    }
+    for (i = 1; i < energies.size(); i++)
+    {
+        if (energies[i] < energies[i - 1])
+        {
+            throw std::invalid_argument("getFluorescenceScan. Energies must be in increasing order");
+        }
+    }
+    for (iFamily = 0; iFamily < elementFamilyList.size(); iFamily++)
+    {
+        result[elementFamilyList[iFamily]].resize(energies.size(), 0.0);
+    }
+    if (energies.size() < 1)
+    {
+        return result;
+    }
+
+    composition = this->configuration.getSample()[layerIndex].getComposition(elementsLibrary);
+    for (c_it = composition.begin(); c_it != composition.end(); ++c_it)
+    {
+        elementList.push_back(c_it->first);
+        massFractions.push_back(c_it->second);
+    }
+    for (iFamily = 0; iFamily < elementFamilyList.size(); iFamily++)
+    {
+        // families of elements absent from the layer give zero
+        if (composition.find(elementFamilyList[iFamily].substr(0, elementFamilyList[iFamily].find(' '))) == \
+            composition.end())
+        {
+            elementList.push_back(elementFamilyList[iFamily].substr(0, elementFamilyList[iFamily].find(' ')));
+            massFractions.push_back(0.0);
+        }
+    }
+
+    scanConfiguration = this->configuration;
+    scanConfiguration.setBeam(energies, std::vector<double>(energies.size(), 1.0), \
+                              std::vector<int>(energies.size(), 1), \
+                              std::vector<double>(energies.size(), 0.0));
+    engine.update(scanConfiguration, elementsLibrary, elementList, elementFamilyList, \
+                  layerIndex, secondary, useGeometricEfficiency);
+    rates = engine.getRayRates(massFractions);
+    // the beam is normalized, each ray carries 1 / energies.size() of the weight
+    for (i = 0; i < energies.size(); i++)
+    {
+        for (iFamily = 0; iFamily < elementFamilyList.size(); iFamily++)
+        {
+            result[elementFamilyList[iFamily]][i] = rates[i * elementFamilyList.size() + iFamily] * \
+                                                    energies.size();
+        }
+    }
+    return result;
+}
+
 std::map<std::string, std::vector<double> > XRF::getSpectrum(const std::vector<double> & channel, \
                 const std::map<std::string, double> & detectorParameters, \
                 const std::map<std::string, double> & shapeParameters, \
                 const std::map<std::string, double> & peakFamilyArea, \
                 const expectedLayerEmissionType & emissionRatios) const
 {
-    std::map<std::string, double>::const_iterator c_it;
     std::map<std::string, std::vector<double> > result;
-    for (c_it = shapeParameters.begin(); c_it != shapeParameters.end(); ++c_it)
+    std::map<std::string, double>::const_iterator c_it;
+    std::vector<std::vector<double> > peaks;
+    std::vector<std::vector<double> > pileUp;
+    std::vector<double> energy;
+    std::vector<double> spectrum;
+    std::vector<double> totalPileUp;
+    std::vector<double>::size_type i, iFamily;
+
+    energy.resize(channel.size());
+    spectrum.resize(channel.size(), 0.0);
+    totalPileUp.resize(channel.size(), 0.0);
+    if (channel.size() > 0)
+    {
+        this->getSpectrumContributions(&channel[0], &energy[0], (int) channel.size(), \
+                                       detectorParameters, shapeParameters, peakFamilyArea, \
+                                       emissionRatios, 1, peaks, pileUp);
+    }
+    iFamily = 0;
+    for (c_it = peakFamilyArea.begin(); c_it != peakFamilyArea.end(); ++c_it)
+    {
+        if (channel.size() == 0)
+        {
+            result[c_it->first] = std::vector<double>();
+            continue;
+        }
+        for (i = 0; i < channel.size(); i++)
+        {
+            spectrum[i] += peaks[iFamily][i];
+        }
+        result[c_it->first] = peaks[iFamily];
+        if (pileUp.size() > 0)
+        {
+            for (i = 0; i < channel.size(); i++)
+            {
+                totalPileUp[i] += pileUp[iFamily][i];
+            }
+            result[c_it->first + " pileup"] = pileUp[iFamily];
+        }
+        iFamily++;
+    }
+    for (i = 0; i < channel.size(); i++)
     {
-        std::cout << "Key = " << c_it->first << " Value " << c_it->second << std::endl;
+        spectrum[i] += totalPileUp[i];
     }
+    result["channel"] = channel;
+    result["energy"] = energy;
+    result["spectrum"] = spectrum;
+    result["pileup"] = totalPileUp;
     return result;
 }
 
@@ -547,24 +913,62 @@ void XRF::getSpectrum(double * channel, double * energy, double *spectrum, int n
                 const std::map<std::string, double> & peakFamilyArea, \
                 const expectedLayerEmissionType & emissionRatios) const
 {
+    std::vector<std::vector<double> > peaks;
+    std::vector<std::vector<double> > pileUp;
+    std::vector<double>::size_type iFamily;
     int i;
-    std::string detectorKeys[5] = {"Zero", "Gain", "Noise", "Fano", "QuantumEnergy"};
-    std::string shapeKeys[6] = {"ShortTailArea", "ShortTailSlope", "LongTailArea", "LongTailSlope", "StepHeight", \
-                                "Eta"};
+
+    this->getSpectrumContributions(channel, energy, nChannels, detectorParameters, shapeParameters, \
+                                   peakFamilyArea, emissionRatios, 0, peaks, pileUp);
+    for (i = 0; i < nChannels; i++)
+    {
+        spectrum[i] = 0.0;
+    }
+    for (iFamily = 0; iFamily < peaks.size(); iFamily++)
+    {
+        for (i = 0; i < nChannels; i++)
+        {
+            spectrum[i] += peaks[iFamily][i];
+        }
+    }
+    for (iFamily = 0; iFamily < pileUp.size(); iFamily++)
+    {
+        for (i = 0; i < nChannels; i++)
+        {
+            spectrum[i] += pileUp[iFamily][i];
+        }
+    }
+}
+
+void XRF::getSpectrumContributions(const double * channel, double * energy, const int & nChannels, \
+                const std::map<std::string, double> & detectorParameters, \
+                const std::map<std::string, double> & shapeParameters, \
+                const std::map<std::string, double> & peakFamilyArea, \
+                const expectedLayerEmissionType & emissionRatios, \
+                const int & separatePileUp, \
+                std::vector<std::vector<double> > & peaks, \
+                std::vector<std::vector<double> > & pileUp) const
+{
+    int i, k;
     std::map<std::string, double>::const_iterator c_it;
+    std::vector<std::vector<double> >::size_type iFamily;
 
     std::string tmpString;
-    std::vector<std::string> tmpStringVector;
-    double zero, gain, noise, fano, quantum;
-    int layerIndex;
+    double zero = 0.0, gain = 1.0, noise = 0.1, fano = 0.114, quantum = 0.00385;
+    double countRate = 0.0, pileUpTime = 0.0, pileUpOrder = 2;
+    double highestEnergy, maximumEnergy;
+    double x, area, fraction, tmpDouble, a, b;
+    int nGrid, nFFT;
+    std::vector<double> gridEnergy;
+    std::vector<std::vector<double> > gridPeaks;
+    std::vector<double> realPart, imaginaryPart;
+    std::vector<double> kernelReal, kernelImaginary;
+    std::vector<double> total;
 
-    double area;
-    double position;
-    double fwhm;
-    double shortTailArea = 0.0, shortTailSlope = -1.0;
-    double longTailArea = 0.0, longTailSlope = -1.0;
-    double stepHeight = 0.0;
-    double eta = 0.0;
+    for (c_it = shapeParameters.begin(); c_it != shapeParameters.end(); ++c_it)
+    {
+        FISX_LOG_DEBUG("XRF::getSpectrum", "Key = " << c_it->first << " Value " << c_it->second);
+    }
 
     for (c_it = detectorParameters.begin(); c_it != detectorParameters.end(); ++c_it)
     {
@@ -595,159 +999,284 @@ void XRF::getSpectrum(double * channel, double * energy, double *spectrum, int n
             quantum = c_it->second;
             continue;
         }
-        std::cout << "WARNING: Unused detector parameter "<< c_it->first << " with value " << c_it->second << std::endl;
+        if (tmpString == "COUNTRATE")
+        {
+            countRate = c_it->second;
+            continue;
+        }
+        if (tmpString == "PILEUPTIME")
+        {
+            pileUpTime = c_it->second;
+            continue;
+        }
+        if (tmpString == "PILEUPORDER")
+        {
+            pileUpOrder = c_it->second;
+            continue;
+        }
+        FISX_LOG_WARNING("XRF::getSpectrum", "Unused detector parameter " << c_it->first << \
+                         " with value " << c_it->second);
     }
 
     for (i = 0; i < nChannels; i++)
     {
         energy[i] = zero + gain * channel[i];
     }
-    for (i = 0; i < nChannels; i++)
+
+    peaks.clear();
+    pileUp.clear();
+    peaks.resize(peakFamilyArea.size());
+    highestEnergy = 0.0;
+    iFamily = 0;
+    for (c_it = peakFamilyArea.begin(); c_it != peakFamilyArea.end(); ++c_it)
     {
-        spectrum[i] = 0.0;
+        peaks[iFamily].resize(nChannels, 0.0);
+        if (nChannels > 0)
+        {
+            this->addPeakFamilySpectrum(c_it->first, c_it->second, emissionRatios, energy, nChannels, \
+                                        noise, fano, quantum, &(peaks[iFamily][0]), highestEnergy);
+        }
+        iFamily++;
+    }
+
+    x = countRate * pileUpTime;
+    if ((x <= 0.0) || (pileUpOrder < 1) || (nChannels < 1) || (peaks.size() < 1))
+    {
+        return;
+    }
+    if (gain <= 0.0)
+    {
+        throw std::invalid_argument("XRF::getSpectrum. Pile-up calculation requires a positive gain");
     }
 
+    // The pile-up of photons of energies E1 and E2 lands at E1 + E2. The convolutions are evaluated
+    // on a grid of step gain starting at zero energy. The grid covers all the peaks because the
+    // normalization needs the whole spectrum.
+    maximumEnergy = highestEnergy;
+    for (i = 0; i < nChannels; i++)
+    {
+        if (energy[i] > maximumEnergy)
+        {
+            maximumEnergy = energy[i];
+        }
+    }
+    nGrid = (int) (maximumEnergy / gain) + 2;
+    gridEnergy.resize(nGrid);
+    for (k = 0; k < nGrid; k++)
+    {
+        gridEnergy[k] = k * gain;
+    }
+    gridPeaks.resize(peaks.size());
+    total.resize(nGrid, 0.0);
+    tmpDouble = 0.0;
+    iFamily = 0;
     for (c_it = peakFamilyArea.begin(); c_it != peakFamilyArea.end(); ++c_it)
     {
-        std::map<int, std::map<std::string, std::map<std::string, double> > > ::const_iterator layerIterator;
-        std::map<std::string, std::map<std::string, double> >::const_iterator lineIterator;
-        std::map<std::string, double>::const_iterator ratePointer;
-        std::vector<double> layerTotalSignal;
-        double totalSignal;
-        iteratorExpectedLayerEmissionType emissionRatiosPointer;
-        emissionRatiosPointer = emissionRatios.find(c_it->first);
-        // check if the description of that peak multiplet is available
-        if (emissionRatiosPointer != emissionRatios.end())
-        {
-            // In this case emission ratios has the form "Cr K".
-            // Remmeber that peakFamily can have the form "Cr K 0"
-            // We have to sum all the signals, to normalize to unit area, and multiply by the supplied
-            // area. This could have been already done ...
-            // loop for each layer
-            layerTotalSignal.clear();
-            totalSignal = 0.0;
-            for (layerIterator = emissionRatiosPointer->second.begin();
-                 layerIterator != emissionRatiosPointer->second.end(); ++layerIterator)
-            {
-                layerTotalSignal.push_back(0.0);
-                for (lineIterator = layerIterator->second.begin(); \
-                     lineIterator != layerIterator->second.end(); ++lineIterator)
-                {
-                    ratePointer = lineIterator->second.find("rate");
-                    if (ratePointer == lineIterator->second.end())
-                    {
-                        tmpString = "Keyword <rate> not found!!!";
-                        std::cout << tmpString << std::cout;
-                        throw std::invalid_argument(tmpString);
-                    }
-                    layerTotalSignal[layerTotalSignal.size() - 1] += ratePointer->second;
-                }
-                totalSignal += layerTotalSignal[layerTotalSignal.size() - 1];
-            }
-           // Now we already have area (provided) and ratio (dividing by totalSignal).
-           // We can therefore calculate the signal keeping the proper ratios.
-            for (layerIterator = emissionRatiosPointer->second.begin();
-                 layerIterator != emissionRatiosPointer->second.end(); ++layerIterator)
-            {
-                for (lineIterator = layerIterator->second.begin(); \
-                     lineIterator != layerIterator->second.end(); ++lineIterator)
-                {
-                    ratePointer = lineIterator->second.find("rate");
-                    area = c_it->second * (ratePointer->second / totalSignal);
-                    ratePointer = lineIterator->second.find("energy");
-                    if (ratePointer == lineIterator->second.end())
-                    {
-                        tmpString = "Keyword <energy> not found!!!";
-                        std::cout << tmpString << std::cout;
-                        throw std::invalid_argument(tmpString);
-                    }
-                    position = ratePointer->second;
-                    fwhm = Math::getFWHM(position, noise, fano, quantum);
-                    for (i = 0; i < nChannels; i++)
-                    {
-                        spectrum[i] += Math::hypermet(energy[i], \
-                                                      area, position, fwhm, \
-                                                      shortTailArea, shortTailSlope, \
-                                                      longTailArea, longTailSlope, stepHeight);
-                    }
-                }
-            }
+        gridPeaks[iFamily].resize(nGrid, 0.0);
+        this->addPeakFamilySpectrum(c_it->first, c_it->second, emissionRatios, &gridEnergy[0], nGrid, \
+                                    noise, fano, quantum, &(gridPeaks[iFamily][0]), tmpDouble);
+        for (k = 0; k < nGrid; k++)
+        {
+            total[k] += gridPeaks[iFamily][k];
+        }
+        iFamily++;
+    }
+    area = 0.0;
+    for (k = 0; k < nGrid; k++)
+    {
+        area += total[k];
+    }
+    area *= gain;
+
+    pileUp.resize(separatePileUp ? peaks.size() : 1);
+    for (iFamily = 0; iFamily < pileUp.size(); iFamily++)
+    {
+        pileUp[iFamily].resize(nChannels, 0.0);
+    }
+    if (area <= 0.0)
+    {
+        return;
+    }
+
+    // zero padding prevents the circular wrap of the convolutions
+    nFFT = 1;
+    while (nFFT < ((pileUpOrder < 2) ? 2 : 3) * nGrid)
+    {
+        nFFT <<= 1;
+    }
+    kernelReal.resize(nFFT, 0.0);
+    kernelImaginary.resize(nFFT, 0.0);
+    std::copy(total.begin(), total.end(), kernelReal.begin());
+    Math::fft(&kernelReal[0], &kernelImaginary[0], nFFT);
+    // x * S / A + x^2 * S * S / (2 A^2) in the Fourier space, with the gain of the discrete convolution
+    tmpDouble = x * gain / area;
+    for (k = 0; k < nFFT; k++)
+    {
+        a = tmpDouble * kernelReal[k];
+        b = tmpDouble * kernelImaginary[k];
+        kernelReal[k] = a;
+        kernelImaginary[k] = b;
+        if (pileUpOrder >= 2)
+        {
+            kernelReal[k] += 0.5 * (a * a - b * b);
+            kernelImaginary[k] += a * b;
+        }
+    }
+
+    for (iFamily = 0; iFamily < pileUp.size(); iFamily++)
+    {
+        realPart.assign(nFFT, 0.0);
+        imaginaryPart.assign(nFFT, 0.0);
+        if (separatePileUp)
+        {
+            std::copy(gridPeaks[iFamily].begin(), gridPeaks[iFamily].end(), realPart.begin());
         }
         else
         {
-            tmpString = "";
-            SimpleIni::parseStringAsMultipleValues(c_it->first, tmpStringVector, tmpString, ' ');
-            if(tmpStringVector.size() != 3)
+            std::copy(total.begin(), total.end(), realPart.begin());
+        }
+        Math::fft(&realPart[0], &imaginaryPart[0], nFFT);
+        for (k = 0; k < nFFT; k++)
+        {
+            tmpDouble = realPart[k] * kernelReal[k] - imaginaryPart[k] * kernelImaginary[k];
+            imaginaryPart[k] = realPart[k] * kernelImaginary[k] + imaginaryPart[k] * kernelReal[k];
+            realPart[k] = tmpDouble;
+        }
+        Math::fft(&realPart[0], &imaginaryPart[0], nFFT, 1);
+        // back to the requested energies
+        for (i = 0; i < nChannels; i++)
+        {
+            if (energy[i] < 0.0)
             {
-                tmpString = "Unsuccessul conversion to Element, Family, layer index: " + c_it->first;
+                continue;
             }
-
-            // We should have a key of the form "Cr K 0"
-            if (!SimpleIni::stringConverter(tmpStringVector[2], layerIndex))
+            fraction = energy[i] / gain;
+            k = (int) fraction;
+            if (k + 1 >= nGrid)
             {
-                tmpString = "Unsuccessul conversion to layer integer: " + tmpStringVector[2];
-                std::cout << tmpString << std::cout;
-                throw std::invalid_argument(tmpString);
+                continue;
             }
-            // TODO: Deal with Ka, Kb, L, L1, L2, L3, ...
-            tmpString = tmpStringVector[0] + " " + tmpStringVector[1];
-            emissionRatiosPointer = emissionRatios.find(tmpString);
-            if (emissionRatiosPointer == emissionRatios.end())
+            fraction -= k;
+            pileUp[iFamily][i] = (1.0 - fraction) * realPart[k] + fraction * realPart[k + 1];
+        }
+    }
+}
+
+void XRF::addPeakFamilySpectrum(const std::string & peakFamily, const double & peakFamilyArea, \
+                const expectedLayerEmissionType & emissionRatios, \
+                const double * energy, const int & nEnergies, \
+                const double & noise, const double & fano, const double & quantum, \
+                double * spectrum, double & highestEnergy) const
+{
+    int i;
+    int layerIndex;
+    std::string tmpString;
+    std::vector<std::string> tmpStringVector;
+    double area;
+    double position;
+    double fwhm;
+    double shortTailArea = 0.0, shortTailSlope = -1.0;
+    double longTailArea = 0.0, longTailSlope = -1.0;
+    double stepHeight = 0.0;
+    std::map<int, std::map<std::string, std::map<std::string, double> > > ::const_iterator layerIterator;
+    std::map<int, std::map<std::string, std::map<std::string, double> > > ::const_iterator layerEnd;
+    std::map<int, std::map<std::string, std::map<std::string, double> > > ::const_iterator layerPointer;
+    std::map<std::string, std::map<std::string, double> >::const_iterator lineIterator;
+    std::map<std::string, double>::const_iterator ratePointer;
+    double totalSignal;
+    iteratorExpectedLayerEmissionType emissionRatiosPointer;
+
+    emissionRatiosPointer = emissionRatios.find(peakFamily);
+    // check if the description of that peak multiplet is available
+    if (emissionRatiosPointer != emissionRatios.end())
+    {
+        // In this case emission ratios has the form "Cr K".
+        // We have to sum all the signals of all the layers, to normalize to unit area,
+        // and multiply by the supplied area.
+        layerIterator = emissionRatiosPointer->second.begin();
+        layerEnd = emissionRatiosPointer->second.end();
+    }
+    else
+    {
+        tmpString = "";
+        SimpleIni::parseStringAsMultipleValues(peakFamily, tmpStringVector, tmpString, ' ');
+        if(tmpStringVector.size() != 3)
+        {
+            tmpString = "Unsuccessul conversion to Element, Family, layer index: " + peakFamily;
+            throw std::invalid_argument(tmpString);
+        }
+
+        // We should have a key of the form "Cr K 0"
+        if (!SimpleIni::stringConverter(tmpStringVector[2], layerIndex))
+        {
+            tmpString = "Unsuccessul conversion to layer integer: " + tmpStringVector[2];
+            throw std::invalid_argument(tmpString);
+        }
+        // TODO: Deal with Ka, Kb, L, L1, L2, L3, ...
+        tmpString = tmpStringVector[0] + " " + tmpStringVector[1];
+        emissionRatiosPointer = emissionRatios.find(tmpString);
+        if (emissionRatiosPointer == emissionRatios.end())
+        {
+            tmpString = "Undefined emission ratios for element " + tmpStringVector[0] +\
+                        " family " + tmpStringVector[1];
+            throw std::invalid_argument(tmpString);
+        }
+        // Emission ratios has the form "Cr K" but we have received peakFamily can have the form
+        // "Cr K index". We have to to normalize the signal from that element, family and layer to
+        // unit area, and multiply by the supplied area.
+        layerIterator = emissionRatiosPointer->second.find(layerIndex);
+        if (layerIterator == emissionRatiosPointer->second.end())
+        {
+            tmpString = "I do not have information for layer number " + tmpStringVector[2];
+            throw std::invalid_argument(tmpString);
+        }
+        layerEnd = layerIterator;
+        ++layerEnd;
+    }
+
+    totalSignal = 0.0;
+    for (layerPointer = layerIterator; layerPointer != layerEnd; ++layerPointer)
+    {
+        for (lineIterator = layerPointer->second.begin(); \
+             lineIterator != layerPointer->second.end(); ++lineIterator)
+        {
+            ratePointer = lineIterator->second.find("rate");
+            if (ratePointer == lineIterator->second.end())
             {
-                tmpString = "Undefined emission ratios for element " + tmpStringVector[0] +\
-                            " family " + tmpStringVector[1];
-                std::cout << tmpString << std::cout;
+                tmpString = "Keyword <rate> not found!!!";
                 throw std::invalid_argument(tmpString);
             }
-            // Emission ratios has the form "Cr K" but we have received peakFamily can have the form "Cr K index"
-            // We have to to normalize the signal from that element, family and layer to unit area,
-            // and multiply by the supplied area. This could have been already done ...
-            layerIterator = emissionRatiosPointer->second.find(layerIndex);
-            if (layerIterator == emissionRatiosPointer->second.end())
+            totalSignal += ratePointer->second;
+        }
+    }
+
+    // Now we already have area (provided) and ratio (dividing by totalSignal).
+    // We can therefore calculate the signal keeping the proper ratios.
+    for (; layerIterator != layerEnd; ++layerIterator)
+    {
+        for (lineIterator = layerIterator->second.begin(); \
+             lineIterator != layerIterator->second.end(); ++lineIterator)
+        {
+            ratePointer = lineIterator->second.find("rate");
+            area = peakFamilyArea * (ratePointer->second / totalSignal);
+            ratePointer = lineIterator->second.find("energy");
+            if (ratePointer == lineIterator->second.end())
             {
-                tmpString = "I do not have information for layer number " + tmpStringVector[2];
-                std::cout << tmpString << std::cout;
+                tmpString = "Keyword <energy> not found!!!";
                 throw std::invalid_argument(tmpString);
             }
-            layerTotalSignal.clear();
-            totalSignal = 0.0;
-            layerTotalSignal.push_back(0.0);
-            for (lineIterator = layerIterator->second.begin(); \
-                 lineIterator != layerIterator->second.end(); ++lineIterator)
+            position = ratePointer->second;
+            fwhm = Math::getFWHM(position, noise, fano, quantum);
+            if ((position + 5 * fwhm) > highestEnergy)
             {
-                ratePointer = lineIterator->second.find("rate");
-                if (ratePointer == lineIterator->second.end())
-                {
-                    tmpString = "Keyword <rate> not found!!!";
-                    std::cout << tmpString << std::cout;
-                    throw std::invalid_argument(tmpString);
-                }
-                layerTotalSignal[layerTotalSignal.size() - 1] += ratePointer->second;
+                highestEnergy = position + 5 * fwhm;
             }
-            totalSignal += layerTotalSignal[layerTotalSignal.size() - 1];
-            // Now we already have area (provided) and ratio (dividing by totalSignal).
-            // We can therefore calculate the signal keeping the proper ratios.
-            for (lineIterator = layerIterator->second.begin(); \
-                 lineIterator != layerIterator->second.end(); ++lineIterator)
+            for (i = 0; i < nEnergies; i++)
             {
-                ratePointer = lineIterator->second.find("rate");
-                area = c_it->second * (ratePointer->second / totalSignal);
-                ratePointer = lineIterator->second.find("energy");
-                if (ratePointer == lineIterator->second.end())
-                {
-                    tmpString = "Keyword <energy> not found!!!";
-                    std::cout << tmpString << std::cout;
-                    throw std::invalid_argument(tmpString);
-                }
-                position = ratePointer->second;
-                fwhm = Math::getFWHM(position, noise, fano, quantum);
-                for (i = 0; i < nChannels; i++)
-                {
-                    spectrum[i] += Math::hypermet(energy[i], \
-                                                  area, position, fwhm, \
-                                                  shortTailArea, shortTailSlope, \
-                                                  longTailArea, longTailSlope, stepHeight);
-                }
+                spectrum[i] += Math::hypermet(energy[i], \
+                                              area, position, fwhm, \
+                                              shortTailArea, shortTailSlope, \
+                                              longTailArea, longTailSlope, stepHeight);
             }
         }
     }
@@ -758,16 +1287,31 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
                 XRF::getMultilayerFluorescence(const std::vector<std::string> & elementFamilyLayer, \
                 const Elements & elementsLibrary, const int & secondary, \
                 const int & useGeometricEfficiency, const int & useMassFractions, \
-                const double & secondaryCalculationLimit)
+                const double & secondaryCalculationLimit, const int & detailLevel)
 {
     std::vector<std::string> elementList;
     std::vector<std::string> familyList;
     std::vector<int> layerList;
+
+    XRF::parseElementFamilyLayer(elementFamilyLayer, elementList, familyList, layerList);
+    return this->getMultilayerFluorescence(elementList, elementsLibrary, \
+                                           layerList, familyList, secondary, useGeometricEfficiency, \
+                                           useMassFractions, secondaryCalculationLimit, detailLevel);
+}
+
+void XRF::parseElementFamilyLayer(const std::vector<std::string> & elementFamilyLayer, \
+                                  std::vector<std::string> & elementList, \
+                                  std::vector<std::string> & familyList, \
+                                  std::vector<int> & layerList)
+{
     std::vector<std::string>::size_type i;
     int layerIndex;
     std::string tmpString;
     std::vector<std::string> tmpStringVector;
 
+    elementList.clear();
+    familyList.clear();
+    layerList.clear();
     elementList.resize(elementFamilyLayer.size());
     familyList.resize(elementFamilyLayer.size());
     layerList.resize(elementFamilyLayer.size());
@@ -784,7 +1328,6 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
             if (!SimpleIni::stringConverter(tmpStringVector[2], layerIndex))
             {
                 tmpString = "Unsuccessul conversion to layer integer: " + tmpStringVector[2];
-                std::cout << tmpString << std::cout;
                 throw std::invalid_argument(tmpString);
             }
             layerList[i] = layerIndex;
@@ -802,9 +1345,6 @@ std::map<std::string, std::map<int, std::map<std::string, std::map<std::string,
             layerList[i] = -1;
         }
     }
-    return this->getMultilayerFluorescence(elementList, elementsLibrary, \
-                                           layerList, familyList, secondary, useGeometricEfficiency, \
-                                           useMassFractions, secondaryCalculationLimit);
 }
 
 } // namespace fisx
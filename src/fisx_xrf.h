@@ -2,11 +2,22 @@
 #define FISX_XRF_H
 #include "fisx_xrfconfig.h"
 #include "fisx_elements.h"
+#include "fisx_stackresponse.h"
+#include "fisx_multilayerworkspace.h"
+#include "fisx_profile.h"
 #include <iostream>
 
 namespace fisx
 {
 
+/*!
+  \class XRF
+  \brief X-ray fluorescence of a sample under a given configuration
+
+   An instance keeps the configuration and the state of the last calculation, so it must not be
+   used by several threads at the same time. Several instances can share the same Elements
+   library concurrently (see XRFBatch).
+*/
 class XRF
 {
 
@@ -92,6 +103,15 @@ public:
     */
     void setDetector(const Detector & detector);
 
+    /*!
+    Add a detector with its own outgoing angle (alphaOut, in degrees) and attenuators looking at
+    the sample together with the one given by setDetector (see XRFConfig::addDetector).
+    Only getMultiDetectorFluorescence takes the additional detectors into account.
+    */
+    void addDetector(const Detector & detector, const double & alphaOut, \
+                     const std::vector<Layer> & attenuators = std::vector<Layer>());
+    void clearAdditionalDetectors();
+
 
     /*!
     Set the excitation geometry.
@@ -124,13 +144,39 @@ public:
     /*!
     Get the current configuration
     */
-    const XRFConfig & getConfiguration();
+    const XRFConfig & getConfiguration() const;
 
     /*!
     Set the configuration
     */
     void setConfiguration(const XRFConfig & configuration);
 
+    /*!
+    Compress the excitation beam before the fluorescence calculation (see getCompressedBeam).
+    The compressed beam is reused while neither the configuration nor the library change. A tolerance of 0
+    (the default) uses the configured beam as it is.
+    */
+    void setBeamCompression(const double & tolerance);
+    const double & getBeamCompression() const;
+
+    /*!
+    Heuristic estimate of the relative error of the compressed beam used by the last calculation.
+    It is the largest relative change of the weighted sums of the responses kept by the compression
+    (see getCompressedBeam), not a bound on the error of the fluorescence. These responses ignore
+    the attenuation of the fluorescence on its way out and the secondary excitation, and the
+    fluorescence can change several times more (for instance 7.4e-4 for an estimate of 2.0e-4).
+    */
+    const double & getBeamCompressionErrorEstimate() const;
+
+    /*!
+    Return a copy of the configured beam with fewer rays (see Beam::compress). The edges are those
+    of the elements of the beam filters, sample, attenuators and detector. The responses kept within
+    tolerance are the photoelectric absorption in each sample layer of every element of the sample,
+    including the attenuation of the beam filters and of the layers above it.
+    */
+    Beam getCompressedBeam(const Elements & elementsLibrary, const double & tolerance, \
+                           double & estimatedError) const;
+
     /*!
     Get the expected fluorescence emission coming from primary excitation per unit photon.
     It needs to be multiplied by the mass fraction and the total number of photons to get
@@ -153,7 +199,7 @@ public:
     void expectedScattering();
     void peakRatios();
     */
-    double getGeometricEfficiency(const int & layerIndex = 0) const;
+    double getGeometricEfficiency(const int & layerIndex = 0, const int & detectorIndex = 0) const;
 
     std::map<std::string, std::map<std::string, double> > getFluorescence(const std::string & element, \
                 const Elements & elementsLibrary, const int & sampleLayerIndex = 0, \
@@ -170,17 +216,22 @@ public:
     [Element Family][Layer][line]["efficiency"] - Detection efficiency
     [Element Family][Layer][line][element line layer] - Secondary rate (prior to correct for detection efficiency)
     due to the fluorescence from the given element, line and layer index composing the map key.
+
+    An empty lineFamily calculates all the excited K, L and M families of the element in a single pass.
+    Each family is reported under its own [Element Family] key.
     */
     std::map<std::string, std::map<int, std::map<std::string, std::map<std::string, double> > > > \
                 getMultilayerFluorescence(const std::string & element, \
                 const Elements & elementsLibrary, const int & sampleLayerIndex = 0, \
                 const std::string & lineFamily = "", const int & secondary = 0, \
                 const int & useGeometricEfficiency = 1, const int & useMassFractions = 0, \
-                const double & secondaryCalculationLimit = 0.0);
+                const double & secondaryCalculationLimit = 0.0, \
+                const int & detailLevel = 2);
     /*!
     Basis method called by all the other convenience methods.
     \param elementFamilyLayer - Vector of strings. Each string represents the information we are interested on.\n
-    "Cr"     - We want the information for Cr, for all line families and sample layers\n
+    "Cr"     - We want the information for Cr, for all line families and sample layers. The families are
+               calculated together and reported as "Cr K", "Cr L" and "Cr M".\n
     "Cr K"   - We want the information for Cr, for the family of K-shell emission lines, in all layers.\n
     "Cr K 0" - We want the information for Cr, for the family of K-shell emission lines, in layer 0.
     \param elementsLibrary - Instance of library to be used for all the Physical constants
@@ -195,6 +246,14 @@ public:
     has to multiply the rates by the actual mass fraction of the element on each sample layer.
                        If set to 1, the rate will be already corrected by the actual mass fraction.
 
+    \param secondaryCalculationLimit - Secondary sources weaker than this fraction of the incoming beam are skipped.
+
+    \param detailLevel - Amount of information to be returned for each line.\n
+                0 Only "energy", "rate", "efficiency" and "massFraction"\n
+                1 As 0 plus the "primary", "secondary" and "tertiary" totals, "mu_1_i" and "energy_threshold"\n
+                2 (default) As 1 plus the secondary contribution of each individual source. Building
+                those keys is expensive, so use a lower level if you do not need them.
+
     \return Return a complete output of the form:\n
     [Element Family][Layer][line]["energy"] - Energy in keV of the emission line\n
     [Element Family][Layer][line]["primary"] - Primary rate prior to correct for detection efficiency\n
@@ -210,7 +269,8 @@ public:
                 const Elements & elementsLibrary, const int & secondary = 0, \
                 const int & useGeometricEfficiency = 1, \
                 const int & useMassFractions = 0, \
-                const double & secondaryCalculationLimit = 0.0);
+                const double & secondaryCalculationLimit = 0.0, \
+                const int & detailLevel = 2);
 
     std::map<std::string, std::map<int, std::map<std::string, std::map<std::string, double> > > > \
                 getMultilayerFluorescence(const std::vector<std::string> & elementList,
@@ -220,12 +280,93 @@ public:
                                           const int & secondary = 0, \
                                           const int & useGeometricEfficiency = 1, \
                                           const int & useMassFractions = 0, \
-                                          const double & secondaryCalculationLimit = 0.0);
+                                          const double & secondaryCalculationLimit = 0.0, \
+                                          const int & detailLevel = 2);
 
+    /*!
+    Same as above using the supplied workspace for the temporary buffers. Keeping the workspace
+    between calls avoids allocating them again on every call.
+    */
+    std::map<std::string, std::map<int, std::map<std::string, std::map<std::string, double> > > > \
+                getMultilayerFluorescence(const std::vector<std::string> & elementList,
+                                          const Elements & elementsLibrary, \
+                                          const std::vector<int> & layerList, \
+                                          const std::vector<std::string> &  familyList, \
+                                          MultilayerWorkspace & workspace, \
+                                          const int & secondary = 0, \
+                                          const int & useGeometricEfficiency = 1, \
+                                          const int & useMassFractions = 0, \
+                                          const double & secondaryCalculationLimit = 0.0, \
+                                          const int & detailLevel = 2);
+
+    /*!
+    Same as getMultilayerFluorescence(elementFamilyLayer, ...) for every detector of the configuration
+    (see addDetector), returning one output per detector. Detector 0 is the one given by setDetector.
+    The beam filters, the attenuation of the incident beam, the excitation factors and the secondary
+    sources are evaluated once. Only the terms depending on the outgoing path, the attenuators and
+    the detector are evaluated for each detector.
+    */
+    std::vector<std::map<std::string, std::map<int, std::map<std::string, std::map<std::string, double> > > > > \
+                getMultiDetectorFluorescence(const std::vector<std::string> & elementFamilyLayer, \
+                const Elements & elementsLibrary, const int & secondary = 0, \
+                const int & useGeometricEfficiency = 1, \
+                const int & useMassFractions = 0, \
+                const double & secondaryCalculationLimit = 0.0, \
+                const int & detailLevel = 2);
 
+    /*!
+    Split strings of the form "Cr", "Cr K" or "Cr K 0" into the element, family and layer lists
+    expected by getMultilayerFluorescence. Missing families are set to "" and missing layers to -1.
+    */
+    static void parseElementFamilyLayer(const std::vector<std::string> & elementFamilyLayer, \
+                                        std::vector<std::string> & elementList, \
+                                        std::vector<std::string> & familyList, \
+                                        std::vector<int> & layerList);
+
+
+    /*!
+    Energy above which the given family (K, L, M or a subshell) of the element is excited.
+    An empty family gives the lowest threshold of the K, L and M families.
+    */
     double getEnergyThreshold(const std::string & elementName, const std::string & family, \
                                 const Elements & elementsLibrary) const;
 
+    /*!
+    Tabulate the beam filters transmission and the detection efficiency (attenuators and detector)
+    of the current configuration between minimumEnergy and maximumEnergy (in keV).
+    The returned instance can be kept as long as the configuration and the library do not change.
+    */
+    StackResponse getStackResponse(const Elements & elementsLibrary, \
+                                   const double & minimumEnergy = 1.0, \
+                                   const double & maximumEnergy = 100.0, \
+                                   const int & pointsPerDecade = 500) const;
+
+    /*!
+    Fluorescence of a sample layer as function of the incident energy.
+
+    The configured beam is replaced by one ray of unit weight at each of the supplied energies.
+    The emitted line energies, their attenuation and their detection efficiency do not depend on
+    the incident energy and are evaluated only once. The energies are evaluated in parallel when
+    the library is compiled with OpenMP support.
+
+    \param energies - Incident energies in keV
+    \param elementFamilyList - Peak families of interest in the form "Fe K"
+    \param elementsLibrary - Instance of library to be used for all the Physical constants
+    \param layerIndex - Sample layer emitting the fluorescence
+    \param secondary - 0 Only primary excitation, 1 Include intralayer secondary excitation.
+                       Other values throw std::invalid_argument.
+    \param useGeometricEfficiency - Take into account solid angle or not. Default is 1 (yes)
+    \return Map of the form [Element Family] -> rate at each incident energy. The rates take into
+    account the mass fraction of the element in the layer. Interlayer secondary excitation is
+    not included and a warning is logged when the sample has other layers.
+    */
+    std::map<std::string, std::vector<double> > getFluorescenceScan(const std::vector<double> & energies, \
+                                          const std::vector<std::string> & elementFamilyList, \
+                                          const Elements & elementsLibrary, \
+                                          const int & layerIndex = 0, \
+                                          const int & secondary = 1, \
+                                          const int & useGeometricEfficiency = 1) const;
+
 
     /*!
     Return the expected fluorescent spectrum per unit photon
@@ -241,7 +382,20 @@ public:
     QuantumEnergy : Average energy (in keV) to create a "signal quantum" (an electron-hole pair in Si)
                     In scintillator detectors is ~100 eV and in gas detectors ~30 eV.
 
-    If any of those keys is not present, the associated value will be taken from the configuration.
+    If any of those keys is not present, the values Zero = 0.0, Gain = 1.0, Noise = 0.1, Fano = 0.114
+    and QuantumEnergy = 0.00385 are used.
+
+    The pile-up peaks are added when detectorParameters also contains:
+
+    CountRate : Input count rate of the detector in counts per second
+    PileUpTime : Pulse pair resolving time in seconds, of the order of the shaping time
+    PileUpOrder : 1 for two photons detected as one, 2 to include three photons (default)
+
+    With x = CountRate * PileUpTime and S the spectrum of area A, the first order term is
+    x * (S * S) / A and the second order term x^2 * (S * S * S) / (2 A^2), where * stands for the
+    convolution in energy. The convolutions are evaluated by FFT on a grid of Gain keV starting
+    at 0 keV, so the cost grows as N log(N) with the number of channels. The peaks are not
+    depleted by the pile-up: the loss of counts is part of the dead time correction.
 
     shapeParameters is a map that may contain the following keys:
 
@@ -264,6 +418,16 @@ public:
 
     Obviously both types of keys should not be used for the same element and family.
 
+    Return a map with the keys:
+
+    channel : The channels
+    energy : Their energies
+    spectrum : The total spectrum, pile-up included
+    pileup : The pile-up contribution
+
+    and, for each key of peakFamilyArea, the contribution of its peaks and under the same key
+    followed by " pileup" its pile-up contribution. The pile-up contributions of the families add
+    up to the total pile-up, the events mixing several families being shared among them.
     */
     std::map<std::string, std::vector<double> > getSpectrum(const std::vector<double> & channel, \
                 const std::map<std::string, double> & detectorParameters = (std::map<std::string, double> ()), \
@@ -272,7 +436,8 @@ public:
                 const expectedLayerEmissionType & emissionRatios = (expectedLayerEmissionType())) const;
 
     /*!
-    Alternative method in a more traditional way.
+    Alternative method in a more traditional way. The energies of the channels are written into
+    energy and the total spectrum, pile-up included, into spectrum.
     */
     void getSpectrum(double * channel, double * energy, double *spectrum, int nChannels, \
                 const std::map<std::string, double> & detectorParameters = (std::map<std::string, double> ()), \
@@ -280,6 +445,12 @@ public:
                 const std::map<std::string, double> & peakFamilyArea = (std::map<std::string, double> ()), \
                 const expectedLayerEmissionType & emissionRatios = (expectedLayerEmissionType())) const;
 
+    /*!
+    Phase timings and operation counters of the last getMultilayerFluorescence call.
+    Only filled when the library is compiled with FISX_PROFILE defined.
+    */
+    const Profile & getProfile() const;
+
 private:
     /*!
     Reference to elements library to be used for calculations
@@ -294,7 +465,62 @@ private:
     */
     bool recentBeam;
 
+    /*!
+    Beam used by the calculation, the configured one or its compressed version
+    */
+    const Beam & getExcitationBeam(const Elements & elementsLibrary);
+
+    /*!
+    Implementation of getMultilayerFluorescence for the first nDetectors detectors of the
+    configuration, one output per detector.
+    */
+    void calculateMultilayerFluorescence(const std::vector<std::string> & elementList, \
+                const Elements & elementsLibrary, \
+                const std::vector<int> & layerList, \
+                const std::vector<std::string> & familyList, \
+                MultilayerWorkspace & workspace, \
+                const int & nDetectors, \
+                const int & secondary, \
+                const int & useGeometricEfficiency, \
+                const int & useMassFractions, \
+                const double & secondaryCalculationLimit, \
+                const int & detailLevel, \
+                std::vector<expectedLayerEmissionType> & results);
+
+    /*!
+    Peaks of each key of peakFamilyArea and their pile-up, either per key or the total one
+    */
+    void getSpectrumContributions(const double * channel, double * energy, const int & nChannels, \
+                const std::map<std::string, double> & detectorParameters, \
+                const std::map<std::string, double> & shapeParameters, \
+                const std::map<std::string, double> & peakFamilyArea, \
+                const expectedLayerEmissionType & emissionRatios, \
+                const int & separatePileUp, \
+                std::vector<std::vector<double> > & peaks, \
+                std::vector<std::vector<double> > & pileUp) const;
+
+    /*!
+    Add the peaks of a peak family to spectrum and update the highest energy they reach
+    */
+    void addPeakFamilySpectrum(const std::string & peakFamily, const double & peakFamilyArea, \
+                const expectedLayerEmissionType & emissionRatios, \
+                const double * energy, const int & nEnergies, \
+                const double & noise, const double & fano, const double & quantum, \
+                double * spectrum, double & highestEnergy) const;
+    double beamCompressionTolerance;
+    double beamCompressionError;
+    Beam compressedBeam;
+
+    /*!
+    Library and library revision used to obtain the compressed beam. The configuration setters
+    set the library to NULL to force a new compression.
+    */
+    const Elements * compressedBeamLibrary;
+    unsigned long compressedBeamRevision;
+
     expectedLayerEmissionType lastMultilayerFluorescence;
+
+    Profile profile;
 };
 
 } // namespace fisx
@@ -0,0 +1,164 @@
+#include "fisx_xrfbatch.h"
+#include "fisx_xrf.h"
+#include "fisx_multilayerworkspace.h"
+#include <stdexcept>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace fisx
+{
+
+XRFBatch::XRFBatch()
+{
+}
+
+int XRFBatch::addItem(const XRFConfig & configuration, \
+                      const std::vector<std::string> & elementFamilyLayer, \
+                      const int & secondary, \
+                      const int & useGeometricEfficiency, \
+                      const int & useMassFractions, \
+                      const double & secondaryCalculationLimit, \
+                      const int & detailLevel)
+{
+    Item item;
+
+    // parse now to report syntax errors to the caller and not from a worker thread
+    XRF::parseElementFamilyLayer(elementFamilyLayer, item.elementList, item.familyList, item.layerList);
+    item.configuration = configuration;
+    item.secondary = secondary;
+    item.useGeometricEfficiency = useGeometricEfficiency;
+    item.useMassFractions = useMassFractions;
+    item.secondaryCalculationLimit = secondaryCalculationLimit;
+    item.detailLevel = detailLevel;
+    item.status = PENDING;
+    this->items.push_back(item);
+    return (int) (this->items.size() - 1);
+}
+
+int XRFBatch::getNumberOfItems() const
+{
+    return (int) this->items.size();
+}
+
+void XRFBatch::clear()
+{
+    this->items.clear();
+    this->completionOrder.clear();
+}
+
+void XRFBatch::run(const Elements & elementsLibrary, \
+                   Callback callback, \
+                   void * userData, \
+                   const int & nThreads)
+{
+    std::vector<int> pending;
+    std::vector<Item>::size_type i;
+    int nPending;
+    int iPending;
+
+    for (i = 0; i < this->items.size(); i++)
+    {
+        if (this->items[i].status == PENDING)
+        {
+            pending.push_back((int) i);
+        }
+    }
+    this->completionOrder.clear();
+    nPending = (int) pending.size();
+    if (nPending < 1)
+    {
+        return;
+    }
+
+#ifdef _OPENMP
+    int actualThreads;
+    actualThreads = (nThreads > 0) ? nThreads : omp_get_max_threads();
+    if (actualThreads > nPending)
+    {
+        actualThreads = nPending;
+    }
+    #pragma omp parallel num_threads(actualThreads) private(iPending)
+#else
+    (void) nThreads;
+#endif
+    {
+        XRF xrf;
+        MultilayerWorkspace workspace;
+#ifdef _OPENMP
+        #pragma omp for schedule(dynamic, 1)
+#endif
+        for (iPending = 0; iPending < nPending; iPending++)
+        {
+            Item & item = this->items[pending[iPending]];
+            try
+            {
+                xrf.setConfiguration(item.configuration);
+                item.result = xrf.getMultilayerFluorescence(item.elementList, elementsLibrary, \
+                                                            item.layerList, item.familyList, workspace, \
+                                                            item.secondary, item.useGeometricEfficiency, \
+                                                            item.useMassFractions, \
+                                                            item.secondaryCalculationLimit, \
+                                                            item.detailLevel);
+                item.status = DONE;
+            }
+            catch (const std::exception & exc)
+            {
+                item.result.clear();
+                item.error = exc.what();
+                item.status = FAILED;
+            }
+#ifdef _OPENMP
+            #pragma omp critical(fisx_xrfbatch)
+#endif
+            {
+                this->completionOrder.push_back(pending[iPending]);
+                if (callback != NULL)
+                {
+                    callback(pending[iPending], item.status, item.result, item.error, userData);
+                }
+            }
+        }
+    }
+}
+
+void XRFBatch::checkIndex(const int & index) const
+{
+    if ((index < 0) || (index >= (int) this->items.size()))
+    {
+        throw std::invalid_argument("XRFBatch. Invalid item index");
+    }
+}
+
+int XRFBatch::getStatus(const int & index) const
+{
+    this->checkIndex(index);
+    return this->items[index].status;
+}
+
+const XRFBatch::Result & XRFBatch::getResult(const int & index) const
+{
+    this->checkIndex(index);
+    if (this->items[index].status == FAILED)
+    {
+        throw std::runtime_error("XRFBatch. Item failed: " + this->items[index].error);
+    }
+    if (this->items[index].status != DONE)
+    {
+        throw std::runtime_error("XRFBatch. Item not evaluated yet");
+    }
+    return this->items[index].result;
+}
+
+const std::string & XRFBatch::getError(const int & index) const
+{
+    this->checkIndex(index);
+    return this->items[index].error;
+}
+
+const std::vector<int> & XRFBatch::getCompletionOrder() const
+{
+    return this->completionOrder;
+}
+
+} // namespace fisx
@@ -0,0 +1,138 @@
+#ifndef FISX_XRFBATCH_H
+#define FISX_XRFBATCH_H
+#include <string>
+#include <vector>
+#include <map>
+#include "fisx_xrfconfig.h"
+#include "fisx_elements.h"
+
+namespace fisx
+{
+
+/*!
+  \class XRFBatch
+  \brief Evaluation of many independent configurations sharing one library
+
+   Each item of the batch is a configuration together with the peak families and the options
+   to be passed to XRF::getMultilayerFluorescence. All the items are evaluated against the same
+   read-only Elements instance.
+
+   When the library is compiled with OpenMP, the items are distributed dynamically among the
+   threads as they become idle, so that an expensive item does not delay the others. Each thread
+   reuses its own XRF instance and MultilayerWorkspace for all the items it evaluates.
+
+   The result or the error of each item is kept in the batch. An optional callback is invoked as
+   soon as each item is finished, so that the results can be consumed while the rest of the batch
+   is still running.
+*/
+class XRFBatch
+{
+public:
+    typedef std::map<std::string, std::map<int, std::map<std::string, std::map<std::string, double> > > > \
+            Result;
+
+    enum Status
+    {
+        PENDING = 0,
+        DONE,
+        FAILED
+    };
+
+    /*!
+    Signature of the completion callback. It receives the index of the finished item, its status
+    (DONE or FAILED), its result (empty if it failed), its error message (empty if it succeeded)
+    and the user data pointer given to run.
+    It is called from the thread that evaluated the item, but never concurrently. It must not throw.
+    The batch itself is not passed because other items are still being written while it runs.
+    */
+    typedef void (*Callback)(const int & index, \
+                             const int & status, \
+                             const Result & result, \
+                             const std::string & error, \
+                             void * userData);
+
+    XRFBatch();
+
+    /*!
+    Add an item to the batch and return its index.
+    \param configuration - Beam, beam filters, sample, attenuators, detector and geometry to be used.
+    \param elementFamilyLayer - Information requested in the form "Cr", "Cr K" or "Cr K 0"
+    The rest of parameters have the meaning described in XRF::getMultilayerFluorescence.
+    */
+    int addItem(const XRFConfig & configuration, \
+                const std::vector<std::string> & elementFamilyLayer, \
+                const int & secondary = 0, \
+                const int & useGeometricEfficiency = 1, \
+                const int & useMassFractions = 0, \
+                const double & secondaryCalculationLimit = 0.0, \
+                const int & detailLevel = 2);
+
+    int getNumberOfItems() const;
+
+    /*!
+    Remove all the items and their results.
+    */
+    void clear();
+
+    /*!
+    Evaluate all the pending items.
+    \param elementsLibrary - Instance of library to be used for all the Physical constants.
+    It is not modified and it must not be modified by other threads while the batch is running.
+    \param callback - Optional function to be called when each item is finished.
+    \param userData - Pointer passed unchanged to the callback.
+    \param nThreads - Number of threads to be used. Zero or negative uses the OpenMP default.
+    Ignored if the library is compiled without OpenMP.
+
+    The failure of an item does not stop the batch. It is reported by getStatus and getError.
+    */
+    void run(const Elements & elementsLibrary, \
+             Callback callback = NULL, \
+             void * userData = NULL, \
+             const int & nThreads = 0);
+
+    /*!
+    PENDING, DONE or FAILED
+    */
+    int getStatus(const int & index) const;
+
+    /*!
+    Result of a finished item in the format returned by XRF::getMultilayerFluorescence.
+    */
+    const Result & getResult(const int & index) const;
+
+    /*!
+    Error message of a failed item.
+    */
+    const std::string & getError(const int & index) const;
+
+    /*!
+    Indices of the items in the order they were finished during the last run.
+    */
+    const std::vector<int> & getCompletionOrder() const;
+
+private:
+    struct Item
+    {
+        XRFConfig configuration;
+        std::vector<std::string> elementList;
+        std::vector<std::string> familyList;
+        std::vector<int> layerList;
+        int secondary;
+        int useGeometricEfficiency;
+        int useMassFractions;
+        double secondaryCalculationLimit;
+        int detailLevel;
+        int status;
+        Result result;
+        std::string error;
+    };
+
+    void checkIndex(const int & index) const;
+
+    std::vector<Item> items;
+    std::vector<int> completionOrder;
+};
+
+} // namespace fisx
+
+#endif // FISX_XRFBATCH_H
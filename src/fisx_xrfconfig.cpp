@@ -1,14 +1,47 @@
 #include "fisx_xrfconfig.h"
 #include "fisx_simpleini.h"
+#include "fisx_logger.h"
 #include <stdexcept>
-#include <iostream>
 #include <algorithm>
+#include <fstream>
+#include <stdio.h>
 
 namespace fisx
 {
 
+const std::string XRFCONFIG_SNAPSHOT_TAG = "fisx XRFConfig";
+const int XRFCONFIG_SNAPSHOT_VERSION = 2;
+
+template<typename T>
+static void writeObjects(BinaryWriter & writer, const std::vector<T> & objects)
+{
+    typename std::vector<T>::size_type i;
+
+    writer.write((int) objects.size());
+    for (i = 0; i < objects.size(); i++)
+    {
+        objects[i].writeBinary(writer);
+    }
+}
+
+template<typename T>
+static void readObjects(BinaryReader & reader, std::vector<T> & objects)
+{
+    int i, n;
+    T object;
+
+    reader.read(n);
+    objects.clear();
+    for (i = 0; i < n; i++)
+    {
+        object.readBinary(reader);
+        objects.push_back(object);
+    }
+}
+
 XRFConfig::XRFConfig()
 {
+    this->referenceLayer = 0;
     this->setGeometry(45.0, 45.0, 90.);
 }
 
@@ -21,7 +54,7 @@ void XRFConfig::setGeometry(const double & alphaIn, const double & alphaOut, con
 
 void XRFConfig::readConfigurationFromFile(const std::string & fileName)
 {
-    SimpleIni iniFile = SimpleIni(fileName);
+    SimpleIni iniFile;
     std::map<std::string, std::string> sectionContents;
     std::string key;
     std::string content;
@@ -43,6 +76,12 @@ void XRFConfig::readConfigurationFromFile(const std::string & fileName)
     bool multilayerSample;
     double value;
 
+    if (this->readSnapshotFile(fileName))
+    {
+        return;
+    }
+    iniFile.readFileName(fileName);
+
     // find out if it is a fix or a PyMca configuration file
     sectionContents.clear();
     sectionContents = iniFile.readSection("fisx", false);
@@ -73,7 +112,7 @@ void XRFConfig::readConfigurationFromFile(const std::string & fileName)
         {
             throw std::invalid_argument("File not recognized as a fisx or PyMca configuration file.");
         }
-        std::cout << "fit result file" << std::endl;
+        FISX_LOG_DEBUG("XRFConfig::readConfigurationFromFile", "fit result file");
     }
     else
     {
@@ -131,8 +170,8 @@ void XRFConfig::readConfigurationFromFile(const std::string & fileName)
             }
             if(intVector[iIntVector] < 0)
             {
-                std::cout << "WARNING: " << "Negative characteristic flag. ";
-                std::cout << "Assuming not a characteristic photon energy." << std::endl;
+                FISX_LOG_WARNING("XRFConfig::readConfigurationFromFile", "Negative characteristic flag. " \
+                                 "Assuming not a characteristic photon energy.");
                 intVector[iIntVector] = 0;
             }
             counter++;
@@ -214,6 +253,7 @@ void XRFConfig::readConfigurationFromFile(const std::string & fileName)
     this->attenuators.clear();
     this->sample.clear();
     this->detector = Detector();
+    this->clearAdditionalDetectors();
     multilayerSample = false;
     for (c_it = sectionContents.begin(); c_it != sectionContents.end(); ++c_it)
     {
@@ -223,8 +263,8 @@ void XRFConfig::readConfigurationFromFile(const std::string & fileName)
         iniFile.parseStringAsMultipleValues(content, stringVector, std::string());
         if (doubleVector.size() == 0.0)
         {
-            std::cout << "WARNING: Empty line in attenuators section. Offending key is: "<< std::endl;
-            std::cout << "<" << c_it->first << ">" << std::endl;
+            FISX_LOG_WARNING("XRFConfig::readConfigurationFromFile", \
+                             "Empty line in attenuators section. Offending key is: <" << c_it->first << ">");
             continue;
         }
         if (doubleVector[0] > 0.0)
@@ -328,8 +368,8 @@ void XRFConfig::readConfigurationFromFile(const std::string & fileName)
             iniFile.parseStringAsMultipleValues(content, stringVector, std::string());
             if (doubleVector.size() == 0.0)
             {
-                std::cout << "WARNING: Empty line in multilayer section. Offending key is: "<< std::endl;
-                std::cout << "<" << c_it->first << ">" << std::endl;
+                FISX_LOG_WARNING("XRFConfig::readConfigurationFromFile", \
+                                 "Empty line in multilayer section. Offending key is: <" << c_it->first << ">");
                 continue;
             }
             if (doubleVector[0] > 0.0)
@@ -386,7 +426,7 @@ void XRFConfig::setBeam(const Beam & beam)
     this->beam = beam;
 }
 
-const Beam & XRFConfig::getBeam()
+const Beam & XRFConfig::getBeam() const
 {
     return this->beam;
 }
@@ -417,6 +457,218 @@ void XRFConfig::setDetector(const Detector & detector)
     this->detector = detector;
 }
 
+void XRFConfig::addDetector(const Detector & detector, const double & alphaOut, \
+                            const std::vector<Layer> & attenuators)
+{
+    if ((alphaOut <= 0.0) || (alphaOut > 180.0))
+    {
+        throw std::invalid_argument("XRFConfig::addDetector. Outgoing angle must be in (0, 180] degrees");
+    }
+    this->additionalDetectors.push_back(detector);
+    this->additionalAlphaOut.push_back(alphaOut);
+    this->additionalAttenuators.push_back(attenuators);
+}
+
+void XRFConfig::clearAdditionalDetectors()
+{
+    this->additionalDetectors.clear();
+    this->additionalAlphaOut.clear();
+    this->additionalAttenuators.clear();
+}
+
+int XRFConfig::getNumberOfDetectors() const
+{
+    return 1 + (int) this->additionalDetectors.size();
+}
+
+const Detector & XRFConfig::getDetector(const int & index) const
+{
+    if ((index < 0) || (index >= this->getNumberOfDetectors()))
+    {
+        throw std::invalid_argument("XRFConfig::getDetector. Invalid detector index");
+    }
+    if (index == 0)
+    {
+        return this->detector;
+    }
+    return this->additionalDetectors[index - 1];
+}
+
+const double & XRFConfig::getAlphaOut(const int & index) const
+{
+    if ((index < 0) || (index >= this->getNumberOfDetectors()))
+    {
+        throw std::invalid_argument("XRFConfig::getAlphaOut. Invalid detector index");
+    }
+    if (index == 0)
+    {
+        return this->alphaOut;
+    }
+    return this->additionalAlphaOut[index - 1];
+}
+
+const std::vector<Layer> & XRFConfig::getAttenuators(const int & index) const
+{
+    if ((index < 0) || (index >= this->getNumberOfDetectors()))
+    {
+        throw std::invalid_argument("XRFConfig::getAttenuators. Invalid detector index");
+    }
+    if (index == 0)
+    {
+        return this->attenuators;
+    }
+    return this->additionalAttenuators[index - 1];
+}
+
+void XRFConfig::getSnapshot(std::vector<char> & buffer) const
+{
+    BinaryWriter writer(buffer);
+    std::vector<Detector>::size_type i;
+
+    buffer.clear();
+    writer.writeHeader(XRFCONFIG_SNAPSHOT_TAG, XRFCONFIG_SNAPSHOT_VERSION);
+    this->beam.writeBinary(writer);
+    writeObjects(writer, this->materials);
+    writeObjects(writer, this->beamFilters);
+    writeObjects(writer, this->sample);
+    writeObjects(writer, this->attenuators);
+    writer.write(this->referenceLayer);
+    writer.write(this->alphaIn);
+    writer.write(this->alphaOut);
+    writer.write(this->scatteringAngle);
+    this->detector.writeBinary(writer);
+    writeObjects(writer, this->additionalDetectors);
+    for (i = 0; i < this->additionalDetectors.size(); i++)
+    {
+        writer.write(this->additionalAlphaOut[i]);
+        writeObjects(writer, this->additionalAttenuators[i]);
+    }
+}
+
+void XRFConfig::setSnapshot(const char * buffer, const std::size_t & size)
+{
+    BinaryReader reader(buffer, size);
+    XRFConfig configuration;
+    std::vector<Detector>::size_type i;
+    int version;
+
+    // version 1 snapshots have no additional detectors
+    version = reader.readHeader(XRFCONFIG_SNAPSHOT_TAG);
+    if ((version < 1) || (version > XRFCONFIG_SNAPSHOT_VERSION))
+    {
+        throw std::runtime_error("XRFConfig::setSnapshot. Unsupported snapshot version");
+    }
+    // decode everything before touching the instance
+    configuration.beam.readBinary(reader);
+    readObjects(reader, configuration.materials);
+    readObjects(reader, configuration.beamFilters);
+    readObjects(reader, configuration.sample);
+    readObjects(reader, configuration.attenuators);
+    reader.read(configuration.referenceLayer);
+    reader.read(configuration.alphaIn);
+    reader.read(configuration.alphaOut);
+    reader.read(configuration.scatteringAngle);
+    configuration.detector.readBinary(reader);
+    if (version > 1)
+    {
+        readObjects(reader, configuration.additionalDetectors);
+        configuration.additionalAlphaOut.resize(configuration.additionalDetectors.size());
+        configuration.additionalAttenuators.resize(configuration.additionalDetectors.size());
+        for (i = 0; i < configuration.additionalDetectors.size(); i++)
+        {
+            reader.read(configuration.additionalAlphaOut[i]);
+            readObjects(reader, configuration.additionalAttenuators[i]);
+        }
+    }
+    if (reader.getRemainingSize() != 0)
+    {
+        throw std::runtime_error("XRFConfig::setSnapshot. Unexpected data at the end of the buffer");
+    }
+    *this = configuration;
+}
+
+std::string XRFConfig::getHash() const
+{
+    std::vector<char> buffer;
+    std::vector<char>::size_type i;
+    // 64 bit FNV-1a computed on 16 bit limbs to stay within standard integer types
+    unsigned long h[4] = {0x2325, 0x8422, 0x9ce4, 0xcbf2};
+    unsigned long r[4];
+    int k;
+    char text[17];
+
+    this->getSnapshot(buffer);
+    for (i = 0; i < buffer.size(); i++)
+    {
+        h[0] ^= (unsigned char) buffer[i];
+        // multiply by the prime 0x100000001b3 = 2^40 + 0x1b3
+        r[0] = h[0] * 0x1b3;
+        r[1] = h[1] * 0x1b3;
+        r[2] = h[2] * 0x1b3 + (h[0] << 8);
+        r[3] = h[3] * 0x1b3 + (h[1] << 8);
+        for (k = 0; k < 3; k++)
+        {
+            r[k + 1] += r[k] >> 16;
+            h[k] = r[k] & 0xffff;
+        }
+        h[3] = r[3] & 0xffff;
+    }
+    sprintf(text, "%04lx%04lx%04lx%04lx", h[3], h[2], h[1], h[0]);
+    return std::string(text);
+}
+
+void XRFConfig::saveConfigurationToFile(const std::string & fileName) const
+{
+    std::vector<char> buffer;
+    std::ofstream outputFile;
+
+    this->getSnapshot(buffer);
+    outputFile.open(fileName.c_str(), std::ios::out | std::ios::binary);
+    if (!outputFile.is_open())
+    {
+        throw std::ios_base::failure("Cannot open file " + fileName);
+    }
+    outputFile.write(&buffer[0], buffer.size());
+    outputFile.close();
+    if (outputFile.fail())
+    {
+        throw std::ios_base::failure("Error writing file " + fileName);
+    }
+}
+
+bool XRFConfig::readSnapshotFile(const std::string & fileName)
+{
+    std::vector<char> buffer;
+    std::ifstream inputFile;
+    std::streamoff size;
+
+    inputFile.open(fileName.c_str(), std::ios::in | std::ios::binary);
+    if (!inputFile.is_open())
+    {
+        return false;
+    }
+    // only the header is needed to recognize the format
+    buffer.resize(sizeof(int) + XRFCONFIG_SNAPSHOT_TAG.size());
+    inputFile.read(&buffer[0], buffer.size());
+    if ((inputFile.gcount() != (std::streamsize) buffer.size()) || \
+        (!BinaryReader(&buffer[0], buffer.size()).checkTag(XRFCONFIG_SNAPSHOT_TAG)))
+    {
+        return false;
+    }
+    inputFile.clear();
+    inputFile.seekg(0, std::ios::end);
+    size = inputFile.tellg();
+    inputFile.seekg(0, std::ios::beg);
+    buffer.resize((std::size_t) size);
+    inputFile.read(&buffer[0], size);
+    if (inputFile.gcount() != size)
+    {
+        throw std::ios_base::failure("Error reading file " + fileName);
+    }
+    this->setSnapshot(&buffer[0], buffer.size());
+    return true;
+}
+
 std::ostream& operator<< (std::ostream& o, XRFConfig const& config)
 {
     std::vector<Layer>::size_type i;
@@ -443,6 +695,13 @@ std::ostream& operator<< (std::ostream& o, XRFConfig const& config)
     o << "GEOMETRY" << std::endl;
     o << "Alpha In(deg): "<< config.getAlphaIn() << std::endl;
     o << "Alpha In(deg): "<< config.getAlphaOut() << std::endl;
+    for(i = 0; i < config.additionalDetectors.size(); i++)
+    {
+        o << "ADDITIONAL DETECTOR " << i + 1 << std::endl;
+        o << config.additionalDetectors[i] << std::endl;
+        o << "Alpha Out(deg): "<< config.additionalAlphaOut[i] << std::endl;
+        o << "Number of attenuators: " << config.additionalAttenuators[i].size() << std::endl;
+    }
     return o;
 }
 
@@ -14,8 +14,33 @@ public:
 
     friend std::ostream& operator<< (std::ostream& o, XRFConfig const & config);
 
+    /*!
+    Read the configuration from a PyMca fit configuration file or from a file written by
+    saveConfigurationToFile. The format is recognized from the file contents.
+    */
     void readConfigurationFromFile(const std::string & fileName);
-    void saveConfigurationToFile(const std::string & fileName);
+
+    /*!
+    Write the configuration to a binary file (see getSnapshot).
+    */
+    void saveConfigurationToFile(const std::string & fileName) const;
+
+    /*!
+    Serialize the configuration into a flat buffer: beam, beam filters, sample, attenuators,
+    detector, geometry, additional detectors and the materials defined in the configuration file.
+    Reading it back with setSnapshot gives an identical configuration without any text parsing.
+    The buffer is written in native byte order and it can only be read on a platform with the
+    same byte order and double size.
+    */
+    void getSnapshot(std::vector<char> & buffer) const;
+    void setSnapshot(const char * buffer, const std::size_t & size);
+
+    /*!
+    Hash of the configuration contents as 16 hexadecimal characters (64 bit FNV-1a of the snapshot).
+    Identical configurations give the same hash in any process running on the same platform,
+    so it can be used as a cache key.
+    */
+    std::string getHash() const;
 
     /*!
     Set the excitation beam
@@ -83,6 +108,25 @@ public:
     */
     void setDetector(const Detector & detector);
 
+    /*!
+    Add a detector looking at the sample at the same time as the one set with setDetector.
+    Each additional detector has its own outgoing angle (alphaOut, in degrees) and its own
+    attenuators. The detector set with setDetector, alphaOut and the attenuators given by
+    setAttenuators is always detector 0.
+    */
+    void addDetector(const Detector & detector, const double & alphaOut, \
+                     const std::vector<Layer> & attenuators = std::vector<Layer>());
+
+    /*!
+    Remove all the detectors added with addDetector.
+    */
+    void clearAdditionalDetectors();
+
+    /*!
+    Number of detectors, including detector 0.
+    */
+    int getNumberOfDetectors() const;
+
     /*!
     Methods coordinating all the calculation
     */
@@ -96,7 +140,7 @@ public:
     /*!
     Returns a constant reference to the internal beam.
     */
-   const Beam & getBeam();
+   const Beam & getBeam() const;
    const std::vector<Layer> & getBeamFilters() const {return this->beamFilters;};
    const std::vector<Layer> & getSample() const {return this->sample;};
    const std::vector<Layer> & getAttenuators() const {return this->attenuators;};
@@ -106,7 +150,16 @@ public:
    const double & getScatteringAngle() const {return this->scatteringAngle;};
    const int & getReferenceLayer() const {return this->referenceLayer;};
 
+    /*!
+    Detector, outgoing angle and attenuators of the given detector index. Index 0 corresponds to
+    the values returned by the methods above.
+    */
+   const Detector & getDetector(const int & index) const;
+   const double & getAlphaOut(const int & index) const;
+   const std::vector<Layer> & getAttenuators(const int & index) const;
+
 private:
+    bool readSnapshotFile(const std::string & fileName);
     Beam beam;
     std::vector<Material> materials;
     std::vector<Layer> beamFilters;
@@ -118,6 +171,10 @@ private:
     double  scatteringAngle;
     // for the time being the detector is just other layer
     Detector detector;
+    // detectors added with addDetector
+    std::vector<Detector> additionalDetectors;
+    std::vector<double> additionalAlphaOut;
+    std::vector<std::vector<Layer> > additionalAttenuators;
     //collimators Not implemented;
 
 